@@ -86,9 +86,14 @@ LOCAL_SRC_FILES := \
 	audio_hw.c \
 	voice.c \
 	platform_info.c \
+	name_index.c \
+	kv_parms.c \
+	period_tuner.c \
 	audio_extn/ext_speaker.c \
 	audio_extn/audio_extn.c \
 	audio_extn/utils.c \
+	audio_extn/pcm_kernels.c \
+	audio_extn/latency_histogram.c \
 	$(AUDIO_PLATFORM)/platform.c \
         acdb.c
 
@@ -198,6 +203,11 @@ ifeq ($(strip $(AUDIO_FEATURE_ENABLED_SND_MONITOR)), true)
     LOCAL_SRC_FILES += audio_extn/sndmonitor.c
 endif
 
+ifeq ($(strip $(AUDIO_FEATURE_ENABLED_ASYNC_PCM)), true)
+    LOCAL_CFLAGS += -DASYNC_PCM_ENABLED
+    LOCAL_SRC_FILES += audio_extn/async_pcm.c
+endif
+
 ifeq ($(strip $(AUDIO_FEATURE_ENABLED_USB_SERVICE_INTERVAL)), true)
     LOCAL_CFLAGS += -DUSB_SERVICE_INTERVAL_ENABLED
 endif
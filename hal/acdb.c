@@ -142,9 +142,9 @@ cleanup:
         if (my_data->acdb_handle)
             dlclose(my_data->acdb_handle);
 
-        struct listnode *node;
+        struct listnode *node, *tempnode;
         struct meta_key_list *key_info;
-        list_for_each(node, &my_data->acdb_meta_key_list) {
+        list_for_each_safe(node, tempnode, &my_data->acdb_meta_key_list) {
             key_info = node_to_item(node, struct meta_key_list, list);
             free(key_info);
         }
@@ -21,7 +21,10 @@
 #include <dlfcn.h>
 #include <errno.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdlib.h>
+#include <sys/prctl.h>
+#include <sys/system_properties.h>
 
 #include <cutils/log.h>
 #include <cutils/str_parms.h>
@@ -88,6 +91,9 @@
 // Default encoder latency
 #define DEFAULT_ENCODER_LATENCY    200
 
+// Poll interval of the latency property watcher, bounds deinit time
+#define A2DP_LATENCY_PROP_WAIT_MS  1000
+
 // Encoder latency offset for codecs supported
 #define ENCODER_LATENCY_AAC        70
 #define ENCODER_LATENCY_APTX       40
@@ -248,6 +254,20 @@ struct a2dp_data {
     bool is_aptx_dual_mono_supported;
     /* Adaptive bitrate config for A2DP codecs */
     struct a2dp_abr_config abr_config;
+    /* Encoder + sink latency in ms, read lock free by
+     * audio_extn_a2dp_get_encoder_latency() */
+    _Atomic uint32_t encoder_latency_ms;
+    /* Serializes latency cache refreshes and guards the key below */
+    pthread_mutex_t latency_lock;
+    /* Inputs the cached latency was computed from */
+    enc_codec_t latency_encoder_format;
+    uint32_t latency_sink_ms;
+    uint32_t latency_prop_serial;
+    bool latency_valid;
+    /* Property watcher, started by init and joined by deinit */
+    pthread_t latency_prop_thread;
+    bool latency_prop_thread_started;
+    _Atomic bool latency_prop_thread_exit;
 };
 
 struct a2dp_data a2dp;
@@ -540,6 +560,9 @@ typedef struct {
 
 /*********** END of DSP configurable structures ********************/
 
+static void a2dp_refresh_encoder_latency();
+static void *a2dp_latency_prop_thread_loop(void *context);
+
 static void a2dp_common_init()
 {
     a2dp.a2dp_started = false;
@@ -1396,6 +1419,7 @@ bool configure_a2dp_encoder_format()
             is_configured = false;
             break;
     }
+    a2dp_refresh_encoder_latency();
     return is_configured;
 }
 
@@ -1469,6 +1493,7 @@ static int reset_a2dp_enc_config_params()
     }
 
     ret = a2dp_set_bit_format(DEFAULT_ENCODER_BIT_FORMAT);
+    a2dp_refresh_encoder_latency();
 
     return ret;
 }
@@ -1591,7 +1616,7 @@ int audio_extn_a2dp_set_parameters(struct str_parms *parms, bool *reconfig)
                          (uc_info->stream.out->devices & AUDIO_DEVICE_OUT_ALL_A2DP)) {
                         pthread_mutex_unlock(&a2dp.adev->lock);
                         check_a2dp_restore(a2dp.adev, uc_info->stream.out, false);
-                        pthread_mutex_lock(&a2dp.adev->lock);
+                        adev_lock(a2dp.adev, ADEV_LOCK_SITE_EXTN);
                     }
                 }
                 reset_a2dp_config();
@@ -1648,7 +1673,7 @@ int audio_extn_a2dp_set_parameters(struct str_parms *parms, bool *reconfig)
                          (uc_info->stream.out->devices & AUDIO_DEVICE_OUT_ALL_A2DP)) {
                         pthread_mutex_unlock(&a2dp.adev->lock);
                         check_a2dp_restore(a2dp.adev, uc_info->stream.out, true);
-                        pthread_mutex_lock(&a2dp.adev->lock);
+                        adev_lock(a2dp.adev, ADEV_LOCK_SITE_EXTN);
                     }
                 }
             }
@@ -1667,6 +1692,7 @@ int audio_extn_a2dp_set_parameters(struct str_parms *parms, bool *reconfig)
      }
 
 param_handled:
+     a2dp_refresh_encoder_latency();
      ALOGV("%s: end of A2DP setparam", __func__);
      return status;
 }
@@ -1710,10 +1736,19 @@ bool audio_extn_a2dp_is_suspended()
     return a2dp.a2dp_suspended;
 }
 
+static pthread_once_t a2dp_latency_once = PTHREAD_ONCE_INIT;
+
+static void a2dp_latency_init_once()
+{
+    pthread_mutex_init(&a2dp.latency_lock, (const pthread_mutexattr_t *) NULL);
+}
+
 void audio_extn_a2dp_init(void *adev)
 {
   a2dp.adev = (struct audio_device*)adev;
   a2dp.bt_lib_handle = NULL;
+  pthread_once(&a2dp_latency_once, a2dp_latency_init_once);
+  a2dp.latency_valid = false;
   a2dp_common_init();
   a2dp.enc_sampling_rate = 48000;
   a2dp.is_a2dp_offload_enabled = false;
@@ -1722,9 +1757,29 @@ void audio_extn_a2dp_init(void *adev)
   reset_a2dp_enc_config_params();
   reset_a2dp_dec_config_params();
   update_offload_codec_support();
+
+  if (a2dp.is_a2dp_offload_enabled && !a2dp.latency_prop_thread_started) {
+      atomic_store(&a2dp.latency_prop_thread_exit, false);
+      if (pthread_create(&a2dp.latency_prop_thread, (const pthread_attr_t *) NULL,
+                         a2dp_latency_prop_thread_loop, NULL) == 0)
+          a2dp.latency_prop_thread_started = true;
+      else
+          ALOGW("%s: cannot watch %s, updates apply on next reconfig",
+                __func__, SYSPROP_A2DP_CODEC_LATENCIES);
+  }
 }
 
-uint32_t audio_extn_a2dp_get_encoder_latency()
+void audio_extn_a2dp_deinit()
+{
+  if (a2dp.latency_prop_thread_started) {
+      atomic_store(&a2dp.latency_prop_thread_exit, true);
+      pthread_join(a2dp.latency_prop_thread, (void **) NULL);
+      a2dp.latency_prop_thread_started = false;
+  }
+}
+
+static uint32_t a2dp_compute_encoder_latency(enc_codec_t encoder_format,
+                                             uint32_t slatency_ms)
 {
     uint32_t latency_ms = 0;
     int avsync_runtime_prop = 0;
@@ -1743,12 +1798,7 @@ uint32_t audio_extn_a2dp_get_encoder_latency()
         }
     }
 
-    uint32_t slatency_ms = 0;
-    if (a2dp.audio_get_a2dp_sink_latency && a2dp.bt_state != A2DP_STATE_DISCONNECTED) {
-        slatency_ms = a2dp.audio_get_a2dp_sink_latency();
-    }
-
-    switch (a2dp.bt_encoder_format) {
+    switch (encoder_format) {
         case ENC_CODEC_TYPE_SBC:
             latency_ms = (avsync_runtime_prop > 0) ? sbc_offset : ENCODER_LATENCY_SBC;
             latency_ms += (slatency_ms == 0) ? DEFAULT_SINK_LATENCY_SBC : slatency_ms;
@@ -1780,6 +1830,97 @@ uint32_t audio_extn_a2dp_get_encoder_latency()
     return latency_ms;
 }
 
+static uint32_t a2dp_get_latency_prop_serial()
+{
+    const prop_info *pi = __system_property_find(SYSPROP_A2DP_CODEC_LATENCIES);
+
+    return pi != NULL ? __system_property_serial(pi) : 0;
+}
+
+/* Recomputes the cached encoder latency if the codec, the sink latency
+ * reported by the Bluetooth stack or the latency property changed.
+ * Called on codec (re)configuration, set_parameters and property updates,
+ * always with adev->lock held so that the Bluetooth library cannot be
+ * closed underneath the sink latency query.
+ */
+static void a2dp_refresh_encoder_latency()
+{
+    uint32_t slatency_ms = 0;
+    uint32_t prop_serial = a2dp_get_latency_prop_serial();
+
+    if (a2dp.bt_lib_handle && a2dp.audio_get_a2dp_sink_latency &&
+        a2dp.bt_state != A2DP_STATE_DISCONNECTED) {
+        slatency_ms = a2dp.audio_get_a2dp_sink_latency();
+    }
+
+    pthread_mutex_lock(&a2dp.latency_lock);
+    if (!a2dp.latency_valid ||
+        a2dp.latency_encoder_format != a2dp.bt_encoder_format ||
+        a2dp.latency_sink_ms != slatency_ms ||
+        a2dp.latency_prop_serial != prop_serial) {
+        a2dp.latency_encoder_format = a2dp.bt_encoder_format;
+        a2dp.latency_sink_ms = slatency_ms;
+        a2dp.latency_prop_serial = prop_serial;
+        a2dp.latency_valid = true;
+        atomic_store(&a2dp.encoder_latency_ms,
+                     a2dp_compute_encoder_latency(a2dp.bt_encoder_format, slatency_ms));
+        ALOGV("%s: encoder latency %u ms", __func__, atomic_load(&a2dp.encoder_latency_ms));
+    }
+    pthread_mutex_unlock(&a2dp.latency_lock);
+}
+
+/* True if the cached latency was not computed from this property serial */
+static bool a2dp_latency_prop_changed(uint32_t prop_serial)
+{
+    bool changed;
+
+    pthread_mutex_lock(&a2dp.latency_lock);
+    changed = !a2dp.latency_valid || a2dp.latency_prop_serial != prop_serial;
+    pthread_mutex_unlock(&a2dp.latency_lock);
+    return changed;
+}
+
+/* Waits for updates of SYSPROP_A2DP_CODEC_LATENCIES. Until the property
+ * exists the global property serial is watched instead. The serial is
+ * compared with the cache before each wait so that updates made before the
+ * thread first looked are not missed. The wait times out periodically so
+ * that audio_extn_a2dp_deinit() can stop the thread.
+ */
+static void *a2dp_latency_prop_thread_loop(void *context __unused)
+{
+    const struct timespec timeout = {
+        .tv_sec = A2DP_LATENCY_PROP_WAIT_MS / 1000,
+        .tv_nsec = (A2DP_LATENCY_PROP_WAIT_MS % 1000) * 1000000,
+    };
+    uint32_t serial;
+
+    prctl(PR_SET_NAME, (unsigned long)"A2DP Latency Prop", 0, 0, 0);
+
+    while (!atomic_load(&a2dp.latency_prop_thread_exit)) {
+        const prop_info *pi = __system_property_find(SYSPROP_A2DP_CODEC_LATENCIES);
+
+        if (pi == NULL) {
+            serial = __system_property_area_serial();
+        } else {
+            serial = __system_property_serial(pi);
+            if (a2dp_latency_prop_changed(serial)) {
+                adev_lock(a2dp.adev, ADEV_LOCK_SITE_EXTN);
+                a2dp_refresh_encoder_latency();
+                pthread_mutex_unlock(&a2dp.adev->lock);
+            }
+        }
+        /* returns on update, timeout or error, all just look again */
+        __system_property_wait(pi, serial, (uint32_t *) NULL, &timeout);
+    }
+
+    return NULL;
+}
+
+uint32_t audio_extn_a2dp_get_encoder_latency()
+{
+    return atomic_load_explicit(&a2dp.encoder_latency_ms, memory_order_relaxed);
+}
+
 int audio_extn_a2dp_get_parameters(struct str_parms *query,
                                    struct str_parms *reply)
 {
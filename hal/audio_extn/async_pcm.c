@@ -0,0 +1,647 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "audio_hw_async_pcm"
+/*#define LOG_NDEBUG 0*/
+
+/* Async PCM playback
+
+   When enabled, out_write() no longer calls pcm_write() itself. It copies
+   the buffer into a single-producer/single-consumer ring owned by the
+   stream and returns, and a per-stream SCHED_FIFO writer thread drains the
+   ring into the kernel one period at a time.
+
+   The producer (out_write, under out->lock) only blocks when the ring is
+   full, which keeps AudioFlinger paced by the sink. The writer thread never
+   takes out->lock, so the blocking kernel write no longer holds the stream
+   lock.
+
+   The ring is sized to two AudioFlinger buffers and is discarded on standby.
+   A tinyalsa handle is not thread safe, so while the writer thread runs it
+   is the only one to touch out->pcm. It samples the kernel position right
+   after each write, together with the ring position that write reached, and
+   audio_extn_async_pcm_get_htimestamp() returns that sample so that
+   out_get_presentation_position() counts the frames still in the ring as
+   not yet presented.
+
+   Async PCM capture
+
+   The same arrangement run backwards for VOIP and low latency record. A
+   per-stream SCHED_FIFO reader thread pulls one period at a time from the
+   kernel into a ring, and in_read() only copies out of it. The 24_8 to 8_24
+   shift is done by the reader, which also samples the ALSA timestamp right
+   after each read so that in_get_capture_position() keeps reporting a
+   position tied to the kernel rather than to the ring.
+
+   The reader zeroes the periods it captures while the mic is muted, so they
+   stay silent if the mic is unmuted before they are read. in_read() still
+   zeroes its buffer while muted: the ring may hold periods captured before
+   the mute.
+
+   The reader stops at the first read error. in_read() returns the periods
+   captured before it, then the error, which puts the stream in standby as
+   a failed synchronous read does; the next read starts a new reader.
+*/
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+
+#include <log/log.h>
+#include <cutils/properties.h>
+#include <system/thread_defs.h>
+
+#include "audio_hw.h"
+#include "audio_extn.h"
+#include "pcm_kernels.h"
+#include "voice.h"
+
+#define ASYNC_PCM_PROPERTY "vendor.audio.async_pcm.enabled"
+#define ASYNC_PCM_WRITER_PRIORITY 2
+#define ASYNC_PCM_RING_BUFFERS 2
+#define ASYNC_PCM_CAPTURE_PROPERTY "vendor.audio.async_capture.enabled"
+#define ASYNC_PCM_CAPTURE_PERIODS 4
+
+struct async_pcm {
+    struct stream_out *out;
+    pthread_t thread;
+
+    uint8_t *base;
+    size_t size;            /* ring capacity in bytes, a multiple of frame_size */
+    size_t frame_size;
+    size_t chunk_size;      /* bytes handed to one pcm_write(), one period */
+    bool use_mmap;
+
+    /* rear is only advanced by the producer, front only by the writer thread.
+       Both count bytes since open and are never reset. */
+    _Atomic uint64_t rear;
+    _Atomic uint64_t front;
+    _Atomic int error;
+    _Atomic bool exit;
+
+    /* lock and conds are only used to park a side that has nothing to do.
+       The flags below let the other side skip the lock when nobody sleeps;
+       counter updates are seq_cst so a wakeup cannot be lost against them. */
+    pthread_mutex_t lock;
+    pthread_cond_t data_cond;
+    pthread_cond_t space_cond;
+    _Atomic bool writer_waiting;
+    _Atomic bool producer_waiting;
+
+    /* kernel position after the last write, protected by lock */
+    uint64_t position_front;    /* front once that write is counted */
+    unsigned int position_avail;
+    struct timespec position_time;
+    bool position_valid;
+};
+
+static bool async_pcm_is_usecase_supported(const struct stream_out *out)
+{
+    // mmap fill streams write into the DMA buffer themselves
+    return !out->mmap_fill &&
+           (out->usecase == USECASE_AUDIO_PLAYBACK_DEEP_BUFFER ||
+            out->usecase == USECASE_AUDIO_PLAYBACK_LOW_LATENCY);
+}
+
+static void async_pcm_wake(struct async_pcm *apcm, _Atomic bool *waiting,
+                           pthread_cond_t *cond)
+{
+    if (atomic_load(waiting)) {
+        pthread_mutex_lock(&apcm->lock);
+        pthread_cond_signal(cond);
+        pthread_mutex_unlock(&apcm->lock);
+    }
+}
+
+static void *async_pcm_writer_loop(void *context)
+{
+    struct async_pcm *apcm = (struct async_pcm *)context;
+    struct stream_out *out = apcm->out;
+    struct sched_param param = {
+        .sched_priority = ASYNC_PCM_WRITER_PRIORITY,
+    };
+
+    if (sched_setscheduler(0, SCHED_FIFO, &param) != 0) {
+        ALOGW("%s: cannot set SCHED_FIFO, falling back to audio priority", __func__);
+        setpriority(PRIO_PROCESS, 0, ANDROID_PRIORITY_AUDIO);
+    }
+    prctl(PR_SET_NAME, (unsigned long)"Async PCM Writer", 0, 0, 0);
+
+    ALOGV("%s: enter usecase(%d: %s)", __func__, out->usecase, use_case_table[out->usecase]);
+
+    for (;;) {
+        if (atomic_load(&apcm->exit))
+            break;
+
+        uint64_t front = atomic_load_explicit(&apcm->front, memory_order_relaxed);
+        uint64_t rear = atomic_load_explicit(&apcm->rear, memory_order_acquire);
+
+        if (rear == front) {
+            pthread_mutex_lock(&apcm->lock);
+            atomic_store(&apcm->writer_waiting, true);
+            while (atomic_load(&apcm->rear) == front && !atomic_load(&apcm->exit))
+                pthread_cond_wait(&apcm->data_cond, &apcm->lock);
+            atomic_store(&apcm->writer_waiting, false);
+            pthread_mutex_unlock(&apcm->lock);
+            continue;
+        }
+
+        size_t offset = front % apcm->size;
+        size_t bytes = rear - front;
+        if (bytes > apcm->chunk_size)
+            bytes = apcm->chunk_size;
+        if (bytes > apcm->size - offset)
+            bytes = apcm->size - offset;
+
+        /* after an error the remaining data is dropped so the producer never stalls */
+        if (atomic_load_explicit(&apcm->error, memory_order_relaxed) == 0) {
+            int ret;
+            if (apcm->use_mmap)
+                ret = pcm_mmap_write(out->pcm, apcm->base + offset, bytes);
+            else
+                ret = pcm_write(out->pcm, apcm->base + offset, bytes);
+            if (ret != 0) {
+                ALOGE("%s: error %d - %s", __func__, ret, pcm_get_error(out->pcm));
+                atomic_store(&apcm->error, ret < 0 ? ret : -EIO);
+            } else {
+                struct timespec timestamp;
+                unsigned int avail;
+
+                if (pcm_get_htimestamp(out->pcm, &avail, &timestamp) == 0) {
+                    pthread_mutex_lock(&apcm->lock);
+                    apcm->position_front = front + bytes;
+                    apcm->position_avail = avail;
+                    apcm->position_time = timestamp;
+                    apcm->position_valid = true;
+                    pthread_mutex_unlock(&apcm->lock);
+                }
+            }
+        }
+
+        atomic_store(&apcm->front, front + bytes);
+        async_pcm_wake(apcm, &apcm->producer_waiting, &apcm->space_cond);
+    }
+
+    ALOGV("%s: exit", __func__);
+    return NULL;
+}
+
+/* must be called with out->lock held, after out->pcm has been opened */
+int audio_extn_async_pcm_open(struct stream_out *out)
+{
+    struct async_pcm *apcm;
+    size_t buffer_size;
+
+    if (out->async_pcm != NULL || out->pcm == NULL || !async_pcm_is_usecase_supported(out))
+        return 0;
+
+    if (!property_get_bool(ASYNC_PCM_PROPERTY, false))
+        return 0;
+
+    apcm = (struct async_pcm *)calloc(1, sizeof(struct async_pcm));
+    if (apcm == NULL)
+        return -ENOMEM;
+
+    apcm->out = out;
+    apcm->frame_size = audio_stream_out_frame_size(&out->stream);
+    apcm->chunk_size = pcm_frames_to_bytes(out->pcm, out->config.period_size);
+    apcm->use_mmap = out->realtime;
+    buffer_size = out->config.period_size * out->af_period_multiplier * apcm->frame_size;
+    apcm->size = ASYNC_PCM_RING_BUFFERS * buffer_size;
+    apcm->base = (uint8_t *)malloc(apcm->size);
+    if (apcm->base == NULL) {
+        free(apcm);
+        return -ENOMEM;
+    }
+
+    atomic_init(&apcm->rear, 0);
+    atomic_init(&apcm->front, 0);
+    atomic_init(&apcm->error, 0);
+    atomic_init(&apcm->exit, false);
+    atomic_init(&apcm->writer_waiting, false);
+    atomic_init(&apcm->producer_waiting, false);
+    pthread_mutex_init(&apcm->lock, (const pthread_mutexattr_t *) NULL);
+    pthread_cond_init(&apcm->data_cond, (const pthread_condattr_t *) NULL);
+    pthread_cond_init(&apcm->space_cond, (const pthread_condattr_t *) NULL);
+
+    if (pthread_create(&apcm->thread, (const pthread_attr_t *) NULL,
+                       async_pcm_writer_loop, apcm) != 0) {
+        ALOGE("%s: failed to create writer thread, using synchronous writes", __func__);
+        pthread_cond_destroy(&apcm->space_cond);
+        pthread_cond_destroy(&apcm->data_cond);
+        pthread_mutex_destroy(&apcm->lock);
+        free(apcm->base);
+        free(apcm);
+        return -ENOSYS;
+    }
+
+    ALOGD("%s: usecase(%d: %s) ring %zu bytes, chunk %zu bytes", __func__,
+          out->usecase, use_case_table[out->usecase], apcm->size, apcm->chunk_size);
+    out->async_pcm = apcm;
+    return 0;
+}
+
+/* must be called with out->lock held, before out->pcm is closed.
+   Like pcm_close() on the kernel buffer, data still in the ring is dropped. */
+void audio_extn_async_pcm_close(struct stream_out *out)
+{
+    struct async_pcm *apcm = out->async_pcm;
+
+    if (apcm == NULL)
+        return;
+
+    pthread_mutex_lock(&apcm->lock);
+    atomic_store(&apcm->exit, true);
+    pthread_cond_signal(&apcm->data_cond);
+    pthread_mutex_unlock(&apcm->lock);
+    pthread_join(apcm->thread, (void **) NULL);
+
+    pthread_cond_destroy(&apcm->space_cond);
+    pthread_cond_destroy(&apcm->data_cond);
+    pthread_mutex_destroy(&apcm->lock);
+    free(apcm->base);
+    free(apcm);
+    out->async_pcm = NULL;
+}
+
+/* must be called with out->lock held.
+   Returns 0 once all bytes are queued, or the error hit by the writer thread. */
+int audio_extn_async_pcm_write(struct stream_out *out, const void *buffer, size_t bytes)
+{
+    struct async_pcm *apcm = out->async_pcm;
+    const uint8_t *src = (const uint8_t *)buffer;
+    int error;
+
+    while (bytes > 0) {
+        error = atomic_load_explicit(&apcm->error, memory_order_relaxed);
+        if (error != 0)
+            return error;
+
+        uint64_t rear = atomic_load_explicit(&apcm->rear, memory_order_relaxed);
+        uint64_t front = atomic_load_explicit(&apcm->front, memory_order_acquire);
+        size_t space = apcm->size - (size_t)(rear - front);
+
+        if (space == 0) {
+            pthread_mutex_lock(&apcm->lock);
+            atomic_store(&apcm->producer_waiting, true);
+            while (atomic_load(&apcm->front) == front && atomic_load(&apcm->error) == 0)
+                pthread_cond_wait(&apcm->space_cond, &apcm->lock);
+            atomic_store(&apcm->producer_waiting, false);
+            pthread_mutex_unlock(&apcm->lock);
+            continue;
+        }
+
+        size_t offset = rear % apcm->size;
+        size_t count = bytes < space ? bytes : space;
+        if (count > apcm->size - offset)
+            count = apcm->size - offset;
+
+        memcpy(apcm->base + offset, src, count);
+        atomic_store(&apcm->rear, rear + count);
+        async_pcm_wake(apcm, &apcm->writer_waiting, &apcm->data_cond);
+
+        src += count;
+        bytes -= count;
+    }
+
+    return atomic_load_explicit(&apcm->error, memory_order_relaxed);
+}
+
+/* must be called with out->lock held.
+   Returns pcm_get_htimestamp() of out->pcm and, in *pending_frames, the frames
+   accepted by out_write() that had not reached the kernel at that time. The
+   kernel is only asked directly while the writer thread waits for data,
+   otherwise the sample the thread took after its last write is returned. */
+int audio_extn_async_pcm_get_htimestamp(struct stream_out *out, unsigned int *avail,
+                                        struct timespec *timestamp,
+                                        unsigned int *pending_frames)
+{
+    struct async_pcm *apcm = out->async_pcm;
+    uint64_t front = 0;
+    int ret = 0;
+
+    pthread_mutex_lock(&apcm->lock);
+    if (atomic_load(&apcm->writer_waiting)) {
+        /* the thread leaves its wait with lock held, and rear cannot move under out->lock */
+        ret = pcm_get_htimestamp(out->pcm, avail, timestamp);
+        front = atomic_load(&apcm->front);
+    } else if (apcm->position_valid) {
+        *avail = apcm->position_avail;
+        *timestamp = apcm->position_time;
+        front = apcm->position_front;
+    } else {
+        ret = -ENODATA;
+    }
+    pthread_mutex_unlock(&apcm->lock);
+
+    if (ret == 0)
+        *pending_frames = (unsigned int)((atomic_load(&apcm->rear) - front) / apcm->frame_size);
+    return ret;
+}
+
+struct async_pcm_capture {
+    struct stream_in *in;
+    pthread_t thread;
+
+    uint8_t *base;
+    size_t size;            /* ring capacity in bytes, a multiple of chunk_size */
+    size_t frame_size;
+    size_t chunk_size;      /* bytes filled by one pcm_read(), one period */
+    bool use_mmap;
+    bool muted[ASYNC_PCM_CAPTURE_PERIODS]; /* per chunk, written before rear is published */
+
+    /* rear is only advanced by the reader thread, front only by in_read().
+       Both count bytes since open and are never reset. */
+    _Atomic uint64_t rear;
+    _Atomic uint64_t front;
+    _Atomic int error;
+    _Atomic bool exit;
+
+    pthread_mutex_t lock;
+    pthread_cond_t data_cond;
+    pthread_cond_t space_cond;
+    _Atomic bool reader_waiting;
+    _Atomic bool consumer_waiting;
+
+    /* last kernel position, protected by lock */
+    int64_t base_frames;    /* in->frames_read when the ring was opened */
+    int64_t position_frames;
+    int64_t position_ns;
+    bool position_valid;
+};
+
+static bool async_pcm_capture_is_usecase_supported(const struct stream_in *in)
+{
+    return in->usecase == USECASE_AUDIO_RECORD_LOW_LATENCY ||
+           in->usecase == USECASE_AUDIO_RECORD_VOIP;
+}
+
+static void async_pcm_capture_wake(struct async_pcm_capture *acap, _Atomic bool *waiting,
+                                   pthread_cond_t *cond)
+{
+    if (atomic_load(waiting)) {
+        pthread_mutex_lock(&acap->lock);
+        pthread_cond_signal(cond);
+        pthread_mutex_unlock(&acap->lock);
+    }
+}
+
+static void *async_pcm_reader_loop(void *context)
+{
+    struct async_pcm_capture *acap = (struct async_pcm_capture *)context;
+    struct stream_in *in = acap->in;
+    struct sched_param param = {
+        .sched_priority = ASYNC_PCM_WRITER_PRIORITY,
+    };
+
+    if (sched_setscheduler(0, SCHED_FIFO, &param) != 0) {
+        ALOGW("%s: cannot set SCHED_FIFO, falling back to audio priority", __func__);
+        setpriority(PRIO_PROCESS, 0, ANDROID_PRIORITY_AUDIO);
+    }
+    prctl(PR_SET_NAME, (unsigned long)"Async PCM Reader", 0, 0, 0);
+
+    ALOGV("%s: enter usecase(%d: %s)", __func__, in->usecase, use_case_table[in->usecase]);
+
+    for (;;) {
+        if (atomic_load(&acap->exit))
+            break;
+
+        uint64_t rear = atomic_load_explicit(&acap->rear, memory_order_relaxed);
+        uint64_t front = atomic_load_explicit(&acap->front, memory_order_acquire);
+
+        if (acap->size - (size_t)(rear - front) < acap->chunk_size) {
+            pthread_mutex_lock(&acap->lock);
+            atomic_store(&acap->reader_waiting, true);
+            while (atomic_load(&acap->front) == front && !atomic_load(&acap->exit))
+                pthread_cond_wait(&acap->space_cond, &acap->lock);
+            atomic_store(&acap->reader_waiting, false);
+            pthread_mutex_unlock(&acap->lock);
+            continue;
+        }
+
+        /* size is a multiple of chunk_size so a chunk never wraps */
+        size_t offset = rear % acap->size;
+        uint8_t *dst = acap->base + offset;
+        int ret;
+
+        if (acap->use_mmap)
+            ret = pcm_mmap_read(in->pcm, dst, acap->chunk_size);
+        else
+            ret = pcm_read(in->pcm, dst, acap->chunk_size);
+        if (ret != 0) {
+            // tinyalsa returns -1 and leaves the cause in errno
+            const int error = errno != 0 ? -errno : -EIO;
+            ALOGE("%s: error %d - %s", __func__, error, pcm_get_error(in->pcm));
+            atomic_store(&acap->error, error);
+            async_pcm_capture_wake(acap, &acap->consumer_waiting, &acap->data_cond);
+            break;
+        }
+
+        struct timespec timestamp;
+        unsigned int avail;
+        bool have_timestamp = pcm_get_htimestamp(in->pcm, &avail, &timestamp) == 0;
+
+        if (in->format == AUDIO_FORMAT_PCM_8_24_BIT) {
+            /* data from DSP comes in 24_8 format, convert it to 8_24 */
+            pcm_kernels_shift_24_8_to_8_24((int32_t *)dst, acap->chunk_size / 4);
+        }
+
+        /* No need to acquire adev->lock to read mic_muted, as in_read() does not either. */
+        bool muted = in->dev->mic_muted &&
+                     !voice_is_in_call_rec_stream(in) &&
+                     in->usecase != USECASE_AUDIO_RECORD_AFE_PROXY;
+        if (muted)
+            memset(dst, 0, acap->chunk_size);
+        acap->muted[offset / acap->chunk_size] = muted;
+
+        if (have_timestamp) {
+            pthread_mutex_lock(&acap->lock);
+            acap->position_frames = acap->base_frames +
+                                    (int64_t)((rear + acap->chunk_size) / acap->frame_size) +
+                                    avail;
+            acap->position_ns = timestamp.tv_sec * 1000000000LL + timestamp.tv_nsec;
+            acap->position_valid = true;
+            pthread_mutex_unlock(&acap->lock);
+        }
+
+        atomic_store(&acap->rear, rear + acap->chunk_size);
+        async_pcm_capture_wake(acap, &acap->consumer_waiting, &acap->data_cond);
+    }
+
+    ALOGV("%s: exit", __func__);
+    return NULL;
+}
+
+/* must be called with in->lock held, after in->pcm has been opened */
+int audio_extn_async_pcm_capture_open(struct stream_in *in)
+{
+    struct async_pcm_capture *acap;
+
+    if (in->async_capture != NULL || in->pcm == NULL ||
+            !async_pcm_capture_is_usecase_supported(in))
+        return 0;
+
+    if (!property_get_bool(ASYNC_PCM_CAPTURE_PROPERTY, false))
+        return 0;
+
+    acap = (struct async_pcm_capture *)calloc(1, sizeof(struct async_pcm_capture));
+    if (acap == NULL)
+        return -ENOMEM;
+
+    acap->in = in;
+    acap->frame_size = audio_stream_in_frame_size(&in->stream);
+    acap->chunk_size = pcm_frames_to_bytes(in->pcm, in->config.period_size);
+    acap->use_mmap = in->realtime;
+    acap->size = ASYNC_PCM_CAPTURE_PERIODS * acap->chunk_size;
+    acap->base_frames = in->frames_read;
+    if (acap->chunk_size == 0 || acap->chunk_size % acap->frame_size != 0) {
+        ALOGE("%s: period %zu bytes is not a whole number of frames", __func__,
+              acap->chunk_size);
+        free(acap);
+        return -EINVAL;
+    }
+    acap->base = (uint8_t *)malloc(acap->size);
+    if (acap->base == NULL) {
+        free(acap);
+        return -ENOMEM;
+    }
+
+    atomic_init(&acap->rear, 0);
+    atomic_init(&acap->front, 0);
+    atomic_init(&acap->error, 0);
+    atomic_init(&acap->exit, false);
+    atomic_init(&acap->reader_waiting, false);
+    atomic_init(&acap->consumer_waiting, false);
+    pthread_mutex_init(&acap->lock, (const pthread_mutexattr_t *) NULL);
+    pthread_cond_init(&acap->data_cond, (const pthread_condattr_t *) NULL);
+    pthread_cond_init(&acap->space_cond, (const pthread_condattr_t *) NULL);
+
+    if (pthread_create(&acap->thread, (const pthread_attr_t *) NULL,
+                       async_pcm_reader_loop, acap) != 0) {
+        ALOGE("%s: failed to create reader thread, using synchronous reads", __func__);
+        pthread_cond_destroy(&acap->space_cond);
+        pthread_cond_destroy(&acap->data_cond);
+        pthread_mutex_destroy(&acap->lock);
+        free(acap->base);
+        free(acap);
+        return -ENOSYS;
+    }
+
+    ALOGD("%s: usecase(%d: %s) ring %zu bytes, chunk %zu bytes", __func__,
+          in->usecase, use_case_table[in->usecase], acap->size, acap->chunk_size);
+    in->async_capture = acap;
+    return 0;
+}
+
+/* must be called with in->lock held, before in->pcm is closed.
+   Captured data still in the ring is dropped. */
+void audio_extn_async_pcm_capture_close(struct stream_in *in)
+{
+    struct async_pcm_capture *acap = in->async_capture;
+
+    if (acap == NULL)
+        return;
+
+    pthread_mutex_lock(&acap->lock);
+    atomic_store(&acap->exit, true);
+    pthread_cond_signal(&acap->space_cond);
+    pthread_mutex_unlock(&acap->lock);
+    pthread_join(acap->thread, (void **) NULL);
+
+    pthread_cond_destroy(&acap->space_cond);
+    pthread_cond_destroy(&acap->data_cond);
+    pthread_mutex_destroy(&acap->lock);
+    free(acap->base);
+    free(acap);
+    in->async_capture = NULL;
+}
+
+/* must be called with in->lock held.
+   Returns 0 once bytes have been copied out, or the error hit by the reader
+   thread once the ring has drained. *muted_frames is set to the number of
+   returned frames that were zeroed because the mic was muted. */
+int audio_extn_async_pcm_read(struct stream_in *in, void *buffer, size_t bytes,
+                              size_t *muted_frames)
+{
+    struct async_pcm_capture *acap = in->async_capture;
+    uint8_t *dst = (uint8_t *)buffer;
+
+    *muted_frames = 0;
+    while (bytes > 0) {
+        uint64_t front = atomic_load_explicit(&acap->front, memory_order_relaxed);
+        uint64_t rear = atomic_load_explicit(&acap->rear, memory_order_acquire);
+
+        if (rear == front) {
+            int error = atomic_load(&acap->error);
+            if (error != 0)
+                return error;
+
+            pthread_mutex_lock(&acap->lock);
+            atomic_store(&acap->consumer_waiting, true);
+            while (atomic_load(&acap->rear) == front && atomic_load(&acap->error) == 0)
+                pthread_cond_wait(&acap->data_cond, &acap->lock);
+            atomic_store(&acap->consumer_waiting, false);
+            pthread_mutex_unlock(&acap->lock);
+            continue;
+        }
+
+        /* copy at most up to the end of the current chunk so mute is accounted per chunk */
+        size_t offset = front % acap->size;
+        size_t count = (size_t)(rear - front);
+        size_t chunk_left = acap->chunk_size - offset % acap->chunk_size;
+        if (count > bytes)
+            count = bytes;
+        if (count > chunk_left)
+            count = chunk_left;
+
+        memcpy(dst, acap->base + offset, count);
+        if (acap->muted[offset / acap->chunk_size])
+            *muted_frames += count / acap->frame_size;
+        atomic_store(&acap->front, front + count);
+        async_pcm_capture_wake(acap, &acap->reader_waiting, &acap->space_cond);
+
+        dst += count;
+        bytes -= count;
+    }
+
+    return 0;
+}
+
+/* Position of the last kernel read, in the same units as in->frames_read.
+   Must be called with in->lock held. */
+int audio_extn_async_pcm_get_capture_position(struct stream_in *in, int64_t *frames,
+                                              int64_t *time)
+{
+    struct async_pcm_capture *acap = in->async_capture;
+    int ret = -ENOSYS;
+
+    if (acap == NULL)
+        return ret;
+
+    pthread_mutex_lock(&acap->lock);
+    if (acap->position_valid) {
+        *frames = acap->position_frames;
+        *time = acap->position_ns;
+        ret = 0;
+    }
+    pthread_mutex_unlock(&acap->lock);
+    return ret;
+}
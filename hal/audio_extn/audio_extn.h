@@ -118,6 +118,7 @@ char *audio_extn_usb_usbid(void);
 #define audio_extn_sound_trigger_init(adev)                            (0)
 #define audio_extn_sound_trigger_deinit(adev)                          (0)
 #define audio_extn_sound_trigger_update_device_status(snd_dev, event)  (0)
+#define audio_extn_sound_trigger_watches_device(snd_dev)               (false)
 #define audio_extn_sound_trigger_update_stream_status(uc_info, event)  (0)
 #define audio_extn_sound_trigger_set_parameters(adev, parms)           (0)
 #define audio_extn_sound_trigger_check_and_get_session(in)             (0)
@@ -138,6 +139,8 @@ int audio_extn_sound_trigger_init(struct audio_device *adev);
 void audio_extn_sound_trigger_deinit(struct audio_device *adev);
 void audio_extn_sound_trigger_update_device_status(snd_device_t snd_device,
                                      st_event_type_t event);
+/* true when the device status events of snd_device reach the sound trigger HAL */
+bool audio_extn_sound_trigger_watches_device(snd_device_t snd_device);
 void audio_extn_sound_trigger_update_stream_status(struct audio_usecase *uc_info,
                                      st_event_type_t event);
 void audio_extn_sound_trigger_set_parameters(struct audio_device *adev,
@@ -150,6 +153,7 @@ int audio_extn_sound_trigger_read(struct stream_in *in, void *buffer,
 
 #ifndef A2DP_OFFLOAD_ENABLED
 #define audio_extn_a2dp_init(adev)                       (0)
+#define audio_extn_a2dp_deinit()                         (0)
 #define audio_extn_a2dp_start_playback()                 (0)
 #define audio_extn_a2dp_stop_playback()                  (0)
 #define audio_extn_a2dp_set_parameters(parms, reconfig)  (0)
@@ -162,6 +166,7 @@ int audio_extn_sound_trigger_read(struct stream_in *in, void *buffer,
 #define audio_extn_a2dp_is_suspended()                   (0)
 #else
 void audio_extn_a2dp_init(void *adev);
+void audio_extn_a2dp_deinit();
 int audio_extn_a2dp_start_playback();
 int audio_extn_a2dp_stop_playback();
 int audio_extn_a2dp_set_parameters(struct str_parms *parms, bool *reconfig);
@@ -232,6 +237,30 @@ int audio_extn_snd_mon_register_listener(void *stream, snd_mon_cb cb);
 int audio_extn_snd_mon_unregister_listener(void *stream);
 #endif
 
+#ifndef ASYNC_PCM_ENABLED
+#define audio_extn_async_pcm_open(out)                     (0)
+#define audio_extn_async_pcm_close(out)                    (0)
+#define audio_extn_async_pcm_write(out, buffer, bytes)     (-ENOSYS)
+#define audio_extn_async_pcm_get_htimestamp(out, avail, timestamp, pending_frames) (-ENOSYS)
+#define audio_extn_async_pcm_capture_open(in)              (0)
+#define audio_extn_async_pcm_capture_close(in)             (0)
+#define audio_extn_async_pcm_read(in, buffer, bytes, muted_frames) (-ENOSYS)
+#define audio_extn_async_pcm_get_capture_position(in, frames, time) (-ENOSYS)
+#else
+int audio_extn_async_pcm_open(struct stream_out *out);
+void audio_extn_async_pcm_close(struct stream_out *out);
+int audio_extn_async_pcm_write(struct stream_out *out, const void *buffer, size_t bytes);
+int audio_extn_async_pcm_get_htimestamp(struct stream_out *out, unsigned int *avail,
+                                        struct timespec *timestamp,
+                                        unsigned int *pending_frames);
+int audio_extn_async_pcm_capture_open(struct stream_in *in);
+void audio_extn_async_pcm_capture_close(struct stream_in *in);
+int audio_extn_async_pcm_read(struct stream_in *in, void *buffer, size_t bytes,
+                              size_t *muted_frames);
+int audio_extn_async_pcm_get_capture_position(struct stream_in *in, int64_t *frames,
+                                              int64_t *time);
+#endif
+
 bool audio_extn_utils_resolve_config_file(char[]);
 int audio_extn_utils_get_platform_info(const char* snd_card_name,
                                        char* platform_info_file);
@@ -478,7 +478,7 @@ static void *audio_extn_cirrus_calibration_thread() {
         ALOGE("%s: rx usecase can not be found", __func__);
         goto exit;
     }
-    pthread_mutex_lock(&adev->lock);
+    adev_lock(adev, ADEV_LOCK_SITE_EXTN);
 
     uc_info_rx->id = USECASE_AUDIO_PLAYBACK_DEEP_BUFFER;
     uc_info_rx->type = PCM_PLAYBACK;
@@ -524,7 +524,7 @@ static void *audio_extn_cirrus_calibration_thread() {
     ALOGE_IF(ret < 0, "%s: Set tuning configs failed (%d)", __func__, ret);
 
 close_stream:
-    pthread_mutex_lock(&adev->lock);
+    adev_lock(adev, ADEV_LOCK_SITE_EXTN);
     if (handle.pcm_rx) {
         ALOGI("%s: pcm_rx_close", __func__);
         pcm_close(handle.pcm_rx);
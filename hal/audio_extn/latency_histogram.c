@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include "latency_histogram.h"
+
+void latency_histogram_log_ns(struct latency_histogram *hist, int64_t duration_ns)
+{
+    uint64_t us = duration_ns > 0 ? (uint64_t)duration_ns / 1000 : 0;
+    uint32_t us32 = us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+    unsigned int bucket = us32 == 0 ? 0 : 32 - __builtin_clz(us32);
+
+    if (bucket >= LATENCY_HISTOGRAM_BUCKETS)
+        bucket = LATENCY_HISTOGRAM_BUCKETS - 1;
+
+    /* each field is updated atomically, a concurrent dump may see them skewed by one sample */
+    atomic_fetch_add_explicit(&hist->buckets[bucket], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->sum_us, us, memory_order_relaxed);
+
+    uint32_t max = atomic_load_explicit(&hist->max_us, memory_order_relaxed);
+    while (us32 > max &&
+           !atomic_compare_exchange_weak_explicit(&hist->max_us, &max, us32,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+}
+
+void latency_histogram_dump(const struct latency_histogram *hist, int fd,
+                            const char *prefix, const char *name)
+{
+    char buckets[LATENCY_HISTOGRAM_BUCKETS * 24];
+    size_t len = 0;
+
+    buckets[0] = '\0';
+    for (unsigned int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        uint32_t n = atomic_load_explicit(&hist->buckets[i], memory_order_relaxed);
+        if (n == 0)
+            continue;
+        int ret;
+        if (i == LATENCY_HISTOGRAM_BUCKETS - 1)
+            ret = snprintf(buckets + len, sizeof(buckets) - len, "%sinf:%u",
+                           len ? "," : "", n);
+        else
+            ret = snprintf(buckets + len, sizeof(buckets) - len, "%s%u:%u",
+                           len ? "," : "", 1u << i, n);
+        if (ret < 0 || (size_t)ret >= sizeof(buckets) - len)
+            break;
+        len += ret;
+    }
+
+    dprintf(fd, "%shist %s n=%llu sum_us=%llu max_us=%u buckets_us=%s\n",
+            prefix, name,
+            (unsigned long long)atomic_load_explicit(&hist->count, memory_order_relaxed),
+            (unsigned long long)atomic_load_explicit(&hist->sum_us, memory_order_relaxed),
+            atomic_load_explicit(&hist->max_us, memory_order_relaxed),
+            buckets);
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATENCY_HISTOGRAM_H_
+#define LATENCY_HISTOGRAM_H_
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+/* Bucket i counts durations in [2^(i-1), 2^i) us, bucket 0 counts < 1 us
+ * and the last bucket everything from ~0.5 s up.
+ */
+#define LATENCY_HISTOGRAM_BUCKETS 21
+
+/* Lock free duration histogram, cheap enough to be always on.
+ * Zero initialized memory is an empty histogram.
+ */
+struct latency_histogram {
+    _Atomic uint32_t buckets[LATENCY_HISTOGRAM_BUCKETS];
+    _Atomic uint64_t count;
+    _Atomic uint64_t sum_us;
+    _Atomic uint32_t max_us;
+};
+
+void latency_histogram_log_ns(struct latency_histogram *hist, int64_t duration_ns);
+
+/* Writes one line:
+ * <prefix>hist <name> n=<count> sum_us=<sum> max_us=<max> buckets_us=<upper>:<count>,...
+ * Only non empty buckets are listed, the last bucket upper bound is "inf".
+ */
+void latency_histogram_dump(const struct latency_histogram *hist, int fd,
+                            const char *prefix, const char *name);
+
+#endif /* LATENCY_HISTOGRAM_H_ */
@@ -0,0 +1,384 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* PCM buffer kernels used on the HAL write and read paths.
+
+   Each kernel has a scalar implementation that handles any size and
+   layout. The ABI's SIMD unit (NEON on arm/arm64, SSE2 on x86) is used for
+   the common layouts and the scalar code finishes the remaining tail, so
+   results are bit exact with the scalar reference whatever path is taken.
+   Both units are part of the Android ABI baseline, so the choice is made at
+   compile time.
+*/
+
+#include <stdint.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PCM_KERNELS_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define PCM_KERNELS_SSE2
+#endif
+
+#include "pcm_kernels.h"
+
+static void split_haptics_scalar(const uint8_t *src, uint8_t *dst, uint8_t *haptic_buffer,
+                                 size_t frames, size_t bytes_per_sample, size_t audio_channels,
+                                 size_t haptic_channels, size_t skip_channels)
+{
+    size_t audio_frame_size = audio_channels * bytes_per_sample;
+    size_t haptic_frame_size = haptic_channels * bytes_per_sample;
+    size_t skip_frame_size = skip_channels * bytes_per_sample;
+
+    /* frames are a few bytes, byte loops beat a memmove() call per frame */
+    for (size_t i = 0; i < frames; i++) {
+        /* dst never runs ahead of src, so a forward copy is safe in place */
+        for (size_t j = 0; j < audio_frame_size; j++)
+            *dst++ = *src++;
+        for (size_t j = 0; j < haptic_frame_size; j++)
+            *haptic_buffer++ = *src++;
+        src += skip_frame_size;
+    }
+}
+
+#ifdef PCM_KERNELS_NEON
+/* returns the number of frames handled, the caller finishes the tail */
+static size_t split_haptics_neon_16(uint16_t *buffer, uint16_t *haptic_buffer, size_t frames,
+                                    size_t audio_channels, size_t haptic_channels,
+                                    size_t skip_channels)
+{
+    const size_t block = 8;
+    size_t blocks = frames / block;
+    const uint16_t *src = buffer;
+    uint16_t *dst = buffer;
+
+    if (audio_channels == 2 && haptic_channels == 1 && skip_channels == 0) {
+        for (size_t i = 0; i < blocks; i++, src += block * 3) {
+            uint16x8x3_t in = vld3q_u16(src);
+            uint16x8x2_t audio = { { in.val[0], in.val[1] } };
+            vst2q_u16(dst, audio);
+            vst1q_u16(haptic_buffer, in.val[2]);
+            dst += block * 2;
+            haptic_buffer += block;
+        }
+    } else if (audio_channels == 1 && haptic_channels == 1 && skip_channels == 1) {
+        for (size_t i = 0; i < blocks; i++, src += block * 3) {
+            uint16x8x3_t in = vld3q_u16(src);
+            vst1q_u16(dst, in.val[0]);
+            vst1q_u16(haptic_buffer, in.val[1]);
+            dst += block;
+            haptic_buffer += block;
+        }
+    } else if (audio_channels == 2 && haptic_channels == 2 && skip_channels == 0) {
+        for (size_t i = 0; i < blocks; i++, src += block * 4) {
+            uint16x8x4_t in = vld4q_u16(src);
+            uint16x8x2_t audio = { { in.val[0], in.val[1] } };
+            uint16x8x2_t haptic = { { in.val[2], in.val[3] } };
+            vst2q_u16(dst, audio);
+            vst2q_u16(haptic_buffer, haptic);
+            dst += block * 2;
+            haptic_buffer += block * 2;
+        }
+    } else {
+        return 0;
+    }
+    return blocks * block;
+}
+
+static size_t split_haptics_neon_32(uint32_t *buffer, uint32_t *haptic_buffer, size_t frames,
+                                    size_t audio_channels, size_t haptic_channels,
+                                    size_t skip_channels)
+{
+    const size_t block = 4;
+    size_t blocks = frames / block;
+    const uint32_t *src = buffer;
+    uint32_t *dst = buffer;
+
+    if (audio_channels == 2 && haptic_channels == 1 && skip_channels == 0) {
+        for (size_t i = 0; i < blocks; i++, src += block * 3) {
+            uint32x4x3_t in = vld3q_u32(src);
+            uint32x4x2_t audio = { { in.val[0], in.val[1] } };
+            vst2q_u32(dst, audio);
+            vst1q_u32(haptic_buffer, in.val[2]);
+            dst += block * 2;
+            haptic_buffer += block;
+        }
+    } else if (audio_channels == 1 && haptic_channels == 1 && skip_channels == 1) {
+        for (size_t i = 0; i < blocks; i++, src += block * 3) {
+            uint32x4x3_t in = vld3q_u32(src);
+            vst1q_u32(dst, in.val[0]);
+            vst1q_u32(haptic_buffer, in.val[1]);
+            dst += block;
+            haptic_buffer += block;
+        }
+    } else if (audio_channels == 2 && haptic_channels == 2 && skip_channels == 0) {
+        for (size_t i = 0; i < blocks; i++, src += block * 4) {
+            uint32x4x4_t in = vld4q_u32(src);
+            uint32x4x2_t audio = { { in.val[0], in.val[1] } };
+            uint32x4x2_t haptic = { { in.val[2], in.val[3] } };
+            vst2q_u32(dst, audio);
+            vst2q_u32(haptic_buffer, haptic);
+            dst += block * 2;
+            haptic_buffer += block * 2;
+        }
+    } else {
+        return 0;
+    }
+    return blocks * block;
+}
+#endif
+
+#ifdef PCM_KERNELS_SSE2
+/* SSE2 has no structured loads, the 3 sample layouts are deinterleaved with
+   32 bit lane shuffles. Integer data only moves through the float shuffles,
+   no arithmetic touches it. */
+#define SHUFFLE_32(a, b, imm) \
+        _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), (imm)))
+
+/* 4 frames of 2 audio and 1 haptic sample: L0 R0 H0 L1 | R1 H1 L2 R2 | H2 L3 R3 H3 */
+static inline void split_2_1_x4(__m128i v0, __m128i v1, __m128i v2,
+                                __m128i *audio0, __m128i *audio1, __m128i *haptic)
+{
+    __m128i l1r1 = SHUFFLE_32(v0, v1, _MM_SHUFFLE(0, 0, 3, 3));
+    __m128i h01 = SHUFFLE_32(v0, v1, _MM_SHUFFLE(1, 1, 2, 2));
+    __m128i h23 = SHUFFLE_32(v2, v2, _MM_SHUFFLE(3, 3, 0, 0));
+
+    *audio0 = SHUFFLE_32(v0, l1r1, _MM_SHUFFLE(2, 0, 1, 0));
+    *audio1 = SHUFFLE_32(v1, v2, _MM_SHUFFLE(2, 1, 3, 2));
+    *haptic = SHUFFLE_32(h01, h23, _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+/* 4 frames of 1 audio, 1 haptic and 1 skipped sample: A0 H0 S0 A1 | H1 S1 A2 H2 | S2 A3 H3 S3 */
+static inline void split_1_1_1_x4(__m128i v0, __m128i v1, __m128i v2,
+                                  __m128i *audio, __m128i *haptic)
+{
+    __m128i a01 = SHUFFLE_32(v0, v0, _MM_SHUFFLE(3, 3, 0, 0));
+    __m128i a23 = SHUFFLE_32(v1, v2, _MM_SHUFFLE(1, 1, 2, 2));
+    __m128i h01 = SHUFFLE_32(v0, v1, _MM_SHUFFLE(0, 0, 1, 1));
+    __m128i h23 = SHUFFLE_32(v1, v2, _MM_SHUFFLE(2, 2, 3, 3));
+
+    *audio = SHUFFLE_32(a01, a23, _MM_SHUFFLE(2, 0, 2, 0));
+    *haptic = SHUFFLE_32(h01, h23, _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+/* sign extends the low or high 4 samples to 32 bits, packs_epi32 narrows them back exactly */
+static inline __m128i widen_lo_16(__m128i v)
+{
+    return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+}
+
+static inline __m128i widen_hi_16(__m128i v)
+{
+    return _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+}
+
+/* returns the number of frames handled, the caller finishes the tail */
+static size_t split_haptics_sse2_16(uint16_t *buffer, uint16_t *haptic_buffer, size_t frames,
+                                    size_t audio_channels, size_t haptic_channels,
+                                    size_t skip_channels)
+{
+    const uint16_t *src = buffer;
+    uint16_t *dst = buffer;
+    size_t block;
+    size_t blocks;
+
+    if ((audio_channels == 2 && haptic_channels == 1 && skip_channels == 0) ||
+            (audio_channels == 1 && haptic_channels == 1 && skip_channels == 1)) {
+        block = 8;
+        blocks = frames / block;
+        for (size_t i = 0; i < blocks; i++, src += block * 3) {
+            __m128i in0 = _mm_loadu_si128((const __m128i *)src);
+            __m128i in1 = _mm_loadu_si128((const __m128i *)(src + 8));
+            __m128i in2 = _mm_loadu_si128((const __m128i *)(src + 16));
+            __m128i w0 = widen_lo_16(in0), w1 = widen_hi_16(in0), w2 = widen_lo_16(in1);
+            __m128i w3 = widen_hi_16(in1), w4 = widen_lo_16(in2), w5 = widen_hi_16(in2);
+            __m128i a0, a1, a2, a3, h0, h1;
+
+            if (audio_channels == 2) {
+                split_2_1_x4(w0, w1, w2, &a0, &a1, &h0);
+                split_2_1_x4(w3, w4, w5, &a2, &a3, &h1);
+                _mm_storeu_si128((__m128i *)dst, _mm_packs_epi32(a0, a1));
+                _mm_storeu_si128((__m128i *)(dst + 8), _mm_packs_epi32(a2, a3));
+            } else {
+                split_1_1_1_x4(w0, w1, w2, &a0, &h0);
+                split_1_1_1_x4(w3, w4, w5, &a1, &h1);
+                _mm_storeu_si128((__m128i *)dst, _mm_packs_epi32(a0, a1));
+            }
+            _mm_storeu_si128((__m128i *)haptic_buffer, _mm_packs_epi32(h0, h1));
+            dst += block * audio_channels;
+            haptic_buffer += block;
+        }
+    } else if (audio_channels == 2 && haptic_channels == 2 && skip_channels == 0) {
+        /* one frame is one 64 bit lane, audio and haptic pairs are 32 bit lanes */
+        block = 4;
+        blocks = frames / block;
+        for (size_t i = 0; i < blocks; i++, src += block * 4) {
+            __m128i in0 = _mm_loadu_si128((const __m128i *)src);
+            __m128i in1 = _mm_loadu_si128((const __m128i *)(src + 8));
+            in0 = _mm_shuffle_epi32(in0, _MM_SHUFFLE(3, 1, 2, 0));
+            in1 = _mm_shuffle_epi32(in1, _MM_SHUFFLE(3, 1, 2, 0));
+            _mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi64(in0, in1));
+            _mm_storeu_si128((__m128i *)haptic_buffer, _mm_unpackhi_epi64(in0, in1));
+            dst += block * 2;
+            haptic_buffer += block * 2;
+        }
+    } else {
+        return 0;
+    }
+    return blocks * block;
+}
+
+static size_t split_haptics_sse2_32(uint32_t *buffer, uint32_t *haptic_buffer, size_t frames,
+                                    size_t audio_channels, size_t haptic_channels,
+                                    size_t skip_channels)
+{
+    const uint32_t *src = buffer;
+    uint32_t *dst = buffer;
+    size_t block;
+    size_t blocks;
+
+    if (audio_channels == 2 && haptic_channels == 1 && skip_channels == 0) {
+        block = 4;
+        blocks = frames / block;
+        for (size_t i = 0; i < blocks; i++, src += block * 3) {
+            __m128i a0, a1, h;
+
+            split_2_1_x4(_mm_loadu_si128((const __m128i *)src),
+                         _mm_loadu_si128((const __m128i *)(src + 4)),
+                         _mm_loadu_si128((const __m128i *)(src + 8)), &a0, &a1, &h);
+            _mm_storeu_si128((__m128i *)dst, a0);
+            _mm_storeu_si128((__m128i *)(dst + 4), a1);
+            _mm_storeu_si128((__m128i *)haptic_buffer, h);
+            dst += block * 2;
+            haptic_buffer += block;
+        }
+    } else if (audio_channels == 1 && haptic_channels == 1 && skip_channels == 1) {
+        block = 4;
+        blocks = frames / block;
+        for (size_t i = 0; i < blocks; i++, src += block * 3) {
+            __m128i a, h;
+
+            split_1_1_1_x4(_mm_loadu_si128((const __m128i *)src),
+                           _mm_loadu_si128((const __m128i *)(src + 4)),
+                           _mm_loadu_si128((const __m128i *)(src + 8)), &a, &h);
+            _mm_storeu_si128((__m128i *)dst, a);
+            _mm_storeu_si128((__m128i *)haptic_buffer, h);
+            dst += block;
+            haptic_buffer += block;
+        }
+    } else if (audio_channels == 2 && haptic_channels == 2 && skip_channels == 0) {
+        /* one frame is one vector, audio and haptic pairs are its 64 bit lanes */
+        block = 2;
+        blocks = frames / block;
+        for (size_t i = 0; i < blocks; i++, src += block * 4) {
+            __m128i in0 = _mm_loadu_si128((const __m128i *)src);
+            __m128i in1 = _mm_loadu_si128((const __m128i *)(src + 4));
+            _mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi64(in0, in1));
+            _mm_storeu_si128((__m128i *)haptic_buffer, _mm_unpackhi_epi64(in0, in1));
+            dst += block * 2;
+            haptic_buffer += block * 2;
+        }
+    } else {
+        return 0;
+    }
+    return blocks * block;
+}
+#endif
+
+void pcm_kernels_split_haptics(void *buffer, void *haptic_buffer, size_t frames,
+                               size_t bytes_per_sample, size_t audio_channels,
+                               size_t haptic_channels, size_t skip_channels)
+{
+    size_t done = 0;
+
+#if defined(PCM_KERNELS_NEON)
+    /* the vector paths need naturally aligned samples */
+    if (((uintptr_t)buffer | (uintptr_t)haptic_buffer) % bytes_per_sample == 0) {
+        if (bytes_per_sample == 2)
+            done = split_haptics_neon_16((uint16_t *)buffer, (uint16_t *)haptic_buffer, frames,
+                                         audio_channels, haptic_channels, skip_channels);
+        else if (bytes_per_sample == 4)
+            done = split_haptics_neon_32((uint32_t *)buffer, (uint32_t *)haptic_buffer, frames,
+                                         audio_channels, haptic_channels, skip_channels);
+    }
+#elif defined(PCM_KERNELS_SSE2)
+    if (((uintptr_t)buffer | (uintptr_t)haptic_buffer) % bytes_per_sample == 0) {
+        if (bytes_per_sample == 2)
+            done = split_haptics_sse2_16((uint16_t *)buffer, (uint16_t *)haptic_buffer, frames,
+                                         audio_channels, haptic_channels, skip_channels);
+        else if (bytes_per_sample == 4)
+            done = split_haptics_sse2_32((uint32_t *)buffer, (uint32_t *)haptic_buffer, frames,
+                                         audio_channels, haptic_channels, skip_channels);
+    }
+#endif
+
+    if (done < frames) {
+        size_t src_frame_size =
+                (audio_channels + haptic_channels + skip_channels) * bytes_per_sample;
+
+        split_haptics_scalar((const uint8_t *)buffer + done * src_frame_size,
+                             (uint8_t *)buffer + done * audio_channels * bytes_per_sample,
+                             (uint8_t *)haptic_buffer + done * haptic_channels * bytes_per_sample,
+                             frames - done, bytes_per_sample,
+                             audio_channels, haptic_channels, skip_channels);
+    }
+}
+
+void pcm_kernels_downmix_to_mono_16(int16_t *dst, const int16_t *src, size_t frames)
+{
+    size_t i = 0;
+
+#if defined(PCM_KERNELS_NEON)
+    for (; i + 8 <= frames; i += 8) {
+        int16x8x2_t in = vld2q_s16(src + 2 * i);
+        /* halving add is (a + b) >> 1 computed without overflow */
+        vst1q_s16(dst + i, vhaddq_s16(in.val[0], in.val[1]));
+    }
+#elif defined(PCM_KERNELS_SSE2)
+    const __m128i ones = _mm_set1_epi16(1);
+    for (; i + 8 <= frames; i += 8) {
+        __m128i lo = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+        __m128i hi = _mm_loadu_si128((const __m128i *)(src + 2 * i + 8));
+        /* madd by one sums each L/R pair into 32 bits */
+        lo = _mm_srai_epi32(_mm_madd_epi16(lo, ones), 1);
+        hi = _mm_srai_epi32(_mm_madd_epi16(hi, ones), 1);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(lo, hi));
+    }
+#endif
+    for (; i < frames; i++) {
+        dst[i] = (int16_t)(((int32_t)src[2 * i] + (int32_t)src[2 * i + 1]) >> 1);
+    }
+}
+
+void pcm_kernels_shift_24_8_to_8_24(int32_t *buffer, size_t samples)
+{
+    size_t i = 0;
+
+#if defined(PCM_KERNELS_NEON)
+    for (; i + 4 <= samples; i += 4) {
+        vst1q_s32(buffer + i, vshrq_n_s32(vld1q_s32(buffer + i), 8));
+    }
+#elif defined(PCM_KERNELS_SSE2)
+    for (; i + 4 <= samples; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(buffer + i));
+        _mm_storeu_si128((__m128i *)(buffer + i), _mm_srai_epi32(v, 8));
+    }
+#endif
+    for (; i < samples; i++) {
+        buffer[i] >>= 8;
+    }
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PCM_KERNELS_H_
+#define PCM_KERNELS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Splits interleaved frames made of audio_channels audio samples, followed by
+ * haptic_channels haptic samples and skip_channels discarded samples.
+ * Audio samples are compacted in place at the start of buffer, haptic samples
+ * are written to haptic_buffer. bytes_per_sample is 2, 3 or 4.
+ */
+void pcm_kernels_split_haptics(void *buffer, void *haptic_buffer, size_t frames,
+                               size_t bytes_per_sample, size_t audio_channels,
+                               size_t haptic_channels, size_t skip_channels);
+
+/* Averages each stereo frame of src into one mono sample of dst.
+ * dst may be equal to src for an in place downmix.
+ */
+void pcm_kernels_downmix_to_mono_16(int16_t *dst, const int16_t *src, size_t frames);
+
+/* Converts samples in place from 24_8 (DSP capture) to 8_24 with an
+ * arithmetic right shift by 8.
+ */
+void pcm_kernels_shift_24_8_to_8_24(int32_t *buffer, size_t samples);
+
+#endif /* PCM_KERNELS_H_ */
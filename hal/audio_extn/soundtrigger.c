@@ -356,6 +356,13 @@ void audio_extn_sound_trigger_check_and_get_session(struct stream_in *in)
     pthread_mutex_unlock(&st_dev->lock);
 }
 
+bool audio_extn_sound_trigger_watches_device(snd_device_t snd_device)
+{
+    return st_dev != NULL &&
+           snd_device >= SND_DEVICE_IN_BEGIN && snd_device < SND_DEVICE_IN_END &&
+           snd_device != SND_DEVICE_IN_CAPTURE_VI_FEEDBACK;
+}
+
 void audio_extn_sound_trigger_update_device_status(snd_device_t snd_device,
                                      st_event_type_t event)
 {
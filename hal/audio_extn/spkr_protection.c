@@ -527,7 +527,7 @@ exit:
         handle.cancel_spkr_calib = 0;
         pthread_mutex_unlock(&handle.spkr_calib_cancelack_mutex);
         pthread_mutex_unlock(&handle.mutex_spkr_prot);
-        pthread_mutex_lock(&adev->lock);
+        adev_lock(adev, ADEV_LOCK_SITE_EXTN);
     }
 
     return status.status;
@@ -644,7 +644,7 @@ static void* spkr_calibration_thread()
             t0 = SAFE_SPKR_TEMP_Q6;
         }
         goahead = false;
-        pthread_mutex_lock(&adev->lock);
+        adev_lock(adev, ADEV_LOCK_SITE_EXTN);
         if (is_speaker_in_use(&sec)) {
             ALOGD("%s: Speaker in use retry calibration", __func__);
             pthread_mutex_unlock(&adev->lock);
@@ -53,6 +53,7 @@
 #include "audio_hw.h"
 #include "audio_extn.h"
 #include "audio_perf.h"
+#include "kv_parms.h"
 #include "platform_api.h"
 #include <platform.h>
 #include "voice_extn.h"
@@ -61,6 +62,7 @@
 #include "audio_extn/tfa_98xx.h"
 #include "audio_extn/maxxaudio.h"
 #include "audio_extn/audiozoom.h"
+#include "audio_extn/pcm_kernels.h"
 
 /* COMPRESS_OFFLOAD_FRAGMENT_SIZE must be more than 8KB and a multiple of 32KB if more than 32KB.
  * COMPRESS_OFFLOAD_FRAGMENT_SIZE * COMPRESS_OFFLOAD_NUM_FRAGMENTS must be less than 8MB. */
@@ -99,6 +101,24 @@
 
 #define ULL_PERIOD_SIZE (DEFAULT_OUTPUT_SAMPLING_RATE/1000)
 
+/* Power budget for warm standby: the hold-off is capped, and halved after
+ * every hold-off that expires without a write, down to the minimum. */
+#define WARM_STANDBY_MAX_HOLD_MS 10000
+#define WARM_STANDBY_MIN_HOLD_MS 100
+
+/* Age after which out_write() resamples the kernel position instead of
+ * advancing the last sample by the frames written. */
+#define OUT_POSITION_MAX_AGE_MS 500
+
+/* Defaults for the low latency period tuner, see period_tuner.h */
+#define PERIOD_TUNER_MIN_COUNT 2
+#define PERIOD_TUNER_MAX_COUNT 8
+#define PERIOD_TUNER_SHRINK_AFTER 8
+#define PERIOD_TUNER_MIN_SESSION_MS 2000
+#define PERIOD_TUNER_HIGH_CPU_PRESSURE 20
+/* PSI avg10 covers 10 s, a sample that recent is reused instead of reread */
+#define PERIOD_TUNER_CPU_PRESSURE_MAX_AGE_MS 10000
+
 static unsigned int configured_low_latency_capture_period_size =
         LOW_LATENCY_CAPTURE_PERIOD_SIZE;
 
@@ -348,6 +368,59 @@ static const struct string_to_enum channels_name_to_enum_table[] = {
     STRING_TO_ENUM(AUDIO_CHANNEL_INDEX_MASK_8),
 };
 
+/* Keys the set_parameters() entry points act on, see kv_parms.h */
+enum {
+    SET_PARAM_ROUTING,
+    SET_PARAM_INPUT_SOURCE,
+    SET_PARAM_CARD,
+    SET_PARAM_BT_NREC,
+    SET_PARAM_SCREEN_STATE,
+    SET_PARAM_ROTATION,
+    SET_PARAM_BT_SCO_WB,
+    SET_PARAM_BT_SCO,
+    SET_PARAM_DEVICE_CONNECT,
+    SET_PARAM_DEVICE_DISCONNECT,
+    SET_PARAM_CAMERA_FACING,
+    SET_PARAM_A2DP_SUSPENDED,
+    SET_PARAM_A2DP_RECONFIG,
+    SET_PARAM_COUNT,
+};
+
+/* Subsystems adev_set_parameters() hands the key/value pairs to. Keys
+ * missing from the table go to all of them, as they used to. */
+#define PARAM_CONSUMER_ADEV     (1u << 0)
+#define PARAM_CONSUMER_VOICE    (1u << 1)
+#define PARAM_CONSUMER_HFP      (1u << 2)
+#define PARAM_CONSUMER_MA       (1u << 3)
+#define PARAM_CONSUMER_A2DP     (1u << 4)
+#define PARAM_CONSUMER_ALL      (PARAM_CONSUMER_ADEV | PARAM_CONSUMER_VOICE | \
+                                 PARAM_CONSUMER_HFP | PARAM_CONSUMER_MA | \
+                                 PARAM_CONSUMER_A2DP)
+
+static const struct kv_keyword set_param_keywords[SET_PARAM_COUNT] = {
+    [SET_PARAM_ROUTING] = KV_KEYWORD(AUDIO_PARAMETER_STREAM_ROUTING, PARAM_CONSUMER_HFP),
+    [SET_PARAM_INPUT_SOURCE] = KV_KEYWORD(AUDIO_PARAMETER_STREAM_INPUT_SOURCE, 0),
+    [SET_PARAM_CARD] = KV_KEYWORD("card", PARAM_CONSUMER_ADEV | PARAM_CONSUMER_MA),
+    [SET_PARAM_BT_NREC] = KV_KEYWORD(AUDIO_PARAMETER_KEY_BT_NREC, PARAM_CONSUMER_ADEV),
+    [SET_PARAM_SCREEN_STATE] = KV_KEYWORD("screen_state", PARAM_CONSUMER_ADEV),
+    [SET_PARAM_ROTATION] = KV_KEYWORD("rotation", PARAM_CONSUMER_ADEV | PARAM_CONSUMER_MA),
+    [SET_PARAM_BT_SCO_WB] = KV_KEYWORD(AUDIO_PARAMETER_KEY_BT_SCO_WB, PARAM_CONSUMER_ADEV),
+    [SET_PARAM_BT_SCO] = KV_KEYWORD("BT_SCO", PARAM_CONSUMER_ADEV),
+    [SET_PARAM_DEVICE_CONNECT] = KV_KEYWORD(AUDIO_PARAMETER_DEVICE_CONNECT,
+            PARAM_CONSUMER_ADEV | PARAM_CONSUMER_MA | PARAM_CONSUMER_A2DP),
+    [SET_PARAM_DEVICE_DISCONNECT] = KV_KEYWORD(AUDIO_PARAMETER_DEVICE_DISCONNECT,
+            PARAM_CONSUMER_ADEV | PARAM_CONSUMER_MA | PARAM_CONSUMER_A2DP),
+    [SET_PARAM_CAMERA_FACING] = KV_KEYWORD(AUDIO_PARAMETER_KEY_CAMERA_FACING,
+            PARAM_CONSUMER_ADEV),
+    [SET_PARAM_A2DP_SUSPENDED] = KV_KEYWORD("A2dpSuspended", PARAM_CONSUMER_A2DP),
+    [SET_PARAM_A2DP_RECONFIG] = KV_KEYWORD(AUDIO_PARAMETER_RECONFIG_A2DP, PARAM_CONSUMER_A2DP),
+};
+
+static void set_param_parse(struct kv_parms *parms, const char *kvpairs)
+{
+    kv_parms_parse(parms, kvpairs, set_param_keywords, SET_PARAM_COUNT, PARAM_CONSUMER_ALL);
+}
+
 struct in_effect_list {
     struct listnode list;
     effect_handle_t handle;
@@ -367,6 +440,7 @@ static int out_set_pcm_volume(struct audio_stream_out *stream, float left, float
 static int in_set_microphone_direction(const struct audio_stream_in *stream,
                                            audio_microphone_direction_t dir);
 static int in_set_microphone_field_dimension(const struct audio_stream_in *stream, float zoom);
+static void adev_wait_for_init_libs(struct audio_device *adev);
 
 static bool may_use_noirq_mode(struct audio_device *adev, audio_usecase_t uc_id,
                                int flags __unused)
@@ -505,7 +579,7 @@ bool audio_hw_send_gain_dep_calibration(int level) {
     pthread_mutex_lock(&adev_init_lock);
 
     if (adev != NULL && adev->platform != NULL) {
-        pthread_mutex_lock(&adev->lock);
+        adev_lock(adev, ADEV_LOCK_SITE_EXTN);
         last_known_cal_step = level;
         send_gain_dep_calibration_l();
         pthread_mutex_unlock(&adev->lock);
@@ -528,7 +602,7 @@ bool audio_hw_send_ma_parameter(int stream_type, float vol, bool active)
     pthread_mutex_lock(&adev_init_lock);
 
     if (adev != NULL && adev->platform != NULL) {
-        pthread_mutex_lock(&adev->lock);
+        adev_lock(adev, ADEV_LOCK_SITE_EXTN);
         ret = audio_extn_ma_set_state(adev, stream_type, vol, active);
         pthread_mutex_unlock(&adev->lock);
     }
@@ -554,9 +628,8 @@ int audio_hw_get_gain_level_mapping(struct amp_db_and_gain_table *mapping_tbl,
          goto done;
      }
 
-     pthread_mutex_lock(&adev->lock);
+     // the gain level table is immutable once adev_open() returns
      ret_val = platform_get_gain_level_mapping(mapping_tbl, table_size);
-     pthread_mutex_unlock(&adev->lock);
 done:
      pthread_mutex_unlock(&adev_init_lock);
      ALOGV("%s: exit ... ", __func__);
@@ -648,6 +721,105 @@ static bool is_a2dp_device(snd_device_t out_snd_device)
    return out_snd_device == SND_DEVICE_OUT_BT_A2DP;
 }
 
+/*
+ * Routing transactions: between route_transaction_begin() and
+ * route_transaction_commit() mixer path applies and resets are queued in
+ * call order instead of being written. An apply queued right after a reset
+ * of the same path, or the reverse, collapse into the later operation: it
+ * alone decides the final value of every control of the path and writes
+ * nothing unless a path outside the transaction changed one of them.
+ * Disables and enables nest (route, device, device, route) so a usecase
+ * re-routed on an unchanged backend collapses completely.
+ * The remaining operations are replayed one path at a time, so each path
+ * keeps its own control order (resets in reverse) and disables still
+ * precede the enables that followed them. route_transaction_flush() is a
+ * barrier for code that needs the hardware to reflect the routing so far.
+ */
+static void route_transaction_begin(struct audio_device *adev)
+{
+    adev->route_txn_depth++;
+}
+
+static void route_transaction_flush(struct audio_device *adev)
+{
+    int i;
+
+    for (i = 0; i < adev->route_txn_num_ops; i++) {
+        const struct route_txn_op *op = &adev->route_txn_ops[i];
+
+        if (op->apply)
+            audio_route_apply_and_update_path(adev->audio_route, op->name);
+        else
+            audio_route_reset_and_update_path(adev->audio_route, op->name);
+        adev->route_paths_updated++;
+    }
+    adev->route_txn_num_ops = 0;
+}
+
+static void route_transaction_commit(struct audio_device *adev)
+{
+    if (--adev->route_txn_depth == 0)
+        route_transaction_flush(adev);
+}
+
+/* Queues a path operation, returns false if it must be written right away */
+static bool route_transaction_queue(struct audio_device *adev, const char *name,
+                                    bool apply)
+{
+    int i;
+
+    if (adev->route_txn_depth == 0 || strlen(name) >= ROUTE_TXN_PATH_MAX_LENGTH)
+        return false;
+
+    /* collapse with the latest pending operation only, looking through
+       collapsed ones, so no other path touching the same controls is
+       written in between. Both operations cannot simply be dropped: a path
+       outside the transaction may have overwritten shared controls since
+       this one was applied. */
+    for (i = adev->route_txn_num_ops - 1; i >= 0; i--) {
+        struct route_txn_op *op = &adev->route_txn_ops[i];
+
+        if (op->apply != apply && strcmp(op->name, name) == 0) {
+            /* move it last to keep the enable order */
+            memmove(op, op + 1, (adev->route_txn_num_ops - i - 1) * sizeof(*op));
+            op = &adev->route_txn_ops[adev->route_txn_num_ops - 1];
+            strlcpy(op->name, name, ROUTE_TXN_PATH_MAX_LENGTH);
+            op->apply = apply;
+            op->collapsed = true;
+            return true;
+        }
+        if (!op->collapsed)
+            break;
+    }
+
+    if (adev->route_txn_num_ops == ROUTE_TXN_MAX_OPS)
+        route_transaction_flush(adev);
+    strlcpy(adev->route_txn_ops[adev->route_txn_num_ops].name, name,
+            ROUTE_TXN_PATH_MAX_LENGTH);
+    adev->route_txn_ops[adev->route_txn_num_ops].apply = apply;
+    adev->route_txn_ops[adev->route_txn_num_ops].collapsed = false;
+    adev->route_txn_num_ops++;
+    return true;
+}
+
+static void route_apply_and_update_path(struct audio_device *adev, const char *name)
+{
+    if (route_transaction_queue(adev, name, true))
+        return;
+    route_transaction_flush(adev);
+    audio_route_apply_and_update_path(adev->audio_route, name);
+    adev->route_paths_updated++;
+}
+
+static void route_reset_and_update_path(struct audio_device *adev, const char *name)
+{
+    if (route_transaction_queue(adev, name, false))
+        return;
+    route_transaction_flush(adev);
+    audio_route_reset_and_update_path(adev->audio_route, name);
+    adev->route_paths_updated++;
+}
+
 int enable_audio_route(struct audio_device *adev,
                        struct audio_usecase *usecase)
 {
@@ -686,6 +858,8 @@ int enable_audio_route(struct audio_device *adev,
                         }
                     }
                 }
+                // the echo reference path is written directly
+                route_transaction_flush(adev);
                 platform_set_echo_reference(adev, true, out_device);
                 in->ec_opened = true;
             }
@@ -703,7 +877,7 @@ int enable_audio_route(struct audio_device *adev,
     platform_add_backend_name(adev->platform, mixer_path, snd_device);
 
     ALOGD("%s: usecase(%d) apply and update mixer path: %s", __func__,  usecase->id, mixer_path);
-    audio_route_apply_and_update_path(adev->audio_route, mixer_path);
+    route_apply_and_update_path(adev, mixer_path);
 
     ALOGV("%s: exit", __func__);
     return 0;
@@ -731,10 +905,11 @@ int disable_audio_route(struct audio_device *adev,
     platform_add_backend_name(adev->platform, mixer_path, snd_device);
     ALOGD("%s: usecase(%d) reset and update mixer path: %s", __func__, usecase->id, mixer_path);
 
-    audio_route_reset_and_update_path(adev->audio_route, mixer_path);
+    route_reset_and_update_path(adev, mixer_path);
     if (usecase->type == PCM_CAPTURE) {
         struct stream_in *in = usecase->stream.in;
         if (in && in->ec_opened) {
+            route_transaction_flush(adev);
             platform_set_echo_reference(in->dev, false, AUDIO_DEVICE_NONE);
             in->ec_opened = false;
         }
@@ -783,6 +958,8 @@ int enable_snd_device(struct audio_device *adev,
         if (platform_get_snd_device_acdb_id(snd_device) < 0) {
             goto on_error;
         }
+        // speaker protection starts its own sessions on the current routing
+        route_transaction_flush(adev);
         if (audio_extn_spkr_prot_start_processing(snd_device)) {
             ALOGE("%s: spkr_start_processing failed", __func__);
             goto on_error;
@@ -793,6 +970,8 @@ int enable_snd_device(struct audio_device *adev,
         for (i = 0; i < num_devices; i++) {
             enable_snd_device(adev, new_snd_devices[i]);
         }
+        // the combo gain path is written directly and must land after the speaker path
+        route_transaction_flush(adev);
         platform_set_speaker_gain_in_combo(adev, snd_device, true);
     } else {
         char device_name[DEVICE_NAME_MAX_SIZE] = {0};
@@ -803,13 +982,15 @@ int enable_snd_device(struct audio_device *adev,
 
         ALOGD("%s: snd_device(%d: %s)", __func__, snd_device, device_name);
 
+        if (is_a2dp_device(snd_device))
+            route_transaction_flush(adev);
         if (is_a2dp_device(snd_device) &&
             (audio_extn_a2dp_start_playback() < 0)) {
                ALOGE("%s: failed to configure A2DP control path", __func__);
                goto on_error;
         }
 
-        audio_route_apply_and_update_path(adev->audio_route, device_name);
+        route_apply_and_update_path(adev, device_name);
     }
 on_success:
     adev->snd_dev_ref_cnt[snd_device]++;
@@ -862,6 +1043,7 @@ int disable_snd_device(struct audio_device *adev,
             for (i = 0; i < num_devices; i++) {
                 disable_snd_device(adev, new_snd_devices[i]);
             }
+            route_transaction_flush(adev);
             platform_set_speaker_gain_in_combo(adev, snd_device, false);
         } else {
             char device_name[DEVICE_NAME_MAX_SIZE] = {0};
@@ -871,8 +1053,11 @@ int disable_snd_device(struct audio_device *adev,
             }
 
             ALOGD("%s: snd_device(%d: %s)", __func__, snd_device, device_name);
-            audio_route_reset_and_update_path(adev->audio_route, device_name);
+            route_reset_and_update_path(adev, device_name);
         }
+        // sound trigger may take the device over as soon as it is told it is free
+        if (audio_extn_sound_trigger_watches_device(snd_device))
+            route_transaction_flush(adev);
         audio_extn_sound_trigger_update_device_status(snd_device,
                                         ST_EVENT_SND_DEVICE_FREE);
     }
@@ -1451,7 +1636,7 @@ static bool is_usb_ready(struct audio_device *adev, bool is_playback)
     // The usb device may have been removed quickly after insertion and hence
     // no longer available.  This will show up as empty channel masks, or rates.
 
-    pthread_mutex_lock(&adev->lock);
+    adev_lock(adev, ADEV_LOCK_SITE_EXTN);
     uint32_t supported_sample_rate;
 
     // we consider usb ready if we can fetch at least one sample rate.
@@ -1772,6 +1957,14 @@ int select_devices_with_force_switch(struct audio_device *adev,
         adev->last_logged_snd_device[uc_id][1] = in_snd_device;
     }
 
+    const int64_t switch_start_ns = systemTime(SYSTEM_TIME_MONOTONIC);
+    const unsigned int switch_start_paths = adev->route_paths_updated;
+
+    /* Batch all route and device changes of this switch, including the
+       usecases moved along by check_and_route_*_usecases(), so that paths
+       disabled and re-enabled on the same backend collapse. */
+    route_transaction_begin(adev);
+
     /*
      * Limitation: While in call, to do a device switch we need to disable
      * and enable both RX and TX devices though one of them is same as current
@@ -1797,6 +1990,15 @@ int select_devices_with_force_switch(struct audio_device *adev,
         disable_snd_device(adev, usecase->in_snd_device);
     }
 
+    /* Tear down the old devices first when moving to another backend, or when
+       the voice call needs the modem informed in between, to avoid pops. */
+    if (usecase->type == VOICE_CALL ||
+        (usecase->out_snd_device != SND_DEVICE_NONE && out_snd_device != SND_DEVICE_NONE &&
+         !platform_check_backends_match(usecase->out_snd_device, out_snd_device)) ||
+        (usecase->in_snd_device != SND_DEVICE_NONE && in_snd_device != SND_DEVICE_NONE &&
+         !platform_check_backends_match(usecase->in_snd_device, in_snd_device)))
+        route_transaction_flush(adev);
+
     /* Applicable only on the targets that has external modem.
      * New device information should be sent to modem before enabling
      * the devices to reduce in-call device switch time.
@@ -1823,10 +2025,12 @@ int select_devices_with_force_switch(struct audio_device *adev,
         enable_snd_device(adev, in_snd_device);
     }
 
-    if (usecase->type == VOICE_CALL)
+    if (usecase->type == VOICE_CALL) {
+        route_transaction_flush(adev);
         status = platform_switch_voice_call_device_post(adev->platform,
                                                         out_snd_device,
                                                         in_snd_device);
+    }
 
     usecase->in_snd_device = in_snd_device;
     usecase->out_snd_device = out_snd_device;
@@ -1834,6 +2038,16 @@ int select_devices_with_force_switch(struct audio_device *adev,
     audio_extn_tfa_98xx_set_mode();
 
     enable_audio_route(adev, usecase);
+    route_transaction_commit(adev);
+
+    const double switch_ms = (systemTime(SYSTEM_TIME_MONOTONIC) - switch_start_ns) * 1e-6;
+    const unsigned int switch_paths = adev->route_paths_updated - switch_start_paths;
+    simple_stats_log(&adev->route_switch_latency_ms, switch_ms);
+    latency_histogram_log_ns(&adev->select_devices_hist,
+                             systemTime(SYSTEM_TIME_MONOTONIC) - switch_start_ns);
+    simple_stats_log(&adev->route_switch_paths, switch_paths);
+    ALOGV("%s: usecase %s switched in %.2f ms, %u mixer paths updated",
+          __func__, use_case_table[uc_id], switch_ms, switch_paths);
 
     /* If input stream is already running the effect needs to be
        applied on the new input device that's being enabled here.  */
@@ -2018,6 +2232,10 @@ int start_input_stream(struct stream_in *in)
                 goto error_open;
             }
         }
+        // failure to start the async reader falls back to synchronous pcm_read()
+        ret = audio_extn_async_pcm_capture_open(in);
+        if (ret != 0)
+            ALOGW("%s: async capture not started ret %d", __func__, ret);
     }
     register_in_stream(in);
     check_and_enable_effect(adev);
@@ -2053,16 +2271,54 @@ void lock_output_stream(struct stream_out *out)
     pthread_mutex_unlock(&out->pre_lock);
 }
 
+void adev_lock(struct audio_device *adev, adev_lock_site_t site)
+{
+    struct adev_lock_stats *stats = &adev->lock_stats[site];
+
+    // uncontended acquisitions are not timed
+    if (pthread_mutex_trylock(&adev->lock) != 0) {
+        const int64_t start_ns = systemTime(SYSTEM_TIME_MONOTONIC);
+        pthread_mutex_lock(&adev->lock);
+        const int64_t wait_ns = systemTime(SYSTEM_TIME_MONOTONIC) - start_ns;
+        stats->contended++;
+        stats->wait_ns += wait_ns;
+        if (wait_ns > stats->max_wait_ns)
+            stats->max_wait_ns = wait_ns;
+    }
+    stats->acquired++;
+}
+
 /* must be called with out->lock locked */
 static int send_offload_cmd_l(struct stream_out* out, int command)
 {
-    struct offload_cmd *cmd = (struct offload_cmd *)calloc(1, sizeof(struct offload_cmd));
-
     ALOGVV("%s %d", __func__, command);
 
-    cmd->cmd = command;
-    list_add_tail(&out->offload_cmd_list, &cmd->node);
-    pthread_cond_signal(&out->offload_cond);
+    /* EXIT is out of band so that a full ring can never lose it */
+    if (command == OFFLOAD_CMD_EXIT) {
+        out->offload_thread_exit = true;
+        pthread_cond_signal(&out->offload_cond);
+        return 0;
+    }
+
+    /* one WRITE_READY callback releases every write waiting on the DSP */
+    if (command == OFFLOAD_CMD_WAIT_FOR_BUFFER && out->offload_wait_queued)
+        return 0;
+
+    if (out->offload_cmd_count == OFFLOAD_CMD_RING_SIZE) {
+        ALOGE("%s: command ring full, dropping command %d", __func__, command);
+        return -ENOSPC;
+    }
+
+    out->offload_cmds[(out->offload_cmd_head + out->offload_cmd_count) %
+                      OFFLOAD_CMD_RING_SIZE] = command;
+    out->offload_cmd_count++;
+    if (command == OFFLOAD_CMD_WAIT_FOR_BUFFER)
+        out->offload_wait_queued = true;
+
+    /* the thread only sleeps on offload_cond with an empty ring, there is
+       nobody to wake while it is busy with a previous command */
+    if (out->offload_thread_idle)
+        pthread_cond_signal(&out->offload_cond);
     return 0;
 }
 
@@ -2083,7 +2339,6 @@ static void stop_compressed_output_l(struct stream_out *out)
 static void *offload_thread_loop(void *context)
 {
     struct stream_out *out = (struct stream_out *) context;
-    struct listnode *item;
 
     setpriority(PRIO_PROCESS, 0, ANDROID_PRIORITY_AUDIO);
     set_sched_policy(0, SP_FOREGROUND);
@@ -2092,45 +2347,42 @@ static void *offload_thread_loop(void *context)
     ALOGV("%s", __func__);
 
     lock_output_stream(out);
-    out->offload_state = OFFLOAD_STATE_IDLE;
-    out->playback_started = 0;
     for (;;) {
-        struct offload_cmd *cmd = NULL;
+        int cmd;
         stream_callback_event_t event;
         bool send_callback = false;
 
-        ALOGVV("%s offload_cmd_list %d out->offload_state %d",
-              __func__, list_empty(&out->offload_cmd_list),
-              out->offload_state);
-        if (list_empty(&out->offload_cmd_list)) {
+        ALOGVV("%s offload_cmd_count %u out->offload_state %d",
+              __func__, out->offload_cmd_count, out->offload_state);
+        if (out->offload_thread_exit)
+            break;
+        if (out->offload_cmd_count == 0) {
             ALOGV("%s SLEEPING", __func__);
+            out->offload_thread_idle = true;
             pthread_cond_wait(&out->offload_cond, &out->lock);
+            out->offload_thread_idle = false;
             ALOGV("%s RUNNING", __func__);
             continue;
         }
 
-        item = list_head(&out->offload_cmd_list);
-        cmd = node_to_item(item, struct offload_cmd, node);
-        list_remove(item);
+        cmd = out->offload_cmds[out->offload_cmd_head];
+        out->offload_cmd_head = (out->offload_cmd_head + 1) % OFFLOAD_CMD_RING_SIZE;
+        out->offload_cmd_count--;
+        if (cmd == OFFLOAD_CMD_WAIT_FOR_BUFFER)
+            out->offload_wait_queued = false;
 
         ALOGVV("%s STATE %d CMD %d out->compr %p",
-               __func__, out->offload_state, cmd->cmd, out->compr);
-
-        if (cmd->cmd == OFFLOAD_CMD_EXIT) {
-            free(cmd);
-            break;
-        }
+               __func__, out->offload_state, cmd, out->compr);
 
         if (out->compr == NULL) {
             ALOGE("%s: Compress handle is NULL", __func__);
-            free(cmd);
             pthread_cond_signal(&out->cond);
             continue;
         }
         out->offload_thread_blocked = true;
         pthread_mutex_unlock(&out->lock);
         send_callback = false;
-        switch (cmd->cmd) {
+        switch (cmd) {
         case OFFLOAD_CMD_WAIT_FOR_BUFFER:
             compress_wait(out->compr, -1);
             send_callback = true;
@@ -2154,7 +2406,7 @@ static void *offload_thread_loop(void *context)
             event = STREAM_CBK_EVENT_ERROR;
             break;
         default:
-            ALOGE("%s unknown command received: %d", __func__, cmd->cmd);
+            ALOGE("%s unknown command received: %d", __func__, cmd);
             break;
         }
         lock_output_stream(out);
@@ -2164,15 +2416,11 @@ static void *offload_thread_loop(void *context)
             ALOGVV("%s: sending offload_callback event %d", __func__, event);
             out->offload_callback(event, NULL, out->offload_cookie);
         }
-        free(cmd);
     }
 
     pthread_cond_signal(&out->cond);
-    while (!list_empty(&out->offload_cmd_list)) {
-        item = list_head(&out->offload_cmd_list);
-        list_remove(item);
-        free(node_to_item(item, struct offload_cmd, node));
-    }
+    out->offload_cmd_count = 0;
+    out->offload_wait_queued = false;
     pthread_mutex_unlock(&out->lock);
 
     return NULL;
@@ -2181,7 +2429,14 @@ static void *offload_thread_loop(void *context)
 static int create_offload_callback_thread(struct stream_out *out)
 {
     pthread_cond_init(&out->offload_cond, (const pthread_condattr_t *) NULL);
-    list_init(&out->offload_cmd_list);
+    /* before the thread runs, a write may start playback ahead of it */
+    out->offload_state = OFFLOAD_STATE_IDLE;
+    out->playback_started = 0;
+    out->offload_cmd_head = 0;
+    out->offload_cmd_count = 0;
+    out->offload_wait_queued = false;
+    out->offload_thread_idle = false;
+    out->offload_thread_exit = false;
     pthread_create(&out->offload_thread, (const pthread_attr_t *) NULL,
                     offload_thread_loop, out);
     return 0;
@@ -2345,8 +2600,9 @@ static int stop_output_stream(struct stream_out *out)
             adev->visualizer_stop_output(out->handle, out->pcm_device_id);
         if (adev->offload_effects_stop_output != NULL)
             adev->offload_effects_stop_output(out->handle, out->pcm_device_id);
-    } else if (out->usecase == USECASE_AUDIO_PLAYBACK_ULL ||
+    } else if ((out->usecase == USECASE_AUDIO_PLAYBACK_ULL && !out->warm_standby) ||
                out->usecase == USECASE_AUDIO_PLAYBACK_MMAP) {
+        // a warm ULL stream ended its hint when it was parked
         audio_low_latency_hint_end();
     }
 
@@ -2511,6 +2767,7 @@ int start_output_stream(struct stream_out *out)
     audio_streaming_hint_start();
     audio_extn_perf_lock_acquire();
 
+    const int64_t route_start_ns = systemTime(SYSTEM_TIME_MONOTONIC);
     if ((out->devices & AUDIO_DEVICE_OUT_ALL_A2DP) &&
         (!audio_extn_a2dp_is_ready())) {
         if (!a2dp_combo) {
@@ -2529,6 +2786,8 @@ int start_output_stream(struct stream_out *out)
     }
 
     audio_extn_extspk_update(adev->extspk);
+    simple_stats_log(&out->start_route_ms,
+                     (systemTime(SYSTEM_TIME_MONOTONIC) - route_start_ns) * 1e-6);
 
     if (out->usecase == USECASE_INCALL_MUSIC_UPLINK ||
         out->usecase == USECASE_INCALL_MUSIC_UPLINK2) {
@@ -2579,8 +2838,11 @@ int start_output_stream(struct stream_out *out)
             pcm_open_retry_count = PROXY_OPEN_RETRY_COUNT;
         } else if (out->realtime) {
             flags |= PCM_MMAP | PCM_NOIRQ;
+        } else if (out->mmap_fill) {
+            flags |= PCM_MMAP;
         }
 
+        const int64_t pcm_open_start_ns = systemTime(SYSTEM_TIME_MONOTONIC);
         out->pcm = pcm_open_prepare_helper(adev->snd_card, out->pcm_device_id,
                                        flags, pcm_open_retry_count,
                                        &(out->config));
@@ -2588,6 +2850,8 @@ int start_output_stream(struct stream_out *out)
            ret = -EIO;
            goto error_open;
         }
+        simple_stats_log(&out->start_pcm_open_ms,
+                         (systemTime(SYSTEM_TIME_MONOTONIC) - pcm_open_start_ns) * 1e-6);
 
         if (out->usecase == USECASE_AUDIO_PLAYBACK_WITH_HAPTICS) {
             if (adev->haptic_pcm != NULL) {
@@ -2616,6 +2880,10 @@ int start_output_stream(struct stream_out *out)
                 || out->usecase == USECASE_AUDIO_PLAYBACK_ULL)) {
            out_set_pcm_volume(&out->stream, out->volume_l, out->volume_r);
          }
+        // failure to start the async writer falls back to synchronous pcm_write()
+        ret = audio_extn_async_pcm_open(out);
+        if (ret != 0)
+            ALOGW("%s: async pcm not started ret %d", __func__, ret);
     }
 
     register_out_stream(out);
@@ -2797,18 +3065,359 @@ static int out_set_format(struct audio_stream *stream __unused, audio_format_t f
     return -ENOSYS;
 }
 
+/* must be called with out->lock held */
+static void out_publish_position_l(struct stream_out *out, int64_t written, int64_t fifo_frames,
+                                   int64_t latency_frames, int64_t time_ns)
+{
+    struct out_position_snapshot *snap = &out->position;
+    const unsigned int seq = atomic_load_explicit(&snap->seq, memory_order_relaxed);
+
+    atomic_store_explicit(&snap->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&snap->written, written, memory_order_relaxed);
+    atomic_store_explicit(&snap->fifo_frames, fifo_frames, memory_order_relaxed);
+    atomic_store_explicit(&snap->latency_frames, latency_frames, memory_order_relaxed);
+    atomic_store_explicit(&snap->time_ns, time_ns, memory_order_relaxed);
+    atomic_store_explicit(&snap->seq, seq + 2, memory_order_release);
+}
+
+/* Lock free. With check_drain, a position older than the frames it had queued
+   is refused, as the pipeline may have drained since. */
+static int out_read_position(struct stream_out *out, bool check_drain,
+                             uint64_t *frames, struct timespec *timestamp)
+{
+    struct out_position_snapshot *snap = &out->position;
+    unsigned int seq;
+    int64_t written, fifo_frames, latency_frames, time_ns;
+
+    do {
+        seq = atomic_load_explicit(&snap->seq, memory_order_acquire);
+        written = atomic_load_explicit(&snap->written, memory_order_relaxed);
+        fifo_frames = atomic_load_explicit(&snap->fifo_frames, memory_order_relaxed);
+        latency_frames = atomic_load_explicit(&snap->latency_frames, memory_order_relaxed);
+        time_ns = atomic_load_explicit(&snap->time_ns, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+    } while ((seq & 1) != 0 || seq != atomic_load_explicit(&snap->seq, memory_order_relaxed));
+
+    if (time_ns == 0)
+        return -ENODATA;
+    if (check_drain && systemTime(SYSTEM_TIME_MONOTONIC) - time_ns >
+            fifo_frames * NANOS_PER_SECOND / out->config.rate)
+        return -ENODATA;
+
+    // It would be unusual for this value to be negative, but check just in case ...
+    const int64_t signed_frames = written - fifo_frames - latency_frames;
+    if (signed_frames < 0)
+        return -ENODATA;
+
+    *frames = signed_frames;
+    timestamp->tv_sec = time_ns / NANOS_PER_SECOND;
+    timestamp->tv_nsec = time_ns % NANOS_PER_SECOND;
+    return 0;
+}
+
+/* must be called with out->lock held, PCM usecases only.
+   Samples the kernel position and publishes it for out_read_position(). */
+static int out_update_position_l(struct stream_out *out)
+{
+    struct timespec timestamp;
+    unsigned int avail;
+    unsigned int pending_frames = 0;
+
+    // a warm pcm may be closed under adev->lock alone, standby covers it
+    if (out->standby || out->pcm == NULL)
+        return -ENODATA;
+    // the async writer thread owns the pcm, it samples the kernel and its ring together
+    if (out->async_pcm != NULL) {
+        if (audio_extn_async_pcm_get_htimestamp(out, &avail, &timestamp, &pending_frames) != 0)
+            return -ENODATA;
+    } else if (pcm_get_htimestamp(out->pcm, &avail, &timestamp) != 0) {
+        return -ENODATA;
+    }
+
+    // pcm_get_htimestamp() computes the available frames by comparing
+    // the alsa driver hw_ptr and the appl_ptr levels.
+    // In underrun, the hw_ptr may keep running and report an excessively
+    // large number available number.
+    if (avail > out->kernel_buffer_size) {
+        ALOGW("%s: avail:%u > kernel_buffer_size:%zu clamping!",
+                __func__, avail, out->kernel_buffer_size);
+        avail = out->kernel_buffer_size;
+        out->last_fifo_frames_remaining = 0;
+    } else {
+        out->last_fifo_frames_remaining = out->kernel_buffer_size - avail;
+    }
+    // frames queued to the async writer were not in the kernel yet
+    out->last_fifo_frames_remaining += pending_frames;
+    out->last_fifo_valid = true;
+    out->last_fifo_time_ns = audio_utils_ns_from_timespec(&timestamp);
+
+    // This adjustment accounts for buffering after app processor.
+    // It is based on estimated DSP latency per use case, rather than exact.
+    int64_t latency_frames = platform_render_latency(out) * out->sample_rate / 1000000LL;
+
+    // Adjustment accounts for A2DP encoder latency with non-offload usecases
+    // Note: Encoder latency is returned in ms, while platform_render_latency in us.
+    if (AUDIO_DEVICE_OUT_ALL_A2DP & out->devices)
+        latency_frames += audio_extn_a2dp_get_encoder_latency() * out->sample_rate / 1000;
+
+    ALOGVV("%s: written:%lld  avail:%u  kernel_buffer_size:%zu", __func__,
+           (long long)out->written, avail, out->kernel_buffer_size);
+    out_publish_position_l(out, out->written, out->last_fifo_frames_remaining,
+                           latency_frames, out->last_fifo_time_ns);
+    return 0;
+}
+
+/* must be called with out->lock held, after frames were written.
+   The frames just written are both written and still queued at the time of
+   the last kernel sample, so that sample stays a true position and is
+   republished without asking the kernel again. It is only resampled once it
+   is older than OUT_POSITION_MAX_AGE_MS, to bound clock drift, or after the
+   underrun check found the queued estimate wrong. */
+static void out_advance_position_l(struct stream_out *out, size_t frames)
+{
+    if (!out->last_fifo_valid ||
+            systemTime(SYSTEM_TIME_MONOTONIC) - out->last_fifo_time_ns >
+                    OUT_POSITION_MAX_AGE_MS * 1000000LL) {
+        out_update_position_l(out);
+        return;
+    }
+
+    out->last_fifo_frames_remaining += frames;
+    // out->lock serializes every publisher, so the latency can be read back
+    out_publish_position_l(out, out->written, out->last_fifo_frames_remaining,
+                           atomic_load_explicit(&out->position.latency_frames,
+                                                memory_order_relaxed),
+                           out->last_fifo_time_ns);
+}
+
+/* must be called with out->lock held and adev->lock not held: reads procfs
+   unless the last sample is recent enough */
+static int out_sample_cpu_pressure_l(struct stream_out *out)
+{
+    const int64_t now_ns = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    if (out->cpu_pressure_time_ns == 0 || now_ns - out->cpu_pressure_time_ns >
+            PERIOD_TUNER_CPU_PRESSURE_MAX_AGE_MS * 1000000LL) {
+        out->cpu_pressure = period_tuner_read_cpu_pressure();
+        out->cpu_pressure_time_ns = now_ns;
+    }
+    return out->cpu_pressure;
+}
+
+/* must be called with out->lock held, before the pcm is opened.
+   cpu_pressure comes from out_sample_cpu_pressure_l(), taken before adev->lock. */
+static void out_apply_period_tuning_l(struct stream_out *out, int cpu_pressure)
+{
+    struct period_tuner_decision decision;
+
+    if (!out->period_tuning)
+        return;
+
+    period_tuner_decide(&out->period_tuner, cpu_pressure, &decision);
+    out->config.period_count = decision.period_count;
+    out->config.start_threshold = decision.start_threshold;
+    out->config.avail_min = decision.avail_min;
+    out->kernel_buffer_size = out->config.period_size * out->config.period_count;
+    ALOGV("%s: period_count %u start_threshold %u avail_min %u", __func__,
+          decision.period_count, decision.start_threshold, decision.avail_min);
+}
+
+/* must be called with out->lock held and adev->lock not held, when leaving
+   a play session */
+static void out_end_period_tuning_session_l(struct stream_out *out)
+{
+    struct period_tuner_session session = {
+        .frames = out->written - out->session_start_written,
+        .underruns = out->fifo_underruns.n - out->session_start_underruns,
+        .cpu_pressure = out_sample_cpu_pressure_l(out),
+    };
+
+    period_tuner_end_session(&out->period_tuner, &session);
+}
+
+/* must be called with adev->lock held. A warm stream is in standby and its
+   pcm and usecase are only touched under adev->lock, so out->lock is not
+   needed to drop it. */
+static void out_drop_warm_standby_l(struct stream_out *out)
+{
+    if (!out->warm_standby)
+        return;
+
+    ALOGV("%s: usecase(%d: %s)", __func__, out->usecase, use_case_table[out->usecase]);
+    if (out->pcm) {
+        pcm_close(out->pcm);
+        out->pcm = NULL;
+    }
+    stop_output_stream(out);
+    out->warm_standby = false;
+}
+
+/* must be called with adev->lock held, before a call or mode change takes
+   over the routing that warm streams keep applied */
+void drop_warm_standby_outputs(struct audio_device *adev)
+{
+    struct listnode *node, *tempnode;
+    struct audio_usecase *usecase;
+
+    list_for_each_safe(node, tempnode, &adev->usecase_list) {
+        usecase = node_to_item(node, struct audio_usecase, list);
+        if (usecase->type == PCM_PLAYBACK && usecase->stream.out != NULL &&
+                usecase->stream.out->warm_standby)
+            out_drop_warm_standby_l(usecase->stream.out);
+    }
+}
+
+static void *out_warm_standby_thread_loop(void *context)
+{
+    struct stream_out *out = (struct stream_out *)context;
+    struct audio_device *adev = out->dev;
+
+    prctl(PR_SET_NAME, (unsigned long)"Warm Standby", 0, 0, 0);
+
+    lock_output_stream(out);
+    while (!out->warm_standby_thread_exit) {
+        if (!out->warm_standby) {
+            pthread_cond_wait(&out->warm_standby_cond, &out->lock);
+            continue;
+        }
+
+        if (systemTime(SYSTEM_TIME_MONOTONIC) >= out->warm_standby_deadline_ns) {
+            adev_lock(adev, ADEV_LOCK_SITE_OUT_STANDBY);
+            // a mode change may have dropped it meanwhile, that is no expiry
+            if (out->warm_standby) {
+                out_drop_warm_standby_l(out);
+                out->warm_standby_expiries++;
+                out->warm_standby_hold_ms /= 2;
+                if (out->warm_standby_hold_ms < WARM_STANDBY_MIN_HOLD_MS)
+                    out->warm_standby_hold_ms =
+                            out->warm_standby_max_ms < WARM_STANDBY_MIN_HOLD_MS ?
+                            out->warm_standby_max_ms : WARM_STANDBY_MIN_HOLD_MS;
+            }
+            pthread_mutex_unlock(&adev->lock);
+            continue;
+        }
+
+        struct timespec deadline = {
+            .tv_sec = out->warm_standby_deadline_ns / NANOS_PER_SECOND,
+            .tv_nsec = out->warm_standby_deadline_ns % NANOS_PER_SECOND,
+        };
+        pthread_cond_timedwait(&out->warm_standby_cond, &out->lock, &deadline);
+    }
+    pthread_mutex_unlock(&out->lock);
+    return NULL;
+}
+
+/* must be called with out->lock and adev->lock held, pcm still open.
+   Returns true if the stream was parked in warm standby instead of closed. */
+static bool out_enter_warm_standby_l(struct stream_out *out)
+{
+    struct audio_device *adev = out->dev;
+    const audio_devices_t internal_devices = AUDIO_DEVICE_OUT_EARPIECE |
+                                             AUDIO_DEVICE_OUT_SPEAKER |
+                                             AUDIO_DEVICE_OUT_SPEAKER_SAFE |
+                                             AUDIO_DEVICE_OUT_WIRED_HEADSET |
+                                             AUDIO_DEVICE_OUT_WIRED_HEADPHONE;
+
+    // keeping an external link (BT, USB, HDMI) or a call path up is outside the budget
+    if (out->warm_standby_hold_ms == 0 || out->pcm == NULL ||
+            (out->devices & ~internal_devices) != 0 ||
+            adev->mode != AUDIO_MODE_NORMAL ||
+            out->card_status == CARD_STATUS_OFFLINE ||
+            adev->card_status == CARD_STATUS_OFFLINE)
+        return false;
+
+    if (!out->warm_standby_thread_started) {
+        if (pthread_create(&out->warm_standby_thread, (const pthread_attr_t *) NULL,
+                           out_warm_standby_thread_loop, out) != 0) {
+            ALOGW("%s: cannot create expiry thread", __func__);
+            return false;
+        }
+        out->warm_standby_thread_started = true;
+    }
+
+    if (pcm_stop(out->pcm) < 0 || pcm_prepare(out->pcm) < 0) {
+        ALOGW("%s: %s", __func__, pcm_get_error(out->pcm));
+        return false;
+    }
+
+    if (out->usecase == USECASE_AUDIO_PLAYBACK_ULL)
+        audio_low_latency_hint_end();
+
+    out->warm_standby = true;
+    out->warm_standby_deadline_ns = systemTime(SYSTEM_TIME_MONOTONIC) +
+                                    out->warm_standby_hold_ms * 1000000LL;
+    pthread_cond_signal(&out->warm_standby_cond);
+    ALOGV("%s: usecase(%d: %s) hold %u ms", __func__, out->usecase,
+          use_case_table[out->usecase], out->warm_standby_hold_ms);
+    return true;
+}
+
+/* must be called with out->lock and adev->lock held.
+   On failure the warm pcm and usecase are released and the caller starts cold. */
+static int out_resume_warm_standby_l(struct stream_out *out)
+{
+    struct audio_device *adev = out->dev;
+    int ret = 0;
+
+    if (adev->mode != AUDIO_MODE_NORMAL ||
+            out->card_status == CARD_STATUS_OFFLINE ||
+            adev->card_status == CARD_STATUS_OFFLINE) {
+        ret = -EAGAIN;
+        goto error;
+    }
+
+    // other usecases may have switched the shared backend meanwhile, no-op otherwise
+    select_devices(adev, out->usecase);
+
+    if (out->realtime) {
+        ret = pcm_start(out->pcm);
+        if (ret < 0) {
+            ALOGE("%s: RT pcm_start failed ret %d", __func__, ret);
+            goto error;
+        }
+    }
+
+    out->warm_standby = false;
+    out->warm_standby_hits++;
+    out->warm_standby_hold_ms = out->warm_standby_max_ms;
+
+    if (out->usecase == USECASE_AUDIO_PLAYBACK_ULL)
+        audio_low_latency_hint_start();
+    register_out_stream(out);
+    // failure to start the async writer falls back to synchronous pcm_write()
+    if (audio_extn_async_pcm_open(out) != 0)
+        ALOGW("%s: async pcm not started", __func__);
+    return 0;
+
+error:
+    out_drop_warm_standby_l(out);
+    return ret;
+}
+
 /* must be called with out->lock locked */
-static int out_standby_l(struct audio_stream *stream)
+static int out_standby_l(struct audio_stream *stream, bool allow_warm)
 {
     struct stream_out *out = (struct stream_out *)stream;
     struct audio_device *adev = out->dev;
     bool do_stop = true;
 
     if (!out->standby) {
+        if (out->period_tuning)
+            out_end_period_tuning_session_l(out);
         if (adev->adm_deregister_stream)
             adev->adm_deregister_stream(adev->adm_data, out->handle);
-        pthread_mutex_lock(&adev->lock);
+        // stop the writer thread before adev->lock, it may be blocked in pcm_write()
+        audio_extn_async_pcm_close(out);
+        adev_lock(adev, ADEV_LOCK_SITE_OUT_STANDBY);
         out->standby = true;
+        out->last_write_ns = 0;
+        out->mmap_fill_started = false;
+        out_publish_position_l(out, 0, 0, 0, 0);
+        if (allow_warm && out_enter_warm_standby_l(out)) {
+            pthread_mutex_unlock(&adev->lock);
+            return 0;
+        }
         if (out->usecase != USECASE_AUDIO_PLAYBACK_OFFLOAD) {
             if (out->pcm) {
                 pcm_close(out->pcm);
@@ -2819,12 +3428,6 @@ static int out_standby_l(struct audio_stream *stream)
                         pcm_close(adev->haptic_pcm);
                         adev->haptic_pcm = NULL;
                     }
-
-                    if (adev->haptic_buffer != NULL) {
-                        free(adev->haptic_buffer);
-                        adev->haptic_buffer = NULL;
-                        adev->haptic_buffer_size = 0;
-                    }
                 }
             }
             if (out->usecase == USECASE_AUDIO_PLAYBACK_MMAP) {
@@ -2864,12 +3467,34 @@ static int out_standby(struct audio_stream *stream)
           out->usecase, use_case_table[out->usecase]);
 
     lock_output_stream(out);
-    out_standby_l(stream);
+    out_standby_l(stream, true /* allow_warm */);
     pthread_mutex_unlock(&out->lock);
     ALOGV("%s: exit", __func__);
     return 0;
 }
 
+/* releases a pcm parked before close and stops the expiry thread if it was
+   ever started, before the stream is freed */
+static void out_destroy_warm_standby(struct stream_out *out)
+{
+    struct audio_device *adev = out->dev;
+
+    lock_output_stream(out);
+    if (out->warm_standby) {
+        adev_lock(adev, ADEV_LOCK_SITE_OUT_STANDBY);
+        out_drop_warm_standby_l(out);
+        pthread_mutex_unlock(&adev->lock);
+    }
+    out->warm_standby_thread_exit = true;
+    pthread_cond_signal(&out->warm_standby_cond);
+    pthread_mutex_unlock(&out->lock);
+
+    if (out->warm_standby_thread_started) {
+        pthread_join(out->warm_standby_thread, (void **) NULL);
+        out->warm_standby_thread_started = false;
+    }
+}
+
 static int out_on_error(struct audio_stream *stream)
 {
     struct stream_out *out = (struct stream_out *)stream;
@@ -2883,6 +3508,10 @@ static int out_on_error(struct audio_stream *stream)
             send_offload_cmd_l(out, OFFLOAD_CMD_ERROR);
         } else
             do_standby = true;
+    } else if (out->warm_standby) {
+        adev_lock(adev, ADEV_LOCK_SITE_OUT_STANDBY);
+        out_drop_warm_standby_l(out);
+        pthread_mutex_unlock(&adev->lock);
     }
     pthread_mutex_unlock(&out->lock);
 
@@ -2911,6 +3540,39 @@ static int out_dump(const struct audio_stream *stream, int fd)
         simple_stats_to_string(&out->start_latency_ms, buffer, sizeof(buffer));
         dprintf(fd, "      Start latency ms: %s\n", buffer);
     }
+    if (out->start_route_ms.n > 0) {
+        simple_stats_to_string(&out->start_route_ms, buffer, sizeof(buffer));
+        dprintf(fd, "      Cold start route ms: %s\n", buffer);
+    }
+    if (out->start_pcm_open_ms.n > 0) {
+        simple_stats_to_string(&out->start_pcm_open_ms, buffer, sizeof(buffer));
+        dprintf(fd, "      Cold start pcm open ms: %s\n", buffer);
+    }
+    if (out->start_cal_ms.n > 0) {
+        simple_stats_to_string(&out->start_cal_ms, buffer, sizeof(buffer));
+        dprintf(fd, "      Cold start calibration ms: %s\n", buffer);
+    }
+    if (out->warm_standby_max_ms > 0) {
+        dprintf(fd, "      Warm standby: %s, hold %u ms, hits %u, expiries %u\n",
+                out->warm_standby ? "yes" : "no", out->warm_standby_hold_ms,
+                out->warm_standby_hits, out->warm_standby_expiries);
+    }
+    if (out->warm_start_ms.n > 0) {
+        simple_stats_to_string(&out->warm_start_ms, buffer, sizeof(buffer));
+        dprintf(fd, "      Warm start ms: %s\n", buffer);
+    }
+    if (out->period_tuning) {
+        const struct period_tuner *tuner = &out->period_tuner;
+        dprintf(fd, "      Period tuner: %u x %u frames (%u..%u), grows %u, shrinks %u, "
+                "clean sessions %u\n", tuner->period_count, tuner->config.period_size,
+                tuner->config.min_count, tuner->config.max_count, tuner->grows,
+                tuner->shrinks, tuner->clean_sessions);
+    }
+
+    latency_histogram_dump(&out->write_hist, fd, "      ", "write");
+    latency_histogram_dump(&out->lock_wait_hist, fd, "      ", "lock_wait");
+    latency_histogram_dump(&out->kernel_write_hist, fd, "      ", "kernel_write");
+    latency_histogram_dump(&out->write_jitter_hist, fd, "      ", "write_jitter");
 
     if (locked) {
         pthread_mutex_unlock(&out->lock);
@@ -2960,9 +3622,9 @@ static bool output_drives_call(struct audio_device *adev, struct stream_out *out
     return out == adev->primary_output || out == adev->voice_tx_output;
 }
 
-static int get_alive_usb_card(struct str_parms* parms) {
+static int get_alive_usb_card(const struct kv_parms *parms) {
     int card;
-    if ((str_parms_get_int(parms, "card", &card) >= 0) &&
+    if ((kv_parms_get_int(parms, SET_PARAM_CARD, &card) >= 0) &&
         !audio_extn_usb_alive(card)) {
         return card;
     }
@@ -2975,7 +3637,7 @@ static int out_set_parameters(struct audio_stream *stream, const char *kvpairs)
     struct audio_device *adev = out->dev;
     struct audio_usecase *usecase;
     struct listnode *node;
-    struct str_parms *parms;
+    struct kv_parms parms;
     char value[32];
     int ret, val = 0;
     bool select_new_device = false;
@@ -2985,8 +3647,8 @@ static int out_set_parameters(struct audio_stream *stream, const char *kvpairs)
 
     ALOGD("%s: enter: usecase(%d: %s) kvpairs: %s",
           __func__, out->usecase, use_case_table[out->usecase], kvpairs);
-    parms = str_parms_create_str(kvpairs);
-    ret = str_parms_get_str(parms, AUDIO_PARAMETER_STREAM_ROUTING, value, sizeof(value));
+    set_param_parse(&parms, kvpairs);
+    ret = kv_parms_get_str(&parms, SET_PARAM_ROUTING, value, sizeof(value));
     if (ret >= 0) {
         val = atoi(value);
 
@@ -2998,7 +3660,7 @@ static int out_set_parameters(struct audio_stream *stream, const char *kvpairs)
             forced_speaker_fallback = true;
         }
 
-        pthread_mutex_lock(&adev->lock);
+        adev_lock(adev, ADEV_LOCK_SITE_OUT_PARAMS);
 
         /*
          * When HDMI cable is unplugged the music playback is paused and
@@ -3058,7 +3720,7 @@ static int out_set_parameters(struct audio_stream *stream, const char *kvpairs)
         // The routing request will otherwise block during 10 second
         int card;
         if (audio_is_usb_out_device(new_dev) &&
-            (card = get_alive_usb_card(parms)) >= 0) {
+            (card = get_alive_usb_card(&parms)) >= 0) {
 
             ALOGW("out_set_parameters() ignoring rerouting to non existing USB card %d", card);
             pthread_mutex_unlock(&adev->lock);
@@ -3087,6 +3749,9 @@ static int out_set_parameters(struct audio_stream *stream, const char *kvpairs)
          */
         if (new_dev != AUDIO_DEVICE_NONE) {
             bool same_dev = out->devices == new_dev;
+            // the warm pcm is routed for the old device, start cold on the new one
+            if (!same_dev)
+                out_drop_warm_standby_l(out);
             out->devices = new_dev;
 
             if (output_drives_call(adev, out)) {
@@ -3177,11 +3842,13 @@ static int out_set_parameters(struct audio_stream *stream, const char *kvpairs)
     }
     routing_fail:
 
-    if (out->usecase == USECASE_AUDIO_PLAYBACK_OFFLOAD) {
-        parse_compress_metadata(out, parms);
+    /* the gapless metadata keys are the only ones needing the full str_parms */
+    if (out->usecase == USECASE_AUDIO_PLAYBACK_OFFLOAD && parms.unknown > 0) {
+        struct str_parms *metadata = str_parms_create_str(kvpairs);
+        parse_compress_metadata(out, metadata);
+        str_parms_destroy(metadata);
     }
 
-    str_parms_destroy(parms);
     ALOGV("%s: exit: code(%d)", __func__, status);
     return status;
 }
@@ -3456,7 +4123,7 @@ static void out_snd_mon_cb(void * stream, struct str_parms * parms)
     if (parse_snd_card_status(parms, &card, &status) < 0)
         return;
 
-    pthread_mutex_lock(&adev->lock);
+    adev_lock(adev, ADEV_LOCK_SITE_SND_MON);
     bool valid_cb = (card == adev->snd_card);
     pthread_mutex_unlock(&adev->lock);
 
@@ -3496,6 +4163,88 @@ static ssize_t out_write_for_no_output(struct audio_stream_out *stream,
 }
 #endif
 
+/* Fills the DMA buffer of a PCM_MMAP stream from the AF buffer. This is not
+ * zero copy: the frames are still copied once into the DMA area, here in
+ * user space where pcm_write() has the kernel do it. What it saves is the
+ * separate pass over the AF buffer that mute (a memset) and the VOIP mono
+ * downmix (an in-place fold) make before pcm_write(): they are applied on
+ * the way into the DMA area instead, and the AF buffer is left untouched.
+ * For a stream that is neither muted nor downmixed it only trades the copy
+ * in the write syscall for a memcpy and the mmap sync calls.
+ * must be called with out->lock locked
+ */
+static int out_write_mmap_fill_l(struct stream_out *out, const void *buffer, size_t frames)
+{
+    const size_t src_frame_size = audio_stream_out_frame_size(&out->stream);
+    const bool downmix = out->config.channels == 1 &&
+            audio_channel_count_from_out_mask(out->channel_mask) == 2;
+    const unsigned int buffer_frames = pcm_get_buffer_size(out->pcm);
+    const unsigned int start_threshold =
+            (out->config.start_threshold > 0 && out->config.start_threshold < buffer_frames) ?
+            out->config.start_threshold : buffer_frames / 2;
+    const int wait_ms = (int)(2000LL * buffer_frames / out->config.rate) + 1;
+    const uint8_t *src = (const uint8_t *)buffer;
+    int ret;
+
+    LOG_ALWAYS_FATAL_IF(downmix && out->format != AUDIO_FORMAT_PCM_16_BIT,
+                        "%s: mono downmix needs 16 bit PCM", __func__);
+
+    while (frames > 0) {
+        void *area;
+        unsigned int offset;
+        unsigned int chunk = frames > UINT_MAX ? UINT_MAX : (unsigned int)frames;
+        int avail = pcm_avail_update(out->pcm);
+
+        if (avail < 0)
+            return avail;
+        if (avail == 0) {
+            // full before reaching the start threshold, the DSP must drain it
+            if (!out->mmap_fill_started) {
+                ret = pcm_start(out->pcm);
+                if (ret < 0)
+                    return ret;
+                out->mmap_fill_started = true;
+            }
+            ret = pcm_wait(out->pcm, wait_ms);
+            if (ret < 0)
+                return ret;
+            if (ret == 0) {
+                ALOGE("%s: timed out waiting for DMA buffer space", __func__);
+                return -ETIMEDOUT;
+            }
+            continue;
+        }
+
+        ret = pcm_mmap_begin(out->pcm, &area, &offset, &chunk);
+        if (ret < 0)
+            return ret;
+
+        uint8_t *dst = (uint8_t *)area + pcm_frames_to_bytes(out->pcm, offset);
+        if (out->muted)
+            memset(dst, 0, pcm_frames_to_bytes(out->pcm, chunk));
+        else if (downmix)
+            pcm_kernels_downmix_to_mono_16((int16_t *)dst, (const int16_t *)src, chunk);
+        else
+            memcpy(dst, src, chunk * src_frame_size);
+
+        ret = pcm_mmap_commit(out->pcm, offset, chunk);
+        if (ret < 0)
+            return ret;
+
+        src += chunk * src_frame_size;
+        frames -= chunk;
+
+        if (!out->mmap_fill_started &&
+                buffer_frames - (unsigned int)avail + chunk >= start_threshold) {
+            ret = pcm_start(out->pcm);
+            if (ret < 0)
+                return ret;
+            out->mmap_fill_started = true;
+        }
+    }
+    return 0;
+}
+
 static ssize_t out_write(struct audio_stream_out *stream, const void *buffer,
                          size_t bytes)
 {
@@ -3504,11 +4253,25 @@ static ssize_t out_write(struct audio_stream_out *stream, const void *buffer,
     ssize_t ret = 0;
     int error_code = ERROR_CODE_STANDBY;
 
+    const int64_t write_start_ns = systemTime(SYSTEM_TIME_MONOTONIC);
     lock_output_stream(out);
+    latency_histogram_log_ns(&out->lock_wait_hist,
+                             systemTime(SYSTEM_TIME_MONOTONIC) - write_start_ns);
     // this is always nonzero
     const size_t frame_size = audio_stream_out_frame_size(stream);
     const size_t frames = bytes / frame_size;
 
+    if (out->usecase != USECASE_AUDIO_PLAYBACK_OFFLOAD) {
+        if (out->last_write_ns != 0) {
+            const int64_t expected_ns = frames * (int64_t)NANOS_PER_SECOND /
+                                        out_get_sample_rate(&out->stream.common);
+            const int64_t interval_ns = write_start_ns - out->last_write_ns;
+            latency_histogram_log_ns(&out->write_jitter_hist,
+                                     llabs(interval_ns - expected_ns));
+        }
+        out->last_write_ns = write_start_ns;
+    }
+
     if (out->usecase == USECASE_AUDIO_PLAYBACK_MMAP) {
         error_code = ERROR_CODE_WRITE;
         goto exit;
@@ -3528,27 +4291,43 @@ static ssize_t out_write(struct audio_stream_out *stream, const void *buffer,
     if (out->standby) {
         out->standby = false;
         const int64_t startNs = systemTime(SYSTEM_TIME_MONOTONIC);
-
-        pthread_mutex_lock(&adev->lock);
-        ret = start_output_stream(out);
-
-        /* ToDo: If use case is compress offload should return 0 */
-        if (ret != 0) {
-            out->standby = true;
-            pthread_mutex_unlock(&adev->lock);
-            goto exit;
+        // procfs is read here rather than on the start path under adev->lock
+        const int cpu_pressure = out->period_tuning ? out_sample_cpu_pressure_l(out) : -1;
+
+        adev_lock(adev, ADEV_LOCK_SITE_OUT_START);
+        const bool warm_start = out->warm_standby && out_resume_warm_standby_l(out) == 0;
+        if (!warm_start) {
+            out_apply_period_tuning_l(out, cpu_pressure);
+            ret = start_output_stream(out);
+
+            /* ToDo: If use case is compress offload should return 0 */
+            if (ret != 0) {
+                out->standby = true;
+                pthread_mutex_unlock(&adev->lock);
+                goto exit;
+            }
         }
 
-        // after standby always force set last known cal step
+        // after standby always force set last known cal step, a warm start
+        // included: the level may have changed while the stream was parked
         // dont change level anywhere except at the audio_hw_send_gain_dep_calibration
         ALOGD("%s: retry previous failed cal level set", __func__);
+        const int64_t cal_start_ns = systemTime(SYSTEM_TIME_MONOTONIC);
         send_gain_dep_calibration_l();
+        simple_stats_log(&out->start_cal_ms,
+                         (systemTime(SYSTEM_TIME_MONOTONIC) - cal_start_ns) * 1e-6);
         pthread_mutex_unlock(&adev->lock);
+        if (warm_start) {
+            simple_stats_log(
+                    &out->warm_start_ms, (systemTime(SYSTEM_TIME_MONOTONIC) - startNs) * 1e-6);
+        }
 
         // log startup time in ms.
         simple_stats_log(
                 &out->start_latency_ms, (systemTime(SYSTEM_TIME_MONOTONIC) - startNs) * 1e-6);
         out->last_fifo_valid = false; // we're coming out of standby, last_fifo isn't valid.
+        out->session_start_written = out->written;
+        out->session_start_underruns = out->fifo_underruns.n;
     }
 
     if (out->usecase == USECASE_AUDIO_PLAYBACK_OFFLOAD) {
@@ -3596,6 +4375,8 @@ static ssize_t out_write(struct audio_stream_out *stream, const void *buffer,
         } else {
             out->written += ret; // accumulate bytes written for offload.
         }
+        latency_histogram_log_ns(&out->write_hist,
+                                 systemTime(SYSTEM_TIME_MONOTONIC) - write_start_ns);
         pthread_mutex_unlock(&out->lock);
         // TODO: consider logging offload pcm
         return ret;
@@ -3604,12 +4385,14 @@ static ssize_t out_write(struct audio_stream_out *stream, const void *buffer,
         if (out->pcm) {
             size_t bytes_to_write = bytes;
 
-            if (out->muted)
+            // mmap fill streams mute and downmix while filling the DMA buffer
+            if (out->muted && !out->mmap_fill)
                 memset((void *)buffer, 0, bytes);
             // FIXME: this can be removed once audio flinger mixer supports mono output
-            if (out->usecase == USECASE_AUDIO_PLAYBACK_VOIP ||
-                out->usecase == USECASE_INCALL_MUSIC_UPLINK ||
-                out->usecase == USECASE_INCALL_MUSIC_UPLINK2) {
+            if (!out->mmap_fill &&
+                (out->usecase == USECASE_AUDIO_PLAYBACK_VOIP ||
+                 out->usecase == USECASE_INCALL_MUSIC_UPLINK ||
+                 out->usecase == USECASE_INCALL_MUSIC_UPLINK2)) {
                 size_t channel_count = audio_channel_count_from_out_mask(out->channel_mask);
                 int16_t *src = (int16_t *)buffer;
                 int16_t *dst = (int16_t *)buffer;
@@ -3618,15 +4401,12 @@ static ssize_t out_write(struct audio_stream_out *stream, const void *buffer,
                                     out->format != AUDIO_FORMAT_PCM_16_BIT,
                                     "out_write called for VOIP use case with wrong properties");
 
-                for (size_t i = 0; i < frames ; i++, dst++, src += 2) {
-                    *dst = (int16_t)(((int32_t)src[0] + (int32_t)src[1]) >> 1);
-                }
+                pcm_kernels_downmix_to_mono_16(dst, src, frames);
                 bytes_to_write /= 2;
             }
 
-            // Note: since out_get_presentation_position() is called alternating with out_write()
-            // by AudioFlinger, we can check underruns using the prior timestamp read.
-            // (Alternately we could check if the buffer is empty using pcm_get_htimestamp().
+            // The last kernel sample plus every frame written since tells how much
+            // should still be queued; if more time passed than that, we underran.
             if (out->last_fifo_valid) {
                 // compute drain to see if there is an underrun.
                 const int64_t current_ns = systemTime(SYSTEM_TIME_MONOTONIC); // sys call
@@ -3643,85 +4423,83 @@ static ssize_t out_write(struct audio_stream_out *stream, const void *buffer,
                             (long long)out->fifo_underruns.n,
                             (long long)frames_by_time,
                             (long long)out->last_fifo_frames_remaining);
+                    out->last_fifo_valid = false;  // the estimate is off, resample after writing.
                 }
-                out->last_fifo_valid = false;  // we're writing below, mark fifo info as stale.
             }
 
             long ns = (frames * (int64_t) NANOS_PER_SECOND) / out->config.rate;
             request_out_focus(out, ns);
 
+            const int64_t kernel_start_ns = systemTime(SYSTEM_TIME_MONOTONIC);
             bool use_mmap = is_mmap_usecase(out->usecase) || out->realtime;
-            if (use_mmap) {
+            if (out->mmap_fill) {
+                ret = out_write_mmap_fill_l(out, buffer, frames);
+            } else if (out->async_pcm != NULL) {
+                ret = audio_extn_async_pcm_write(out, buffer, bytes_to_write);
+            } else if (use_mmap) {
                 ret = pcm_mmap_write(out->pcm, (void *)buffer, bytes_to_write);
             } else {
                 if (out->usecase == USECASE_AUDIO_PLAYBACK_WITH_HAPTICS) {
-                    size_t channel_count = audio_channel_count_from_out_mask(out->channel_mask);
                     size_t bytes_per_sample = audio_bytes_per_sample(out->format);
-                    size_t frame_size = channel_count * bytes_per_sample;
-                    size_t frame_count = bytes_to_write / frame_size;
-
-                    bool force_haptic_path =
-                         property_get_bool("vendor.audio.test_haptic", false);
+                    size_t channel_count = audio_channel_count_from_out_mask(out->channel_mask);
+                    size_t frame_count = bytes_to_write / (channel_count * bytes_per_sample);
 
                     // extract Haptics data from Audio buffer
-                    bool   alloc_haptic_buffer = false;
-                    int    haptic_channel_count = adev->haptics_config.channels;
-                    size_t haptic_frame_size = bytes_per_sample * haptic_channel_count;
-                    size_t audio_frame_size = frame_size - haptic_frame_size;
-                    size_t total_haptic_buffer_size = frame_count * haptic_frame_size;
-
-                    if (adev->haptic_buffer == NULL) {
-                        alloc_haptic_buffer = true;
-                    } else if (adev->haptic_buffer_size < total_haptic_buffer_size) {
-                        free(adev->haptic_buffer);
-                        adev->haptic_buffer_size = 0;
-                        alloc_haptic_buffer = true;
-                    }
-
-                    if (alloc_haptic_buffer) {
-                        adev->haptic_buffer = (uint8_t *)calloc(1, total_haptic_buffer_size);
-                        adev->haptic_buffer_size = total_haptic_buffer_size;
-                    }
-
-                    size_t src_index = 0, aud_index = 0, hap_index = 0;
-                    uint8_t *audio_buffer = (uint8_t *)buffer;
-                    uint8_t *haptic_buffer  = adev->haptic_buffer;
+                    size_t haptic_channel_count = adev->haptics_config.channels;
+                    size_t audio_channel_count = channel_count - haptic_channel_count;
+                    size_t skip_channel_count = 0;
 
                     // This is required for testing only. This works for stereo data only.
-                    // One channel is fed to audio stream and other to haptic stream for testing.
-                    if (force_haptic_path) {
-                       audio_frame_size = haptic_frame_size = bytes_per_sample;
+                    // One channel is fed to audio stream and other to haptic stream for testing,
+                    // haptic channel data is discarded. adev_open_output_stream() only
+                    // accepts it with at least 2 channels.
+                    if (out->force_haptic_path) {
+                        audio_channel_count = 1;
+                        skip_channel_count = channel_count - 2;
                     }
 
-                    for (size_t i = 0; i < frame_count; i++) {
-                        for (size_t j = 0; j < audio_frame_size; j++)
-                            audio_buffer[aud_index++] = audio_buffer[src_index++];
-
-                        for (size_t j = 0; j < haptic_frame_size; j++)
-                            haptic_buffer[hap_index++] = audio_buffer[src_index++];
-                        }
+                    size_t audio_frame_size = audio_channel_count * bytes_per_sample;
+                    size_t haptic_frame_size = haptic_channel_count * bytes_per_sample;
+                    size_t total_haptic_buffer_size = frame_count * haptic_frame_size;
 
-                        // This is required for testing only.
-                        // Discard haptic channel data.
-                        if (force_haptic_path) {
-                            src_index += haptic_frame_size;
+                    // the buffer is sized at open, only grow it if AF writes more than a buffer
+                    if (adev->haptic_buffer_size < total_haptic_buffer_size) {
+                        ALOGW("%s: growing haptic buffer %zu -> %zu", __func__,
+                              adev->haptic_buffer_size, total_haptic_buffer_size);
+                        free(adev->haptic_buffer);
+                        adev->haptic_buffer = (uint8_t *)calloc(1, total_haptic_buffer_size);
+                        adev->haptic_buffer_size =
+                                adev->haptic_buffer != NULL ? total_haptic_buffer_size : 0;
                     }
 
-                    // write to audio pipeline
-                    ret = pcm_write(out->pcm,
-                                    (void *)audio_buffer,
-                                    frame_count * audio_frame_size);
-
-                    // write to haptics pipeline
-                    if (adev->haptic_pcm)
-                        ret = pcm_write(adev->haptic_pcm,
-                                        (void *)adev->haptic_buffer,
-                                        frame_count * haptic_frame_size);
-
+                    if (adev->haptic_buffer == NULL) {
+                        ALOGE("%s: cannot allocate %zu bytes of haptic buffer", __func__,
+                              total_haptic_buffer_size);
+                        ret = -ENOMEM;
+                    } else {
+                        uint8_t *audio_buffer = (uint8_t *)buffer;
+                        pcm_kernels_split_haptics(audio_buffer, adev->haptic_buffer,
+                                                  frame_count, bytes_per_sample,
+                                                  audio_channel_count, haptic_channel_count,
+                                                  skip_channel_count);
+
+                        // write to audio pipeline
+                        ret = pcm_write(out->pcm,
+                                        (void *)audio_buffer,
+                                        frame_count * audio_frame_size);
+
+                        // write to haptics pipeline
+                        if (adev->haptic_pcm)
+                            ret = pcm_write(adev->haptic_pcm,
+                                            (void *)adev->haptic_buffer,
+                                            frame_count * haptic_frame_size);
+                    }
                 } else {
                     ret = pcm_write(out->pcm, (void *)buffer, bytes_to_write);
                 }
             }
+            latency_histogram_log_ns(&out->kernel_write_hist,
+                                     systemTime(SYSTEM_TIME_MONOTONIC) - kernel_start_ns);
             release_out_focus(out, ns);
         } else {
             LOG_ALWAYS_FATAL("out->pcm is NULL after starting output stream");
@@ -3732,6 +4510,9 @@ exit:
     // For PCM we always consume the buffer and return #bytes regardless of ret.
     if (out->usecase != USECASE_AUDIO_PLAYBACK_OFFLOAD) {
         out->written += frames;
+        // publish while the stream lock is held anyway, position queries then skip it
+        if (ret == 0)
+            out_advance_position_l(out, frames);
     }
     long long sleeptime_us = 0;
 
@@ -3745,6 +4526,8 @@ exit:
         }
     }
 
+    latency_histogram_log_ns(&out->write_hist,
+                             systemTime(SYSTEM_TIME_MONOTONIC) - write_start_ns);
     pthread_mutex_unlock(&out->lock);
 
     if (ret != 0) {
@@ -3801,6 +4584,12 @@ static int out_get_presentation_position(const struct audio_stream_out *stream,
     int ret = -ENODATA;
     unsigned long dsp_frames;
 
+    // PCM positions published by out_write() are answered without waiting for
+    // a write blocked in the kernel; only a drained or missing one takes the lock.
+    if (out->usecase != USECASE_AUDIO_PLAYBACK_OFFLOAD &&
+            out_read_position(out, true /* check_drain */, frames, timestamp) == 0)
+        return 0;
+
     lock_output_stream(out);
 
     if (out->usecase == USECASE_AUDIO_PLAYBACK_OFFLOAD) {
@@ -3822,50 +4611,8 @@ static int out_get_presentation_position(const struct audio_stream_out *stream,
             /* this is the best we can do */
             clock_gettime(CLOCK_MONOTONIC, timestamp);
         }
-    } else {
-        if (out->pcm) {
-            unsigned int avail;
-            if (pcm_get_htimestamp(out->pcm, &avail, timestamp) == 0) {
-
-                // pcm_get_htimestamp() computes the available frames by comparing
-                // the alsa driver hw_ptr and the appl_ptr levels.
-                // In underrun, the hw_ptr may keep running and report an excessively
-                // large number available number.
-                if (avail > out->kernel_buffer_size) {
-                    ALOGW("%s: avail:%u > kernel_buffer_size:%zu clamping!",
-                            __func__, avail, out->kernel_buffer_size);
-                    avail = out->kernel_buffer_size;
-                    out->last_fifo_frames_remaining = 0;
-                } else {
-                    out->last_fifo_frames_remaining = out->kernel_buffer_size - avail;
-                }
-                out->last_fifo_valid = true;
-                out->last_fifo_time_ns = audio_utils_ns_from_timespec(timestamp);
-
-                int64_t signed_frames = out->written - out->last_fifo_frames_remaining;
-
-                ALOGVV("%s: frames:%lld  avail:%u  kernel_buffer_size:%zu",
-                        __func__, (long long)signed_frames, avail, out->kernel_buffer_size);
-
-                // This adjustment accounts for buffering after app processor.
-                // It is based on estimated DSP latency per use case, rather than exact.
-                signed_frames -=
-                    (platform_render_latency(out) * out->sample_rate / 1000000LL);
-
-                // Adjustment accounts for A2DP encoder latency with non-offload usecases
-                // Note: Encoder latency is returned in ms, while platform_render_latency in us.
-                if (AUDIO_DEVICE_OUT_ALL_A2DP & out->devices) {
-                    signed_frames -=
-                            (audio_extn_a2dp_get_encoder_latency() * out->sample_rate / 1000);
-                }
-
-                // It would be unusual for this value to be negative, but check just in case ...
-                if (signed_frames >= 0) {
-                    *frames = signed_frames;
-                    ret = 0;
-                }
-            }
-        }
+    } else if (out_update_position_l(out) == 0) {
+        ret = out_read_position(out, false /* check_drain */, frames, timestamp);
     }
 
     pthread_mutex_unlock(&out->lock);
@@ -3956,7 +4703,7 @@ static int out_stop(const struct audio_stream_out* stream)
     int ret = -ENOSYS;
 
     ALOGV("%s", __func__);
-    pthread_mutex_lock(&adev->lock);
+    adev_lock(adev, ADEV_LOCK_SITE_MMAP);
     if (out->usecase == USECASE_AUDIO_PLAYBACK_MMAP && !out->standby &&
             out->playback_started && out->pcm != NULL) {
         pcm_stop(out->pcm);
@@ -3974,7 +4721,7 @@ static int out_start(const struct audio_stream_out* stream)
     int ret = -ENOSYS;
 
     ALOGV("%s", __func__);
-    pthread_mutex_lock(&adev->lock);
+    adev_lock(adev, ADEV_LOCK_SITE_MMAP);
     if (out->usecase == USECASE_AUDIO_PLAYBACK_MMAP && !out->standby &&
             !out->playback_started && out->pcm != NULL) {
         ret = start_output_stream(out);
@@ -4032,7 +4779,7 @@ static int out_create_mmap_buffer(const struct audio_stream_out *stream,
 
     ALOGV("%s", __func__);
     lock_output_stream(out);
-    pthread_mutex_lock(&adev->lock);
+    adev_lock(adev, ADEV_LOCK_SITE_MMAP);
 
     if (info == NULL || min_size_frames <= 0 || min_size_frames > MMAP_MIN_SIZE_FRAMES_MAX) {
         ALOGE("%s: info = %p, min_size_frames = %d", __func__, info, min_size_frames);
@@ -4209,9 +4956,12 @@ static int in_standby(struct audio_stream *stream)
     if (!in->standby) {
         if (adev->adm_deregister_stream)
             adev->adm_deregister_stream(adev->adm_data, in->capture_handle);
+        // stop the reader thread before adev->lock, it may be blocked in pcm_read()
+        audio_extn_async_pcm_capture_close(in);
 
-        pthread_mutex_lock(&adev->lock);
+        adev_lock(adev, ADEV_LOCK_SITE_IN_STANDBY);
         in->standby = true;
+        in->last_read_ns = 0;
         if (in->usecase == USECASE_AUDIO_RECORD_MMAP) {
             do_stop = in->capture_started;
             in->capture_started = false;
@@ -4261,6 +5011,11 @@ static int in_dump(const struct audio_stream *stream, int fd)
         dprintf(fd, "      Start latency ms: %s\n", buffer);
     }
 
+    latency_histogram_dump(&in->read_hist, fd, "      ", "read");
+    latency_histogram_dump(&in->lock_wait_hist, fd, "      ", "lock_wait");
+    latency_histogram_dump(&in->kernel_read_hist, fd, "      ", "kernel_read");
+    latency_histogram_dump(&in->read_jitter_hist, fd, "      ", "read_jitter");
+
     if (locked) {
         pthread_mutex_unlock(&in->lock);
     }
@@ -4275,20 +5030,19 @@ static int in_set_parameters(struct audio_stream *stream, const char *kvpairs)
 {
     struct stream_in *in = (struct stream_in *)stream;
     struct audio_device *adev = in->dev;
-    struct str_parms *parms;
-    char *str;
+    struct kv_parms parms;
     char value[32];
     int ret, val = 0;
     int status = 0;
 
     ALOGV("%s: enter: kvpairs=%s", __func__, kvpairs);
-    parms = str_parms_create_str(kvpairs);
+    set_param_parse(&parms, kvpairs);
 
-    ret = str_parms_get_str(parms, AUDIO_PARAMETER_STREAM_INPUT_SOURCE, value, sizeof(value));
+    ret = kv_parms_get_str(&parms, SET_PARAM_INPUT_SOURCE, value, sizeof(value));
 
     lock_input_stream(in);
 
-    pthread_mutex_lock(&adev->lock);
+    adev_lock(adev, ADEV_LOCK_SITE_IN_PARAMS);
     if (ret >= 0) {
         val = atoi(value);
         /* no audio source uses val == 0 */
@@ -4297,7 +5051,7 @@ static int in_set_parameters(struct audio_stream *stream, const char *kvpairs)
         }
     }
 
-    ret = str_parms_get_str(parms, AUDIO_PARAMETER_STREAM_ROUTING, value, sizeof(value));
+    ret = kv_parms_get_str(&parms, SET_PARAM_ROUTING, value, sizeof(value));
 
     if (ret >= 0) {
         val = atoi(value);
@@ -4307,7 +5061,7 @@ static int in_set_parameters(struct audio_stream *stream, const char *kvpairs)
             // The routing request will otherwise block during 10 second
             int card;
             if (audio_is_usb_in_device(val) &&
-                (card = get_alive_usb_card(parms)) >= 0) {
+                (card = get_alive_usb_card(&parms)) >= 0) {
 
                 ALOGW("in_set_parameters() ignoring rerouting to non existing USB card %d", card);
                 status = -ENOSYS;
@@ -4331,7 +5085,6 @@ static int in_set_parameters(struct audio_stream *stream, const char *kvpairs)
     pthread_mutex_unlock(&adev->lock);
     pthread_mutex_unlock(&in->lock);
 
-    str_parms_destroy(parms);
     ALOGV("%s: exit: status(%d)", __func__, status);
     return status;
 }
@@ -4411,7 +5164,7 @@ static void in_snd_mon_cb(void * stream, struct str_parms * parms)
     if (parse_snd_card_status(parms, &card, &status) < 0)
         return;
 
-    pthread_mutex_lock(&adev->lock);
+    adev_lock(adev, ADEV_LOCK_SITE_SND_MON);
     bool valid_cb = (card == adev->snd_card);
     pthread_mutex_unlock(&adev->lock);
 
@@ -4441,13 +5194,23 @@ static ssize_t in_read(struct audio_stream_in *stream, void *buffer,
     struct stream_in *in = (struct stream_in *)stream;
     struct audio_device *adev = in->dev;
     int i, ret = -1;
-    int *int_buf_stream = NULL;
     int error_code = ERROR_CODE_STANDBY; // initial errors are considered coming out of standby.
 
+    const int64_t read_start_ns = systemTime(SYSTEM_TIME_MONOTONIC);
     lock_input_stream(in);
+    latency_histogram_log_ns(&in->lock_wait_hist,
+                             systemTime(SYSTEM_TIME_MONOTONIC) - read_start_ns);
     const size_t frame_size = audio_stream_in_frame_size(stream);
     const size_t frames = bytes / frame_size;
 
+    if (in->last_read_ns != 0) {
+        const int64_t expected_ns = frames * (int64_t)NANOS_PER_SECOND /
+                                    in_get_sample_rate(&in->stream.common);
+        latency_histogram_log_ns(&in->read_jitter_hist,
+                                 llabs(read_start_ns - in->last_read_ns - expected_ns));
+    }
+    in->last_read_ns = read_start_ns;
+
     if (in->flags & AUDIO_INPUT_FLAG_HW_HOTWORD) {
         ALOGVV(" %s: reading on st session bytes=%zu", __func__, bytes);
         /* Read from sound trigger HAL */
@@ -4464,7 +5227,7 @@ static ssize_t in_read(struct audio_stream_in *stream, void *buffer,
     if (in->standby) {
         const int64_t startNs = systemTime(SYSTEM_TIME_MONOTONIC);
 
-        pthread_mutex_lock(&adev->lock);
+        adev_lock(adev, ADEV_LOCK_SITE_IN_START);
         ret = start_input_stream(in);
         pthread_mutex_unlock(&adev->lock);
         if (ret != 0) {
@@ -4486,12 +5249,20 @@ static ssize_t in_read(struct audio_stream_in *stream, void *buffer,
     request_in_focus(in, ns);
 
     bool use_mmap = is_mmap_usecase(in->usecase) || in->realtime;
-    if (in->pcm) {
+    size_t async_muted_frames = 0;
+    if (in->async_capture != NULL) {
+        // the reader thread has already converted the data and zeroed the
+        // periods it captured while muted
+        ret = audio_extn_async_pcm_read(in, buffer, bytes, &async_muted_frames);
+    } else if (in->pcm) {
+        const int64_t kernel_start_ns = systemTime(SYSTEM_TIME_MONOTONIC);
         if (use_mmap) {
             ret = pcm_mmap_read(in->pcm, buffer, bytes);
         } else {
             ret = pcm_read(in->pcm, buffer, bytes);
         }
+        latency_histogram_log_ns(&in->kernel_read_hist,
+                                 systemTime(SYSTEM_TIME_MONOTONIC) - kernel_start_ns);
         if (ret < 0) {
             ALOGE("Failed to read w/err %s", strerror(errno));
             ret = -errno;
@@ -4499,10 +5270,7 @@ static ssize_t in_read(struct audio_stream_in *stream, void *buffer,
         if (!ret && bytes > 0 && (in->format == AUDIO_FORMAT_PCM_8_24_BIT)) {
             if (bytes % 4 == 0) {
                 /* data from DSP comes in 24_8 format, convert it to 8_24 */
-                int_buf_stream = buffer;
-                for (size_t itt=0; itt < bytes/4 ; itt++) {
-                    int_buf_stream[itt] >>= 8;
-                }
+                pcm_kernels_shift_24_8_to_8_24((int32_t *)buffer, bytes / 4);
             } else {
                 ALOGE("%s: !!! something wrong !!! ... data not 32 bit aligned ", __func__);
                 ret = -EINVAL;
@@ -4517,15 +5285,20 @@ static ssize_t in_read(struct audio_stream_in *stream, void *buffer,
      * Instead of writing zeroes here, we could trust the hardware
      * to always provide zeroes when muted.
      * No need to acquire adev->lock to read mic_muted here as we don't change its state.
+     * With async capture the ring may hold periods captured before the mute.
      */
     if (ret == 0 && adev->mic_muted &&
         !voice_is_in_call_rec_stream(in) &&
         in->usecase != USECASE_AUDIO_RECORD_AFE_PROXY) {
         memset(buffer, 0, bytes);
         in->frames_muted += frames;
+    } else if (ret == 0) {
+        in->frames_muted += async_muted_frames;
     }
 
 exit:
+    latency_histogram_log_ns(&in->read_hist,
+                             systemTime(SYSTEM_TIME_MONOTONIC) - read_start_ns);
     pthread_mutex_unlock(&in->lock);
 
     if (ret != 0) {
@@ -4565,7 +5338,12 @@ static int in_get_capture_position(const struct audio_stream_in *stream,
                  "%s stream in standby but pcm not NULL for non ST session", __func__);
         goto exit;
     }
-    if (in->pcm) {
+    if (in->async_capture != NULL) {
+        // sampled by the reader thread right after its last pcm_read()
+        ret = audio_extn_async_pcm_get_capture_position(in, frames, time);
+        if (ret == 0)
+            *time -= platform_capture_latency(in) * 1000LL;
+    } else if (in->pcm) {
         struct timespec timestamp;
         unsigned int avail;
         if (pcm_get_htimestamp(in->pcm, &avail, &timestamp) == 0) {
@@ -4641,7 +5419,7 @@ static int add_remove_audio_effect(const struct audio_stream *stream,
         return status;
 
     lock_input_stream(in);
-    pthread_mutex_lock(&in->dev->lock);
+    adev_lock(in->dev, ADEV_LOCK_SITE_EFFECTS);
     if ((in->source == AUDIO_SOURCE_VOICE_COMMUNICATION ||
             in->source == AUDIO_SOURCE_VOICE_RECOGNITION ||
             adev->mode == AUDIO_MODE_IN_COMMUNICATION) &&
@@ -4713,7 +5491,7 @@ static int in_stop(const struct audio_stream_in* stream)
 
     int ret = -ENOSYS;
     ALOGV("%s", __func__);
-    pthread_mutex_lock(&adev->lock);
+    adev_lock(adev, ADEV_LOCK_SITE_MMAP);
     if (in->usecase == USECASE_AUDIO_RECORD_MMAP && !in->standby &&
             in->capture_started && in->pcm != NULL) {
         pcm_stop(in->pcm);
@@ -4731,7 +5509,7 @@ static int in_start(const struct audio_stream_in* stream)
     int ret = -ENOSYS;
 
     ALOGV("%s in %p", __func__, in);
-    pthread_mutex_lock(&adev->lock);
+    adev_lock(adev, ADEV_LOCK_SITE_MMAP);
     if (in->usecase == USECASE_AUDIO_RECORD_MMAP && !in->standby &&
             !in->capture_started && in->pcm != NULL) {
         if (!in->capture_started) {
@@ -4770,7 +5548,7 @@ static int in_create_mmap_buffer(const struct audio_stream_in *stream,
     uint32_t buffer_size;
 
     lock_input_stream(in);
-    pthread_mutex_lock(&adev->lock);
+    adev_lock(adev, ADEV_LOCK_SITE_MMAP);
     ALOGV("%s in %p", __func__, in);
 
     if (info == NULL || min_size_frames <= 0 || min_size_frames > MMAP_MIN_SIZE_FRAMES_MAX) {
@@ -4899,7 +5677,7 @@ static int in_get_active_microphones(const struct audio_stream_in *stream,
     ALOGVV("%s", __func__);
 
     lock_input_stream(in);
-    pthread_mutex_lock(&adev->lock);
+    adev_lock(adev, ADEV_LOCK_SITE_IN_PARAMS);
     int ret = platform_get_active_microphones(adev->platform,
                                               audio_channel_count_from_in_mask(in->channel_mask),
                                               in->usecase, mic_array, mic_count);
@@ -4915,9 +5693,8 @@ static int adev_get_microphones(const struct audio_hw_device *dev,
     struct audio_device *adev = (struct audio_device *)dev;
     ALOGVV("%s", __func__);
 
-    pthread_mutex_lock(&adev->lock);
+    // microphone characteristics are immutable once adev_open() returns
     int ret = platform_get_microphones(adev->platform, mic_array, mic_count);
-    pthread_mutex_unlock(&adev->lock);
 
     return ret;
 }
@@ -4970,7 +5747,7 @@ static void in_update_sink_metadata(struct audio_stream_in *stream,
         device = sink_metadata->tracks->dest_device;
 
     lock_input_stream(in);
-    pthread_mutex_lock(&adev->lock);
+    adev_lock(adev, ADEV_LOCK_SITE_IN_PARAMS);
     ALOGV("%s: in->usecase: %d, device: %x", __func__, in->usecase, device);
 
     if (in->usecase == USECASE_AUDIO_RECORD_AFE_PROXY
@@ -5047,6 +5824,7 @@ static int adev_open_output_stream(struct audio_hw_device *dev,
           __func__, config->format, config->sample_rate, config->channel_mask, devices, flags);
 
     *stream_out = NULL;
+    adev_wait_for_init_libs(adev);
     out = (struct stream_out *)calloc(1, sizeof(struct stream_out));
 
     pthread_mutex_init(&out->compr_mute_lock, (const pthread_mutexattr_t *) NULL);
@@ -5070,7 +5848,7 @@ static int adev_open_output_stream(struct audio_hw_device *dev,
         audio_channel_mask_t req_channel_mask = config->channel_mask;
         uint32_t req_sample_rate = config->sample_rate;
 
-        pthread_mutex_lock(&adev->lock);
+        adev_lock(adev, ADEV_LOCK_SITE_OPEN);
         if (is_hdmi) {
             ret = read_hdmi_channel_masks(out);
             if (config->sample_rate == 0)
@@ -5132,7 +5910,7 @@ static int adev_open_output_stream(struct audio_hw_device *dev,
         }
         out->config.format = pcm_format_from_audio_format(out->format);
     } else if (flags & AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD) {
-        pthread_mutex_lock(&adev->lock);
+        adev_lock(adev, ADEV_LOCK_SITE_OPEN);
         bool offline = (adev->card_status == CARD_STATUS_OFFLINE);
         pthread_mutex_unlock(&adev->lock);
 
@@ -5390,6 +6168,7 @@ static int adev_open_output_stream(struct audio_hw_device *dev,
                     goto error_open;
                 }
                 out->config = pcm_config_haptics_audio;
+                out->force_haptic_path = force_haptic_path;
                 if (force_haptic_path)
                     adev->haptics_config = pcm_config_haptics_audio;
                 else
@@ -5437,6 +6216,13 @@ static int adev_open_output_stream(struct audio_hw_device *dev,
                                                   ~AUDIO_CHANNEL_HAPTIC_ALL);
 
              if (force_haptic_path) {
+                 // the test path feeds the first channel to audio and the second to haptics
+                 if (audio_channel_count_from_out_mask(out->channel_mask) < 2) {
+                     ALOGE("%s: forced haptic path needs 2 channels, got mask %#x", __func__,
+                           out->channel_mask);
+                     ret = -EINVAL;
+                     goto error_open;
+                 }
                  out->config.channels = 1;
                  adev->haptics_config.channels = 1;
              } else {
@@ -5480,7 +6266,7 @@ static int adev_open_output_stream(struct audio_hw_device *dev,
     }
 
     /* Check if this usecase is already existing */
-    pthread_mutex_lock(&adev->lock);
+    adev_lock(adev, ADEV_LOCK_SITE_OPEN);
     if (get_usecase_from_list(adev, out->usecase) != NULL) {
         ALOGE("%s: Usecase (%d) is already present", __func__, out->usecase);
         pthread_mutex_unlock(&adev->lock);
@@ -5520,8 +6306,58 @@ static int adev_open_output_stream(struct audio_hw_device *dev,
     else
         out->af_period_multiplier = 1;
 
+    out->mmap_fill = !out->realtime &&
+            (out->usecase == USECASE_AUDIO_PLAYBACK_DEEP_BUFFER ||
+             out->usecase == USECASE_AUDIO_PLAYBACK_HIFI ||
+             out->usecase == USECASE_AUDIO_PLAYBACK_VOIP) &&
+            property_get_bool("vendor.audio.mmap_fill_write.enabled", false);
+
+    if (out->usecase == USECASE_AUDIO_PLAYBACK_LOW_LATENCY ||
+        out->usecase == USECASE_AUDIO_PLAYBACK_ULL) {
+        int32_t hold_ms = property_get_int32("vendor.audio.warm_standby_ms", 0);
+        if (hold_ms > WARM_STANDBY_MAX_HOLD_MS)
+            hold_ms = WARM_STANDBY_MAX_HOLD_MS;
+        out->warm_standby_max_ms = hold_ms > 0 ? hold_ms : 0;
+        out->warm_standby_hold_ms = out->warm_standby_max_ms;
+    }
+
+    if ((out->usecase == USECASE_AUDIO_PLAYBACK_LOW_LATENCY ||
+         (out->usecase == USECASE_AUDIO_PLAYBACK_ULL && !out->realtime)) &&
+        property_get_bool("vendor.audio.adaptive_period.enabled", false)) {
+        int32_t min_count = property_get_int32("vendor.audio.adaptive_period.min_count",
+                                               PERIOD_TUNER_MIN_COUNT);
+        int32_t max_count = property_get_int32("vendor.audio.adaptive_period.max_count",
+                                               PERIOD_TUNER_MAX_COUNT);
+        struct period_tuner_config tuner_config = {
+            .period_size = out->config.period_size,
+            // below two periods the DMA would wrap onto the period being written
+            .min_count = min_count < PERIOD_TUNER_MIN_COUNT ? PERIOD_TUNER_MIN_COUNT : min_count,
+            .max_count = max_count > 0 ? max_count : PERIOD_TUNER_MAX_COUNT,
+            .shrink_after = PERIOD_TUNER_SHRINK_AFTER,
+            .min_session_frames = (int64_t)out->config.rate * PERIOD_TUNER_MIN_SESSION_MS / 1000,
+            .high_cpu_pressure = PERIOD_TUNER_HIGH_CPU_PRESSURE,
+        };
+        period_tuner_init(&out->period_tuner, &tuner_config, out->config.period_count);
+        out->config.period_count = out->period_tuner.period_count;
+        out->period_tuning = true;
+    }
+
     out->kernel_buffer_size = out->config.period_size * out->config.period_count;
 
+    if (out->usecase == USECASE_AUDIO_PLAYBACK_WITH_HAPTICS) {
+        // one AF buffer worth of haptic samples, so out_write() never allocates
+        free(adev->haptic_buffer);
+        adev->haptic_buffer_size = out->config.period_size * out->af_period_multiplier *
+                                   adev->haptics_config.channels *
+                                   audio_bytes_per_sample(out->format);
+        adev->haptic_buffer = (uint8_t *)calloc(1, adev->haptic_buffer_size);
+        if (adev->haptic_buffer == NULL) {
+            adev->haptic_buffer_size = 0;
+            ret = -ENOMEM;
+            goto error_open;
+        }
+    }
+
     out->standby = 1;
     /* out->muted = false; by calloc() */
     /* out->written = 0; by calloc() */
@@ -5529,6 +6365,11 @@ static int adev_open_output_stream(struct audio_hw_device *dev,
     pthread_mutex_init(&out->lock, (const pthread_mutexattr_t *) NULL);
     pthread_mutex_init(&out->pre_lock, (const pthread_mutexattr_t *) NULL);
     pthread_cond_init(&out->cond, (const pthread_condattr_t *) NULL);
+    pthread_condattr_t warm_standby_condattr;
+    pthread_condattr_init(&warm_standby_condattr);
+    pthread_condattr_setclock(&warm_standby_condattr, CLOCK_MONOTONIC);
+    pthread_cond_init(&out->warm_standby_cond, &warm_standby_condattr);
+    pthread_condattr_destroy(&warm_standby_condattr);
 
     config->format = out->stream.common.get_format(&out->stream.common);
     config->channel_mask = out->stream.common.get_channels(&out->stream.common);
@@ -5549,7 +6390,7 @@ static int adev_open_output_stream(struct audio_hw_device *dev,
     */
     lock_output_stream(out);
     audio_extn_snd_mon_register_listener(out, out_snd_mon_cb);
-    pthread_mutex_lock(&adev->lock);
+    adev_lock(adev, ADEV_LOCK_SITE_OPEN);
     out->card_status = adev->card_status;
     pthread_mutex_unlock(&adev->lock);
     pthread_mutex_unlock(&out->lock);
@@ -5562,6 +6403,10 @@ static int adev_open_output_stream(struct audio_hw_device *dev,
     return 0;
 
 error_open:
+    if (adev->primary_output == out)
+        adev->primary_output = NULL;
+    if (adev->voice_tx_output == out)
+        adev->voice_tx_output = NULL;
     free(out);
     *stream_out = NULL;
     ALOGW("%s: exit: ret %d", __func__, ret);
@@ -5579,7 +6424,11 @@ static void adev_close_output_stream(struct audio_hw_device *dev __unused,
     // must deregister from sndmonitor first to prevent races
     // between the callback and close_stream
     audio_extn_snd_mon_unregister_listener(out);
-    out_standby(&stream->common);
+    // a closing stream is not parked in warm standby
+    lock_output_stream(out);
+    out_standby_l(&stream->common, false /* allow_warm */);
+    pthread_mutex_unlock(&out->lock);
+    out_destroy_warm_standby(out);
     if (out->usecase == USECASE_AUDIO_PLAYBACK_OFFLOAD) {
         destroy_offload_callback_thread(out);
 
@@ -5589,12 +6438,19 @@ static void adev_close_output_stream(struct audio_hw_device *dev __unused,
 
     out->a2dp_compress_mute = false;
 
+    if (out->usecase == USECASE_AUDIO_PLAYBACK_WITH_HAPTICS) {
+        free(adev->haptic_buffer);
+        adev->haptic_buffer = NULL;
+        adev->haptic_buffer_size = 0;
+    }
+
     if (adev->voice_tx_output == out)
         adev->voice_tx_output = NULL;
 
     error_log_destroy(out->error_log);
     out->error_log = NULL;
 
+    pthread_cond_destroy(&out->warm_standby_cond);
     pthread_cond_destroy(&out->cond);
     pthread_mutex_destroy(&out->pre_lock);
     pthread_mutex_destroy(&out->lock);
@@ -5605,8 +6461,8 @@ static void adev_close_output_stream(struct audio_hw_device *dev __unused,
 static int adev_set_parameters(struct audio_hw_device *dev, const char *kvpairs)
 {
     struct audio_device *adev = (struct audio_device *)dev;
-    struct str_parms *parms;
-    char *str;
+    struct kv_parms kv;
+    struct str_parms *parms = NULL;
     char value[32];
     int val;
     int ret;
@@ -5615,15 +6471,23 @@ static int adev_set_parameters(struct audio_hw_device *dev, const char *kvpairs)
 
     ALOGV("%s: enter: %s", __func__, kvpairs);
 
-    pthread_mutex_lock(&adev->lock);
+    /* Keys handled here are read from the tokenized kvpairs. The other
+     * subsystems still take a str_parms, which is only built when one of
+     * them has a key to act on. */
+    set_param_parse(&kv, kvpairs);
+    if (kv.consumers & ~PARAM_CONSUMER_ADEV)
+        parms = str_parms_create_str(kvpairs);
 
-    parms = str_parms_create_str(kvpairs);
-    status = voice_set_parameters(adev, parms);
-    if (status != 0) {
-        goto done;
+    adev_lock(adev, ADEV_LOCK_SITE_ADEV_PARAMS);
+
+    if (kv.consumers & PARAM_CONSUMER_VOICE) {
+        status = voice_set_parameters(adev, parms);
+        if (status != 0) {
+            goto done;
+        }
     }
 
-    ret = str_parms_get_str(parms, AUDIO_PARAMETER_KEY_BT_NREC, value, sizeof(value));
+    ret = kv_parms_get_str(&kv, SET_PARAM_BT_NREC, value, sizeof(value));
     if (ret >= 0) {
         /* When set to false, HAL should disable EC and NS */
         if (strcmp(value, AUDIO_PARAMETER_VALUE_ON) == 0)
@@ -5632,7 +6496,7 @@ static int adev_set_parameters(struct audio_hw_device *dev, const char *kvpairs)
             adev->bluetooth_nrec = false;
     }
 
-    ret = str_parms_get_str(parms, "screen_state", value, sizeof(value));
+    ret = kv_parms_get_str(&kv, SET_PARAM_SCREEN_STATE, value, sizeof(value));
     if (ret >= 0) {
         if (strcmp(value, AUDIO_PARAMETER_VALUE_ON) == 0)
             adev->screen_off = false;
@@ -5640,7 +6504,7 @@ static int adev_set_parameters(struct audio_hw_device *dev, const char *kvpairs)
             adev->screen_off = true;
     }
 
-    ret = str_parms_get_int(parms, "rotation", &val);
+    ret = kv_parms_get_int(&kv, SET_PARAM_ROTATION, &val);
     if (ret >= 0) {
         bool reverse_speakers = false;
         int camera_rotation = CAMERA_ROTATION_LANDSCAPE;
@@ -5675,12 +6539,12 @@ static int adev_set_parameters(struct audio_hw_device *dev, const char *kvpairs)
         }
     }
 
-    ret = str_parms_get_str(parms, AUDIO_PARAMETER_KEY_BT_SCO_WB, value, sizeof(value));
+    ret = kv_parms_get_str(&kv, SET_PARAM_BT_SCO_WB, value, sizeof(value));
     if (ret >= 0) {
         adev->bt_wb_speech_enabled = !strcmp(value, AUDIO_PARAMETER_VALUE_ON);
     }
 
-    ret = str_parms_get_str(parms, "BT_SCO", value, sizeof(value));
+    ret = kv_parms_get_str(&kv, SET_PARAM_BT_SCO, value, sizeof(value));
     if (ret >= 0) {
         if (strcmp(value, AUDIO_PARAMETER_VALUE_ON) == 0)
             adev->bt_sco_on = true;
@@ -5688,17 +6552,17 @@ static int adev_set_parameters(struct audio_hw_device *dev, const char *kvpairs)
             adev->bt_sco_on = false;
     }
 
-    ret = str_parms_get_str(parms, AUDIO_PARAMETER_DEVICE_CONNECT, value, sizeof(value));
+    ret = kv_parms_get_str(&kv, SET_PARAM_DEVICE_CONNECT, value, sizeof(value));
     if (ret >= 0) {
         audio_devices_t device = (audio_devices_t)strtoul(value, NULL, 10);
         if (audio_is_usb_out_device(device)) {
-            ret = str_parms_get_str(parms, "card", value, sizeof(value));
+            ret = kv_parms_get_str(&kv, SET_PARAM_CARD, value, sizeof(value));
             if (ret >= 0) {
                 const int card = atoi(value);
                 audio_extn_usb_add_device(device, card);
             }
         } else if (audio_is_usb_in_device(device)) {
-            ret = str_parms_get_str(parms, "card", value, sizeof(value));
+            ret = kv_parms_get_str(&kv, SET_PARAM_CARD, value, sizeof(value));
             if (ret >= 0) {
                 const int card = atoi(value);
                 audio_extn_usb_add_device(device, card);
@@ -5706,17 +6570,17 @@ static int adev_set_parameters(struct audio_hw_device *dev, const char *kvpairs)
         }
     }
 
-    ret = str_parms_get_str(parms, AUDIO_PARAMETER_DEVICE_DISCONNECT, value, sizeof(value));
+    ret = kv_parms_get_str(&kv, SET_PARAM_DEVICE_DISCONNECT, value, sizeof(value));
     if (ret >= 0) {
         audio_devices_t device = (audio_devices_t)strtoul(value, NULL, 10);
         if (audio_is_usb_out_device(device)) {
-            ret = str_parms_get_str(parms, "card", value, sizeof(value));
+            ret = kv_parms_get_str(&kv, SET_PARAM_CARD, value, sizeof(value));
             if (ret >= 0) {
                 const int card = atoi(value);
                 audio_extn_usb_remove_device(device, card);
             }
         } else if (audio_is_usb_in_device(device)) {
-            ret = str_parms_get_str(parms, "card", value, sizeof(value));
+            ret = kv_parms_get_str(&kv, SET_PARAM_CARD, value, sizeof(value));
             if (ret >= 0) {
                 const int card = atoi(value);
                 audio_extn_usb_remove_device(device, card);
@@ -5724,10 +6588,13 @@ static int adev_set_parameters(struct audio_hw_device *dev, const char *kvpairs)
         }
     }
 
-    audio_extn_hfp_set_parameters(adev, parms);
-    audio_extn_ma_set_parameters(adev, parms);
+    if (kv.consumers & PARAM_CONSUMER_HFP)
+        audio_extn_hfp_set_parameters(adev, parms);
+    if (kv.consumers & PARAM_CONSUMER_MA)
+        audio_extn_ma_set_parameters(adev, parms);
 
-    status = audio_extn_a2dp_set_parameters(parms, &a2dp_reconfig);
+    if (kv.consumers & PARAM_CONSUMER_A2DP)
+        status = audio_extn_a2dp_set_parameters(parms, &a2dp_reconfig);
     if (status >= 0 && a2dp_reconfig) {
         struct audio_usecase *usecase;
         struct listnode *node;
@@ -5739,7 +6606,7 @@ static int adev_set_parameters(struct audio_hw_device *dev, const char *kvpairs)
 
                 pthread_mutex_unlock(&adev->lock);
                 lock_output_stream(usecase->stream.out);
-                pthread_mutex_lock(&adev->lock);
+                adev_lock(adev, ADEV_LOCK_SITE_ADEV_PARAMS);
                 audio_extn_a2dp_set_handoff_mode(true);
                 // force device switch to reconfigure encoder
                 select_devices(adev, usecase->id);
@@ -5751,7 +6618,7 @@ static int adev_set_parameters(struct audio_hw_device *dev, const char *kvpairs)
     }
 
     //FIXME: to be replaced by proper video capture properties API
-    ret = str_parms_get_str(parms, AUDIO_PARAMETER_KEY_CAMERA_FACING, value, sizeof(value));
+    ret = kv_parms_get_str(&kv, SET_PARAM_CAMERA_FACING, value, sizeof(value));
     if (ret >= 0) {
         int camera_facing = CAMERA_FACING_BACK;
         if (strcmp(value, AUDIO_PARAMETER_VALUE_FRONT) == 0)
@@ -5777,8 +6644,9 @@ static int adev_set_parameters(struct audio_hw_device *dev, const char *kvpairs)
     }
 
 done:
-    str_parms_destroy(parms);
     pthread_mutex_unlock(&adev->lock);
+    if (parms != NULL)
+        str_parms_destroy(parms);
     ALOGV("%s: exit with code(%d)", __func__, status);
     return status;
 }
@@ -5791,7 +6659,7 @@ static char* adev_get_parameters(const struct audio_hw_device *dev,
     struct str_parms *query = str_parms_create_str(keys);
     char *str;
 
-    pthread_mutex_lock(&adev->lock);
+    adev_lock(adev, ADEV_LOCK_SITE_ADEV_PARAMS);
 
     voice_get_parameters(adev, query, reply);
     audio_extn_a2dp_get_parameters(query, reply);
@@ -5817,7 +6685,7 @@ static int adev_set_voice_volume(struct audio_hw_device *dev, float volume)
 
     audio_extn_extspk_set_voice_vol(adev->extspk, volume);
 
-    pthread_mutex_lock(&adev->lock);
+    adev_lock(adev, ADEV_LOCK_SITE_VOICE);
     ret = voice_set_volume(adev, volume);
     pthread_mutex_unlock(&adev->lock);
 
@@ -5849,10 +6717,13 @@ static int adev_set_mode(struct audio_hw_device *dev, audio_mode_t mode)
 {
     struct audio_device *adev = (struct audio_device *)dev;
 
-    pthread_mutex_lock(&adev->lock);
+    adev_lock(adev, ADEV_LOCK_SITE_VOICE);
     if (adev->mode != mode) {
         ALOGD("%s: mode %d", __func__, (int)mode);
         adev->mode = mode;
+        // warm standby is only kept in normal mode, see out_enter_warm_standby_l()
+        if (mode != AUDIO_MODE_NORMAL)
+            drop_warm_standby_outputs(adev);
         if ((mode == AUDIO_MODE_NORMAL || mode == AUDIO_MODE_IN_COMMUNICATION) &&
                 voice_is_in_call(adev)) {
             voice_stop_call(adev);
@@ -5885,7 +6756,7 @@ static int adev_set_mic_mute(struct audio_hw_device *dev, bool state)
     struct audio_device *adev = (struct audio_device *)dev;
 
     ALOGD("%s: state %d", __func__, (int)state);
-    pthread_mutex_lock(&adev->lock);
+    adev_lock(adev, ADEV_LOCK_SITE_VOICE);
     if (audio_extn_tfa_98xx_is_supported() && adev->enable_hfp) {
         ret = audio_extn_hfp_set_mic_mute(adev, state);
     } else {
@@ -5979,6 +6850,7 @@ static int adev_open_input_stream(struct audio_hw_device *dev,
             __func__, flags, is_usb_dev, may_use_hifi_record,
             config->sample_rate, config->channel_mask, config->format);
     *stream_in = NULL;
+    adev_wait_for_init_libs(adev);
 
     if (is_usb_dev && !is_usb_ready(adev, false /* is_playback */)) {
         return -ENOSYS;
@@ -6226,7 +7098,7 @@ static int adev_open_input_stream(struct audio_hw_device *dev,
 
     lock_input_stream(in);
     audio_extn_snd_mon_register_listener(in, in_snd_mon_cb);
-    pthread_mutex_lock(&adev->lock);
+    adev_lock(adev, ADEV_LOCK_SITE_OPEN);
     in->card_status = adev->card_status;
     pthread_mutex_unlock(&adev->lock);
     pthread_mutex_unlock(&in->lock);
@@ -6265,8 +7137,68 @@ static void adev_close_input_stream(struct audio_hw_device *dev __unused,
     return;
 }
 
-static int adev_dump(const audio_hw_device_t *device __unused, int fd __unused)
+static const char * const adev_init_stage_names[ADEV_INIT_STAGE_MAX] = {
+    [ADEV_INIT_STAGE_PLATFORM] = "platform",
+    [ADEV_INIT_STAGE_LIBS] = "libs",
+    [ADEV_INIT_STAGE_LIBS_WAIT] = "libs_wait",
+    [ADEV_INIT_STAGE_VERIFY_DEVICES] = "verify_devices",
+    [ADEV_INIT_STAGE_EXTN] = "extn",
+    [ADEV_INIT_STAGE_SND_MON] = "snd_mon",
+    [ADEV_INIT_STAGE_TOTAL] = "total",
+};
+
+static const char * const adev_lock_site_names[ADEV_LOCK_SITE_MAX] = {
+    [ADEV_LOCK_SITE_OPEN] = "open",
+    [ADEV_LOCK_SITE_OUT_START] = "out_start",
+    [ADEV_LOCK_SITE_OUT_STANDBY] = "out_standby",
+    [ADEV_LOCK_SITE_OUT_PARAMS] = "out_params",
+    [ADEV_LOCK_SITE_IN_START] = "in_start",
+    [ADEV_LOCK_SITE_IN_STANDBY] = "in_standby",
+    [ADEV_LOCK_SITE_IN_PARAMS] = "in_params",
+    [ADEV_LOCK_SITE_MMAP] = "mmap",
+    [ADEV_LOCK_SITE_EFFECTS] = "effects",
+    [ADEV_LOCK_SITE_ADEV_PARAMS] = "adev_params",
+    [ADEV_LOCK_SITE_VOICE] = "voice",
+    [ADEV_LOCK_SITE_SND_MON] = "snd_mon",
+    [ADEV_LOCK_SITE_EXTN] = "extn",
+};
+
+static int adev_dump(const audio_hw_device_t *device, int fd)
 {
+    struct audio_device *adev = (struct audio_device *)device;
+
+    // Best effort, as with stream dumps the lock may be held by a blocked caller.
+    const bool locked = (pthread_mutex_trylock(&adev->lock) == 0);
+
+    char buffer[256]; // for statistics formatting
+    if (adev->route_switch_latency_ms.n > 0) {
+        simple_stats_to_string(&adev->route_switch_latency_ms, buffer, sizeof(buffer));
+        dprintf(fd, "  Route switch latency ms: %s\n", buffer);
+        simple_stats_to_string(&adev->route_switch_paths, buffer, sizeof(buffer));
+        dprintf(fd, "  Route switch mixer paths: %s\n", buffer);
+    }
+    latency_histogram_dump(&adev->select_devices_hist, fd, "  ", "select_devices");
+
+    dprintf(fd, "  Open stages ms:");
+    for (int i = 0; i < ADEV_INIT_STAGE_MAX; i++) {
+        dprintf(fd, " %s=%.3f", adev_init_stage_names[i], adev->init_stage_ns[i] * 1e-6);
+    }
+    dprintf(fd, "\n");
+
+    dprintf(fd, "  Device lock contention:\n");
+    for (int i = 0; i < ADEV_LOCK_SITE_MAX; i++) {
+        const struct adev_lock_stats *stats = &adev->lock_stats[i];
+        if (stats->acquired == 0)
+            continue;
+        dprintf(fd, "    %-12s acquired %llu contended %llu wait ms %.3f max ms %.3f\n",
+                adev_lock_site_names[i],
+                (unsigned long long)stats->acquired, (unsigned long long)stats->contended,
+                stats->wait_ns * 1e-6, stats->max_wait_ns * 1e-6);
+    }
+
+    if (locked) {
+        pthread_mutex_unlock(&adev->lock);
+    }
     return 0;
 }
 
@@ -6408,6 +7340,7 @@ static int adev_close(hw_device_t *device)
         goto done;
 
     if ((--audio_device_ref_count) == 0) {
+        adev_wait_for_init_libs(adev);
         audio_extn_snd_mon_unregister_listener(adev);
         audio_extn_tfa_98xx_deinit();
         audio_extn_ma_deinit();
@@ -6422,6 +7355,7 @@ static int adev_close(hw_device_t *device)
         }
         if (adev->adm_deinit)
             adev->adm_deinit(adev->adm_data);
+        pthread_mutex_destroy(&adev->init_libs_lock);
         pthread_mutex_destroy(&adev->lock);
         free(device);
         adev = NULL;
@@ -6464,7 +7398,7 @@ static void adev_snd_mon_cb(void * stream __unused, struct str_parms * parms)
     if (parse_snd_card_status(parms, &card, &status) < 0)
         return;
 
-    pthread_mutex_lock(&adev->lock);
+    adev_lock(adev, ADEV_LOCK_SITE_SND_MON);
     bool valid_cb = (card == adev->snd_card);
     if (valid_cb) {
         if (adev->card_status != status) {
@@ -6542,7 +7476,7 @@ int check_a2dp_restore(struct audio_device *adev, struct stream_out *out, bool r
     int ret = 0;
 
     lock_output_stream(out);
-    pthread_mutex_lock(&adev->lock);
+    adev_lock(adev, ADEV_LOCK_SITE_EXTN);
 
     ret = check_a2dp_restore_l(adev, out, restore);
 
@@ -6551,6 +7485,108 @@ int check_a2dp_restore(struct audio_device *adev, struct stream_out *out, bool r
     return ret;
 }
 
+/* Nothing loaded here is used before the first stream is opened, so it runs
+ * on a worker while adev_open() goes through platform_init(), and is only
+ * joined by adev_wait_for_init_libs().
+ */
+static void *adev_init_libs_loop(void *context)
+{
+    struct audio_device *adev = (struct audio_device *)context;
+    const int64_t start_ns = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    prctl(PR_SET_NAME, (unsigned long)"HAL Init Libs", 0, 0, 0);
+
+    adev->visualizer_lib = dlopen(VISUALIZER_LIBRARY_PATH, RTLD_NOW);
+    if (adev->visualizer_lib == NULL) {
+        ALOGW("%s: DLOPEN failed for %s", __func__, VISUALIZER_LIBRARY_PATH);
+    } else {
+        ALOGV("%s: DLOPEN successful for %s", __func__, VISUALIZER_LIBRARY_PATH);
+        adev->visualizer_start_output =
+                    (int (*)(audio_io_handle_t, int, int, int))dlsym(adev->visualizer_lib,
+                                                    "visualizer_hal_start_output");
+        adev->visualizer_stop_output =
+                    (int (*)(audio_io_handle_t, int))dlsym(adev->visualizer_lib,
+                                                    "visualizer_hal_stop_output");
+    }
+
+    adev->offload_effects_lib = dlopen(OFFLOAD_EFFECTS_BUNDLE_LIBRARY_PATH, RTLD_NOW);
+    if (adev->offload_effects_lib == NULL) {
+        ALOGW("%s: DLOPEN failed for %s", __func__,
+              OFFLOAD_EFFECTS_BUNDLE_LIBRARY_PATH);
+    } else {
+        ALOGV("%s: DLOPEN successful for %s", __func__,
+              OFFLOAD_EFFECTS_BUNDLE_LIBRARY_PATH);
+        adev->offload_effects_start_output =
+                    (int (*)(audio_io_handle_t, int))dlsym(adev->offload_effects_lib,
+                                     "offload_effects_bundle_hal_start_output");
+        adev->offload_effects_stop_output =
+                    (int (*)(audio_io_handle_t, int))dlsym(adev->offload_effects_lib,
+                                     "offload_effects_bundle_hal_stop_output");
+    }
+
+    adev->adm_lib = dlopen(ADM_LIBRARY_PATH, RTLD_NOW);
+    if (adev->adm_lib == NULL) {
+        ALOGW("%s: DLOPEN failed for %s", __func__, ADM_LIBRARY_PATH);
+    } else {
+        ALOGV("%s: DLOPEN successful for %s", __func__, ADM_LIBRARY_PATH);
+        adev->adm_init = (adm_init_t)
+                                dlsym(adev->adm_lib, "adm_init");
+        adev->adm_deinit = (adm_deinit_t)
+                                dlsym(adev->adm_lib, "adm_deinit");
+        adev->adm_register_input_stream = (adm_register_input_stream_t)
+                                dlsym(adev->adm_lib, "adm_register_input_stream");
+        adev->adm_register_output_stream = (adm_register_output_stream_t)
+                                dlsym(adev->adm_lib, "adm_register_output_stream");
+        adev->adm_deregister_stream = (adm_deregister_stream_t)
+                                dlsym(adev->adm_lib, "adm_deregister_stream");
+        adev->adm_request_focus = (adm_request_focus_t)
+                                dlsym(adev->adm_lib, "adm_request_focus");
+        adev->adm_abandon_focus = (adm_abandon_focus_t)
+                                dlsym(adev->adm_lib, "adm_abandon_focus");
+        adev->adm_set_config = (adm_set_config_t)
+                                    dlsym(adev->adm_lib, "adm_set_config");
+        adev->adm_request_focus_v2 = (adm_request_focus_v2_t)
+                                    dlsym(adev->adm_lib, "adm_request_focus_v2");
+        adev->adm_is_noirq_avail = (adm_is_noirq_avail_t)
+                                    dlsym(adev->adm_lib, "adm_is_noirq_avail");
+        adev->adm_on_routing_change = (adm_on_routing_change_t)
+                                    dlsym(adev->adm_lib, "adm_on_routing_change");
+    }
+
+    if (adev->adm_init)
+        adev->adm_data = adev->adm_init();
+
+    audio_extn_audiozoom_init();
+
+    adev->init_stage_ns[ADEV_INIT_STAGE_LIBS] = systemTime(SYSTEM_TIME_MONOTONIC) - start_ns;
+    return NULL;
+}
+
+static void adev_start_init_libs(struct audio_device *adev)
+{
+    adev->init_libs_pending =
+            pthread_create(&adev->init_libs_thread, (const pthread_attr_t *) NULL,
+                           adev_init_libs_loop, adev) == 0;
+    if (!adev->init_libs_pending) {
+        ALOGW("%s: cannot create init thread, loading libraries inline", __func__);
+        adev_init_libs_loop(adev);
+    }
+}
+
+/* must be called before using anything set up by adev_init_libs_loop() */
+static void adev_wait_for_init_libs(struct audio_device *adev)
+{
+    pthread_mutex_lock(&adev->init_libs_lock);
+    if (adev->init_libs_pending) {
+        const int64_t start_ns = systemTime(SYSTEM_TIME_MONOTONIC);
+        pthread_join(adev->init_libs_thread, (void **) NULL);
+        adev->init_libs_pending = false;
+        adev->init_stage_ns[ADEV_INIT_STAGE_LIBS_WAIT] =
+                systemTime(SYSTEM_TIME_MONOTONIC) - start_ns;
+    }
+    pthread_mutex_unlock(&adev->init_libs_lock);
+}
+
 static int adev_open(const hw_module_t *module, const char *name,
                      hw_device_t **device)
 {
@@ -6567,9 +7603,13 @@ static int adev_open(const hw_module_t *module, const char *name,
         pthread_mutex_unlock(&adev_init_lock);
         return 0;
     }
+    const int64_t open_start_ns = systemTime(SYSTEM_TIME_MONOTONIC);
+    int64_t stage_start_ns;
+
     adev = calloc(1, sizeof(struct audio_device));
 
     pthread_mutex_init(&adev->lock, (const pthread_mutexattr_t *) NULL);
+    pthread_mutex_init(&adev->init_libs_lock, (const pthread_mutexattr_t *) NULL);
 
     adev->device.common.tag = HARDWARE_DEVICE_TAG;
     adev->device.common.version = AUDIO_DEVICE_API_VERSION_2_0;
@@ -6597,7 +7637,7 @@ static int adev_open(const hw_module_t *module, const char *name,
     adev->device.get_microphones = adev_get_microphones;
 
     /* Set the default route before the PCM stream is opened */
-    pthread_mutex_lock(&adev->lock);
+    adev_lock(adev, ADEV_LOCK_SITE_OPEN);
     adev->mode = AUDIO_MODE_NORMAL;
     adev->primary_output = NULL;
     adev->bluetooth_nrec = true;
@@ -6608,9 +7648,17 @@ static int adev_open(const hw_module_t *module, const char *name,
     list_init(&adev->usecase_list);
     pthread_mutex_unlock(&adev->lock);
 
+    adev_start_init_libs(adev);
+
     /* Loads platform specific libraries dynamically */
+    stage_start_ns = systemTime(SYSTEM_TIME_MONOTONIC);
     adev->platform = platform_init(adev);
+    adev->init_stage_ns[ADEV_INIT_STAGE_PLATFORM] =
+            systemTime(SYSTEM_TIME_MONOTONIC) - stage_start_ns;
     if (!adev->platform) {
+        adev_wait_for_init_libs(adev);
+        if (adev->adm_deinit)
+            adev->adm_deinit(adev->adm_data);
         free(adev->snd_dev_ref_cnt);
         free(adev);
         ALOGE("%s: Failed to init platform data, aborting.", __func__);
@@ -6620,70 +7668,16 @@ static int adev_open(const hw_module_t *module, const char *name,
     }
     adev->extspk = audio_extn_extspk_init(adev);
 
-    adev->visualizer_lib = dlopen(VISUALIZER_LIBRARY_PATH, RTLD_NOW);
-    if (adev->visualizer_lib == NULL) {
-        ALOGW("%s: DLOPEN failed for %s", __func__, VISUALIZER_LIBRARY_PATH);
-    } else {
-        ALOGV("%s: DLOPEN successful for %s", __func__, VISUALIZER_LIBRARY_PATH);
-        adev->visualizer_start_output =
-                    (int (*)(audio_io_handle_t, int, int, int))dlsym(adev->visualizer_lib,
-                                                    "visualizer_hal_start_output");
-        adev->visualizer_stop_output =
-                    (int (*)(audio_io_handle_t, int))dlsym(adev->visualizer_lib,
-                                                    "visualizer_hal_stop_output");
-    }
-
-    adev->offload_effects_lib = dlopen(OFFLOAD_EFFECTS_BUNDLE_LIBRARY_PATH, RTLD_NOW);
-    if (adev->offload_effects_lib == NULL) {
-        ALOGW("%s: DLOPEN failed for %s", __func__,
-              OFFLOAD_EFFECTS_BUNDLE_LIBRARY_PATH);
-    } else {
-        ALOGV("%s: DLOPEN successful for %s", __func__,
-              OFFLOAD_EFFECTS_BUNDLE_LIBRARY_PATH);
-        adev->offload_effects_start_output =
-                    (int (*)(audio_io_handle_t, int))dlsym(adev->offload_effects_lib,
-                                     "offload_effects_bundle_hal_start_output");
-        adev->offload_effects_stop_output =
-                    (int (*)(audio_io_handle_t, int))dlsym(adev->offload_effects_lib,
-                                     "offload_effects_bundle_hal_stop_output");
-    }
-
-    adev->adm_lib = dlopen(ADM_LIBRARY_PATH, RTLD_NOW);
-    if (adev->adm_lib == NULL) {
-        ALOGW("%s: DLOPEN failed for %s", __func__, ADM_LIBRARY_PATH);
-    } else {
-        ALOGV("%s: DLOPEN successful for %s", __func__, ADM_LIBRARY_PATH);
-        adev->adm_init = (adm_init_t)
-                                dlsym(adev->adm_lib, "adm_init");
-        adev->adm_deinit = (adm_deinit_t)
-                                dlsym(adev->adm_lib, "adm_deinit");
-        adev->adm_register_input_stream = (adm_register_input_stream_t)
-                                dlsym(adev->adm_lib, "adm_register_input_stream");
-        adev->adm_register_output_stream = (adm_register_output_stream_t)
-                                dlsym(adev->adm_lib, "adm_register_output_stream");
-        adev->adm_deregister_stream = (adm_deregister_stream_t)
-                                dlsym(adev->adm_lib, "adm_deregister_stream");
-        adev->adm_request_focus = (adm_request_focus_t)
-                                dlsym(adev->adm_lib, "adm_request_focus");
-        adev->adm_abandon_focus = (adm_abandon_focus_t)
-                                dlsym(adev->adm_lib, "adm_abandon_focus");
-        adev->adm_set_config = (adm_set_config_t)
-                                    dlsym(adev->adm_lib, "adm_set_config");
-        adev->adm_request_focus_v2 = (adm_request_focus_v2_t)
-                                    dlsym(adev->adm_lib, "adm_request_focus_v2");
-        adev->adm_is_noirq_avail = (adm_is_noirq_avail_t)
-                                    dlsym(adev->adm_lib, "adm_is_noirq_avail");
-        adev->adm_on_routing_change = (adm_on_routing_change_t)
-                                    dlsym(adev->adm_lib, "adm_on_routing_change");
-    }
-
     adev->bt_wb_speech_enabled = false;
     adev->enable_voicerx = false;
 
     *device = &adev->device.common;
 
+    stage_start_ns = systemTime(SYSTEM_TIME_MONOTONIC);
     if (k_enable_extended_precision)
         adev_verify_devices(adev);
+    adev->init_stage_ns[ADEV_INIT_STAGE_VERIFY_DEVICES] =
+            systemTime(SYSTEM_TIME_MONOTONIC) - stage_start_ns;
 
     char value[PROPERTY_VALUE_MAX];
     int trial;
@@ -6724,22 +7718,26 @@ static int adev_open(const hw_module_t *module, const char *name,
         ALOGV("new period_multiplier = %d", af_period_multiplier);
     }
 
+    stage_start_ns = systemTime(SYSTEM_TIME_MONOTONIC);
     audio_extn_tfa_98xx_init(adev);
     audio_extn_ma_init(adev->platform);
-    audio_extn_audiozoom_init();
+    adev->init_stage_ns[ADEV_INIT_STAGE_EXTN] =
+            systemTime(SYSTEM_TIME_MONOTONIC) - stage_start_ns;
 
     pthread_mutex_unlock(&adev_init_lock);
 
-    if (adev->adm_init)
-        adev->adm_data = adev->adm_init();
-
     audio_extn_perf_lock_init();
+    stage_start_ns = systemTime(SYSTEM_TIME_MONOTONIC);
     audio_extn_snd_mon_init();
-    pthread_mutex_lock(&adev->lock);
+    adev_lock(adev, ADEV_LOCK_SITE_OPEN);
     audio_extn_snd_mon_register_listener(NULL, adev_snd_mon_cb);
     adev->card_status = CARD_STATUS_ONLINE;
     pthread_mutex_unlock(&adev->lock);
     audio_extn_sound_trigger_init(adev);/* dependent on snd_mon_init() */
+    adev->init_stage_ns[ADEV_INIT_STAGE_SND_MON] =
+            systemTime(SYSTEM_TIME_MONOTONIC) - stage_start_ns;
+    adev->init_stage_ns[ADEV_INIT_STAGE_TOTAL] =
+            systemTime(SYSTEM_TIME_MONOTONIC) - open_start_ns;
 
     ALOGD("%s: exit", __func__);
     return 0;
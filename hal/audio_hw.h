@@ -17,6 +17,7 @@
 #ifndef QCOM_AUDIO_HW_H
 #define QCOM_AUDIO_HW_H
 
+#include <stdatomic.h>
 #include <cutils/str_parms.h>
 #include <cutils/list.h>
 #include <hardware/audio.h>
@@ -28,6 +29,8 @@
 #include <audio_utils/ErrorLog.h>
 #include <audio_utils/Statistics.h>
 #include "voice.h"
+#include "period_tuner.h"
+#include "audio_extn/latency_histogram.h"
 
 // dlopen() does not go through default library path search if there is a "/" in the library name.
 #ifdef __LP64__
@@ -195,10 +198,21 @@ enum {
     OFFLOAD_STATE_PAUSED,
 };
 
-struct offload_cmd {
-    struct listnode node;
-    int cmd;
-    int data[];
+/* Pending offload callback commands. WAIT_FOR_BUFFER is coalesced so at most
+ * one of each command is queued and the ring cannot fill up in practice.
+ */
+#define OFFLOAD_CMD_RING_SIZE 8
+
+/* Mixer path operations batched by one routing transaction. Longer
+ * transactions are flushed early, longer names are applied directly.
+ */
+#define ROUTE_TXN_MAX_OPS 32
+#define ROUTE_TXN_PATH_MAX_LENGTH 100
+
+struct route_txn_op {
+    char name[ROUTE_TXN_PATH_MAX_LENGTH];
+    bool apply; /* false: reset */
+    bool collapsed; /* replaces a reset and apply pair of the path */
 };
 
 struct stream_app_type_cfg {
@@ -209,6 +223,17 @@ struct stream_app_type_cfg {
     int gain[2];
 };
 
+/* Last PCM presentation position, published by out_write() under the stream
+ * lock and read lock free by out_get_presentation_position(). seq is odd while
+ * an update is in progress. time_ns is 0 when there is no valid position. */
+struct out_position_snapshot {
+    atomic_uint seq;
+    _Atomic int64_t written;        /* out->written at time_ns */
+    _Atomic int64_t fifo_frames;    /* frames queued below the HAL at time_ns */
+    _Atomic int64_t latency_frames; /* render and A2DP encoder latency */
+    _Atomic int64_t time_ns;        /* ALSA timestamp, CLOCK_MONOTONIC */
+};
+
 struct stream_out {
     struct audio_stream_out stream;
     pthread_mutex_t lock; /* see note below on mutex acquisition order */
@@ -242,7 +267,12 @@ struct stream_out {
     int offload_state;
     pthread_cond_t offload_cond;
     pthread_t offload_thread;
-    struct listnode offload_cmd_list;
+    int offload_cmds[OFFLOAD_CMD_RING_SIZE];
+    unsigned int offload_cmd_head;
+    unsigned int offload_cmd_count;
+    bool offload_wait_queued;
+    bool offload_thread_idle;
+    bool offload_thread_exit;       /* OFFLOAD_CMD_EXIT, not queued in the ring */
     bool offload_thread_blocked;
 
     stream_callback_t offload_callback;
@@ -263,15 +293,55 @@ struct stream_out {
 
     struct stream_app_type_cfg app_type_cfg;
 
-    size_t kernel_buffer_size;  // cached value of the alsa buffer size, const after open().
+    size_t kernel_buffer_size;  // cached value of the alsa buffer size, set at open() and
+                                // when the period tuner changes the period count.
 
     // last out_get_presentation_position() cached info.
     bool         last_fifo_valid;
     unsigned int last_fifo_frames_remaining;
     int64_t      last_fifo_time_ns;
+    struct out_position_snapshot position;
 
     simple_stats_t fifo_underruns;  // TODO: keep a list of the last N fifo underrun times.
     simple_stats_t start_latency_ms;
+
+    struct latency_histogram write_hist;         // out_write() duration, including lock wait.
+    struct latency_histogram lock_wait_hist;     // out_write() wait for pre_lock and lock.
+    struct latency_histogram kernel_write_hist;  // pcm write or async ring copy duration.
+    struct latency_histogram write_jitter_hist;  // |write interval - buffer duration|.
+    int64_t last_write_ns;  // out_write() entry time, 0 after standby.
+
+    struct async_pcm *async_pcm;  // non NULL while the async writer thread owns pcm_write().
+
+    bool mmap_fill;  // pcm opened with PCM_MMAP, out_write() fills the DMA buffer directly.
+    bool mmap_fill_started;  // pcm_start() done since the last standby.
+
+    bool force_haptic_path;  // vendor.audio.test_haptic, read once at open().
+
+    /* Warm standby: on standby the pcm is only stopped and re-prepared, and the
+       usecase keeps its route, until the hold-off expires or the next write. */
+    bool warm_standby;                  // standby with pcm prepared and route applied.
+    uint32_t warm_standby_max_ms;       // vendor.audio.warm_standby_ms, 0 if disabled.
+    uint32_t warm_standby_hold_ms;      // next hold-off, halved after each expiry.
+    int64_t warm_standby_deadline_ns;
+    pthread_cond_t warm_standby_cond;   // wakes the expiry thread, used with lock.
+    pthread_t warm_standby_thread;
+    bool warm_standby_thread_started;
+    bool warm_standby_thread_exit;
+    unsigned int warm_standby_hits;     // writes resumed from warm standby.
+    unsigned int warm_standby_expiries; // hold-offs that ran out.
+
+    simple_stats_t start_route_ms;      // cold start: select_devices().
+    simple_stats_t start_pcm_open_ms;   // cold start: pcm open and prepare.
+    simple_stats_t start_cal_ms;        // cold start: gain dependent calibration.
+    simple_stats_t warm_start_ms;       // warm start: route check and pcm_start().
+
+    bool period_tuning;                 // vendor.audio.adaptive_period.enabled, low latency pcm.
+    struct period_tuner period_tuner;
+    uint64_t session_start_written;     // written at the last standby exit.
+    int64_t session_start_underruns;    // fifo_underruns.n at the last standby exit.
+    int cpu_pressure;                   // last period_tuner_read_cpu_pressure().
+    int64_t cpu_pressure_time_ns;       // when cpu_pressure was read, 0 if never.
 };
 
 struct stream_in {
@@ -322,6 +392,14 @@ struct stream_in {
     error_log_t *error_log;
 
     simple_stats_t start_latency_ms;
+
+    struct latency_histogram read_hist;         // in_read() duration, including lock wait.
+    struct latency_histogram lock_wait_hist;    // in_read() wait for pre_lock and lock.
+    struct latency_histogram kernel_read_hist;  // pcm read duration.
+    struct latency_histogram read_jitter_hist;  // |read interval - buffer duration|.
+    int64_t last_read_ns;  // in_read() entry time, 0 after standby.
+
+    struct async_pcm_capture *async_capture;  // non NULL while the async reader thread owns pcm_read().
 };
 
 typedef enum usecase_type_t {
@@ -361,6 +439,43 @@ typedef void (*adm_request_focus_v2_t)(void *, audio_io_handle_t, long);
 typedef bool (*adm_is_noirq_avail_t)(void *, int, int, int);
 typedef void (*adm_on_routing_change_t)(void *, audio_io_handle_t);
 
+/* adev_open() stages, timed for adev_dump() */
+enum {
+    ADEV_INIT_STAGE_PLATFORM,       /* sound card, platform info, mixer paths, ACDB */
+    ADEV_INIT_STAGE_LIBS,           /* visualizer, offload effects, ADM, audiozoom (worker) */
+    ADEV_INIT_STAGE_LIBS_WAIT,      /* time the first stream open waited for the worker */
+    ADEV_INIT_STAGE_VERIFY_DEVICES,
+    ADEV_INIT_STAGE_EXTN,           /* tfa98xx, maxxaudio */
+    ADEV_INIT_STAGE_SND_MON,        /* sound card monitor, sound trigger */
+    ADEV_INIT_STAGE_TOTAL,
+    ADEV_INIT_STAGE_MAX,
+};
+
+/* adev->lock acquisition sites, for the contention profile in adev_dump() */
+typedef enum {
+    ADEV_LOCK_SITE_OPEN,            /* stream open, adev_open() */
+    ADEV_LOCK_SITE_OUT_START,       /* out_write() leaving standby */
+    ADEV_LOCK_SITE_OUT_STANDBY,     /* output standby, warm standby expiry, errors */
+    ADEV_LOCK_SITE_OUT_PARAMS,      /* out_set_parameters(), routing */
+    ADEV_LOCK_SITE_IN_START,        /* in_read() leaving standby */
+    ADEV_LOCK_SITE_IN_STANDBY,
+    ADEV_LOCK_SITE_IN_PARAMS,       /* in_set_parameters(), sink metadata, active mics */
+    ADEV_LOCK_SITE_MMAP,            /* mmap start, stop and buffer creation */
+    ADEV_LOCK_SITE_EFFECTS,         /* pre-processing add and remove */
+    ADEV_LOCK_SITE_ADEV_PARAMS,     /* adev_set_parameters(), adev_get_parameters() */
+    ADEV_LOCK_SITE_VOICE,           /* mode, voice volume, mic mute */
+    ADEV_LOCK_SITE_SND_MON,         /* sound card state callbacks */
+    ADEV_LOCK_SITE_EXTN,            /* A2DP restore, USB, calibration, extensions */
+    ADEV_LOCK_SITE_MAX,
+} adev_lock_site_t;
+
+struct adev_lock_stats {
+    uint64_t acquired;
+    uint64_t contended;             /* acquisitions that had to wait */
+    int64_t wait_ns;                /* total wait of the contended acquisitions */
+    int64_t max_wait_ns;
+};
+
 struct audio_device {
     struct audio_hw_device device;
 
@@ -429,8 +544,22 @@ struct audio_device {
 
     /* logging */
     snd_device_t last_logged_snd_device[AUDIO_USECASE_MAX][2]; /* [out, in] */
+    unsigned int route_paths_updated; /* mixer paths applied or reset since open */
+    int route_txn_depth; /* > 0 while mixer path updates are batched */
+    int route_txn_num_ops;
+    struct route_txn_op route_txn_ops[ROUTE_TXN_MAX_OPS]; /* in call order */
+    simple_stats_t route_switch_latency_ms;
+    simple_stats_t route_switch_paths;
+    struct latency_histogram select_devices_hist;
+
+    pthread_mutex_t init_libs_lock;
+    pthread_t init_libs_thread;
+    bool init_libs_pending;  // init_libs_thread not joined yet.
+    int64_t init_stage_ns[ADEV_INIT_STAGE_MAX];
     int camera_orientation; /* CAMERA_BACK_LANDSCAPE ... CAMERA_FRONT_PORTRAIT */
     bool bt_sco_on;
+
+    struct adev_lock_stats lock_stats[ADEV_LOCK_SITE_MAX]; /* protected by lock itself */
 };
 
 int select_devices(struct audio_device *adev,
@@ -453,6 +582,12 @@ struct audio_usecase *get_usecase_from_list(struct audio_device *adev,
 
 int check_a2dp_restore(struct audio_device *adev, struct stream_out *out, bool restore);
 
+/* Closes the pcm and usecase of outputs in warm standby. Called with adev->lock held. */
+void drop_warm_standby_outputs(struct audio_device *adev);
+
+/* Takes adev->lock and accounts the wait to site. Release with pthread_mutex_unlock(). */
+void adev_lock(struct audio_device *adev, adev_lock_site_t site);
+
 #define LITERAL_TO_STRING(x) #x
 #define CHECK(condition) LOG_ALWAYS_FATAL_IF(!(condition), "%s",\
             __FILE__ ":" LITERAL_TO_STRING(__LINE__)\
@@ -461,6 +596,28 @@ int check_a2dp_restore(struct audio_device *adev, struct stream_out *out, bool r
 /*
  * NOTE: when multiple mutexes have to be acquired, always take the
  * stream_in or stream_out mutex first, followed by the audio_device mutex.
+ *
+ * Locking domains, in acquisition order:
+ *
+ * 1. stream pre_lock, then stream lock: everything in stream_in/stream_out.
+ *    Async PCM, mmap fill and warm standby state is covered by the stream lock;
+ *    their worker threads never take adev->lock except the warm standby expiry,
+ *    which takes the stream lock first. The pcm and usecase of a stream in
+ *    warm standby are only touched under adev->lock, which is enough to drop
+ *    them on a mode change or call start.
+ * 2. adev->lock: the usecase list and everything derived from it (snd device
+ *    reference counts, audio_route and the mixer path transaction, backend
+ *    configuration), voice and call state (mode, voice, current_call_output,
+ *    bt_sco_on), card_status, and the extension state that re-routes through
+ *    select_devices() (A2DP, HFP, speaker protection, extspk). These cannot be
+ *    split further because select_devices() walks all of them.
+ * 3. leaf locks, never held while taking a lock above: out->compr_mute_lock,
+ *    adev->init_libs_lock, extension private locks.
+ *
+ * Not locked:
+ * - platform tables parsed by adev_open() (microphones, gain level mapping,
+ *   snd device names) are immutable once adev_open() returns.
+ * - adev->mic_muted is written under adev->lock but read lock free by capture.
  */
 
 #endif // QCOM_AUDIO_HW_H
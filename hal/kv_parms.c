@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "kv_parms"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <log/log.h>
+
+#include "kv_parms.h"
+
+static int kv_parms_lookup(const struct kv_keyword *keywords, size_t count,
+                           const char *key, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        if (keywords[i].len == len && memcmp(keywords[i].name, key, len) == 0)
+            return i;
+    }
+    return -1;
+}
+
+void kv_parms_parse(struct kv_parms *parms, const char *kvpairs,
+                    const struct kv_keyword *keywords, size_t count,
+                    uint32_t unknown_consumers)
+{
+    const char *pair = kvpairs;
+
+    LOG_ALWAYS_FATAL_IF(count > KV_PARMS_MAX_KEYWORDS, "%s: %zu keywords", __func__, count);
+
+    parms->present = 0;
+    parms->consumers = 0;
+    parms->unknown = 0;
+    if (kvpairs == NULL)
+        return;
+
+    while (*pair != '\0') {
+        const char *end = pair + strcspn(pair, ";");
+        const char *eq = memchr(pair, '=', end - pair);
+        const char *value = eq != NULL ? eq + 1 : end;
+        size_t key_len = (eq != NULL ? eq : end) - pair;
+
+        if (key_len > 0) {
+            int key = kv_parms_lookup(keywords, count, pair, key_len);
+            if (key >= 0) {
+                parms->values[key].str = value;
+                parms->values[key].len = end - value;
+                parms->present |= 1u << key;
+                parms->consumers |= keywords[key].consumers;
+            } else {
+                parms->unknown++;
+                parms->consumers |= unknown_consumers;
+            }
+        }
+        pair = *end == ';' ? end + 1 : end;
+    }
+}
+
+int kv_parms_get_str(const struct kv_parms *parms, unsigned int key, char *value, size_t len)
+{
+    const struct kv_value *v = &parms->values[key];
+    size_t copy;
+
+    if (!kv_parms_has(parms, key))
+        return -ENOENT;
+    if (len > 0) {
+        copy = v->len < len ? v->len : len - 1;
+        memcpy(value, v->str, copy);
+        value[copy] = '\0';
+    }
+    return v->len;
+}
+
+int kv_parms_get_int(const struct kv_parms *parms, unsigned int key, int *value)
+{
+    char str[32];
+    char *end;
+    int len = kv_parms_get_str(parms, key, str, sizeof(str));
+
+    if (len < 0)
+        return len;
+    if (len == 0 || (size_t)len >= sizeof(str))
+        return -EINVAL;
+    *value = (int)strtol(str, &end, 0);
+    return *end == '\0' ? 0 : -EINVAL;
+}
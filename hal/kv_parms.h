@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef KV_PARMS_H
+#define KV_PARMS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Single pass "key=value;key=value" tokenizer for set_parameters().
+ *
+ * Unlike str_parms it does not allocate: values are slices of the caller's
+ * kvpairs string, which must outlive the kv_parms. Only the keys of a
+ * keyword table known at compile time are kept, indexed by their position
+ * in the table. Each keyword names the consumers (subsystems) that read it,
+ * and the consumers of all keys present are accumulated so the caller can
+ * skip the subsystems that have nothing to do. A key that is not in the
+ * table is given to unknown_consumers.
+ *
+ * As with str_parms, pairs are separated by ';', a key without '=' has an
+ * empty value and the last of repeated keys wins.
+ */
+struct kv_keyword {
+    const char *name;
+    size_t len;
+    uint32_t consumers;
+};
+
+#define KV_KEYWORD(name, consumers) { name, sizeof(name) - 1, consumers }
+
+#define KV_PARMS_MAX_KEYWORDS 32
+
+struct kv_value {
+    const char *str;
+    size_t len;
+};
+
+struct kv_parms {
+    struct kv_value values[KV_PARMS_MAX_KEYWORDS];
+    uint32_t present;               /* bit per keyword index */
+    uint32_t consumers;             /* union of the consumers of all keys */
+    unsigned int unknown;           /* keys not in the keyword table */
+};
+
+void kv_parms_parse(struct kv_parms *parms, const char *kvpairs,
+                    const struct kv_keyword *keywords, size_t count,
+                    uint32_t unknown_consumers);
+
+static inline bool kv_parms_has(const struct kv_parms *parms, unsigned int key)
+{
+    return (parms->present & (1u << key)) != 0;
+}
+
+/* Same contract as str_parms_get_str(): copies the value, truncated to fit,
+ * and returns its length, or -ENOENT if the key is absent.
+ */
+int kv_parms_get_str(const struct kv_parms *parms, unsigned int key, char *value, size_t len);
+
+/* Same contract as str_parms_get_int(): -ENOENT if the key is absent and
+ * -EINVAL if the value is not a number.
+ */
+int kv_parms_get_int(const struct kv_parms *parms, unsigned int key, int *value);
+
+#endif /* KV_PARMS_H */
@@ -28,6 +28,7 @@
 #include <audio_hw.h>
 #include <platform_api.h>
 #include "platform.h"
+#include "name_index.h"
 #include "audio_extn.h"
 #include "acdb.h"
 #include "voice_extn.h"
@@ -427,13 +428,6 @@ static int acdb_device_table[SND_DEVICE_MAX] = {
     [SND_DEVICE_IN_SPEAKER_QMIC_AEC_NS] = 129,
 };
 
-struct name_to_index {
-    char name[100];
-    unsigned int index;
-};
-
-#define TO_NAME_INDEX(X)   #X, X
-
 /* Used to get index from parsed sting */
 static struct name_to_index snd_device_name_index[SND_DEVICE_MAX] = {
     {TO_NAME_INDEX(SND_DEVICE_OUT_HANDSET)},
@@ -1261,6 +1255,8 @@ void platform_deinit(void *platform)
     struct operator_specific_device *device_item;
     struct listnode *node;
 
+    audio_extn_a2dp_deinit();
+
     audio_extn_spkr_prot_deinit(my_data->adev);
 
     hw_info_deinit(my_data->hw_info);
@@ -1426,16 +1422,29 @@ int platform_get_haptics_pcm_device_id()
     return -1;
 }
 
-static int find_index(struct name_to_index * table, int32_t len, const char * name)
+static struct name_index snd_device_names;
+static struct name_index usecase_names;
+static struct name_index audio_source_names;
+static pthread_once_t name_index_once = PTHREAD_ONCE_INIT;
+
+static void init_name_indexes()
 {
-    int ret = 0;
-    int32_t i;
+    static struct name_index_slot snd_device_names_slots[NAME_INDEX_SLOTS(SND_DEVICE_MAX)];
+    static struct name_index_slot usecase_names_slots[NAME_INDEX_SLOTS(AUDIO_USECASE_MAX)];
+    static struct name_index_slot audio_source_names_slots[NAME_INDEX_SLOTS(AUDIO_SOURCE_CNT)];
 
-    if (table == NULL) {
-        ALOGE("%s: table is NULL", __func__);
-        ret = -ENODEV;
-        goto done;
-    }
+    name_index_build(&snd_device_names, snd_device_names_slots, ARRAY_SIZE(snd_device_names_slots),
+                     snd_device_name_index, SND_DEVICE_MAX);
+    name_index_build(&usecase_names, usecase_names_slots, ARRAY_SIZE(usecase_names_slots),
+                     usecase_name_index, AUDIO_USECASE_MAX);
+    name_index_build(&audio_source_names, audio_source_names_slots, ARRAY_SIZE(audio_source_names_slots),
+                     audio_source_index, AUDIO_SOURCE_CNT);
+}
+
+static int find_index(const struct name_index *index, const char *name)
+{
+    unsigned int value;
+    int ret = 0;
 
     if (name == NULL) {
         ALOGE("null key");
@@ -1443,37 +1452,31 @@ static int find_index(struct name_to_index * table, int32_t len, const char * na
         goto done;
     }
 
-    for (i=0; i < len; i++) {
-        const char* tn = table[i].name;
-        size_t len = strlen(tn);
-        if (strncmp(tn, name, len) == 0) {
-            if (strlen(name) != len) {
-                continue; // substring
-            }
-            ret = table[i].index;
-            goto done;
-        }
+    pthread_once(&name_index_once, init_name_indexes);
+    if (!name_index_find(index, name, &value)) {
+        ALOGE("%s: Could not find index for name = %s",
+                __func__, name);
+        ret = -ENODEV;
+        goto done;
     }
-    ALOGE("%s: Could not find index for name = %s",
-            __func__, name);
-    ret = -ENODEV;
+    ret = value;
 done:
     return ret;
 }
 
 int platform_get_snd_device_index(char *device_name)
 {
-    return find_index(snd_device_name_index, SND_DEVICE_MAX, device_name);
+    return find_index(&snd_device_names, device_name);
 }
 
 int platform_get_usecase_index(const char *usecase_name)
 {
-    return find_index(usecase_name_index, AUDIO_USECASE_MAX, usecase_name);
+    return find_index(&usecase_names, usecase_name);
 }
 
 int platform_get_audio_source_index(const char *audio_source_name)
 {
-    return find_index(audio_source_index, AUDIO_SOURCE_CNT, audio_source_name);
+    return find_index(&audio_source_names, audio_source_name);
 }
 
 int platform_get_effect_config_data(snd_device_t snd_device,
@@ -25,6 +25,7 @@
 #include <audio_hw.h>
 #include <platform_api.h>
 #include "platform.h"
+#include "name_index.h"
 #include "audio_extn.h"
 
 #define LIB_ACDB_LOADER "libacdbloader.so"
@@ -244,6 +245,40 @@ static struct name_to_index audio_source_index[AUDIO_SOURCE_CNT] = {
     {TO_NAME_INDEX(AUDIO_SOURCE_VOICE_PERFORMANCE)},
 };
 
+static struct name_index audio_source_names;
+static pthread_once_t name_index_once = PTHREAD_ONCE_INIT;
+
+static void init_name_indexes()
+{
+    static struct name_index_slot audio_source_names_slots[NAME_INDEX_SLOTS(AUDIO_SOURCE_CNT)];
+
+    name_index_build(&audio_source_names, audio_source_names_slots, ARRAY_SIZE(audio_source_names_slots),
+                     audio_source_index, AUDIO_SOURCE_CNT);
+}
+
+static int find_index(const struct name_index *index, const char *name)
+{
+    unsigned int value;
+    int ret = 0;
+
+    if (name == NULL) {
+        ALOGE("null key");
+        ret = -ENODEV;
+        goto done;
+    }
+
+    pthread_once(&name_index_once, init_name_indexes);
+    if (!name_index_find(index, name, &value)) {
+        ALOGE("%s: Could not find index for name = %s",
+                __func__, name);
+        ret = -ENODEV;
+        goto done;
+    }
+    ret = value;
+done:
+    return ret;
+}
+
 static pthread_once_t check_op_once_ctl = PTHREAD_ONCE_INIT;
 static bool is_tmus = false;
 
@@ -1151,7 +1186,7 @@ int platform_get_usecase_index(const char * usecase __unused)
 
 int platform_get_audio_source_index(const char *audio_source_name)
 {
-    return find_index(audio_source_index, AUDIO_SOURCE_CNT, audio_source_name);
+    return find_index(&audio_source_names, audio_source_name);
 }
 
 int platform_set_usecase_pcm_id(audio_usecase_t usecase __unused, int32_t type __unused,
@@ -28,6 +28,7 @@
 #include <platform_api.h>
 #include "acdb.h"
 #include "platform.h"
+#include "name_index.h"
 #include "audio_extn.h"
 #include <linux/msm_audio.h>
 #if defined (PLATFORM_MSM8996) || (PLATFORM_MSM8998) || (PLATFORM_SDM845) || (PLATFORM_SDM710) || (PLATFORM_SM8150)
@@ -144,6 +145,34 @@ typedef struct acdb_audio_cal_cfg {
 /* Audio calibration related functions */
 typedef void (*acdb_send_audio_cal_v3_t)(int, int, int, int, int);
 
+#define OUT_SND_DEVICE_CACHE_SIZE 16
+
+enum {
+    OUT_SND_DEVICE_KEY_IN_CALL = 1 << 0,
+    OUT_SND_DEVICE_KEY_VOICERX = 1 << 1,
+    OUT_SND_DEVICE_KEY_HFP_ACTIVE = 1 << 2,
+    OUT_SND_DEVICE_KEY_ENABLE_HFP = 1 << 3,
+    OUT_SND_DEVICE_KEY_BT_WB = 1 << 4,
+    OUT_SND_DEVICE_KEY_HAC = 1 << 5,
+    OUT_SND_DEVICE_KEY_LR_SWAP = 1 << 6,
+    OUT_SND_DEVICE_KEY_USB_CAPTURE = 1 << 7,
+    OUT_SND_DEVICE_KEY_MA_USB = 1 << 8,
+};
+
+/* everything get_output_snd_device() depends on */
+struct out_snd_device_key {
+    audio_devices_t devices;
+    int tty_mode;
+    uint32_t flags;
+    unsigned int acdb_generation;
+};
+
+struct out_snd_device_cache_entry {
+    struct out_snd_device_key key;
+    snd_device_t snd_device;
+    bool valid;
+};
+
 struct platform_data {
     struct audio_device *adev;
     bool fluence_in_spkr_mode;
@@ -186,6 +215,8 @@ struct platform_data {
     uint32_t declared_mic_count;
     struct audio_microphone_characteristic_t microphones[AUDIO_MICROPHONE_MAX_COUNT];
     struct snd_device_to_mic_map mic_map[SND_DEVICE_MAX];
+
+    struct out_snd_device_cache_entry out_snd_device_cache[OUT_SND_DEVICE_CACHE_SIZE];
 };
 
 static int pcm_device_table[AUDIO_USECASE_MAX][2] = {
@@ -412,6 +443,9 @@ static struct audio_effect_config \
 };
 
 /* ACDB IDs (audio DSP path configuration IDs) for each sound device */
+/* bumped on every acdb_device_table[] update, part of the out_snd_device_key */
+static unsigned int acdb_device_table_generation;
+
 static int acdb_device_table[SND_DEVICE_MAX] = {
     [SND_DEVICE_NONE] = -1,
     [SND_DEVICE_OUT_HANDSET] = 7,
@@ -541,13 +575,6 @@ static int acdb_device_table[SND_DEVICE_MAX] = {
 // Platform specific backend bit width table
 static int backend_bit_width_table[SND_DEVICE_MAX] = {0};
 
-struct name_to_index {
-    char name[100];
-    unsigned int index;
-};
-
-#define TO_NAME_INDEX(X)   #X, X
-
 /* Used to get index from parsed string */
 static const struct name_to_index snd_device_name_index[SND_DEVICE_MAX] = {
     /* out */
@@ -2015,6 +2042,8 @@ void platform_deinit(void *platform)
     struct platform_data *my_data = (struct platform_data *)platform;
     close_csd_client(my_data->csd);
 
+    audio_extn_a2dp_deinit();
+
     audio_extn_spkr_prot_deinit(my_data->adev);
 
     hw_info_deinit(my_data->hw_info);
@@ -2180,17 +2209,29 @@ int platform_get_haptics_pcm_device_id()
     return HAPTICS_PCM_DEVICE;
 }
 
-static int find_index(const struct name_to_index * table, int32_t len,
-                      const char * name)
+static struct name_index snd_device_names;
+static struct name_index usecase_names;
+static struct name_index audio_source_names;
+static pthread_once_t name_index_once = PTHREAD_ONCE_INIT;
+
+static void init_name_indexes()
 {
-    int ret = 0;
-    int32_t i;
+    static struct name_index_slot snd_device_names_slots[NAME_INDEX_SLOTS(SND_DEVICE_MAX)];
+    static struct name_index_slot usecase_names_slots[NAME_INDEX_SLOTS(AUDIO_USECASE_MAX)];
+    static struct name_index_slot audio_source_names_slots[NAME_INDEX_SLOTS(AUDIO_SOURCE_CNT)];
+
+    name_index_build(&snd_device_names, snd_device_names_slots, ARRAY_SIZE(snd_device_names_slots),
+                     snd_device_name_index, SND_DEVICE_MAX);
+    name_index_build(&usecase_names, usecase_names_slots, ARRAY_SIZE(usecase_names_slots),
+                     usecase_name_index, AUDIO_USECASE_MAX);
+    name_index_build(&audio_source_names, audio_source_names_slots, ARRAY_SIZE(audio_source_names_slots),
+                     audio_source_index, AUDIO_SOURCE_CNT);
+}
 
-    if (table == NULL) {
-        ALOGE("%s: table is NULL", __func__);
-        ret = -ENODEV;
-        goto done;
-    }
+static int find_index(const struct name_index *index, const char *name)
+{
+    unsigned int value;
+    int ret = 0;
 
     if (name == NULL) {
         ALOGE("null key");
@@ -2198,27 +2239,26 @@ static int find_index(const struct name_to_index * table, int32_t len,
         goto done;
     }
 
-    for (i=0; i < len; i++) {
-        if (!strcmp(table[i].name, name)) {
-            ret = table[i].index;
-            goto done;
-        }
+    pthread_once(&name_index_once, init_name_indexes);
+    if (!name_index_find(index, name, &value)) {
+        ALOGE("%s: Could not find index for name = %s",
+                __func__, name);
+        ret = -ENODEV;
+        goto done;
     }
-    ALOGE("%s: Could not find index for name = %s",
-            __func__, name);
-    ret = -ENODEV;
+    ret = value;
 done:
     return ret;
 }
 
 int platform_get_snd_device_index(char *device_name)
 {
-    return find_index(snd_device_name_index, SND_DEVICE_MAX, device_name);
+    return find_index(&snd_device_names, device_name);
 }
 
 int platform_get_usecase_index(const char *usecase_name)
 {
-    return find_index(usecase_name_index, AUDIO_USECASE_MAX, usecase_name);
+    return find_index(&usecase_names, usecase_name);
 }
 
 int platform_get_effect_config_data(snd_device_t snd_device,
@@ -2274,7 +2314,7 @@ done:
 
 int platform_get_audio_source_index(const char *audio_source_name)
 {
-    return find_index(audio_source_index, AUDIO_SOURCE_CNT, audio_source_name);
+    return find_index(&audio_source_names, audio_source_name);
 }
 
 void platform_add_operator_specific_device(snd_device_t snd_device,
@@ -2341,6 +2381,7 @@ int platform_set_snd_device_acdb_id(snd_device_t snd_device, unsigned int acdb_i
     ALOGV("%s: acdb_device_table[%s]: old = %d new = %d", __func__,
           platform_get_snd_device_name(snd_device), acdb_device_table[snd_device], acdb_id);
     acdb_device_table[snd_device] = acdb_id;
+    acdb_device_table_generation++;
 done:
     return ret;
 }
@@ -2779,7 +2820,7 @@ int platform_set_device_mute(void *platform, bool state, char *dir)
                               ALL_SESSION_VSID,
                               0};
     if(dir == NULL) {
-        ALOGE("%s: Invalid direction:%s", __func__, dir);
+        ALOGE("%s: Invalid direction", __func__);
         return -EINVAL;
     }
 
@@ -2903,11 +2944,9 @@ int platform_can_split_snd_device(snd_device_t snd_device,
     return ret;
 }
 
-snd_device_t platform_get_output_snd_device(void *platform, audio_devices_t devices)
+static snd_device_t get_output_snd_device(struct platform_data *my_data, audio_devices_t devices)
 {
-    struct platform_data *my_data = (struct platform_data *)platform;
     struct audio_device *adev = my_data->adev;
-    audio_mode_t mode = adev->mode;
     snd_device_t snd_device = SND_DEVICE_NONE;
 
     ALOGV("%s: enter: output devices(%#x)", __func__, devices);
@@ -3104,6 +3143,71 @@ exit:
     return snd_device;
 }
 
+static void get_output_snd_device_key(struct platform_data *my_data, audio_devices_t devices,
+                                      struct out_snd_device_key *key)
+{
+    struct audio_device *adev = my_data->adev;
+    uint32_t flags = 0;
+
+    if (voice_is_in_call(adev))
+        flags |= OUT_SND_DEVICE_KEY_IN_CALL;
+    if (adev->enable_voicerx)
+        flags |= OUT_SND_DEVICE_KEY_VOICERX;
+    if (audio_extn_hfp_is_active(adev))
+        flags |= OUT_SND_DEVICE_KEY_HFP_ACTIVE;
+    if (adev->enable_hfp)
+        flags |= OUT_SND_DEVICE_KEY_ENABLE_HFP;
+    if (adev->bt_wb_speech_enabled)
+        flags |= OUT_SND_DEVICE_KEY_BT_WB;
+    if (adev->voice.hac)
+        flags |= OUT_SND_DEVICE_KEY_HAC;
+    if (my_data->speaker_lr_swap)
+        flags |= OUT_SND_DEVICE_KEY_LR_SWAP;
+    /* only queried for USB devices, as get_output_snd_device() does */
+    if (audio_is_usb_out_device(devices)) {
+        if (audio_extn_usb_is_capture_supported())
+            flags |= OUT_SND_DEVICE_KEY_USB_CAPTURE;
+        if (audio_extn_ma_supported_usb())
+            flags |= OUT_SND_DEVICE_KEY_MA_USB;
+    }
+
+    key->devices = devices;
+    key->tty_mode = adev->voice.tty_mode;
+    key->flags = flags;
+    key->acdb_generation = acdb_device_table_generation;
+}
+
+/* Memoizes get_output_snd_device() on its complete input, so a state change
+ * simply misses the cache and nothing has to be invalidated.
+ * Called with adev->lock held.
+ */
+snd_device_t platform_get_output_snd_device(void *platform, audio_devices_t devices)
+{
+    struct platform_data *my_data = (struct platform_data *)platform;
+    struct out_snd_device_key key;
+    struct out_snd_device_cache_entry *entry;
+    uint32_t hash;
+
+    get_output_snd_device_key(my_data, devices, &key);
+    hash = (key.devices * 2654435761u) ^ (key.flags * 40503u) ^ (uint32_t)key.tty_mode;
+    entry = &my_data->out_snd_device_cache[(hash >> 16) % OUT_SND_DEVICE_CACHE_SIZE];
+
+    if (entry->valid &&
+            entry->key.devices == key.devices &&
+            entry->key.tty_mode == key.tty_mode &&
+            entry->key.flags == key.flags &&
+            entry->key.acdb_generation == key.acdb_generation) {
+        ALOGV("%s: devices(%#x) -> snd_device(%s), cached",
+              __func__, devices, device_table[entry->snd_device]);
+        return entry->snd_device;
+    }
+
+    entry->snd_device = get_output_snd_device(my_data, devices);
+    entry->key = key;
+    entry->valid = true;
+    return entry->snd_device;
+}
+
 #ifdef DYNAMIC_ECNS_ENABLED
 static snd_device_t get_snd_device_for_voice_comm(struct platform_data *my_data,
                                                   struct stream_in *in __unused,
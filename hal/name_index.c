@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "name_index"
+
+#include <string.h>
+#include <log/log.h>
+
+#include "name_index.h"
+
+static uint32_t name_hash(const char *name)
+{
+    /* FNV-1a */
+    uint32_t hash = 2166136261u;
+
+    for (; *name != '\0'; name++) {
+        hash ^= (uint8_t)*name;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void name_index_build(struct name_index *index, struct name_index_slot *slots, size_t size,
+                      const struct name_to_index *table, size_t count)
+{
+    /* an empty slot must remain to end every probe sequence */
+    LOG_ALWAYS_FATAL_IF(count >= size, "%s: %zu slots for %zu names", __func__, size, count);
+
+    memset(slots, 0, size * sizeof(*slots));
+    index->slots = slots;
+    index->size = size;
+
+    for (size_t i = 0; i < count; i++) {
+        const char *name = table[i].name;
+        uint32_t hash;
+        size_t pos;
+
+        /* entries not listed in a sparse table are zero */
+        if (name[0] == '\0')
+            continue;
+
+        hash = name_hash(name);
+        for (pos = hash % size; slots[pos].name != NULL; pos = (pos + 1) % size) {
+            if (slots[pos].hash == hash && strcmp(slots[pos].name, name) == 0)
+                break;
+        }
+        /* repeated name, keep the first one */
+        if (slots[pos].name != NULL)
+            continue;
+
+        slots[pos].name = name;
+        slots[pos].value = table[i].index;
+        slots[pos].hash = hash;
+    }
+}
+
+bool name_index_find(const struct name_index *index, const char *name, unsigned int *value)
+{
+    uint32_t hash = name_hash(name);
+
+    for (size_t pos = hash % index->size; index->slots[pos].name != NULL;
+            pos = (pos + 1) % index->size) {
+        const struct name_index_slot *slot = &index->slots[pos];
+        if (slot->hash == hash && strcmp(slot->name, name) == 0) {
+            *value = slot->value;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NAME_INDEX_H
+#define NAME_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* name to enum tables of the platform variants */
+struct name_to_index {
+    char name[100];
+    unsigned int index;
+};
+
+#define TO_NAME_INDEX(X)   #X, X
+
+/* Open addressing hash index over a name table, so a lookup costs one hash
+ * and normally a single strcmp instead of a scan of the whole table.
+ */
+struct name_index_slot {
+    const char *name;
+    unsigned int value;
+    uint32_t hash;
+};
+
+struct name_index {
+    struct name_index_slot *slots;
+    size_t size;
+};
+
+/* Two slots per name keeps probe sequences short. */
+#define NAME_INDEX_SLOTS(count) (2 * (count))
+
+/* Indexes the named entries of table, names are referenced, not copied.
+ * The first entry wins when a name is repeated, as with a linear scan.
+ */
+void name_index_build(struct name_index *index, struct name_index_slot *slots, size_t size,
+                      const struct name_to_index *table, size_t count);
+
+bool name_index_find(const struct name_index *index, const char *name, unsigned int *value);
+
+#endif /* NAME_INDEX_H */
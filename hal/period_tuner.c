@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "period_tuner"
+/*#define LOG_NDEBUG 0*/
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <log/log.h>
+
+#include "period_tuner.h"
+
+#define CPU_PRESSURE_PATH "/proc/pressure/cpu"
+
+void period_tuner_init(struct period_tuner *tuner, const struct period_tuner_config *config,
+                       unsigned int period_count)
+{
+    tuner->config = *config;
+    if (tuner->config.max_count < tuner->config.min_count)
+        tuner->config.max_count = tuner->config.min_count;
+    if (period_count < tuner->config.min_count)
+        period_count = tuner->config.min_count;
+    else if (period_count > tuner->config.max_count)
+        period_count = tuner->config.max_count;
+    tuner->period_count = period_count;
+    tuner->clean_sessions = 0;
+    tuner->grows = 0;
+    tuner->shrinks = 0;
+}
+
+void period_tuner_end_session(struct period_tuner *tuner,
+                              const struct period_tuner_session *session)
+{
+    const struct period_tuner_config *config = &tuner->config;
+
+    // in the format of the session traces replayed by host/tests/period_tuner_replay
+    ALOGV("%s: session %lld %lld %d", __func__, (long long)session->frames,
+          (long long)session->underruns, session->cpu_pressure);
+
+    if (session->underruns > 0) {
+        // glitches are audible, back off right away
+        tuner->clean_sessions = 0;
+        if (tuner->period_count < config->max_count) {
+            tuner->period_count++;
+            tuner->grows++;
+            ALOGV("%s: %lld underruns, %u periods", __func__,
+                  (long long)session->underruns, tuner->period_count);
+        }
+        return;
+    }
+
+    // short sessions or sessions under load do not prove the smaller buffer
+    if (session->frames < config->min_session_frames)
+        return;
+    if (session->cpu_pressure >= config->high_cpu_pressure) {
+        tuner->clean_sessions = 0;
+        return;
+    }
+
+    if (++tuner->clean_sessions >= config->shrink_after) {
+        tuner->clean_sessions = 0;
+        if (tuner->period_count > config->min_count) {
+            tuner->period_count--;
+            tuner->shrinks++;
+            ALOGV("%s: clean run, %u periods", __func__, tuner->period_count);
+        }
+    }
+}
+
+void period_tuner_decide(const struct period_tuner *tuner, int cpu_pressure,
+                         struct period_tuner_decision *decision)
+{
+    const struct period_tuner_config *config = &tuner->config;
+    const bool loaded = cpu_pressure >= config->high_cpu_pressure;
+    unsigned int period_count = tuner->period_count;
+
+    // one more period for this session only, the learned count is not changed
+    if (loaded && period_count < config->max_count)
+        period_count++;
+
+    decision->period_count = period_count;
+    // pre-roll one more period for every period above the minimum
+    decision->start_threshold = config->period_size / 4 +
+                                (period_count - config->min_count) * config->period_size;
+    // under load wake the writer half as often
+    decision->avail_min = loaded ? config->period_size / 2 : config->period_size / 4;
+}
+
+int period_tuner_read_cpu_pressure(void)
+{
+    char buf[128];
+    float avg10;
+    ssize_t len;
+    int fd;
+
+    fd = open(CPU_PRESSURE_PATH, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (len <= 0)
+        return -1;
+    buf[len] = '\0';
+
+    // some avg10=1.23 avg60=0.50 avg300=0.10 total=12345
+    if (sscanf(buf, "some avg10=%f", &avg10) != 1)
+        return -1;
+    return (int)(avg10 + 0.5f);
+}
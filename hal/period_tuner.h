@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PERIOD_TUNER_H
+#define PERIOD_TUNER_H
+
+#include <stdint.h>
+
+/* Feedback controller for the kernel buffer depth of low latency output.
+ *
+ * The period size is what AudioFlinger sees as the stream buffer size and is
+ * fixed at open, so the controller moves the period count, start threshold
+ * and avail_min instead. Each play session (standby exit to standby) is
+ * reported with its underruns: a session with underruns grows the buffer by
+ * one period, and a run of clean sessions without CPU pressure shrinks it by
+ * one, always within [min_count, max_count].
+ *
+ * The controller has no HAL dependencies so that session traces can be
+ * replayed through it offline.
+ */
+struct period_tuner_config {
+    unsigned int period_size;
+    unsigned int min_count;
+    unsigned int max_count;
+    unsigned int shrink_after;      /* clean sessions needed for one step down */
+    int64_t min_session_frames;     /* shorter clean sessions give no credit */
+    int high_cpu_pressure;          /* percent, blocks shrinking and adds a period */
+};
+
+struct period_tuner {
+    struct period_tuner_config config;
+    unsigned int period_count;
+    unsigned int clean_sessions;
+    unsigned int grows;
+    unsigned int shrinks;
+};
+
+struct period_tuner_session {
+    int64_t frames;                 /* frames written during the session */
+    int64_t underruns;              /* underrun events during the session */
+    int cpu_pressure;               /* percent at the end of the session, < 0 if unknown */
+};
+
+struct period_tuner_decision {
+    unsigned int period_count;
+    unsigned int start_threshold;
+    unsigned int avail_min;
+};
+
+void period_tuner_init(struct period_tuner *tuner, const struct period_tuner_config *config,
+                       unsigned int period_count);
+
+void period_tuner_end_session(struct period_tuner *tuner,
+                              const struct period_tuner_session *session);
+
+/* Configuration for the next session, cpu_pressure as in struct period_tuner_session. */
+void period_tuner_decide(const struct period_tuner *tuner, int cpu_pressure,
+                         struct period_tuner_decision *decision);
+
+/* Share of time some task waited for a CPU over the last 10 s, from
+ * /proc/pressure/cpu, rounded to a percent. Returns -1 without PSI. */
+int period_tuner_read_cpu_pressure(void);
+
+#endif /* PERIOD_TUNER_H */
@@ -18,11 +18,22 @@
 #define LOG_NDDEBUG 0
 
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/system_properties.h>
+#include <unistd.h>
 #include <expat.h>
 #include <log/log.h>
+#include <cutils/properties.h>
+#include <utils/Timers.h>
 #include <audio_hw.h>
 #include "platform_api.h"
+#include "platform_info_snapshot.h"
 #include <platform.h>
 #include <math.h>
 #include <pthread.h>
@@ -642,6 +653,7 @@ static void process_microphone_characteristic(const XML_Char **attr) {
     uint32_t found_mandatory_characteristics = 0;
     uint32_t num_frequencies = 0;
     uint32_t num_responses = 0;
+    microphone.num_frequency_responses = 0;
     microphone.sensitivity = AUDIO_MICROPHONE_SENSITIVITY_UNKNOWN;
     microphone.max_spl = AUDIO_MICROPHONE_SPL_UNKNOWN;
     microphone.min_spl = AUDIO_MICROPHONE_SPL_UNKNOWN;
@@ -1080,6 +1092,304 @@ static void end_tag(void *userdata __unused, const XML_Char *tag_name)
     }
 }
 
+/*
+ * Snapshot of the platform info XML
+ *
+ * A snapshot is the element stream of one successful Expat parse. Loading it
+ * replays the elements through start_tag()/end_tag(), so the handlers and
+ * their platform side effects run exactly as for the XML, but the file is
+ * mmap'ed once instead of being tokenized.
+ *
+ * The record format is described in platform_info_snapshot.h. Replay points
+ * attr[] straight into the mapping.
+ *
+ * A snapshot is only used when the source path, size and mtime recorded in
+ * its header match the XML, it was written by the same build (a hash of
+ * ro.build.fingerprint, since an OTA can replace the XML and keep the build
+ * system's fixed mtime) and the payload checksum is correct. Otherwise the
+ * XML is parsed and the snapshot rewritten. The host tool
+ * platform_info_snapshot writes the same format from the build outputs.
+ *
+ * The payload hash is FNV-1a: it catches a torn or corrupted file, not a
+ * forged one. Anyone able to write the snapshot can make the HAL apply any
+ * configuration, as with the XML itself. The trust therefore rests on who
+ * can write it: /data/vendor/audio belongs to the audio HAL, and sepolicy
+ * keeps other domains out of it. The loader does not rely on that alone. It
+ * parses the XML instead when the snapshot is not a regular file owned by
+ * the HAL's uid, or when group or others may write to it. The snapshot is
+ * opened without following symlinks.
+ */
+#define PLATFORM_INFO_SNAPSHOT_PROPERTY "vendor.audio.platform_info.snapshot"
+#define PLATFORM_INFO_SNAPSHOT_DIR "/data/vendor/audio"
+
+/* element stream of the parse in progress, protected by my_data.lock */
+static struct {
+    uint8_t *data;
+    size_t   size;
+    size_t   capacity;
+    bool     failed;
+} snapshot_writer;
+
+static void snapshot_hash_build_cb(void *cookie, const char *name __unused,
+                                   const char *value, uint32_t serial __unused)
+{
+    *(uint64_t *)cookie = platform_info_snapshot_build_hash(value);
+}
+
+/* ro.build.fingerprint can exceed PROPERTY_VALUE_MAX, read it in full */
+static uint64_t snapshot_build_hash()
+{
+    const prop_info *pi = __system_property_find("ro.build.fingerprint");
+    uint64_t hash = 0;
+
+    if (pi != NULL)
+        __system_property_read_callback(pi, snapshot_hash_build_cb, &hash);
+    return hash;
+}
+
+static int64_t snapshot_mtime_ns(const struct stat *st)
+{
+    return st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec;
+}
+
+static void snapshot_path_for(const char *xml_path, char *path, size_t size)
+{
+    const char *name = strrchr(xml_path, '/');
+
+    snprintf(path, size, "%s/%s.bin", PLATFORM_INFO_SNAPSHOT_DIR,
+             name != NULL ? name + 1 : xml_path);
+}
+
+static void snapshot_append(const void *data, size_t len)
+{
+    if (snapshot_writer.failed)
+        return;
+
+    if (snapshot_writer.size + len > snapshot_writer.capacity) {
+        size_t capacity = snapshot_writer.capacity ? snapshot_writer.capacity : 16384;
+        uint8_t *buf;
+
+        while (capacity < snapshot_writer.size + len)
+            capacity *= 2;
+        buf = (uint8_t *)realloc(snapshot_writer.data, capacity);
+        if (buf == NULL) {
+            snapshot_writer.failed = true;
+            return;
+        }
+        snapshot_writer.data = buf;
+        snapshot_writer.capacity = capacity;
+    }
+    memcpy(snapshot_writer.data + snapshot_writer.size, data, len);
+    snapshot_writer.size += len;
+}
+
+static void snapshot_record(uint8_t type, const XML_Char *tag_name, const XML_Char **attr)
+{
+    size_t count = 0;
+
+    while (attr != NULL && attr[count] != NULL)
+        count++;
+    if (count + 1 > PLATFORM_INFO_SNAPSHOT_MAX_STRINGS) {
+        ALOGW("%s: too many attributes in <%s>, no snapshot", __func__, tag_name);
+        snapshot_writer.failed = true;
+        return;
+    }
+
+    uint8_t record[2] = { type, (uint8_t)count };
+    snapshot_append(record, sizeof(record));
+    snapshot_append(tag_name, strlen(tag_name) + 1);
+    for (size_t i = 0; i < count; i++)
+        snapshot_append(attr[i], strlen(attr[i]) + 1);
+}
+
+static void recording_start_tag(void *userdata, const XML_Char *tag_name,
+                                const XML_Char **attr)
+{
+    snapshot_record(SNAPSHOT_EVENT_START, tag_name, attr);
+    start_tag(userdata, tag_name, attr);
+}
+
+static void recording_end_tag(void *userdata, const XML_Char *tag_name)
+{
+    snapshot_record(SNAPSHOT_EVENT_END, tag_name, NULL);
+    end_tag(userdata, tag_name);
+}
+
+static void snapshot_writer_reset()
+{
+    free(snapshot_writer.data);
+    memset(&snapshot_writer, 0, sizeof(snapshot_writer));
+}
+
+static int snapshot_write_all(int fd, const void *data, size_t size)
+{
+    const uint8_t *p = (const uint8_t *)data;
+
+    while (size > 0) {
+        ssize_t ret = write(fd, p, size);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            return -errno;
+        }
+        p += ret;
+        size -= ret;
+    }
+    return 0;
+}
+
+static void platform_info_write_snapshot(const char *xml_path, const struct stat *xml_st,
+                                         const char *snapshot_path)
+{
+    struct platform_info_snapshot_header header;
+    char tmp_path[PATH_MAX];
+    int fd, ret;
+
+    if (snapshot_writer.failed) {
+        ALOGW("%s: recording failed, %s not written", __func__, snapshot_path);
+        return;
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic = PLATFORM_INFO_SNAPSHOT_MAGIC;
+    header.version = PLATFORM_INFO_SNAPSHOT_VERSION;
+    header.source_mtime_ns = snapshot_mtime_ns(xml_st);
+    header.source_size = xml_st->st_size;
+    header.build_hash = snapshot_build_hash();
+    header.payload_hash = platform_info_snapshot_hash(snapshot_writer.data,
+                                                      snapshot_writer.size);
+    header.payload_size = snapshot_writer.size;
+    strlcpy(header.source_path, xml_path, sizeof(header.source_path));
+
+    /* written aside and renamed, a reader never sees a partial snapshot */
+    ret = snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", snapshot_path);
+    if (ret < 0 || (size_t)ret >= sizeof(tmp_path)) {
+        ALOGW("%s: %s.tmp does not fit in PATH_MAX", __func__, snapshot_path);
+        return;
+    }
+    fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_NOFOLLOW, 0644);
+    if (fd < 0) {
+        ALOGW("%s: cannot create %s: %s", __func__, tmp_path, strerror(errno));
+        return;
+    }
+    /* a leftover tmp file keeps its mode, the loader rejects a writable one */
+    ret = fchmod(fd, 0644) != 0 ? -errno : 0;
+    if (ret == 0)
+        ret = snapshot_write_all(fd, &header, sizeof(header));
+    if (ret == 0)
+        ret = snapshot_write_all(fd, snapshot_writer.data, snapshot_writer.size);
+    if (ret == 0 && fsync(fd) != 0)
+        ret = -errno;
+    close(fd);
+
+    if (ret == 0 && rename(tmp_path, snapshot_path) != 0)
+        ret = -errno;
+    if (ret != 0) {
+        ALOGW("%s: cannot write %s: %s", __func__, snapshot_path, strerror(-ret));
+        unlink(tmp_path);
+        return;
+    }
+    ALOGV("%s: wrote %s (%zu bytes)", __func__, snapshot_path, snapshot_writer.size);
+}
+
+/* Walks the records, only checking their layout unless apply is set, so a
+ * malformed snapshot is rejected before any handler runs.
+ */
+static int snapshot_replay(const uint8_t *data, size_t size, bool apply)
+{
+    const XML_Char *strings[PLATFORM_INFO_SNAPSHOT_MAX_STRINGS + 1];
+    size_t pos = 0;
+
+    while (pos < size) {
+        if (size - pos < 2)
+            return -EINVAL;
+        uint8_t type = data[pos];
+        size_t count = data[pos + 1] + 1;
+        pos += 2;
+        if ((type != SNAPSHOT_EVENT_START && type != SNAPSHOT_EVENT_END) ||
+                count > PLATFORM_INFO_SNAPSHOT_MAX_STRINGS)
+            return -EINVAL;
+
+        for (size_t i = 0; i < count; i++) {
+            const uint8_t *end = (const uint8_t *)memchr(data + pos, '\0', size - pos);
+            if (end == NULL)
+                return -EINVAL;
+            strings[i] = (const XML_Char *)(data + pos);
+            pos = end - data + 1;
+        }
+        strings[count] = NULL;
+
+        if (!apply)
+            continue;
+        if (type == SNAPSHOT_EVENT_START)
+            start_tag(NULL, strings[0], &strings[1]);
+        else
+            end_tag(NULL, strings[0]);
+    }
+    return 0;
+}
+
+static int platform_info_load_snapshot(const char *xml_path, const struct stat *xml_st,
+                                       const char *snapshot_path)
+{
+    const struct platform_info_snapshot_header *header;
+    struct stat st;
+    void *map;
+    int fd, ret = 0;
+
+    fd = open(snapshot_path, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (fd < 0)
+        return -errno;
+    if (fstat(fd, &st) != 0) {
+        ret = -errno;
+        close(fd);
+        return ret;
+    }
+    if (!S_ISREG(st.st_mode) || st.st_uid != geteuid() ||
+            (st.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+        ALOGW("%s: %s is not a file only the HAL can write (uid %u mode %o), parsing the XML",
+              __func__, snapshot_path, (unsigned int)st.st_uid, (unsigned int)st.st_mode);
+        close(fd);
+        return -EPERM;
+    }
+    if (st.st_size < (off_t)sizeof(*header)) {
+        close(fd);
+        return -EINVAL;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return -errno;
+
+    header = (const struct platform_info_snapshot_header *)map;
+    const uint8_t *payload = (const uint8_t *)map + sizeof(*header);
+    if (header->magic != PLATFORM_INFO_SNAPSHOT_MAGIC ||
+            header->version != PLATFORM_INFO_SNAPSHOT_VERSION ||
+            header->payload_size != (uint64_t)(st.st_size - sizeof(*header)) ||
+            strncmp(header->source_path, xml_path, sizeof(header->source_path)) != 0) {
+        ret = -EINVAL;
+        goto done;
+    }
+    if (header->source_mtime_ns != snapshot_mtime_ns(xml_st) ||
+            header->source_size != xml_st->st_size ||
+            header->build_hash != snapshot_build_hash()) {
+        ALOGV("%s: %s is older than %s", __func__, snapshot_path, xml_path);
+        ret = -ESTALE;
+        goto done;
+    }
+    if (platform_info_snapshot_hash(payload, header->payload_size) != header->payload_hash ||
+            snapshot_replay(payload, header->payload_size, false) != 0) {
+        ALOGW("%s: %s is corrupted", __func__, snapshot_path);
+        ret = -EINVAL;
+        goto done;
+    }
+
+    snapshot_replay(payload, header->payload_size, true);
+done:
+    munmap(map, st.st_size);
+    return ret;
+}
+
 int platform_info_init(const char *filename, void *platform,
                        bool do_full_parse, set_parameters_fn fn)
 {
@@ -1090,6 +1400,10 @@ int platform_info_init(const char *filename, void *platform,
     void            *buf;
     static const uint32_t kBufSize = 1024;
     char   platform_info_file_name[MIXER_PATH_MAX_LENGTH]= {0};
+    char   snapshot_path[PATH_MAX];
+    struct stat xml_st;
+    bool   use_snapshot = false;
+    const int64_t start_ns = systemTime(SYSTEM_TIME_MONOTONIC);
 
     if (filename == NULL) {
         strlcpy(platform_info_file_name, PLATFORM_INFO_XML_PATH, MIXER_PATH_MAX_LENGTH);
@@ -1122,7 +1436,21 @@ int platform_info_init(const char *filename, void *platform,
     my_data.kvpairs = str_parms_create();
     my_data.set_parameters = fn;
 
-    XML_SetElementHandler(parser, start_tag, end_tag);
+    if (property_get_bool(PLATFORM_INFO_SNAPSHOT_PROPERTY, false) &&
+            fstat(fileno(file), &xml_st) == 0) {
+        snapshot_path_for(platform_info_file_name, snapshot_path, sizeof(snapshot_path));
+        if (platform_info_load_snapshot(platform_info_file_name, &xml_st,
+                                        snapshot_path) == 0) {
+            ALOGV("%s: loaded %s in %lld us", __func__, snapshot_path,
+                  (long long)(systemTime(SYSTEM_TIME_MONOTONIC) - start_ns) / 1000);
+            goto err_free_parser;
+        }
+        use_snapshot = true;
+        snapshot_writer_reset();
+        XML_SetElementHandler(parser, recording_start_tag, recording_end_tag);
+    } else {
+        XML_SetElementHandler(parser, start_tag, end_tag);
+    }
 
     while (1) {
         buf = XML_GetBuffer(parser, kBufSize);
@@ -1151,7 +1479,14 @@ int platform_info_init(const char *filename, void *platform,
             break;
     }
 
+    ALOGV("%s: parsed %s in %lld us", __func__, platform_info_file_name,
+          (long long)(systemTime(SYSTEM_TIME_MONOTONIC) - start_ns) / 1000);
+    if (use_snapshot)
+        platform_info_write_snapshot(platform_info_file_name, &xml_st, snapshot_path);
+
 err_free_parser:
+    if (use_snapshot)
+        snapshot_writer_reset();
     if (my_data.kvpairs != NULL) {
         str_parms_destroy(my_data.kvpairs);
         my_data.kvpairs = NULL;
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PLATFORM_INFO_SNAPSHOT_H
+#define PLATFORM_INFO_SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* File format of the platform info snapshot, shared by platform_info.c and
+ * the host tool that compiles snapshots ahead of time.
+ *
+ * The file is a platform_info_snapshot_header followed by payload_size bytes
+ * of records, one per Expat start or end element event, in parse order. A
+ * record is <type:u8><string count - 1:u8> followed by NUL terminated
+ * strings: the tag name, then the attribute name/value pairs.
+ *
+ * source_mtime_ns, source_size and source_path describe the XML as the HAL
+ * opens it on the device. build_hash is the hash of ro.build.fingerprint,
+ * 0 when the property is not set.
+ */
+#define PLATFORM_INFO_SNAPSHOT_MAGIC 0x53495050 /* "PPIS" */
+#define PLATFORM_INFO_SNAPSHOT_VERSION 2
+#define PLATFORM_INFO_SNAPSHOT_MAX_STRINGS 128
+#define PLATFORM_INFO_SNAPSHOT_PATH_MAX 100
+
+enum {
+    SNAPSHOT_EVENT_START = 1,
+    SNAPSHOT_EVENT_END,
+};
+
+struct platform_info_snapshot_header {
+    uint32_t magic;
+    uint32_t version;
+    int64_t  source_mtime_ns;
+    int64_t  source_size;
+    uint64_t build_hash;
+    uint64_t payload_hash;
+    uint64_t payload_size;
+    char     source_path[PLATFORM_INFO_SNAPSHOT_PATH_MAX];
+};
+
+/* FNV-1a, used for payload_hash and build_hash */
+static inline uint64_t platform_info_snapshot_hash(const uint8_t *data, size_t size)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static inline uint64_t platform_info_snapshot_build_hash(const char *fingerprint)
+{
+    return platform_info_snapshot_hash((const uint8_t *)fingerprint, strlen(fingerprint));
+}
+
+#endif
@@ -433,6 +433,8 @@ int voice_start_call(struct audio_device *adev)
 {
     int ret = 0;
 
+    // warm low latency streams must not hold a backend the call needs
+    drop_warm_standby_outputs(adev);
     adev->voice.in_call = true;
 
     voice_set_mic_mute(adev, adev->voice.mic_mute);
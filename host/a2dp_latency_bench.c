@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Times audio_extn_a2dp_get_encoder_latency() with the latency cache
+ * against the per call property read, parse and codec switch it replaced,
+ * and checks that the cache returns what the old code computed for every
+ * codec, with and without a sink latency from the Bluetooth library, and
+ * with the latency property unset, valid and unparsable. Property updates
+ * reach the cache through the watcher thread only, the bench waits for it.
+ *
+ * a2dp.c is compiled into the bench to reach the codec state, the host
+ * HAL itself is built without A2DP offload.
+ */
+
+#include "audio_extn/a2dp.c"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <time.h>
+
+#define WATCHER_TIMEOUT_MS 5000
+
+static struct audio_device bench_adev;
+static uint16_t bench_sink_latency_ms;
+
+static const enc_codec_t codecs[] = {
+    ENC_CODEC_TYPE_SBC,
+    ENC_CODEC_TYPE_APTX,
+    ENC_CODEC_TYPE_APTX_HD,
+    ENC_CODEC_TYPE_AAC,
+    ENC_CODEC_TYPE_LDAC,
+    ENC_CODEC_TYPE_PCM,
+    ENC_CODEC_TYPE_INVALID,
+};
+
+#define NUM_CODECS (sizeof(codecs) / sizeof(codecs[0]))
+
+static const uint16_t sink_latencies_ms[] = { 0, 95 };
+
+/* in the order they are set, a property cannot be deleted */
+static const char *const latency_props[] = { NULL, "30/40/50/60/70", "15/25/35/45/55", "bad" };
+
+#define NUM_LATENCY_PROPS (sizeof(latency_props) / sizeof(latency_props[0]))
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static uint16_t bench_get_sink_latency(void)
+{
+    return bench_sink_latency_ms;
+}
+
+/* audio_extn_a2dp_get_encoder_latency() before the cache */
+static uint32_t uncached_get_encoder_latency(void)
+{
+    uint32_t latency_ms = 0;
+    int avsync_runtime_prop = 0;
+    int sbc_offset = 0, aptx_offset = 0, aptxhd_offset = 0,
+        aac_offset = 0, ldac_offset = 0;
+    char value[PROPERTY_VALUE_MAX];
+
+    memset(value, '\0', sizeof(char) * PROPERTY_VALUE_MAX);
+    avsync_runtime_prop = property_get(SYSPROP_A2DP_CODEC_LATENCIES, value, NULL);
+    if (avsync_runtime_prop > 0) {
+        if (sscanf(value, "%d/%d/%d/%d/%d",
+            &sbc_offset, &aptx_offset, &aptxhd_offset, &aac_offset,
+            &ldac_offset) != 5) {
+            avsync_runtime_prop = 0;
+        }
+    }
+
+    uint32_t slatency_ms = 0;
+    if (a2dp.audio_get_a2dp_sink_latency && a2dp.bt_state != A2DP_STATE_DISCONNECTED) {
+        slatency_ms = a2dp.audio_get_a2dp_sink_latency();
+    }
+
+    switch (a2dp.bt_encoder_format) {
+        case ENC_CODEC_TYPE_SBC:
+            latency_ms = (avsync_runtime_prop > 0) ? sbc_offset : ENCODER_LATENCY_SBC;
+            latency_ms += (slatency_ms == 0) ? DEFAULT_SINK_LATENCY_SBC : slatency_ms;
+            break;
+        case ENC_CODEC_TYPE_APTX:
+            latency_ms = (avsync_runtime_prop > 0) ? aptx_offset : ENCODER_LATENCY_APTX;
+            latency_ms += (slatency_ms == 0) ? DEFAULT_SINK_LATENCY_APTX : slatency_ms;
+            break;
+        case ENC_CODEC_TYPE_APTX_HD:
+            latency_ms = (avsync_runtime_prop > 0) ? aptxhd_offset : ENCODER_LATENCY_APTX_HD;
+            latency_ms += (slatency_ms == 0) ? DEFAULT_SINK_LATENCY_APTX_HD : slatency_ms;
+            break;
+        case ENC_CODEC_TYPE_AAC:
+            latency_ms = (avsync_runtime_prop > 0) ? aac_offset : ENCODER_LATENCY_AAC;
+            latency_ms += (slatency_ms == 0) ? DEFAULT_SINK_LATENCY_AAC : slatency_ms;
+            break;
+        case ENC_CODEC_TYPE_LDAC:
+            latency_ms = (avsync_runtime_prop > 0) ? ldac_offset : ENCODER_LATENCY_LDAC;
+            latency_ms += (slatency_ms == 0) ? DEFAULT_SINK_LATENCY_LDAC : slatency_ms;
+            break;
+        case ENC_CODEC_TYPE_PCM:
+            latency_ms = ENCODER_LATENCY_PCM;
+            latency_ms += DEFAULT_SINK_LATENCY_PCM;
+            break;
+        default:
+            latency_ms = DEFAULT_ENCODER_LATENCY;
+            break;
+    }
+    return latency_ms;
+}
+
+/* What a codec (re)configuration does, with the sink latency query of a
+   connected Bluetooth library */
+static void configure(enc_codec_t codec, uint16_t sink_latency_ms)
+{
+    adev_lock(&bench_adev, ADEV_LOCK_SITE_EXTN);
+    a2dp.bt_encoder_format = codec;
+    bench_sink_latency_ms = sink_latency_ms;
+    a2dp_refresh_encoder_latency();
+    pthread_mutex_unlock(&bench_adev.lock);
+}
+
+static int check_all_codecs(const char *prop)
+{
+    int failures = 0;
+
+    for (size_t s = 0; s < sizeof(sink_latencies_ms) / sizeof(sink_latencies_ms[0]); s++) {
+        for (size_t c = 0; c < NUM_CODECS; c++) {
+            uint32_t cached, uncached;
+
+            configure(codecs[c], sink_latencies_ms[s]);
+            cached = audio_extn_a2dp_get_encoder_latency();
+            uncached = uncached_get_encoder_latency();
+            if (cached != uncached) {
+                fprintf(stderr, "codec %#x sink %u ms property %s: cached %u ms, "
+                        "uncached %u ms\n", codecs[c], sink_latencies_ms[s],
+                        prop != NULL ? prop : "unset", cached, uncached);
+                failures++;
+            }
+        }
+    }
+    return failures;
+}
+
+/* Sets the latency property without refreshing and waits until the watcher
+   thread brings the cache in line with the uncached value */
+static int set_latency_prop(const char *prop)
+{
+    const int64_t deadline_ns = now_ns() + WATCHER_TIMEOUT_MS * 1000000LL;
+    const struct timespec poll = { .tv_nsec = 1000000 };
+
+    property_set(SYSPROP_A2DP_CODEC_LATENCIES, prop);
+    while (audio_extn_a2dp_get_encoder_latency() != uncached_get_encoder_latency()) {
+        if (now_ns() > deadline_ns) {
+            fprintf(stderr, "property %s: the watcher did not refresh the cache within %d ms\n",
+                    prop, WATCHER_TIMEOUT_MS);
+            return 1;
+        }
+        nanosleep(&poll, NULL);
+    }
+    return 0;
+}
+
+static double time_ns(uint32_t (*get_latency)(void), unsigned int iterations)
+{
+    volatile uint32_t sink = 0;
+    const int64_t start_ns = now_ns();
+
+    for (unsigned int i = 0; i < iterations; i++)
+        sink += get_latency();
+    (void)sink;
+    return iterations ? (double)(now_ns() - start_ns) / iterations : 0;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n <n>  calls timed per implementation (default 1000000)\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int iterations = 1000000;
+    double uncached_ns, cached_ns;
+    int opt, failures = 0;
+
+    while ((opt = getopt(argc, argv, "n:h")) != -1) {
+        switch (opt) {
+        case 'n': iterations = strtoul(optarg, NULL, 0); break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    setenv("HAL_HOST_LOG", "S", 0);
+    pthread_mutex_init(&bench_adev.lock, (const pthread_mutexattr_t *) NULL);
+    property_set(SYSPROP_A2DP_OFFLOAD_SUPPORTED, "true");
+    audio_extn_a2dp_init(&bench_adev);
+    if (!a2dp.latency_prop_thread_started) {
+        fprintf(stderr, "A2DP offload is off or the latency watcher did not start\n");
+        return 1;
+    }
+
+    /* a connected Bluetooth library, never called through but the sink latency */
+    a2dp.bt_lib_handle = &bench_adev;
+    a2dp.audio_get_a2dp_sink_latency = bench_get_sink_latency;
+    a2dp.bt_state = A2DP_STATE_STARTED;
+
+    for (size_t p = 0; p < NUM_LATENCY_PROPS; p++) {
+        if (latency_props[p] != NULL) {
+            configure(ENC_CODEC_TYPE_SBC, 0);
+            failures += set_latency_prop(latency_props[p]);
+        }
+        failures += check_all_codecs(latency_props[p]);
+    }
+
+    property_set(SYSPROP_A2DP_CODEC_LATENCIES, latency_props[1]);
+    configure(ENC_CODEC_TYPE_AAC, sink_latencies_ms[1]);
+    uncached_ns = time_ns(uncached_get_encoder_latency, iterations);
+    cached_ns = time_ns(audio_extn_a2dp_get_encoder_latency, iterations);
+    printf("get_encoder_latency %u calls: uncached %.1f ns, cached %.1f ns, %.1fx\n",
+           iterations, uncached_ns, cached_ns, cached_ns > 0 ? uncached_ns / cached_ns : 0);
+
+    a2dp.bt_lib_handle = NULL;
+    audio_extn_a2dp_deinit();
+    if (failures != 0)
+        fprintf(stderr, "%d latency checks failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Times the mixer side of offload effect start/stop cycles: the mixer_open(),
+ * control lookup and mixer_close() each offload_effects_bundle_hal_start_output()
+ * used to make, against the shared effects_mixer handle it now acquires. The
+ * visualizer library then starts and stops on the same output, its capture
+ * thread acquiring the same handle. Fails when the shared cycles open the
+ * mixer or look the control up more than once.
+ *
+ * The bundle does not build on the host (it needs the msm kernel effect
+ * headers), so its start/stop calls are reproduced here.
+ */
+
+#define LOG_TAG "effects_mixer_bench"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <system/audio.h>
+#include <tinyalsa/asoundlib.h>
+
+#include "effects_mixer.h"
+#include "fake_alsa.h"
+
+#define MIXER_CARD 0
+#define OUTPUT_HANDLE 13
+#define PCM_ID 9
+#define CAPTURE_PCM_ID 8
+
+int visualizer_hal_start_output(audio_io_handle_t output, int pcm_id, int card_number,
+                                int pcm_capture_id);
+int visualizer_hal_stop_output(audio_io_handle_t output, int pcm_id);
+
+struct cycles {
+    const char *name;
+    unsigned int count;
+    int64_t ns;
+    struct fake_alsa_stats before, after;
+};
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void begin(struct cycles *cycles, const char *name, unsigned int count)
+{
+    cycles->name = name;
+    cycles->count = count;
+    fake_alsa_get_stats(&cycles->before);
+    cycles->ns = now_ns();
+}
+
+static void end(struct cycles *cycles)
+{
+    cycles->ns = now_ns() - cycles->ns;
+    fake_alsa_get_stats(&cycles->after);
+    printf("%-28s %6u cycles, %6llu mixer opens, %6llu ctl lookups, mean %8.2f us\n",
+           cycles->name, cycles->count,
+           (unsigned long long)(cycles->after.mixer_opens - cycles->before.mixer_opens),
+           (unsigned long long)(cycles->after.ctl_lookups - cycles->before.ctl_lookups),
+           cycles->count ? cycles->ns / 1000.0 / cycles->count : 0);
+}
+
+/* as bundle.c did before the mixer was shared */
+static int per_start_cycle(void)
+{
+    char name[64];
+    struct mixer *mixer = mixer_open(MIXER_CARD);
+
+    if (mixer == NULL)
+        return -1;
+    snprintf(name, sizeof(name), "Audio Effects Config %d", PCM_ID);
+    if (mixer_get_ctl_by_name(mixer, name) == NULL) {
+        mixer_close(mixer);
+        return -1;
+    }
+    mixer_close(mixer);
+    return 0;
+}
+
+/* offload_effects_bundle_hal_start_output() and _stop_output() */
+static struct mixer_ctl *shared_cycle(void)
+{
+    struct mixer_ctl *ctl;
+
+    if (effects_mixer_acquire(MIXER_CARD) == NULL)
+        return NULL;
+    ctl = effects_mixer_get_pcm_ctl(MIXER_CARD, "Audio Effects Config", PCM_ID);
+    effects_mixer_release(MIXER_CARD);
+    return ctl;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n <n>   start/stop cycles per measurement (default 1000)\n"
+            "  -o <us>  cost of each mixer_open() (default 0)\n"
+            "Set HAL_HOST_LOG=V|D|I|W|E|S for log output (default W).\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    struct fake_alsa_config config = { 0 };
+    struct cycles per_start, shared, visualizer;
+    struct mixer_ctl *first_ctl = NULL;
+    unsigned int iterations = 1000;
+    int opt, failures = 0;
+
+    while ((opt = getopt(argc, argv, "n:o:h")) != -1) {
+        switch (opt) {
+        case 'n': iterations = strtoul(optarg, NULL, 0); break;
+        case 'o': config.mixer_open_ns = strtoll(optarg, NULL, 0) * 1000; break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    fake_alsa_configure(&config);
+
+    begin(&per_start, "mixer_open per start", iterations);
+    for (unsigned int i = 0; i < iterations; i++)
+        failures += per_start_cycle() != 0;
+    end(&per_start);
+
+    begin(&shared, "shared effects_mixer", iterations);
+    for (unsigned int i = 0; i < iterations; i++) {
+        struct mixer_ctl *ctl = shared_cycle();
+
+        if (first_ctl == NULL)
+            first_ctl = ctl;
+        failures += ctl == NULL || ctl != first_ctl;
+    }
+    end(&shared);
+
+    begin(&visualizer, "visualizer start/stop", iterations);
+    for (unsigned int i = 0; i < iterations; i++) {
+        failures += visualizer_hal_start_output(OUTPUT_HANDLE, PCM_ID, MIXER_CARD,
+                                                CAPTURE_PCM_ID) != 0;
+        failures += visualizer_hal_stop_output(OUTPUT_HANDLE, PCM_ID) != 0;
+    }
+    end(&visualizer);
+
+    /* the first shared acquire opens the mixer, nothing after it */
+    if (shared.after.mixer_opens - shared.before.mixer_opens > 1 ||
+            shared.after.ctl_lookups - shared.before.ctl_lookups > 1 ||
+            visualizer.after.mixer_opens != visualizer.before.mixer_opens) {
+        fprintf(stderr, "the shared mixer was opened or searched again\n");
+        failures++;
+    }
+    if (failures != 0)
+        fprintf(stderr, "%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,1505 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "fake_alsa"
+/*#define LOG_NDEBUG 0*/
+
+#include <errno.h>
+#include <expat.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <log/log.h>
+#include <audio_route/audio_route.h>
+#include <sound/compress_params.h>
+#include <tinyalsa/asoundlib.h>
+#include <tinycompress/tinycompress.h>
+
+#include "fake_alsa.h"
+
+#define FAKE_CARD 0
+#define FAKE_CARD_NAME "msm8974-taiko-mtp-snd-card"
+#define FAKE_CTL_NAME_MAX 64
+#define FAKE_CTL_MAX_VALUES 128
+#define FAKE_CTL_HASH_SIZE 256
+#define FAKE_COMPRESS_DEFAULT_BIT_RATE 128000
+
+static pthread_mutex_t config_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct fake_alsa_config config;
+static fake_alsa_capture_source_t capture_source;
+static void *capture_cookie;
+
+static struct {
+    _Atomic uint64_t mixer_opens;
+    _Atomic uint64_t pcm_opens;
+    _Atomic uint64_t pcm_writes;
+    _Atomic uint64_t pcm_reads;
+    _Atomic uint64_t pcm_underruns;
+    _Atomic uint64_t pcm_read_errors;
+    _Atomic uint64_t pcm_htimestamps;
+    _Atomic uint64_t compress_writes;
+    _Atomic uint64_t ctl_writes;
+    _Atomic uint64_t ctl_lookups;
+    _Atomic uint64_t route_updates;
+} stats;
+
+void fake_alsa_configure(const struct fake_alsa_config *new_config)
+{
+    pthread_mutex_lock(&config_lock);
+    config = *new_config;
+    pthread_mutex_unlock(&config_lock);
+}
+
+void fake_alsa_get_config(struct fake_alsa_config *out_config)
+{
+    pthread_mutex_lock(&config_lock);
+    *out_config = config;
+    pthread_mutex_unlock(&config_lock);
+}
+
+void fake_alsa_get_stats(struct fake_alsa_stats *out_stats)
+{
+    out_stats->mixer_opens = stats.mixer_opens;
+    out_stats->pcm_opens = stats.pcm_opens;
+    out_stats->pcm_writes = stats.pcm_writes;
+    out_stats->pcm_reads = stats.pcm_reads;
+    out_stats->pcm_underruns = stats.pcm_underruns;
+    out_stats->pcm_read_errors = stats.pcm_read_errors;
+    out_stats->pcm_htimestamps = stats.pcm_htimestamps;
+    out_stats->compress_writes = stats.compress_writes;
+    out_stats->ctl_writes = stats.ctl_writes;
+    out_stats->ctl_lookups = stats.ctl_lookups;
+    out_stats->route_updates = stats.route_updates;
+}
+
+void fake_alsa_reset_stats(void)
+{
+    stats.mixer_opens = 0;
+    stats.pcm_opens = 0;
+    stats.pcm_writes = 0;
+    stats.pcm_reads = 0;
+    stats.pcm_underruns = 0;
+    stats.pcm_read_errors = 0;
+    stats.pcm_htimestamps = 0;
+    stats.compress_writes = 0;
+    stats.ctl_writes = 0;
+    stats.ctl_lookups = 0;
+    stats.route_updates = 0;
+}
+
+void fake_alsa_set_capture_source(fake_alsa_capture_source_t source, void *cookie)
+{
+    pthread_mutex_lock(&config_lock);
+    capture_source = source;
+    capture_cookie = cookie;
+    pthread_mutex_unlock(&config_lock);
+}
+
+static struct fake_alsa_config current_config(void)
+{
+    struct fake_alsa_config c;
+
+    fake_alsa_get_config(&c);
+    return c;
+}
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void sleep_ns(int64_t ns)
+{
+    struct timespec ts;
+
+    if (ns <= 0)
+        return;
+    ts.tv_sec = ns / 1000000000LL;
+    ts.tv_nsec = ns % 1000000000LL;
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+        ;
+}
+
+/* ------------------------------------------------------------------ mixer */
+
+struct mixer_ctl {
+    struct mixer_ctl *next;          /* hash chain */
+    char name[FAKE_CTL_NAME_MAX];
+    enum mixer_ctl_type type;
+    unsigned int num_values;
+    int values[FAKE_CTL_MAX_VALUES];
+    char enum_value[FAKE_CTL_NAME_MAX];
+    bool routed;                     /* referenced by a mixer paths file */
+};
+
+struct mixer {
+    unsigned int card;
+};
+
+/* one control table per process, shared by every mixer_open() of the card */
+static pthread_mutex_t ctl_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct mixer_ctl *ctl_table[FAKE_CTL_HASH_SIZE];
+
+static unsigned int ctl_hash(const char *name)
+{
+    unsigned int h = 5381;
+
+    while (*name)
+        h = h * 33 + (unsigned char)*name++;
+    return h % FAKE_CTL_HASH_SIZE;
+}
+
+static struct mixer_ctl *find_ctl_l(const char *name, bool create)
+{
+    unsigned int h = ctl_hash(name);
+    struct mixer_ctl *ctl;
+
+    for (ctl = ctl_table[h]; ctl != NULL; ctl = ctl->next) {
+        if (strcmp(ctl->name, name) == 0)
+            return ctl;
+    }
+    if (!create)
+        return NULL;
+
+    ctl = calloc(1, sizeof(*ctl));
+    if (ctl == NULL)
+        return NULL;
+    strlcpy(ctl->name, name, sizeof(ctl->name));
+    ctl->type = MIXER_CTL_TYPE_INT;
+    ctl->num_values = 1;
+    ctl->next = ctl_table[h];
+    ctl_table[h] = ctl;
+    return ctl;
+}
+
+static void account_ctl_write(void)
+{
+    stats.ctl_writes++;
+    sleep_ns(current_config().ctl_write_ns);
+}
+
+int fake_alsa_get_ctl_value(const char *name, int default_value)
+{
+    struct mixer_ctl *ctl;
+    int value = default_value;
+
+    pthread_mutex_lock(&ctl_lock);
+    ctl = find_ctl_l(name, false);
+    if (ctl != NULL)
+        value = ctl->values[0];
+    pthread_mutex_unlock(&ctl_lock);
+    return value;
+}
+
+void fake_alsa_reset_ctls(void)
+{
+    pthread_mutex_lock(&ctl_lock);
+    for (int i = 0; i < FAKE_CTL_HASH_SIZE; i++) {
+        while (ctl_table[i] != NULL) {
+            struct mixer_ctl *ctl = ctl_table[i];
+
+            ctl_table[i] = ctl->next;
+            free(ctl);
+        }
+    }
+    pthread_mutex_unlock(&ctl_lock);
+}
+
+static uint32_t hash_bytes(uint32_t h, const void *data, size_t size)
+{
+    const unsigned char *p = data;
+
+    /* FNV-1a */
+    while (size-- > 0)
+        h = (h ^ *p++) * 16777619u;
+    return h;
+}
+
+static bool ctl_is_zero(const struct mixer_ctl *ctl)
+{
+    if (ctl->type == MIXER_CTL_TYPE_ENUM)
+        return strcmp(ctl->enum_value, "ZERO") == 0 || ctl->enum_value[0] == '\0';
+    for (unsigned int i = 0; i < ctl->num_values; i++) {
+        if (ctl->values[i] != 0)
+            return false;
+    }
+    return true;
+}
+
+uint32_t fake_alsa_ctl_state_hash(void)
+{
+    uint32_t sum = 0;
+
+    pthread_mutex_lock(&ctl_lock);
+    for (int i = 0; i < FAKE_CTL_HASH_SIZE; i++) {
+        for (struct mixer_ctl *ctl = ctl_table[i]; ctl != NULL; ctl = ctl->next) {
+            uint32_t h = 2166136261u;
+
+            // a control never set and one reset to zero are the same state
+            if (!ctl->routed || ctl_is_zero(ctl))
+                continue;
+            h = hash_bytes(h, ctl->name, strlen(ctl->name));
+            if (ctl->type == MIXER_CTL_TYPE_ENUM)
+                h = hash_bytes(h, ctl->enum_value, strlen(ctl->enum_value));
+            else
+                h = hash_bytes(h, ctl->values, ctl->num_values * sizeof(ctl->values[0]));
+            sum += h;
+        }
+    }
+    pthread_mutex_unlock(&ctl_lock);
+    return sum;
+}
+
+static int compare_ctl_names(const void *a, const void *b)
+{
+    return strcmp((*(struct mixer_ctl * const *)a)->name, (*(struct mixer_ctl * const *)b)->name);
+}
+
+void fake_alsa_dump_ctls(FILE *file)
+{
+    struct mixer_ctl **ctls = NULL;
+    unsigned int count = 0, size = 0;
+
+    pthread_mutex_lock(&ctl_lock);
+    for (int i = 0; i < FAKE_CTL_HASH_SIZE; i++) {
+        for (struct mixer_ctl *ctl = ctl_table[i]; ctl != NULL; ctl = ctl->next) {
+            if (!ctl->routed || ctl_is_zero(ctl))
+                continue;
+            if (count == size) {
+                struct mixer_ctl **grown;
+
+                size = size ? size * 2 : 64;
+                grown = realloc(ctls, size * sizeof(*ctls));
+                if (grown == NULL)
+                    goto exit;
+                ctls = grown;
+            }
+            ctls[count++] = ctl;
+        }
+    }
+    qsort(ctls, count, sizeof(*ctls), compare_ctl_names);
+    for (unsigned int i = 0; i < count; i++) {
+        if (ctls[i]->type == MIXER_CTL_TYPE_ENUM) {
+            fprintf(file, "  %s = %s\n", ctls[i]->name, ctls[i]->enum_value);
+        } else {
+            fprintf(file, "  %s =", ctls[i]->name);
+            for (unsigned int v = 0; v < ctls[i]->num_values; v++)
+                fprintf(file, " %d", ctls[i]->values[v]);
+            fputc('\n', file);
+        }
+    }
+exit:
+    pthread_mutex_unlock(&ctl_lock);
+    free(ctls);
+}
+
+struct mixer *mixer_open(unsigned int card)
+{
+    struct mixer *mixer;
+
+    if (card != FAKE_CARD)
+        return NULL;
+    sleep_ns(current_config().mixer_open_ns);
+    stats.mixer_opens++;
+    mixer = calloc(1, sizeof(*mixer));
+    if (mixer != NULL)
+        mixer->card = card;
+    return mixer;
+}
+
+void mixer_close(struct mixer *mixer)
+{
+    free(mixer);
+}
+
+const char *mixer_get_name(struct mixer *mixer __unused)
+{
+    return FAKE_CARD_NAME;
+}
+
+unsigned int mixer_get_num_ctls(struct mixer *mixer __unused)
+{
+    unsigned int count = 0;
+
+    pthread_mutex_lock(&ctl_lock);
+    for (int i = 0; i < FAKE_CTL_HASH_SIZE; i++) {
+        for (struct mixer_ctl *ctl = ctl_table[i]; ctl != NULL; ctl = ctl->next)
+            count++;
+    }
+    pthread_mutex_unlock(&ctl_lock);
+    return count;
+}
+
+struct mixer_ctl *mixer_get_ctl(struct mixer *mixer __unused, unsigned int id)
+{
+    struct mixer_ctl *found = NULL;
+
+    pthread_mutex_lock(&ctl_lock);
+    for (int i = 0; i < FAKE_CTL_HASH_SIZE && found == NULL; i++) {
+        for (struct mixer_ctl *ctl = ctl_table[i]; ctl != NULL; ctl = ctl->next) {
+            if (id-- == 0) {
+                found = ctl;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&ctl_lock);
+    return found;
+}
+
+struct mixer_ctl *mixer_get_ctl_by_name(struct mixer *mixer, const char *name)
+{
+    struct mixer_ctl *ctl;
+
+    if (mixer == NULL || name == NULL)
+        return NULL;
+    stats.ctl_lookups++;
+    pthread_mutex_lock(&ctl_lock);
+    ctl = find_ctl_l(name, true);
+    pthread_mutex_unlock(&ctl_lock);
+    return ctl;
+}
+
+const char *mixer_ctl_get_name(struct mixer_ctl *ctl)
+{
+    return ctl != NULL ? ctl->name : NULL;
+}
+
+enum mixer_ctl_type mixer_ctl_get_type(struct mixer_ctl *ctl)
+{
+    return ctl != NULL ? ctl->type : MIXER_CTL_TYPE_UNKNOWN;
+}
+
+unsigned int mixer_ctl_get_num_values(struct mixer_ctl *ctl)
+{
+    return ctl != NULL ? ctl->num_values : 0;
+}
+
+unsigned int mixer_ctl_get_num_enums(struct mixer_ctl *ctl)
+{
+    return ctl != NULL && ctl->type == MIXER_CTL_TYPE_ENUM ? 1 : 0;
+}
+
+const char *mixer_ctl_get_enum_string(struct mixer_ctl *ctl, unsigned int enum_id)
+{
+    if (ctl == NULL || ctl->type != MIXER_CTL_TYPE_ENUM || enum_id != 0)
+        return NULL;
+    return ctl->enum_value;
+}
+
+void mixer_ctl_update(struct mixer_ctl *ctl __unused)
+{
+}
+
+int mixer_ctl_get_value(struct mixer_ctl *ctl, unsigned int id)
+{
+    int value;
+
+    if (ctl == NULL || id >= FAKE_CTL_MAX_VALUES)
+        return -EINVAL;
+    pthread_mutex_lock(&ctl_lock);
+    value = ctl->values[id];
+    pthread_mutex_unlock(&ctl_lock);
+    return value;
+}
+
+int mixer_ctl_get_array(struct mixer_ctl *ctl, void *array, size_t count)
+{
+    if (ctl == NULL || array == NULL)
+        return -EINVAL;
+    memset(array, 0, count);
+    return 0;
+}
+
+int mixer_ctl_set_value(struct mixer_ctl *ctl, unsigned int id, int value)
+{
+    if (ctl == NULL || id >= FAKE_CTL_MAX_VALUES)
+        return -EINVAL;
+    pthread_mutex_lock(&ctl_lock);
+    if (id >= ctl->num_values)
+        ctl->num_values = id + 1;
+    ctl->values[id] = value;
+    pthread_mutex_unlock(&ctl_lock);
+    account_ctl_write();
+    return 0;
+}
+
+/* element sizes depend on the control type, only the write is recorded */
+int mixer_ctl_set_array(struct mixer_ctl *ctl, const void *array, size_t count)
+{
+    if (ctl == NULL || array == NULL || count == 0)
+        return -EINVAL;
+    pthread_mutex_lock(&ctl_lock);
+    if (count > ctl->num_values)
+        ctl->num_values = count < FAKE_CTL_MAX_VALUES ? count : FAKE_CTL_MAX_VALUES;
+    pthread_mutex_unlock(&ctl_lock);
+    account_ctl_write();
+    return 0;
+}
+
+int mixer_ctl_set_enum_by_string(struct mixer_ctl *ctl, const char *string)
+{
+    if (ctl == NULL || string == NULL)
+        return -EINVAL;
+    pthread_mutex_lock(&ctl_lock);
+    ctl->type = MIXER_CTL_TYPE_ENUM;
+    strlcpy(ctl->enum_value, string, sizeof(ctl->enum_value));
+    pthread_mutex_unlock(&ctl_lock);
+    account_ctl_write();
+    return 0;
+}
+
+int mixer_ctl_get_range_min(struct mixer_ctl *ctl __unused)
+{
+    return 0;
+}
+
+int mixer_ctl_get_range_max(struct mixer_ctl *ctl __unused)
+{
+    return 100;
+}
+
+/* -------------------------------------------------------------------- pcm */
+
+struct pcm {
+    unsigned int flags;
+    unsigned int device;
+    struct pcm_config config;
+    unsigned int buffer_size;        /* frames */
+    unsigned int frame_bytes;
+    uint8_t *dma_buffer;             /* the ring, pcm_write() copies into it */
+    bool prepared;
+    bool running;
+    int64_t start_ns;                /* clock origin while running */
+    uint64_t hw_base;                /* hw_ptr at start_ns */
+    uint64_t hw_ptr;                 /* frames consumed (out) or produced (in) */
+    uint64_t appl_ptr;               /* frames written (out) or read (in) */
+    uint64_t writes;
+    uint64_t reads;
+    char error[PCM_ERROR_MAX];
+};
+
+static struct pcm bad_pcm = {
+    .error = "fake pcm: device not ready",
+};
+
+unsigned int pcm_format_to_bits(enum pcm_format format)
+{
+    switch (format) {
+    case PCM_FORMAT_S32_LE:
+    case PCM_FORMAT_S24_LE:
+        return 32;
+    case PCM_FORMAT_S24_3LE:
+        return 24;
+    case PCM_FORMAT_S8:
+        return 8;
+    case PCM_FORMAT_S16_LE:
+    default:
+        return 16;
+    }
+}
+
+static bool is_capture(const struct pcm *pcm)
+{
+    return (pcm->flags & PCM_IN) != 0;
+}
+
+/* Advances hw_ptr to now. Playback stops at appl_ptr (an underrun), capture
+   runs ahead of appl_ptr by at most the buffer (an overrun drops frames). */
+static void pcm_sync_l(struct pcm *pcm, bool real_time)
+{
+    if (!pcm->running)
+        return;
+    if (!real_time) {
+        // the consumer keeps pace: the ring stays full for playback and a
+        // read always finds data for capture
+        if (is_capture(pcm))
+            pcm->hw_ptr = pcm->appl_ptr + pcm->buffer_size;
+        return;
+    }
+    pcm->hw_ptr = pcm->hw_base +
+            (uint64_t)((now_ns() - pcm->start_ns) * (int64_t)pcm->config.rate / 1000000000LL);
+    if (is_capture(pcm)) {
+        if (pcm->hw_ptr > pcm->appl_ptr + pcm->buffer_size)
+            pcm->appl_ptr = pcm->hw_ptr - pcm->buffer_size;
+    } else if (pcm->hw_ptr > pcm->appl_ptr) {
+        // drained: the kernel stops the stream and the next write restarts it
+        stats.pcm_underruns++;
+        pcm->hw_ptr = pcm->appl_ptr;
+        pcm->running = false;
+    }
+}
+
+static void pcm_start_l(struct pcm *pcm)
+{
+    pcm->running = true;
+    pcm->start_ns = now_ns();
+    pcm->hw_base = pcm->hw_ptr;
+}
+
+static unsigned int playback_avail_l(const struct pcm *pcm)
+{
+    return pcm->buffer_size - (unsigned int)(pcm->appl_ptr - pcm->hw_ptr);
+}
+
+struct pcm *pcm_open(unsigned int card, unsigned int device, unsigned int flags,
+                     struct pcm_config *pcm_config)
+{
+    struct pcm *pcm;
+
+    if (card != FAKE_CARD || pcm_config == NULL)
+        return &bad_pcm;
+
+    sleep_ns(current_config().pcm_open_ns);
+    pcm = calloc(1, sizeof(*pcm));
+    if (pcm == NULL)
+        return &bad_pcm;
+    pcm->flags = flags;
+    pcm->device = device;
+    pcm->config = *pcm_config;
+    if (pcm->config.period_size == 0)
+        pcm->config.period_size = 256;
+    if (pcm->config.period_count == 0)
+        pcm->config.period_count = 2;
+    if (pcm->config.rate == 0)
+        pcm->config.rate = 48000;
+    if (pcm->config.channels == 0)
+        pcm->config.channels = 2;
+    pcm->buffer_size = pcm->config.period_size * pcm->config.period_count;
+    pcm->frame_bytes = pcm->config.channels * pcm_format_to_bits(pcm->config.format) / 8;
+    pcm->dma_buffer = calloc(pcm->buffer_size, pcm->frame_bytes);
+    if (pcm->dma_buffer == NULL) {
+        free(pcm);
+        return &bad_pcm;
+    }
+    stats.pcm_opens++;
+    return pcm;
+}
+
+int pcm_close(struct pcm *pcm)
+{
+    if (pcm == &bad_pcm || pcm == NULL)
+        return 0;
+    free(pcm->dma_buffer);
+    free(pcm);
+    return 0;
+}
+
+int pcm_is_ready(struct pcm *pcm)
+{
+    return pcm != NULL && pcm != &bad_pcm;
+}
+
+const char *pcm_get_error(struct pcm *pcm)
+{
+    return pcm != NULL ? pcm->error : "fake pcm: no pcm";
+}
+
+unsigned int pcm_get_buffer_size(struct pcm *pcm)
+{
+    return pcm->buffer_size;
+}
+
+unsigned int pcm_frames_to_bytes(struct pcm *pcm, unsigned int frames)
+{
+    return frames * pcm->frame_bytes;
+}
+
+unsigned int pcm_bytes_to_frames(struct pcm *pcm, unsigned int bytes)
+{
+    return bytes / pcm->frame_bytes;
+}
+
+int pcm_get_file_descriptor(struct pcm *pcm __unused)
+{
+    return -1;
+}
+
+int pcm_get_poll_fd(struct pcm *pcm __unused)
+{
+    return -1;
+}
+
+int pcm_prepare(struct pcm *pcm)
+{
+    if (!pcm_is_ready(pcm))
+        return -EBADFD;
+    sleep_ns(current_config().pcm_prepare_ns);
+    pcm->prepared = true;
+    pcm->running = false;
+    pcm->hw_ptr = pcm->appl_ptr;
+    return 0;
+}
+
+int pcm_start(struct pcm *pcm)
+{
+    if (!pcm_is_ready(pcm))
+        return -EBADFD;
+    sleep_ns(current_config().pcm_prepare_ns);
+    if (!pcm->running)
+        pcm_start_l(pcm);
+    return 0;
+}
+
+int pcm_stop(struct pcm *pcm)
+{
+    if (!pcm_is_ready(pcm))
+        return -EBADFD;
+    pcm->running = false;
+    pcm->hw_ptr = pcm->appl_ptr;
+    return 0;
+}
+
+static unsigned int start_threshold(const struct pcm *pcm)
+{
+    unsigned int threshold = pcm->config.start_threshold;
+
+    if (threshold == 0)
+        threshold = pcm->config.period_size;
+    return threshold < pcm->buffer_size ? threshold : pcm->buffer_size;
+}
+
+/* Copies frames into the ring at appl_ptr, as the kernel does on a write. */
+static void playback_copy_l(struct pcm *pcm, const uint8_t *data, unsigned int frames)
+{
+    const unsigned int offset = pcm->appl_ptr % pcm->buffer_size;
+    const unsigned int first = frames < pcm->buffer_size - offset ?
+            frames : pcm->buffer_size - offset;
+
+    memcpy(pcm->dma_buffer + (size_t)offset * pcm->frame_bytes, data,
+           (size_t)first * pcm->frame_bytes);
+    memcpy(pcm->dma_buffer, data + (size_t)first * pcm->frame_bytes,
+           (size_t)(frames - first) * pcm->frame_bytes);
+}
+
+/* Queues frames into the ring, blocking on the stream clock when real_time. */
+static int playback_queue(struct pcm *pcm, const uint8_t *data, unsigned int frames)
+{
+    const struct fake_alsa_config c = current_config();
+
+    sleep_ns(c.pcm_io_ns);
+    stats.pcm_writes++;
+    if (c.underrun_every != 0 && ++pcm->writes % c.underrun_every == 0 && pcm->running) {
+        if (c.real_time) {
+            // stall until the ring drains, the HAL sees a real underrun
+            sleep_ns((int64_t)(pcm->appl_ptr - pcm->hw_ptr) * 1000000000LL / pcm->config.rate);
+        } else {
+            stats.pcm_underruns++;
+            pcm->hw_ptr = pcm->appl_ptr;
+            pcm->running = false;
+        }
+    }
+
+    while (frames > 0) {
+        unsigned int avail, chunk;
+
+        pcm_sync_l(pcm, c.real_time);
+        avail = playback_avail_l(pcm);
+        if (avail == 0) {
+            if (!pcm->running)
+                pcm_start_l(pcm);
+            if (!c.real_time) {
+                pcm->hw_ptr += frames < pcm->buffer_size ? frames : pcm->buffer_size;
+                continue;
+            }
+            sleep_ns((int64_t)pcm->config.period_size * 1000000000LL / pcm->config.rate / 4);
+            continue;
+        }
+        chunk = frames < avail ? frames : avail;
+        playback_copy_l(pcm, data, chunk);
+        data += (size_t)chunk * pcm->frame_bytes;
+        pcm->appl_ptr += chunk;
+        frames -= chunk;
+        if (!pcm->running && pcm->appl_ptr - pcm->hw_ptr >= start_threshold(pcm))
+            pcm_start_l(pcm);
+    }
+    return 0;
+}
+
+int pcm_write(struct pcm *pcm, const void *data, unsigned int count)
+{
+    if (!pcm_is_ready(pcm) || is_capture(pcm) || data == NULL)
+        return -EINVAL;
+    return playback_queue(pcm, data, pcm_bytes_to_frames(pcm, count));
+}
+
+int pcm_mmap_write(struct pcm *pcm, const void *data, unsigned int count)
+{
+    return pcm_write(pcm, data, count);
+}
+
+int pcm_read(struct pcm *pcm, void *data, unsigned int count)
+{
+    const struct fake_alsa_config c = current_config();
+    unsigned int frames;
+
+    if (!pcm_is_ready(pcm) || !is_capture(pcm) || data == NULL)
+        return -EINVAL;
+    sleep_ns(c.pcm_io_ns);
+    stats.pcm_reads++;
+    if (c.read_error_every != 0 && ++pcm->reads % c.read_error_every == 0) {
+        stats.pcm_read_errors++;
+        snprintf(pcm->error, sizeof(pcm->error), "fake pcm: injected read error");
+        errno = EIO;
+        return -1;
+    }
+    frames = pcm_bytes_to_frames(pcm, count);
+    if (!pcm->running)
+        pcm_start_l(pcm);
+    for (;;) {
+        pcm_sync_l(pcm, c.real_time);
+        if (pcm->hw_ptr - pcm->appl_ptr >= frames)
+            break;
+        sleep_ns((int64_t)(frames - (pcm->hw_ptr - pcm->appl_ptr)) * 1000000000LL /
+                pcm->config.rate);
+    }
+    pthread_mutex_lock(&config_lock);
+    if (capture_source != NULL)
+        capture_source(data, count, pcm->appl_ptr, capture_cookie);
+    else
+        memset(data, 0, count);
+    pthread_mutex_unlock(&config_lock);
+    pcm->appl_ptr += frames;
+    return 0;
+}
+
+int pcm_mmap_read(struct pcm *pcm, void *data, unsigned int count)
+{
+    return pcm_read(pcm, data, count);
+}
+
+int pcm_avail_update(struct pcm *pcm)
+{
+    const struct fake_alsa_config c = current_config();
+
+    if (!pcm_is_ready(pcm))
+        return -EBADFD;
+    pcm_sync_l(pcm, c.real_time);
+    if (is_capture(pcm))
+        return (int)(pcm->hw_ptr - pcm->appl_ptr);
+    if (!c.real_time && pcm->running && playback_avail_l(pcm) == 0)
+        pcm->hw_ptr += pcm->config.period_size;
+    return (int)playback_avail_l(pcm);
+}
+
+int pcm_wait(struct pcm *pcm, int timeout)
+{
+    int64_t deadline = now_ns() + (int64_t)timeout * 1000000LL;
+
+    while (pcm_avail_update(pcm) <= 0) {
+        if (!pcm->running)
+            return -EPIPE;
+        if (timeout >= 0 && now_ns() >= deadline)
+            return 0;
+        sleep_ns((int64_t)pcm->config.period_size * 1000000000LL / pcm->config.rate / 4);
+    }
+    return 1;
+}
+
+int pcm_mmap_begin(struct pcm *pcm, void **areas, unsigned int *offset, unsigned int *frames)
+{
+    unsigned int avail, contiguous;
+
+    if (!pcm_is_ready(pcm) || (pcm->flags & PCM_MMAP) == 0)
+        return -ENOSYS;
+    avail = pcm_avail_update(pcm);
+    *offset = pcm->appl_ptr % pcm->buffer_size;
+    contiguous = pcm->buffer_size - *offset;
+    if (*frames > avail)
+        *frames = avail;
+    if (*frames > contiguous)
+        *frames = contiguous;
+    *areas = pcm->dma_buffer;
+    return 0;
+}
+
+int pcm_mmap_commit(struct pcm *pcm, unsigned int offset __unused, unsigned int frames)
+{
+    if (!pcm_is_ready(pcm))
+        return -EBADFD;
+    if (is_capture(pcm)) {
+        pcm->appl_ptr += frames;
+        return frames;
+    }
+    stats.pcm_writes++;
+    pcm->appl_ptr += frames;
+    return frames;
+}
+
+int pcm_mmap_get_hw_ptr(struct pcm *pcm, unsigned int *hw_ptr, struct timespec *tstamp)
+{
+    if (!pcm_is_ready(pcm))
+        return -EBADFD;
+    pcm_sync_l(pcm, current_config().real_time);
+    *hw_ptr = (unsigned int)pcm->hw_ptr;
+    clock_gettime(CLOCK_MONOTONIC, tstamp);
+    return 0;
+}
+
+int pcm_get_htimestamp(struct pcm *pcm, unsigned int *avail, struct timespec *tstamp)
+{
+    const struct fake_alsa_config c = current_config();
+    int64_t frames;
+
+    if (!pcm_is_ready(pcm))
+        return -EBADFD;
+    stats.pcm_htimestamps++;
+    if (!pcm->running)
+        return -1;
+    pcm_sync_l(pcm, c.real_time);
+    if (is_capture(pcm)) {
+        frames = (int64_t)(pcm->hw_ptr - pcm->appl_ptr);
+    } else {
+        // frames held by the DSP after the ring count as still queued
+        frames = (int64_t)playback_avail_l(pcm) - c.pcm_latency_frames;
+        if (frames < 0)
+            frames = 0;
+    }
+    *avail = (unsigned int)frames;
+    clock_gettime(CLOCK_MONOTONIC, tstamp);
+    return 0;
+}
+
+int pcm_ioctl(struct pcm *pcm __unused, int code __unused, ...)
+{
+    return -ENOTTY;
+}
+
+struct pcm_params {
+    unsigned int card;
+    unsigned int device;
+    unsigned int flags;
+};
+
+struct pcm_params *pcm_params_get(unsigned int card, unsigned int device, unsigned int flags)
+{
+    struct pcm_params *params;
+
+    if (card != FAKE_CARD)
+        return NULL;
+    params = calloc(1, sizeof(*params));
+    if (params != NULL) {
+        params->card = card;
+        params->device = device;
+        params->flags = flags;
+    }
+    return params;
+}
+
+void pcm_params_free(struct pcm_params *pcm_params)
+{
+    free(pcm_params);
+}
+
+unsigned int pcm_params_get_min(struct pcm_params *pcm_params __unused, enum pcm_param param)
+{
+    switch (param) {
+    case PCM_PARAM_CHANNELS: return 1;
+    case PCM_PARAM_RATE: return 8000;
+    case PCM_PARAM_PERIOD_SIZE: return 16;
+    case PCM_PARAM_PERIODS: return 2;
+    default: return 0;
+    }
+}
+
+unsigned int pcm_params_get_max(struct pcm_params *pcm_params __unused, enum pcm_param param)
+{
+    switch (param) {
+    case PCM_PARAM_CHANNELS: return 8;
+    case PCM_PARAM_RATE: return 192000;
+    case PCM_PARAM_PERIOD_SIZE: return 8192;
+    case PCM_PARAM_PERIODS: return 8;
+    default: return 0;
+    }
+}
+
+int pcm_params_to_string(struct pcm_params *params, char *string, unsigned int size)
+{
+    if (params == NULL || string == NULL)
+        return -EINVAL;
+    return snprintf(string, size, "fake card %u device %u: channels 1-8, rate 8000-192000",
+                    params->card, params->device);
+}
+
+/* ------------------------------------------------------------- compress */
+
+struct compress {
+    struct compr_config config;
+    uint32_t sample_rate;
+    uint32_t bytes_per_second;
+    uint64_t buffer_bytes;
+    uint64_t written;                /* bytes accepted */
+    uint64_t consumed_base;          /* bytes consumed before start_ns */
+    int64_t start_ns;
+    bool running;
+    bool paused;
+    bool nonblock;
+    char error[64];
+};
+
+static struct compress bad_compress = {
+    .error = "fake compress: device not ready",
+};
+
+static uint64_t compress_consumed_l(struct compress *compress, bool real_time)
+{
+    uint64_t consumed;
+
+    if (!compress->running || compress->paused)
+        return compress->consumed_base;
+    if (!real_time)
+        return compress->written;
+    consumed = compress->consumed_base + (uint64_t)((now_ns() - compress->start_ns) *
+            (int64_t)compress->bytes_per_second / 1000000000LL);
+    return consumed < compress->written ? consumed : compress->written;
+}
+
+struct compress *compress_open(unsigned int card, unsigned int device __unused,
+                               unsigned int flags __unused, struct compr_config *compr_config)
+{
+    struct compress *compress;
+    uint32_t bit_rate = FAKE_COMPRESS_DEFAULT_BIT_RATE;
+
+    if (card != FAKE_CARD || compr_config == NULL)
+        return &bad_compress;
+    sleep_ns(current_config().pcm_open_ns);
+    compress = calloc(1, sizeof(*compress));
+    if (compress == NULL)
+        return &bad_compress;
+    compress->config = *compr_config;
+    if (compr_config->codec != NULL) {
+        compress->sample_rate = compr_config->codec->sample_rate;
+        if (compr_config->codec->bit_rate != 0)
+            bit_rate = compr_config->codec->bit_rate;
+    }
+    if (compress->sample_rate == 0)
+        compress->sample_rate = 44100;
+    compress->bytes_per_second = bit_rate / 8;
+    compress->buffer_bytes = (uint64_t)compr_config->fragment_size * compr_config->fragments;
+    return compress;
+}
+
+void compress_close(struct compress *compress)
+{
+    if (compress != &bad_compress)
+        free(compress);
+}
+
+bool is_compress_ready(struct compress *compress)
+{
+    return compress != NULL && compress != &bad_compress;
+}
+
+bool is_compress_running(struct compress *compress)
+{
+    return is_compress_ready(compress) && compress->running;
+}
+
+const char *compress_get_error(struct compress *compress)
+{
+    return compress != NULL ? compress->error : "fake compress: no stream";
+}
+
+void compress_nonblock(struct compress *compress, int nonblock)
+{
+    compress->nonblock = nonblock != 0;
+}
+
+int compress_get_hpointer(struct compress *compress, unsigned int *avail,
+                          struct timespec *tstamp)
+{
+    uint64_t consumed = compress_consumed_l(compress, current_config().real_time);
+
+    *avail = (unsigned int)(compress->buffer_bytes - (compress->written - consumed));
+    clock_gettime(CLOCK_MONOTONIC, tstamp);
+    return 0;
+}
+
+int compress_get_tstamp(struct compress *compress, unsigned long *samples,
+                        unsigned int *sampling_rate)
+{
+    uint64_t consumed = compress_consumed_l(compress, current_config().real_time);
+
+    *samples = (unsigned long)(consumed * compress->sample_rate /
+            (compress->bytes_per_second ? compress->bytes_per_second : 1));
+    *sampling_rate = compress->sample_rate;
+    return 0;
+}
+
+int compress_write(struct compress *compress, const void *buf __unused, unsigned int size)
+{
+    const struct fake_alsa_config c = current_config();
+    unsigned int total = 0;
+
+    sleep_ns(c.pcm_io_ns);
+    stats.compress_writes++;
+    while (total < size) {
+        uint64_t consumed = compress_consumed_l(compress, c.real_time);
+        uint64_t avail = compress->buffer_bytes - (compress->written - consumed);
+        unsigned int chunk;
+
+        if (avail == 0) {
+            if (compress->nonblock || !compress->running)
+                break;
+            sleep_ns((int64_t)compress->config.fragment_size * 1000000000LL /
+                    (compress->bytes_per_second ? compress->bytes_per_second : 1));
+            continue;
+        }
+        chunk = size - total < avail ? size - total : (unsigned int)avail;
+        compress->written += chunk;
+        total += chunk;
+    }
+    return total;
+}
+
+int compress_read(struct compress *compress __unused, void *buf __unused,
+                  unsigned int size __unused)
+{
+    return -ENOSYS;
+}
+
+int compress_start(struct compress *compress)
+{
+    if (!compress->running) {
+        compress->running = true;
+        compress->paused = false;
+        compress->start_ns = now_ns();
+    }
+    return 0;
+}
+
+int compress_stop(struct compress *compress)
+{
+    compress->running = false;
+    compress->paused = false;
+    compress->written = 0;
+    compress->consumed_base = 0;
+    return 0;
+}
+
+int compress_pause(struct compress *compress)
+{
+    if (compress->running && !compress->paused) {
+        compress->consumed_base = compress_consumed_l(compress, current_config().real_time);
+        compress->paused = true;
+    }
+    return 0;
+}
+
+int compress_resume(struct compress *compress)
+{
+    if (compress->paused) {
+        compress->paused = false;
+        compress->start_ns = now_ns();
+    }
+    return 0;
+}
+
+static int compress_wait_drained(struct compress *compress)
+{
+    const bool real_time = current_config().real_time;
+
+    while (compress->running && !compress->paused &&
+            compress_consumed_l(compress, real_time) < compress->written) {
+        sleep_ns(1000000);
+    }
+    return 0;
+}
+
+int compress_drain(struct compress *compress)
+{
+    return compress_wait_drained(compress);
+}
+
+int compress_partial_drain(struct compress *compress)
+{
+    return compress_wait_drained(compress);
+}
+
+int compress_next_track(struct compress *compress __unused)
+{
+    return 0;
+}
+
+int compress_set_gapless_metadata(struct compress *compress __unused,
+                                  struct compr_gapless_mdata *mdata __unused)
+{
+    return 0;
+}
+
+int compress_wait(struct compress *compress, int timeout_ms)
+{
+    const bool real_time = current_config().real_time;
+    int64_t deadline = now_ns() + (int64_t)timeout_ms * 1000000LL;
+
+    while (compress->running && !compress->paused &&
+            compress->written - compress_consumed_l(compress, real_time) >=
+                    compress->buffer_bytes) {
+        if (timeout_ms >= 0 && now_ns() >= deadline)
+            return -ETIMEDOUT;
+        sleep_ns(1000000);
+    }
+    return 0;
+}
+
+/* ---------------------------------------------------------- audio_route */
+
+#define ROUTE_VALUE_MAX 64
+
+struct route_ctl {
+    struct mixer_ctl *ctl;
+    char reset_value[ROUTE_VALUE_MAX];
+    char value[ROUTE_VALUE_MAX];     /* as last written to the mixer */
+    char pending[ROUTE_VALUE_MAX];
+};
+
+struct route_setting {
+    unsigned int ctl_index;
+    char value[ROUTE_VALUE_MAX];
+};
+
+struct route_path {
+    char *name;
+    struct route_setting *settings;
+    unsigned int num_settings;
+};
+
+struct audio_route {
+    struct mixer *mixer;
+    pthread_mutex_t lock;
+    struct route_ctl *ctls;
+    unsigned int num_ctls;
+    struct route_path *paths;
+    unsigned int num_paths;
+    /* parser state */
+    struct route_path *cur_path;
+    int path_depth;
+    bool failed;
+};
+
+static int route_find_ctl(struct audio_route *ar, const char *name, bool create)
+{
+    struct mixer_ctl *ctl = mixer_get_ctl_by_name(ar->mixer, name);
+    struct route_ctl *ctls;
+
+    if (ctl == NULL)
+        return -1;
+    pthread_mutex_lock(&ctl_lock);
+    ctl->routed = true;
+    pthread_mutex_unlock(&ctl_lock);
+
+    for (unsigned int i = 0; i < ar->num_ctls; i++) {
+        if (ar->ctls[i].ctl == ctl)
+            return i;
+    }
+    if (!create)
+        return -1;
+    ctls = realloc(ar->ctls, (ar->num_ctls + 1) * sizeof(*ctls));
+    if (ctls == NULL)
+        return -1;
+    ar->ctls = ctls;
+    memset(&ar->ctls[ar->num_ctls], 0, sizeof(ar->ctls[0]));
+    ar->ctls[ar->num_ctls].ctl = ctl;
+    strlcpy(ar->ctls[ar->num_ctls].reset_value, "0", ROUTE_VALUE_MAX);
+    strlcpy(ar->ctls[ar->num_ctls].value, "0", ROUTE_VALUE_MAX);
+    strlcpy(ar->ctls[ar->num_ctls].pending, "0", ROUTE_VALUE_MAX);
+    return ar->num_ctls++;
+}
+
+static struct route_path *route_find_path(struct audio_route *ar, const char *name)
+{
+    for (unsigned int i = 0; i < ar->num_paths; i++) {
+        if (strcmp(ar->paths[i].name, name) == 0)
+            return &ar->paths[i];
+    }
+    return NULL;
+}
+
+static int route_path_add_setting(struct route_path *path, unsigned int ctl_index,
+                                  const char *value)
+{
+    struct route_setting *settings;
+
+    for (unsigned int i = 0; i < path->num_settings; i++) {
+        if (path->settings[i].ctl_index == ctl_index) {
+            strlcpy(path->settings[i].value, value, ROUTE_VALUE_MAX);
+            return 0;
+        }
+    }
+    settings = realloc(path->settings, (path->num_settings + 1) * sizeof(*settings));
+    if (settings == NULL)
+        return -ENOMEM;
+    path->settings = settings;
+    path->settings[path->num_settings].ctl_index = ctl_index;
+    strlcpy(path->settings[path->num_settings].value, value, ROUTE_VALUE_MAX);
+    path->num_settings++;
+    return 0;
+}
+
+static const char *route_attr(const XML_Char **attr, const char *name)
+{
+    for (int i = 0; attr[i] != NULL; i += 2) {
+        if (strcmp(attr[i], name) == 0)
+            return attr[i + 1];
+    }
+    return NULL;
+}
+
+static void route_start_tag(void *data, const XML_Char *tag, const XML_Char **attr)
+{
+    struct audio_route *ar = data;
+    const char *name = route_attr(attr, "name");
+
+    if (ar->failed)
+        return;
+
+    if (strcmp(tag, "path") == 0) {
+        if (name == NULL) {
+            ar->failed = true;
+            return;
+        }
+        if (ar->path_depth++ == 0) {
+            struct route_path *paths;
+
+            if (route_find_path(ar, name) != NULL) {
+                ALOGE("%s: duplicate path %s", __func__, name);
+                ar->failed = true;
+                return;
+            }
+            paths = realloc(ar->paths, (ar->num_paths + 1) * sizeof(*paths));
+            if (paths == NULL) {
+                ar->failed = true;
+                return;
+            }
+            ar->paths = paths;
+            memset(&ar->paths[ar->num_paths], 0, sizeof(ar->paths[0]));
+            ar->paths[ar->num_paths].name = strdup(name);
+            ar->cur_path = &ar->paths[ar->num_paths++];
+        } else {
+            // a nested path includes the settings of an earlier one
+            struct route_path *sub_path = route_find_path(ar, name);
+
+            if (sub_path == NULL || sub_path == ar->cur_path) {
+                ALOGE("%s: unknown path %s", __func__, name);
+                ar->failed = true;
+                return;
+            }
+            for (unsigned int i = 0; i < sub_path->num_settings; i++) {
+                route_path_add_setting(ar->cur_path, sub_path->settings[i].ctl_index,
+                                       sub_path->settings[i].value);
+            }
+        }
+    } else if (strcmp(tag, "ctl") == 0) {
+        const char *value = route_attr(attr, "value");
+        int index;
+
+        if (name == NULL || value == NULL) {
+            ar->failed = true;
+            return;
+        }
+        index = route_find_ctl(ar, name, true);
+        if (index < 0) {
+            ar->failed = true;
+            return;
+        }
+        if (ar->path_depth == 0) {
+            strlcpy(ar->ctls[index].reset_value, value, ROUTE_VALUE_MAX);
+            strlcpy(ar->ctls[index].pending, value, ROUTE_VALUE_MAX);
+        } else {
+            route_path_add_setting(ar->cur_path, index, value);
+        }
+    }
+}
+
+static void route_end_tag(void *data, const XML_Char *tag)
+{
+    struct audio_route *ar = data;
+
+    if (strcmp(tag, "path") == 0 && --ar->path_depth == 0)
+        ar->cur_path = NULL;
+}
+
+static int route_parse(struct audio_route *ar, const char *xml_path)
+{
+    XML_Parser parser;
+    FILE *file;
+    char buf[1024];
+    size_t bytes;
+    int ret = 0;
+
+    file = fopen(xml_path, "r");
+    if (file == NULL) {
+        ALOGE("%s: cannot open %s", __func__, xml_path);
+        return -ENOENT;
+    }
+    parser = XML_ParserCreate(NULL);
+    if (parser == NULL) {
+        fclose(file);
+        return -ENOMEM;
+    }
+    XML_SetUserData(parser, ar);
+    XML_SetElementHandler(parser, route_start_tag, route_end_tag);
+    do {
+        bytes = fread(buf, 1, sizeof(buf), file);
+        if (XML_Parse(parser, buf, bytes, bytes == 0) == XML_STATUS_ERROR) {
+            ALOGE("%s: parse error in %s at line %lu", __func__, xml_path,
+                  (unsigned long)XML_GetCurrentLineNumber(parser));
+            ret = -EINVAL;
+            break;
+        }
+    } while (bytes != 0);
+    XML_ParserFree(parser);
+    fclose(file);
+    if (ret == 0 && ar->failed)
+        ret = -EINVAL;
+    return ret;
+}
+
+static bool route_value_is_int(const char *value, long *out)
+{
+    char *end;
+
+    *out = strtol(value, &end, 0);
+    return *value != '\0' && *end == '\0';
+}
+
+static void route_write_ctl_l(struct route_ctl *rctl)
+{
+    long value;
+
+    if (strcmp(rctl->value, rctl->pending) == 0)
+        return;
+    if (route_value_is_int(rctl->pending, &value)) {
+        const unsigned int num_values = mixer_ctl_get_num_values(rctl->ctl);
+
+        for (unsigned int i = 0; i < num_values; i++)
+            mixer_ctl_set_value(rctl->ctl, i, (int)value);
+    } else {
+        mixer_ctl_set_enum_by_string(rctl->ctl, rctl->pending);
+    }
+    strlcpy(rctl->value, rctl->pending, ROUTE_VALUE_MAX);
+}
+
+struct audio_route *audio_route_init(unsigned int card, const char *xml_path)
+{
+    struct audio_route *ar = calloc(1, sizeof(*ar));
+
+    if (ar == NULL)
+        return NULL;
+    ar->mixer = mixer_open(card);
+    if (ar->mixer == NULL || xml_path == NULL || route_parse(ar, xml_path) != 0) {
+        audio_route_free(ar);
+        return NULL;
+    }
+    pthread_mutex_init(&ar->lock, NULL);
+    // the initial settings are written once, as the real library does
+    for (unsigned int i = 0; i < ar->num_ctls; i++) {
+        strlcpy(ar->ctls[i].value, "", ROUTE_VALUE_MAX);
+        route_write_ctl_l(&ar->ctls[i]);
+    }
+    return ar;
+}
+
+void audio_route_free(struct audio_route *ar)
+{
+    if (ar == NULL)
+        return;
+    for (unsigned int i = 0; i < ar->num_paths; i++) {
+        free(ar->paths[i].name);
+        free(ar->paths[i].settings);
+    }
+    free(ar->paths);
+    free(ar->ctls);
+    mixer_close(ar->mixer);
+    free(ar);
+}
+
+static int route_set_path(struct audio_route *ar, const char *name, bool apply, bool update)
+{
+    struct route_path *path;
+
+    if (ar == NULL || name == NULL)
+        return -EINVAL;
+    pthread_mutex_lock(&ar->lock);
+    path = route_find_path(ar, name);
+    if (path == NULL) {
+        pthread_mutex_unlock(&ar->lock);
+        ALOGE("%s: unable to find path '%s'", __func__, name);
+        return -1;
+    }
+    for (unsigned int i = 0; i < path->num_settings; i++) {
+        struct route_ctl *rctl = &ar->ctls[path->settings[i].ctl_index];
+
+        strlcpy(rctl->pending, apply ? path->settings[i].value : rctl->reset_value,
+                ROUTE_VALUE_MAX);
+        if (update)
+            route_write_ctl_l(rctl);
+    }
+    if (update)
+        stats.route_updates++;
+    pthread_mutex_unlock(&ar->lock);
+    return 0;
+}
+
+int audio_route_apply_path(struct audio_route *ar, const char *name)
+{
+    return route_set_path(ar, name, true, false);
+}
+
+int audio_route_reset_path(struct audio_route *ar, const char *name)
+{
+    return route_set_path(ar, name, false, false);
+}
+
+int audio_route_apply_and_update_path(struct audio_route *ar, const char *name)
+{
+    return route_set_path(ar, name, true, true);
+}
+
+int audio_route_reset_and_update_path(struct audio_route *ar, const char *name)
+{
+    return route_set_path(ar, name, false, true);
+}
+
+int audio_route_update_mixer(struct audio_route *ar)
+{
+    if (ar == NULL)
+        return -EINVAL;
+    pthread_mutex_lock(&ar->lock);
+    for (unsigned int i = 0; i < ar->num_ctls; i++)
+        route_write_ctl_l(&ar->ctls[i]);
+    stats.route_updates++;
+    pthread_mutex_unlock(&ar->lock);
+    return 0;
+}
+
+void audio_route_reset(struct audio_route *ar)
+{
+    if (ar == NULL)
+        return;
+    pthread_mutex_lock(&ar->lock);
+    for (unsigned int i = 0; i < ar->num_ctls; i++)
+        strlcpy(ar->ctls[i].pending, ar->ctls[i].reset_value, ROUTE_VALUE_MAX);
+    pthread_mutex_unlock(&ar->lock);
+}
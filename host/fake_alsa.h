@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HOST_FAKE_ALSA_H
+#define HOST_FAKE_ALSA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * In-process fake of tinyalsa (pcm_* and mixer_*), tinycompress and
+ * libaudioroute for host builds of the HAL.
+ *
+ * PCM streams model the DMA clock of a real card: frames drain from the ring
+ * buffer at the configured rate once the stream is started, pcm_write() blocks
+ * while the ring is full and an underrun is reported when the ring drains
+ * before the next write. With real_time false the clock runs instantly so
+ * benchmarks measure only HAL overhead. An injected read error fails like
+ * tinyalsa, returning -1 with errno set to EIO and pcm_get_error() set.
+ *
+ * The mixer accepts any control name and creates the control on first use.
+ * audio_route_init() parses the mixer_paths XML it is given and writes the
+ * controls of a path through the fake mixer, so ctl_writes counts what the
+ * kernel would have seen.
+ */
+
+struct fake_alsa_config {
+    bool real_time;                 /* pace pcm and compress I/O by the stream clock */
+    int64_t pcm_open_ns;            /* cost of pcm_open() and compress_open() */
+    int64_t pcm_prepare_ns;         /* cost of pcm_prepare() and pcm_start() */
+    int64_t pcm_io_ns;              /* cost of each pcm_write() and pcm_read() */
+    int64_t pcm_latency_frames;     /* extra frames reported by pcm_get_htimestamp() */
+    int64_t ctl_write_ns;           /* cost of each mixer control write */
+    int64_t mixer_open_ns;          /* cost of mixer_open(), which reads every control */
+    unsigned int underrun_every;    /* inject an underrun every N pcm writes, 0 for none */
+    unsigned int read_error_every;  /* fail every Nth pcm_read() of a pcm, 0 for none */
+};
+
+struct fake_alsa_stats {
+    uint64_t mixer_opens;
+    uint64_t pcm_opens;
+    uint64_t pcm_writes;
+    uint64_t pcm_reads;
+    uint64_t pcm_underruns;
+    uint64_t pcm_read_errors;
+    uint64_t pcm_htimestamps;
+    uint64_t compress_writes;
+    uint64_t ctl_writes;
+    uint64_t ctl_lookups;
+    uint64_t route_updates;
+};
+
+/* Replaces the current configuration. Takes effect for the next call. */
+void fake_alsa_configure(const struct fake_alsa_config *config);
+void fake_alsa_get_config(struct fake_alsa_config *config);
+
+void fake_alsa_get_stats(struct fake_alsa_stats *stats);
+void fake_alsa_reset_stats(void);
+
+/* Fills the buffers pcm_read() and pcm_mmap_read() return. position is the
+   capture stream frame of the first frame of data. Capture reads silence
+   while no source is set. */
+typedef void (*fake_alsa_capture_source_t)(void *data, unsigned int bytes, uint64_t position,
+                                           void *cookie);
+void fake_alsa_set_capture_source(fake_alsa_capture_source_t source, void *cookie);
+
+/* Value of a mixer control as last written, or default_value if never written. */
+int fake_alsa_get_ctl_value(const char *name, int default_value);
+
+/* Forgets every mixer control, the next lookup creates it afresh. Only call
+   while no mixer or audio_route is open. */
+void fake_alsa_reset_ctls(void);
+
+/* Order independent hash of the name and value of every control set by the
+   mixer paths, to compare the routing state reached by two sequences.
+   Controls the HAL writes directly, such as stream volumes, are left out. */
+uint32_t fake_alsa_ctl_state_hash(void);
+
+/* Writes "name = value" for every mixer path control that is not zero. */
+void fake_alsa_dump_ctls(FILE *file);
+
+#endif
@@ -0,0 +1,634 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host replacements for the Android runtime pieces the HAL links against:
+ * liblog, cutils properties and str_parms, audio_utils error log, the power
+ * HAL hints of audio_perf.cpp, and a file system remap that points the
+ * /odm, /vendor, /system and /data paths the HAL hardcodes at HAL_HOST_ROOT.
+ */
+
+#define LOG_TAG "fake_android"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <audio_utils/ErrorLog.h>
+#include <cutils/properties.h>
+#include <cutils/str_parms.h>
+#include <log/log.h>
+#include <sys/system_properties.h>
+
+#include "audio_perf.h"
+
+#ifndef HAL_HOST_DEFAULT_ROOT
+#define HAL_HOST_DEFAULT_ROOT "."
+#endif
+
+#define FAKE_PROPERTY_MAX 256
+#define FAKE_PATH_MAX 512
+
+/* ---------------------------------------------------------------- liblog */
+
+static int log_threshold(void)
+{
+    static int threshold = -1;
+    const char *level;
+
+    if (threshold >= 0)
+        return threshold;
+    level = getenv("HAL_HOST_LOG");
+    switch (level != NULL ? level[0] : 'W') {
+    case 'V': case 'v': threshold = ANDROID_LOG_VERBOSE; break;
+    case 'D': case 'd': threshold = ANDROID_LOG_DEBUG; break;
+    case 'I': case 'i': threshold = ANDROID_LOG_INFO; break;
+    case 'E': case 'e': threshold = ANDROID_LOG_ERROR; break;
+    case 'S': case 's': threshold = ANDROID_LOG_SILENT; break;
+    case 'W': case 'w':
+    default: threshold = ANDROID_LOG_WARN; break;
+    }
+    return threshold;
+}
+
+int __android_log_print(int prio, const char *tag, const char *fmt, ...)
+{
+    static const char prio_chars[] = "??VDIWEFS";
+    char buf[1024];
+    va_list ap;
+    size_t len;
+
+    if (prio < log_threshold())
+        return 0;
+    va_start(ap, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    // logcat drops the trailing newline some HAL messages carry
+    len = strlen(buf);
+    if (len > 0 && buf[len - 1] == '\n')
+        buf[len - 1] = '\0';
+    return fprintf(stderr, "%c %s: %s\n",
+                   prio_chars[prio < 0 || prio > ANDROID_LOG_SILENT ? 0 : prio],
+                   tag != NULL ? tag : "", buf);
+}
+
+void __android_log_assert(const char *cond, const char *tag, const char *fmt, ...)
+{
+    va_list ap;
+
+    fprintf(stderr, "F %s: ", tag != NULL ? tag : "");
+    if (cond != NULL)
+        fprintf(stderr, "assertion '%s' failed: ", cond);
+    if (fmt != NULL) {
+        va_start(ap, fmt);
+        vfprintf(stderr, fmt, ap);
+        va_end(ap);
+    }
+    fputc('\n', stderr);
+    abort();
+}
+
+/* ------------------------------------------------------------ properties */
+
+struct prop_info {
+    char name[PROPERTY_KEY_MAX * 2];
+    char value[PROP_VALUE_MAX];
+    uint32_t serial;
+};
+
+static pthread_mutex_t prop_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t prop_cond = PTHREAD_COND_INITIALIZER;
+static struct prop_info props[FAKE_PROPERTY_MAX];
+static unsigned int num_props;
+static uint32_t prop_area_serial;
+
+static struct prop_info *find_prop_l(const char *name)
+{
+    for (unsigned int i = 0; i < num_props; i++) {
+        if (strcmp(props[i].name, name) == 0)
+            return &props[i];
+    }
+    return NULL;
+}
+
+int property_set(const char *key, const char *value)
+{
+    struct prop_info *pi;
+
+    if (key == NULL || strlen(key) >= sizeof(props[0].name) ||
+            (value != NULL && strlen(value) >= PROP_VALUE_MAX))
+        return -EINVAL;
+    pthread_mutex_lock(&prop_lock);
+    pi = find_prop_l(key);
+    if (pi == NULL) {
+        if (num_props == FAKE_PROPERTY_MAX) {
+            pthread_mutex_unlock(&prop_lock);
+            return -ENOSPC;
+        }
+        pi = &props[num_props++];
+        strlcpy(pi->name, key, sizeof(pi->name));
+    }
+    strlcpy(pi->value, value != NULL ? value : "", sizeof(pi->value));
+    pi->serial++;
+    prop_area_serial++;
+    pthread_cond_broadcast(&prop_cond);
+    pthread_mutex_unlock(&prop_lock);
+    return 0;
+}
+
+int property_get(const char *key, char *value, const char *default_value)
+{
+    struct prop_info *pi;
+    int len;
+
+    pthread_mutex_lock(&prop_lock);
+    pi = find_prop_l(key);
+    if (pi != NULL && pi->value[0] != '\0') {
+        len = strlcpy(value, pi->value, PROPERTY_VALUE_MAX);
+    } else if (default_value != NULL) {
+        len = strlcpy(value, default_value, PROPERTY_VALUE_MAX);
+    } else {
+        value[0] = '\0';
+        len = 0;
+    }
+    pthread_mutex_unlock(&prop_lock);
+    return len;
+}
+
+bool property_get_bool(const char *key, bool default_value)
+{
+    char value[PROPERTY_VALUE_MAX];
+
+    if (property_get(key, value, NULL) == 0)
+        return default_value;
+    if (!strcmp(value, "1") || !strcmp(value, "y") || !strcmp(value, "yes") ||
+            !strcmp(value, "on") || !strcmp(value, "true"))
+        return true;
+    if (!strcmp(value, "0") || !strcmp(value, "n") || !strcmp(value, "no") ||
+            !strcmp(value, "off") || !strcmp(value, "false"))
+        return false;
+    return default_value;
+}
+
+int64_t property_get_int64(const char *key, int64_t default_value)
+{
+    char value[PROPERTY_VALUE_MAX];
+    char *end;
+    long long result;
+
+    if (property_get(key, value, NULL) == 0)
+        return default_value;
+    errno = 0;
+    result = strtoll(value, &end, 0);
+    if (errno != 0 || end == value || *end != '\0')
+        return default_value;
+    return result;
+}
+
+int32_t property_get_int32(const char *key, int32_t default_value)
+{
+    int64_t value = property_get_int64(key, default_value);
+
+    return value < INT32_MIN || value > INT32_MAX ? default_value : (int32_t)value;
+}
+
+const prop_info *__system_property_find(const char *name)
+{
+    struct prop_info *pi;
+
+    pthread_mutex_lock(&prop_lock);
+    pi = find_prop_l(name);
+    pthread_mutex_unlock(&prop_lock);
+    return pi;
+}
+
+void __system_property_read_callback(const prop_info *pi,
+        void (*callback)(void *cookie, const char *name, const char *value, uint32_t serial),
+        void *cookie)
+{
+    struct prop_info copy;
+
+    pthread_mutex_lock(&prop_lock);
+    copy = *pi;
+    pthread_mutex_unlock(&prop_lock);
+    callback(cookie, copy.name, copy.value, copy.serial);
+}
+
+int __system_property_get(const char *name, char *value)
+{
+    return property_get(name, value, "");
+}
+
+uint32_t __system_property_serial(const prop_info *pi)
+{
+    uint32_t serial;
+
+    pthread_mutex_lock(&prop_lock);
+    serial = pi->serial;
+    pthread_mutex_unlock(&prop_lock);
+    return serial;
+}
+
+uint32_t __system_property_area_serial(void)
+{
+    uint32_t serial;
+
+    pthread_mutex_lock(&prop_lock);
+    serial = prop_area_serial;
+    pthread_mutex_unlock(&prop_lock);
+    return serial;
+}
+
+bool __system_property_wait(const prop_info *pi, uint32_t old_serial,
+        uint32_t *new_serial_ptr, const struct timespec *relative_timeout)
+{
+    struct timespec deadline;
+    uint32_t serial;
+    int ret = 0;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    if (relative_timeout != NULL) {
+        deadline.tv_sec += relative_timeout->tv_sec;
+        deadline.tv_nsec += relative_timeout->tv_nsec;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+    pthread_mutex_lock(&prop_lock);
+    for (;;) {
+        serial = pi != NULL ? pi->serial : prop_area_serial;
+        if (serial != old_serial || ret == ETIMEDOUT)
+            break;
+        if (relative_timeout != NULL)
+            ret = pthread_cond_timedwait(&prop_cond, &prop_lock, &deadline);
+        else
+            pthread_cond_wait(&prop_cond, &prop_lock);
+    }
+    pthread_mutex_unlock(&prop_lock);
+    if (serial == old_serial)
+        return false;
+    if (new_serial_ptr != NULL)
+        *new_serial_ptr = serial;
+    return true;
+}
+
+/* -------------------------------------------------------------- str_parms */
+
+struct str_parm {
+    struct str_parm *next;
+    char *key;
+    char *value;
+};
+
+struct str_parms {
+    struct str_parm *head;
+    struct str_parm **tail;
+};
+
+struct str_parms *str_parms_create(void)
+{
+    struct str_parms *str_parms = calloc(1, sizeof(*str_parms));
+
+    if (str_parms != NULL)
+        str_parms->tail = &str_parms->head;
+    return str_parms;
+}
+
+struct str_parms *str_parms_create_str(const char *_string)
+{
+    struct str_parms *str_parms = str_parms_create();
+    char *str, *kvpair, *saveptr = NULL;
+
+    if (str_parms == NULL)
+        return NULL;
+    str = strdup(_string != NULL ? _string : "");
+    if (str == NULL) {
+        str_parms_destroy(str_parms);
+        return NULL;
+    }
+    for (kvpair = strtok_r(str, ";", &saveptr); kvpair != NULL;
+            kvpair = strtok_r(NULL, ";", &saveptr)) {
+        char *eq = strchr(kvpair, '=');
+
+        if (eq == kvpair)
+            continue;
+        if (eq != NULL)
+            *eq++ = '\0';
+        str_parms_add_str(str_parms, kvpair, eq != NULL ? eq : "");
+    }
+    free(str);
+    return str_parms;
+}
+
+void str_parms_destroy(struct str_parms *str_parms)
+{
+    struct str_parm *parm, *next;
+
+    if (str_parms == NULL)
+        return;
+    for (parm = str_parms->head; parm != NULL; parm = next) {
+        next = parm->next;
+        free(parm->key);
+        free(parm->value);
+        free(parm);
+    }
+    free(str_parms);
+}
+
+static struct str_parm **find_parm(struct str_parms *str_parms, const char *key)
+{
+    struct str_parm **parm;
+
+    for (parm = &str_parms->head; *parm != NULL; parm = &(*parm)->next) {
+        if (strcmp((*parm)->key, key) == 0)
+            return parm;
+    }
+    return NULL;
+}
+
+void str_parms_del(struct str_parms *str_parms, const char *key)
+{
+    struct str_parm **link = find_parm(str_parms, key);
+    struct str_parm *parm;
+
+    if (link == NULL)
+        return;
+    parm = *link;
+    *link = parm->next;
+    if (str_parms->tail == &parm->next)
+        str_parms->tail = link;
+    free(parm->key);
+    free(parm->value);
+    free(parm);
+}
+
+int str_parms_add_str(struct str_parms *str_parms, const char *key, const char *value)
+{
+    struct str_parm **link = find_parm(str_parms, key);
+    struct str_parm *parm;
+    char *new_value = strdup(value);
+
+    if (new_value == NULL)
+        return -ENOMEM;
+    if (link != NULL) {
+        free((*link)->value);
+        (*link)->value = new_value;
+        return 0;
+    }
+    parm = calloc(1, sizeof(*parm));
+    if (parm == NULL || (parm->key = strdup(key)) == NULL) {
+        free(parm);
+        free(new_value);
+        return -ENOMEM;
+    }
+    parm->value = new_value;
+    *str_parms->tail = parm;
+    str_parms->tail = &parm->next;
+    return 0;
+}
+
+int str_parms_add_int(struct str_parms *str_parms, const char *key, int value)
+{
+    char buf[16];
+
+    snprintf(buf, sizeof(buf), "%d", value);
+    return str_parms_add_str(str_parms, key, buf);
+}
+
+int str_parms_add_float(struct str_parms *str_parms, const char *key, float value)
+{
+    char buf[32];
+
+    snprintf(buf, sizeof(buf), "%.*f", 6, value);
+    return str_parms_add_str(str_parms, key, buf);
+}
+
+int str_parms_has_key(struct str_parms *str_parms, const char *key)
+{
+    return find_parm(str_parms, key) != NULL;
+}
+
+int str_parms_get_str(struct str_parms *str_parms, const char *key, char *out_val, int len)
+{
+    struct str_parm **link = find_parm(str_parms, key);
+
+    if (link == NULL)
+        return -ENOENT;
+    return strlcpy(out_val, (*link)->value, len);
+}
+
+int str_parms_get_int(struct str_parms *str_parms, const char *key, int *out_val)
+{
+    struct str_parm **link = find_parm(str_parms, key);
+    char *end;
+
+    if (link == NULL)
+        return -ENOENT;
+    *out_val = (int)strtol((*link)->value, &end, 0);
+    if (*(*link)->value == '\0' || *end != '\0')
+        return -EINVAL;
+    return 0;
+}
+
+int str_parms_get_float(struct str_parms *str_parms, const char *key, float *out_val)
+{
+    struct str_parm **link = find_parm(str_parms, key);
+    char *end;
+
+    if (link == NULL)
+        return -ENOENT;
+    *out_val = strtof((*link)->value, &end);
+    if (*(*link)->value == '\0' || *end != '\0')
+        return -EINVAL;
+    return 0;
+}
+
+char *str_parms_to_str(struct str_parms *str_parms)
+{
+    struct str_parm *parm;
+    size_t size = 1;
+    char *str;
+
+    for (parm = str_parms->head; parm != NULL; parm = parm->next)
+        size += strlen(parm->key) + strlen(parm->value) + 2;
+    str = calloc(1, size);
+    if (str == NULL)
+        return NULL;
+    for (parm = str_parms->head; parm != NULL; parm = parm->next) {
+        if (parm != str_parms->head)
+            strlcat(str, ";", size);
+        strlcat(str, parm->key, size);
+        strlcat(str, "=", size);
+        strlcat(str, parm->value, size);
+    }
+    return str;
+}
+
+void str_parms_dump(struct str_parms *str_parms)
+{
+    for (struct str_parm *parm = str_parms->head; parm != NULL; parm = parm->next)
+        ALOGI("key: '%s' value: '%s'", parm->key, parm->value);
+}
+
+/* ------------------------------------------------------------- error log */
+
+struct error_log_t {
+    pthread_mutex_t lock;
+    uint64_t count;
+    int32_t last_code;
+    int64_t last_ns;
+};
+
+error_log_t *error_log_create(size_t entries __unused, int64_t aggregate_ns __unused)
+{
+    error_log_t *error_log = calloc(1, sizeof(*error_log));
+
+    if (error_log != NULL)
+        pthread_mutex_init(&error_log->lock, NULL);
+    return error_log;
+}
+
+void error_log_log(error_log_t *error_log, int32_t code, int64_t now_ns)
+{
+    if (error_log == NULL)
+        return;
+    pthread_mutex_lock(&error_log->lock);
+    error_log->count++;
+    error_log->last_code = code;
+    error_log->last_ns = now_ns;
+    pthread_mutex_unlock(&error_log->lock);
+}
+
+int error_log_dump(error_log_t *error_log, int fd, const char *prefix,
+                   size_t lines __unused, int64_t limit_ns __unused)
+{
+    if (error_log == NULL)
+        return -EINVAL;
+    pthread_mutex_lock(&error_log->lock);
+    dprintf(fd, "%sErrors: %llu, last code %d\n", prefix != NULL ? prefix : "",
+            (unsigned long long)error_log->count, error_log->last_code);
+    pthread_mutex_unlock(&error_log->lock);
+    return 0;
+}
+
+void error_log_destroy(error_log_t *error_log)
+{
+    if (error_log == NULL)
+        return;
+    pthread_mutex_destroy(&error_log->lock);
+    free(error_log);
+}
+
+/* ------------------------------------------------------------ audio_perf */
+
+bool audio_streaming_hint_start()
+{
+    return true;
+}
+
+bool audio_streaming_hint_end()
+{
+    return true;
+}
+
+bool audio_low_latency_hint_start()
+{
+    return true;
+}
+
+bool audio_low_latency_hint_end()
+{
+    return true;
+}
+
+/* ------------------------------------------------------------ file system */
+
+/*
+ * The link wraps access(), fopen(), open(), rename() and unlink() (see
+ * host/Makefile), so config lookups under /odm/etc, /vendor/etc and
+ * /system/etc and snapshot writes under /data land inside the staged root.
+ */
+static const char *remap_path(const char *path, char *buf, size_t size)
+{
+    static const char *const prefixes[] = { "/odm/", "/vendor/", "/system/", "/data/" };
+    const char *root;
+
+    if (path == NULL)
+        return NULL;
+    for (size_t i = 0; i < sizeof(prefixes) / sizeof(prefixes[0]); i++) {
+        if (strncmp(path, prefixes[i], strlen(prefixes[i])) == 0) {
+            root = getenv("HAL_HOST_ROOT");
+            snprintf(buf, size, "%s%s", root != NULL ? root : HAL_HOST_DEFAULT_ROOT, path);
+            return buf;
+        }
+    }
+    return path;
+}
+
+int __real_access(const char *path, int mode);
+FILE *__real_fopen(const char *path, const char *mode);
+int __real_open(const char *path, int flags, ...);
+int __real_rename(const char *oldpath, const char *newpath);
+int __real_unlink(const char *path);
+
+int __wrap_access(const char *path, int mode)
+{
+    char buf[FAKE_PATH_MAX];
+
+    return __real_access(remap_path(path, buf, sizeof(buf)), mode);
+}
+
+FILE *__wrap_fopen(const char *path, const char *mode)
+{
+    char buf[FAKE_PATH_MAX];
+
+    return __real_fopen(remap_path(path, buf, sizeof(buf)), mode);
+}
+
+int __wrap_open(const char *path, int flags, ...)
+{
+    char buf[FAKE_PATH_MAX];
+    mode_t mode = 0;
+    va_list ap;
+
+    if (flags & O_CREAT) {
+        va_start(ap, flags);
+        mode = va_arg(ap, mode_t);
+        va_end(ap);
+    }
+    return __real_open(remap_path(path, buf, sizeof(buf)), flags, mode);
+}
+
+int __wrap_rename(const char *oldpath, const char *newpath)
+{
+    char oldbuf[FAKE_PATH_MAX], newbuf[FAKE_PATH_MAX];
+
+    return __real_rename(remap_path(oldpath, oldbuf, sizeof(oldbuf)),
+                         remap_path(newpath, newbuf, sizeof(newbuf)));
+}
+
+int __wrap_unlink(const char *path)
+{
+    char buf[FAKE_PATH_MAX];
+
+    return __real_unlink(remap_path(path, buf, sizeof(buf)));
+}
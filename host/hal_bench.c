@@ -0,0 +1,465 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Drives the HAL through its public entry points (module open, adev_open,
+ * open_output_stream, write, get_presentation_position, standby, routing,
+ * open_input_stream, read and close) on the fake ALSA backends and prints one
+ * latency histogram per call, in the format of the HAL's own dumpsys
+ * histograms, and the exact percentiles of the time the caller spent in
+ * out_write.
+ */
+
+#define LOG_TAG "hal_bench"
+
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <cutils/properties.h>
+#include <hardware/audio.h>
+#include <hardware/hardware.h>
+#include <log/log.h>
+
+#include "audio_extn/latency_histogram.h"
+#include "fake_alsa.h"
+
+extern struct audio_module HAL_MODULE_INFO_SYM;
+
+enum {
+    HIST_ADEV_OPEN,
+    HIST_OPEN_OUTPUT,
+    HIST_WRITE_FIRST,
+    HIST_WRITE,
+    HIST_PRESENTATION_POSITION,
+    HIST_ROUTE,
+    HIST_STANDBY,
+    HIST_DRAIN,
+    HIST_CLOSE_OUTPUT,
+    HIST_OPEN_INPUT,
+    HIST_READ_FIRST,
+    HIST_READ,
+    HIST_CAPTURE_POSITION,
+    HIST_IN_STANDBY,
+    HIST_CLOSE_INPUT,
+    HIST_ADEV_CLOSE,
+    HIST_MAX,
+};
+
+static const char *const hist_names[HIST_MAX] = {
+    [HIST_ADEV_OPEN] = "adev_open",
+    [HIST_OPEN_OUTPUT] = "open_output_stream",
+    [HIST_WRITE_FIRST] = "out_write_first",
+    [HIST_WRITE] = "out_write",
+    [HIST_PRESENTATION_POSITION] = "out_get_presentation_position",
+    [HIST_ROUTE] = "out_set_parameters_routing",
+    [HIST_STANDBY] = "out_standby",
+    [HIST_DRAIN] = "out_drain",
+    [HIST_CLOSE_OUTPUT] = "close_output_stream",
+    [HIST_OPEN_INPUT] = "open_input_stream",
+    [HIST_READ_FIRST] = "in_read_first",
+    [HIST_READ] = "in_read",
+    [HIST_CAPTURE_POSITION] = "in_get_capture_position",
+    [HIST_IN_STANDBY] = "in_standby",
+    [HIST_CLOSE_INPUT] = "close_input_stream",
+    [HIST_ADEV_CLOSE] = "adev_close",
+};
+
+static struct latency_histogram hists[HIST_MAX];
+
+/* every steady state out_write, for the percentiles */
+static int64_t *write_ns;
+static size_t num_writes, max_writes;
+
+/* presentation positions lower than the previous one of the same play session */
+static unsigned long position_regressions;
+
+struct bench_options {
+    unsigned int cycles;             /* open ... close cycles */
+    unsigned int writes;             /* writes per cycle */
+    unsigned int standbys;           /* standby and restart per cycle */
+    bool low_latency;
+    bool offload;                    /* compress offload instead of pcm */
+    unsigned int offload_bit_rate;
+    bool capture;                    /* also run a capture stream every cycle */
+    bool reopen_device;              /* adev_open/adev_close every cycle */
+    bool paced;                      /* one write per buffer duration, as the mixer thread */
+};
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Offload streams are non blocking, as AudioFlinger opens them: a short
+   write is retried once the HAL reports STREAM_CBK_EVENT_WRITE_READY. */
+struct offload_events {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool write_ready;
+    bool drain_ready;
+};
+
+static int offload_callback(stream_callback_event_t event, void *param __unused, void *cookie)
+{
+    struct offload_events *events = cookie;
+
+    pthread_mutex_lock(&events->lock);
+    if (event == STREAM_CBK_EVENT_WRITE_READY)
+        events->write_ready = true;
+    else if (event == STREAM_CBK_EVENT_DRAIN_READY)
+        events->drain_ready = true;
+    pthread_cond_signal(&events->cond);
+    pthread_mutex_unlock(&events->lock);
+    return 0;
+}
+
+static bool offload_wait(struct offload_events *events, bool *ready, time_t timeout_s)
+{
+    struct timespec deadline;
+    int ret = 0;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_s;
+    pthread_mutex_lock(&events->lock);
+    while (!*ready && ret == 0)
+        ret = pthread_cond_timedwait(&events->cond, &events->lock, &deadline);
+    *ready = false;
+    pthread_mutex_unlock(&events->lock);
+    return ret == 0;
+}
+
+#define TIMED(hist, call) ({ \
+        const int64_t start_ns__ = now_ns(); \
+        __typeof__(call) ret__ = (call); \
+        latency_histogram_log_ns(&hists[hist], now_ns() - start_ns__); \
+        ret__; })
+
+static int open_device(struct audio_hw_device **adev)
+{
+    struct hw_device_t *device = NULL;
+    const struct hw_module_t *module = &HAL_MODULE_INFO_SYM.common;
+    int ret;
+
+    ret = TIMED(HIST_ADEV_OPEN, module->methods->open(module, AUDIO_HARDWARE_INTERFACE,
+                                                     &device));
+    if (ret != 0) {
+        fprintf(stderr, "adev_open failed: %d\n", ret);
+        return ret;
+    }
+    *adev = (struct audio_hw_device *)device;
+    return 0;
+}
+
+static int run_output(struct audio_hw_device *adev, const struct bench_options *opts,
+                      audio_io_handle_t handle)
+{
+    static const char *const routes[] = {
+        "routing=2",        /* speaker */
+        "routing=8",        /* wired headphone */
+        "routing=10",       /* speaker and wired headphone */
+    };
+    struct audio_config config = {
+        .sample_rate = 48000,
+        .channel_mask = AUDIO_CHANNEL_OUT_STEREO,
+        .format = AUDIO_FORMAT_PCM_16_BIT,
+    };
+    struct audio_stream_out *out = NULL;
+    /* not AUDIO_OUTPUT_FLAG_PRIMARY, the HAL allows one primary output per
+       device lifetime */
+    audio_output_flags_t flags = opts->low_latency ?
+            AUDIO_OUTPUT_FLAG_NONE : AUDIO_OUTPUT_FLAG_DEEP_BUFFER;
+    struct offload_events events = {
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+        .cond = PTHREAD_COND_INITIALIZER,
+    };
+    size_t buffer_size;
+    void *buffer = NULL;
+    int ret;
+
+    if (opts->offload) {
+        flags = AUDIO_OUTPUT_FLAG_DIRECT | AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD |
+                AUDIO_OUTPUT_FLAG_NON_BLOCKING;
+        config.offload_info = AUDIO_INFO_INITIALIZER;
+        config.offload_info.format = AUDIO_FORMAT_MP3;
+        config.offload_info.sample_rate = config.sample_rate;
+        config.offload_info.channel_mask = config.channel_mask;
+        config.offload_info.bit_rate = opts->offload_bit_rate;
+        config.format = AUDIO_FORMAT_MP3;
+    }
+
+    ret = TIMED(HIST_OPEN_OUTPUT, adev->open_output_stream(adev, handle,
+            AUDIO_DEVICE_OUT_SPEAKER, flags, &config, &out, "bench"));
+    if (ret != 0) {
+        fprintf(stderr, "open_output_stream failed: %d\n", ret);
+        return ret;
+    }
+    if (opts->offload)
+        out->set_callback(out, offload_callback, &events);
+    buffer_size = out->common.get_buffer_size(&out->common);
+    buffer = calloc(1, buffer_size);
+    if (buffer == NULL) {
+        ret = -ENOMEM;
+        goto exit;
+    }
+
+    for (unsigned int s = 0; s <= opts->standbys; s++) {
+        unsigned int writes = opts->writes / (opts->standbys + 1);
+        const int64_t buffer_ns = (int64_t)(buffer_size / audio_stream_out_frame_size(out)) *
+                                  1000000000LL / config.sample_rate;
+        struct timespec deadline;
+        uint64_t last_frames = 0;
+
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        for (unsigned int i = 0; i < writes; i++) {
+            uint64_t frames;
+            struct timespec timestamp;
+            ssize_t written;
+            int64_t start_ns;
+
+            if (opts->paced && i > 0) {
+                deadline.tv_nsec += buffer_ns;
+                deadline.tv_sec += deadline.tv_nsec / 1000000000LL;
+                deadline.tv_nsec %= 1000000000LL;
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+            }
+            start_ns = now_ns();
+            written = out->write(out, buffer, buffer_size);
+            latency_histogram_log_ns(&hists[i == 0 ? HIST_WRITE_FIRST : HIST_WRITE],
+                                     now_ns() - start_ns);
+            if (i > 0 && num_writes < max_writes)
+                write_ns[num_writes++] = now_ns() - start_ns;
+            if (written < 0) {
+                fprintf(stderr, "write failed: %zd\n", written);
+                ret = (int)written;
+                goto exit;
+            }
+            if (opts->offload && (size_t)written < buffer_size &&
+                    !offload_wait(&events, &events.write_ready, 5)) {
+                fprintf(stderr, "no write ready event\n");
+                ret = -ETIMEDOUT;
+                goto exit;
+            }
+            if (TIMED(HIST_PRESENTATION_POSITION,
+                      out->get_presentation_position(out, &frames, &timestamp)) == 0) {
+                if (frames < last_frames) {
+                    fprintf(stderr, "write %u: position %llu after %llu\n", i,
+                            (unsigned long long)frames, (unsigned long long)last_frames);
+                    position_regressions++;
+                }
+                last_frames = frames;
+            }
+            if (i == writes / 2) {
+                TIMED(HIST_ROUTE, out->common.set_parameters(&out->common,
+                        routes[(s + handle) % (sizeof(routes) / sizeof(routes[0]))]));
+            }
+        }
+        if (opts->offload) {
+            TIMED(HIST_DRAIN, out->drain(out, AUDIO_DRAIN_ALL));
+            /* with -t the whole DSP buffer plays out first */
+            const time_t drain_s = 5 + (time_t)(out->common.get_buffer_size(&out->common) *
+                    8 * 4 / opts->offload_bit_rate);
+
+            if (!offload_wait(&events, &events.drain_ready, drain_s)) {
+                fprintf(stderr, "no drain ready event\n");
+                ret = -ETIMEDOUT;
+                goto exit;
+            }
+        }
+        TIMED(HIST_STANDBY, out->common.standby(&out->common));
+    }
+
+exit:
+    free(buffer);
+    TIMED(HIST_CLOSE_OUTPUT, (adev->close_output_stream(adev, out), 0));
+    return ret;
+}
+
+static int run_input(struct audio_hw_device *adev, const struct bench_options *opts,
+                     audio_io_handle_t handle)
+{
+    struct audio_config config = {
+        .sample_rate = 48000,
+        .channel_mask = AUDIO_CHANNEL_IN_MONO,
+        .format = AUDIO_FORMAT_PCM_16_BIT,
+    };
+    struct audio_stream_in *in = NULL;
+    size_t buffer_size;
+    void *buffer = NULL;
+    int ret;
+
+    ret = TIMED(HIST_OPEN_INPUT, adev->open_input_stream(adev, handle,
+            AUDIO_DEVICE_IN_BUILTIN_MIC, &config, &in, AUDIO_INPUT_FLAG_NONE, "",
+            AUDIO_SOURCE_MIC));
+    if (ret != 0) {
+        fprintf(stderr, "open_input_stream failed: %d\n", ret);
+        return ret;
+    }
+    buffer_size = in->common.get_buffer_size(&in->common);
+    buffer = calloc(1, buffer_size);
+    if (buffer == NULL) {
+        ret = -ENOMEM;
+        goto exit;
+    }
+
+    for (unsigned int s = 0; s <= opts->standbys; s++) {
+        unsigned int reads = opts->writes / (opts->standbys + 1);
+
+        for (unsigned int i = 0; i < reads; i++) {
+            int64_t frames, time;
+            ssize_t bytes;
+
+            bytes = TIMED(i == 0 ? HIST_READ_FIRST : HIST_READ,
+                          in->read(in, buffer, buffer_size));
+            if (bytes < 0) {
+                fprintf(stderr, "read failed: %zd\n", bytes);
+                ret = (int)bytes;
+                goto exit;
+            }
+            TIMED(HIST_CAPTURE_POSITION, in->get_capture_position(in, &frames, &time));
+        }
+        TIMED(HIST_IN_STANDBY, in->common.standby(&in->common));
+    }
+
+exit:
+    free(buffer);
+    TIMED(HIST_CLOSE_INPUT, (adev->close_input_stream(adev, in), 0));
+    return ret;
+}
+
+static int compare_ns(const void *a, const void *b)
+{
+    const int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static void print_write_percentiles(void)
+{
+    if (num_writes == 0)
+        return;
+    qsort(write_ns, num_writes, sizeof(write_ns[0]), compare_ns);
+    printf("out_write n=%zu p50_us=%.1f p90_us=%.1f p99_us=%.1f max_us=%.1f\n", num_writes,
+           write_ns[num_writes / 2] / 1000.0, write_ns[num_writes * 9 / 10] / 1000.0,
+           write_ns[num_writes * 99 / 100] / 1000.0, write_ns[num_writes - 1] / 1000.0);
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -c <n>   open/write/close cycles (default 20)\n"
+            "  -w <n>   writes per cycle (default 200)\n"
+            "  -s <n>   standby and restart per cycle (default 1)\n"
+            "  -L       low latency output instead of deep buffer\n"
+            "  -O       mp3 compress offload output instead of deep buffer\n"
+            "  -k <n>   offload bit rate in kbps (default 128)\n"
+            "  -C       also open and read a capture stream every cycle\n"
+            "  -R       adev_open/adev_close every cycle\n"
+            "  -P       pace writes to one buffer per buffer duration\n"
+            "  -A       async PCM writer thread (vendor.audio.async_pcm.enabled)\n"
+            "  -t       pace I/O in real time by the stream clock\n"
+            "  -u <n>   inject an underrun every n pcm writes\n"
+            "  -f <n>   extra frames of kernel latency in pcm_get_htimestamp\n"
+            "  -o <us>  cost of pcm_open\n"
+            "  -p <us>  cost of pcm_prepare/pcm_start\n"
+            "  -i <us>  cost of each pcm write/read\n"
+            "  -m <us>  cost of each mixer control write\n"
+            "Set HAL_HOST_LOG=V|D|I|W|E|S for HAL log output (default W).\n",
+            name);
+}
+
+int main(int argc, char **argv)
+{
+    struct bench_options opts = {
+        .cycles = 20,
+        .writes = 200,
+        .standbys = 1,
+        .offload_bit_rate = 128000,
+    };
+    struct fake_alsa_config config = { 0 };
+    struct fake_alsa_stats stats;
+    struct audio_hw_device *adev = NULL;
+    int opt, ret = 0;
+
+    while ((opt = getopt(argc, argv, "c:w:s:LOk:CRPAtu:f:o:p:i:m:h")) != -1) {
+        switch (opt) {
+        case 'c': opts.cycles = strtoul(optarg, NULL, 0); break;
+        case 'w': opts.writes = strtoul(optarg, NULL, 0); break;
+        case 's': opts.standbys = strtoul(optarg, NULL, 0); break;
+        case 'L': opts.low_latency = true; break;
+        case 'O': opts.offload = true; break;
+        case 'k': opts.offload_bit_rate = strtoul(optarg, NULL, 0) * 1000; break;
+        case 'C': opts.capture = true; break;
+        case 'R': opts.reopen_device = true; break;
+        case 'P': opts.paced = true; break;
+        case 'A': property_set("vendor.audio.async_pcm.enabled", "true"); break;
+        case 't': config.real_time = true; break;
+        case 'u': config.underrun_every = strtoul(optarg, NULL, 0); break;
+        case 'f': config.pcm_latency_frames = strtoll(optarg, NULL, 0); break;
+        case 'o': config.pcm_open_ns = strtoll(optarg, NULL, 0) * 1000; break;
+        case 'p': config.pcm_prepare_ns = strtoll(optarg, NULL, 0) * 1000; break;
+        case 'i': config.pcm_io_ns = strtoll(optarg, NULL, 0) * 1000; break;
+        case 'm': config.ctl_write_ns = strtoll(optarg, NULL, 0) * 1000; break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    fake_alsa_configure(&config);
+    max_writes = (size_t)opts.cycles * opts.writes;
+    write_ns = calloc(max_writes, sizeof(write_ns[0]));
+    if (write_ns == NULL)
+        return 1;
+
+    for (unsigned int c = 0; c < opts.cycles && ret == 0; c++) {
+        if (adev == NULL && (ret = open_device(&adev)) != 0)
+            break;
+        ret = run_output(adev, &opts, (audio_io_handle_t)(2 * c + 1));
+        if (ret == 0 && opts.capture)
+            ret = run_input(adev, &opts, (audio_io_handle_t)(2 * c + 2));
+        if (opts.reopen_device || c + 1 == opts.cycles) {
+            TIMED(HIST_ADEV_CLOSE, adev->common.close(&adev->common));
+            adev = NULL;
+        }
+    }
+
+    for (int i = 0; i < HIST_MAX; i++)
+        latency_histogram_dump(&hists[i], 1, "", hist_names[i]);
+    print_write_percentiles();
+    free(write_ns);
+    if (position_regressions != 0) {
+        fprintf(stderr, "%lu presentation positions went backwards\n", position_regressions);
+        ret = -EINVAL;
+    }
+    fake_alsa_get_stats(&stats);
+    printf("fake_alsa pcm_opens=%llu pcm_writes=%llu pcm_reads=%llu pcm_underruns=%llu "
+           "pcm_htimestamps=%llu compress_writes=%llu ctl_writes=%llu ctl_lookups=%llu "
+           "route_updates=%llu\n",
+           (unsigned long long)stats.pcm_opens, (unsigned long long)stats.pcm_writes,
+           (unsigned long long)stats.pcm_reads, (unsigned long long)stats.pcm_underruns,
+           (unsigned long long)stats.pcm_htimestamps, (unsigned long long)stats.compress_writes,
+           (unsigned long long)stats.ctl_writes, (unsigned long long)stats.ctl_lookups,
+           (unsigned long long)stats.route_updates);
+    return ret == 0 ? 0 : 1;
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host build subset of system/media/audio_utils/include/audio_utils/ErrorLog.h.
+ * The implementation is in host/fake_android.c. */
+
+#ifndef ANDROID_AUDIO_ERROR_LOG_H
+#define ANDROID_AUDIO_ERROR_LOG_H
+
+#include <stdint.h>
+#include <sys/cdefs.h>
+#include <sys/types.h>
+
+__BEGIN_DECLS
+
+typedef struct error_log_t error_log_t;
+
+error_log_t *error_log_create(size_t entries, int64_t aggregate_ns);
+void error_log_log(error_log_t *error_log, int32_t code, int64_t now_ns);
+int error_log_dump(error_log_t *error_log, int fd, const char *prefix, size_t lines,
+        int64_t limit_ns);
+void error_log_destroy(error_log_t *error_log);
+
+__END_DECLS
+
+#endif
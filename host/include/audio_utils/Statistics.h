@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host build subset of system/media/audio_utils/include/audio_utils/Statistics.h. */
+
+#ifndef ANDROID_AUDIO_UTILS_STATISTICS_H
+#define ANDROID_AUDIO_UTILS_STATISTICS_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+typedef struct {
+    int64_t n;
+    double min;
+    double max;
+    double last;
+    double mean;
+    double m2;
+} simple_stats_t;
+
+static inline void simple_stats_log(simple_stats_t *stats, double value)
+{
+    if (++stats->n == 1) {
+        stats->min = stats->max = stats->last = stats->mean = value;
+        stats->m2 = 0.;
+        return;
+    }
+    if (value < stats->min)
+        stats->min = value;
+    if (value > stats->max)
+        stats->max = value;
+    stats->last = value;
+    const double delta = value - stats->mean;
+    stats->mean += delta / stats->n;
+    stats->m2 += delta * (value - stats->mean);
+}
+
+static inline size_t simple_stats_to_string(simple_stats_t *stats, char *buffer, size_t size)
+{
+    if (size == 0)
+        return 0;
+    if (stats->n == 0)
+        return snprintf(buffer, size, "none");
+    const double stddev = stats->n > 1 ? sqrt(stats->m2 / (stats->n - 1)) : 0.;
+    return snprintf(buffer, size, "(mean: %.3f  min: %.3f  max: %.3f  last: %.3f  stddev: %.3f"
+            "  n: %lld)", stats->mean, stats->min, stats->max, stats->last, stddev,
+            (long long)stats->n);
+}
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host build subset of system/media/audio_utils/include/audio_utils/clock.h. */
+
+#ifndef ANDROID_AUDIO_CLOCK_H
+#define ANDROID_AUDIO_CLOCK_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define NANOS_PER_MICROSECOND 1000LL
+#define NANOS_PER_MILLISECOND 1000000LL
+#define NANOS_PER_SECOND 1000000000LL
+#define MICROS_PER_SECOND 1000000LL
+#define MILLIS_PER_SECOND 1000LL
+
+static inline int64_t audio_utils_ns_from_timespec(const struct timespec *ts)
+{
+    return ts->tv_sec * 1000000000LL + ts->tv_nsec;
+}
+
+static inline int64_t audio_utils_get_real_time_ns(void)
+{
+    struct timespec now_ts;
+    if (clock_gettime(CLOCK_REALTIME, &now_ts) == 0) {
+        return audio_utils_ns_from_timespec(&now_ts);
+    }
+    return 0;
+}
+
+#endif
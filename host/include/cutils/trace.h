@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host build stub of libcutils atrace. Tracing compiles out. */
+
+#ifndef _LIBS_CUTILS_TRACE_H
+#define _LIBS_CUTILS_TRACE_H
+
+#include <stdint.h>
+
+#define ATRACE_TAG_NEVER 0
+#define ATRACE_TAG_AUDIO (1 << 8)
+
+#define ATRACE_BEGIN(name) ((void)(name))
+#define ATRACE_END() ((void)0)
+#define ATRACE_INT(name, value) ((void)(name), (void)(value))
+#define ATRACE_INT64(name, value) ((void)(name), (void)(value))
+#define ATRACE_ENABLED() 0
+
+#endif
@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host build subset of hardware/libhardware/include/hardware/audio.h. */
+
+#ifndef ANDROID_AUDIO_HAL_INTERFACE_H
+#define ANDROID_AUDIO_HAL_INTERFACE_H
+
+#include <stdint.h>
+#include <strings.h>
+#include <sys/cdefs.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include <hardware/hardware.h>
+#include <system/audio.h>
+#include <hardware/audio_effect.h>
+
+__BEGIN_DECLS
+
+#define AUDIO_HARDWARE_MODULE_ID "audio"
+#define AUDIO_HARDWARE_INTERFACE "audio_hw_if"
+
+#define AUDIO_MODULE_API_VERSION_0_1 HARDWARE_MODULE_API_VERSION(0, 1)
+#define AUDIO_DEVICE_API_VERSION_2_0 HARDWARE_DEVICE_API_VERSION(2, 0)
+#define AUDIO_DEVICE_API_VERSION_3_0 HARDWARE_DEVICE_API_VERSION(3, 0)
+#define AUDIO_DEVICE_API_VERSION_CURRENT AUDIO_DEVICE_API_VERSION_3_0
+
+#define AUDIO_PARAMETER_KEY_BT_NREC "bt_headset_nrec"
+#define AUDIO_PARAMETER_KEY_TTY_MODE "tty_mode"
+#define AUDIO_PARAMETER_VALUE_TTY_OFF "tty_off"
+#define AUDIO_PARAMETER_VALUE_TTY_VCO "tty_vco"
+#define AUDIO_PARAMETER_VALUE_TTY_HCO "tty_hco"
+#define AUDIO_PARAMETER_VALUE_TTY_FULL "tty_full"
+#define AUDIO_PARAMETER_KEY_HAC "HACSetting"
+#define AUDIO_PARAMETER_VALUE_HAC_ON "ON"
+#define AUDIO_PARAMETER_VALUE_HAC_OFF "OFF"
+#define AUDIO_PARAMETER_VALUE_ON "on"
+#define AUDIO_PARAMETER_VALUE_OFF "off"
+#define AUDIO_PARAMETER_VALUE_TRUE "true"
+#define AUDIO_PARAMETER_VALUE_FALSE "false"
+#define AUDIO_PARAMETER_KEY_BT_SCO_WB "bt_wbs"
+#define AUDIO_PARAMETER_KEY_CAMERA_FACING "cameraFacing"
+#define AUDIO_PARAMETER_VALUE_FRONT "front"
+#define AUDIO_PARAMETER_VALUE_BACK "back"
+#define AUDIO_PARAMETER_RECONFIG_A2DP "reconfigA2dp"
+#define AUDIO_PARAMETER_A2DP_RECONFIG_SUPPORTED "isReconfigA2dpSupported"
+#define AUDIO_PARAMETER_STREAM_ROUTING "routing"
+#define AUDIO_PARAMETER_STREAM_FORMAT "format"
+#define AUDIO_PARAMETER_STREAM_CHANNELS "channels"
+#define AUDIO_PARAMETER_STREAM_FRAME_COUNT "frame_count"
+#define AUDIO_PARAMETER_STREAM_INPUT_SOURCE "input_source"
+#define AUDIO_PARAMETER_STREAM_SAMPLING_RATE "sampling_rate"
+#define AUDIO_PARAMETER_STREAM_SUP_FORMATS "sup_formats"
+#define AUDIO_PARAMETER_STREAM_SUP_CHANNELS "sup_channels"
+#define AUDIO_PARAMETER_STREAM_SUP_SAMPLING_RATES "sup_sampling_rates"
+#define AUDIO_PARAMETER_DEVICE_CONNECT "connect"
+#define AUDIO_PARAMETER_DEVICE_DISCONNECT "disconnect"
+#define AUDIO_OFFLOAD_CODEC_PARAMS "music_offload_codec_param"
+#define AUDIO_OFFLOAD_CODEC_BIT_PER_SAMPLE "music_offload_bit_per_sample"
+#define AUDIO_OFFLOAD_CODEC_DELAY_SAMPLES "delay_samples"
+#define AUDIO_OFFLOAD_CODEC_PADDING_SAMPLES "padding_samples"
+
+typedef enum {
+    STREAM_CBK_EVENT_WRITE_READY,
+    STREAM_CBK_EVENT_DRAIN_READY,
+    STREAM_CBK_EVENT_ERROR,
+} stream_callback_event_t;
+
+typedef int (*stream_callback_t)(stream_callback_event_t event, void *param, void *cookie);
+
+struct audio_mmap_buffer_info {
+    void *shared_memory_address;
+    int32_t shared_memory_fd;
+    int32_t buffer_size_frames;
+    int32_t burst_size_frames;
+};
+
+struct audio_mmap_position {
+    int64_t time_nanoseconds;
+    int32_t position_frames;
+};
+
+struct playback_track_metadata {
+    audio_usage_t usage;
+    audio_content_type_t content_type;
+    float gain;
+};
+
+struct source_metadata {
+    size_t track_count;
+    struct playback_track_metadata *tracks;
+};
+
+struct record_track_metadata {
+    audio_source_t source;
+    float gain;
+    audio_devices_t dest_device;
+    char dest_device_address[AUDIO_DEVICE_MAX_ADDRESS_LEN];
+};
+
+struct sink_metadata {
+    size_t track_count;
+    struct record_track_metadata *tracks;
+};
+
+struct audio_stream {
+    uint32_t (*get_sample_rate)(const struct audio_stream *stream);
+    int (*set_sample_rate)(struct audio_stream *stream, uint32_t rate);
+    size_t (*get_buffer_size)(const struct audio_stream *stream);
+    audio_channel_mask_t (*get_channels)(const struct audio_stream *stream);
+    audio_format_t (*get_format)(const struct audio_stream *stream);
+    int (*set_format)(struct audio_stream *stream, audio_format_t format);
+    int (*standby)(struct audio_stream *stream);
+    int (*dump)(const struct audio_stream *stream, int fd);
+    audio_devices_t (*get_device)(const struct audio_stream *stream);
+    int (*set_device)(struct audio_stream *stream, audio_devices_t device);
+    int (*set_parameters)(struct audio_stream *stream, const char *kv_pairs);
+    char * (*get_parameters)(const struct audio_stream *stream, const char *keys);
+    int (*add_audio_effect)(const struct audio_stream *stream, effect_handle_t effect);
+    int (*remove_audio_effect)(const struct audio_stream *stream, effect_handle_t effect);
+};
+typedef struct audio_stream audio_stream_t;
+
+struct audio_stream_out {
+    struct audio_stream common;
+    uint32_t (*get_latency)(const struct audio_stream_out *stream);
+    int (*set_volume)(struct audio_stream_out *stream, float left, float right);
+    ssize_t (*write)(struct audio_stream_out *stream, const void *buffer, size_t bytes);
+    int (*get_render_position)(const struct audio_stream_out *stream, uint32_t *dsp_frames);
+    int (*get_next_write_timestamp)(const struct audio_stream_out *stream, int64_t *timestamp);
+    int (*set_callback)(struct audio_stream_out *stream, stream_callback_t callback,
+            void *cookie);
+    int (*pause)(struct audio_stream_out *stream);
+    int (*resume)(struct audio_stream_out *stream);
+    int (*drain)(struct audio_stream_out *stream, audio_drain_type_t type);
+    int (*flush)(struct audio_stream_out *stream);
+    int (*get_presentation_position)(const struct audio_stream_out *stream,
+            uint64_t *frames, struct timespec *timestamp);
+    int (*start)(const struct audio_stream_out *stream);
+    int (*stop)(const struct audio_stream_out *stream);
+    int (*create_mmap_buffer)(const struct audio_stream_out *stream, int32_t min_size_frames,
+            struct audio_mmap_buffer_info *info);
+    int (*get_mmap_position)(const struct audio_stream_out *stream,
+            struct audio_mmap_position *position);
+    void (*update_source_metadata)(struct audio_stream_out *stream,
+            const struct source_metadata *source_metadata);
+};
+typedef struct audio_stream_out audio_stream_out_t;
+
+struct audio_stream_in {
+    struct audio_stream common;
+    int (*set_gain)(struct audio_stream_in *stream, float gain);
+    ssize_t (*read)(struct audio_stream_in *stream, void *buffer, size_t bytes);
+    uint32_t (*get_input_frames_lost)(struct audio_stream_in *stream);
+    int (*get_capture_position)(const struct audio_stream_in *stream,
+            int64_t *frames, int64_t *time);
+    int (*start)(const struct audio_stream_in *stream);
+    int (*stop)(const struct audio_stream_in *stream);
+    int (*create_mmap_buffer)(const struct audio_stream_in *stream, int32_t min_size_frames,
+            struct audio_mmap_buffer_info *info);
+    int (*get_mmap_position)(const struct audio_stream_in *stream,
+            struct audio_mmap_position *position);
+    int (*get_active_microphones)(const struct audio_stream_in *stream,
+            struct audio_microphone_characteristic_t *mic_array, size_t *mic_count);
+    int (*set_microphone_direction)(const struct audio_stream_in *stream,
+            audio_microphone_direction_t direction);
+    int (*set_microphone_field_dimension)(const struct audio_stream_in *stream, float zoom);
+    void (*update_sink_metadata)(struct audio_stream_in *stream,
+            const struct sink_metadata *sink_metadata);
+};
+typedef struct audio_stream_in audio_stream_in_t;
+
+static inline size_t audio_stream_out_frame_size(const struct audio_stream_out *s)
+{
+    size_t chan_samp_sz;
+    audio_format_t format = s->common.get_format(&s->common);
+
+    if (audio_has_proportional_frames(format)) {
+        chan_samp_sz = audio_bytes_per_sample(format);
+        return audio_channel_count_from_out_mask(s->common.get_channels(&s->common)) *
+                chan_samp_sz;
+    }
+    return sizeof(int8_t);
+}
+
+static inline size_t audio_stream_in_frame_size(const struct audio_stream_in *s)
+{
+    size_t chan_samp_sz;
+    audio_format_t format = s->common.get_format(&s->common);
+
+    if (audio_has_proportional_frames(format)) {
+        chan_samp_sz = audio_bytes_per_sample(format);
+        return audio_channel_count_from_in_mask(s->common.get_channels(&s->common)) *
+                chan_samp_sz;
+    }
+    return sizeof(int8_t);
+}
+
+struct audio_module {
+    struct hw_module_t common;
+};
+
+struct audio_hw_device {
+    struct hw_device_t common;
+    uint32_t (*get_supported_devices)(const struct audio_hw_device *dev);
+    int (*init_check)(const struct audio_hw_device *dev);
+    int (*set_voice_volume)(struct audio_hw_device *dev, float volume);
+    int (*set_master_volume)(struct audio_hw_device *dev, float volume);
+    int (*get_master_volume)(struct audio_hw_device *dev, float *volume);
+    int (*set_mode)(struct audio_hw_device *dev, audio_mode_t mode);
+    int (*set_mic_mute)(struct audio_hw_device *dev, bool state);
+    int (*get_mic_mute)(const struct audio_hw_device *dev, bool *state);
+    int (*set_parameters)(struct audio_hw_device *dev, const char *kv_pairs);
+    char * (*get_parameters)(const struct audio_hw_device *dev, const char *keys);
+    size_t (*get_input_buffer_size)(const struct audio_hw_device *dev,
+            const struct audio_config *config);
+    int (*open_output_stream)(struct audio_hw_device *dev, audio_io_handle_t handle,
+            audio_devices_t devices, audio_output_flags_t flags, struct audio_config *config,
+            struct audio_stream_out **stream_out, const char *address);
+    void (*close_output_stream)(struct audio_hw_device *dev, struct audio_stream_out *stream_out);
+    int (*open_input_stream)(struct audio_hw_device *dev, audio_io_handle_t handle,
+            audio_devices_t devices, struct audio_config *config,
+            struct audio_stream_in **stream_in, audio_input_flags_t flags,
+            const char *address, audio_source_t source);
+    void (*close_input_stream)(struct audio_hw_device *dev, struct audio_stream_in *stream_in);
+    int (*get_microphones)(const struct audio_hw_device *dev,
+            struct audio_microphone_characteristic_t *mic_array, size_t *mic_count);
+    int (*dump)(const struct audio_hw_device *dev, int fd);
+    int (*set_master_mute)(struct audio_hw_device *dev, bool mute);
+    int (*get_master_mute)(struct audio_hw_device *dev, bool *mute);
+};
+typedef struct audio_hw_device audio_hw_device_t;
+
+__END_DECLS
+
+#endif  // ANDROID_AUDIO_HAL_INTERFACE_H
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host build subset of hardware/libhardware/include/hardware/audio_effect.h. */
+
+#ifndef ANDROID_AUDIO_EFFECT_H
+#define ANDROID_AUDIO_EFFECT_H
+
+#include <errno.h>
+#include <stdint.h>
+#include <strings.h>
+#include <sys/cdefs.h>
+#include <sys/types.h>
+
+#include <hardware/hardware.h>
+#include <system/audio.h>
+
+__BEGIN_DECLS
+
+typedef struct effect_uuid_s {
+    uint32_t timeLow;
+    uint16_t timeMid;
+    uint16_t timeHiAndVersion;
+    uint16_t clockSeq;
+    uint8_t node[6];
+} effect_uuid_t;
+
+#define EFFECT_STRING_LEN_MAX 64
+
+typedef struct effect_descriptor_s {
+    effect_uuid_t type;
+    effect_uuid_t uuid;
+    uint32_t apiVersion;
+    uint32_t flags;
+    uint16_t cpuLoad;
+    uint16_t memoryUsage;
+    char name[EFFECT_STRING_LEN_MAX];
+    char implementor[EFFECT_STRING_LEN_MAX];
+} effect_descriptor_t;
+
+#define EFFECT_FLAG_TYPE_INSERT 0x00000000
+#define EFFECT_FLAG_TYPE_AUXILIARY 0x00000001
+#define EFFECT_FLAG_HW_ACC_TUNNEL 0x00000400
+
+#define EFFECT_MAKE_API_VERSION(M, m) (((M) << 16) | ((m) & 0xFFFF))
+#define EFFECT_CONTROL_API_VERSION EFFECT_MAKE_API_VERSION(2, 0)
+#define EFFECT_LIBRARY_API_VERSION EFFECT_MAKE_API_VERSION(3, 0)
+
+typedef struct audio_buffer_s {
+    size_t frameCount;
+    union {
+        void *raw;
+        int32_t *s32;
+        int16_t *s16;
+        uint8_t *u8;
+        float *f32;
+    };
+} audio_buffer_t;
+
+struct effect_interface_s;
+typedef struct effect_interface_s **effect_handle_t;
+
+struct effect_interface_s {
+    int32_t (*process)(effect_handle_t self, audio_buffer_t *inBuffer,
+            audio_buffer_t *outBuffer);
+    int32_t (*command)(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
+            void *pCmdData, uint32_t *replySize, void *pReplyData);
+    int32_t (*get_descriptor)(effect_handle_t self, effect_descriptor_t *pDescriptor);
+    int32_t (*process_reverse)(effect_handle_t self, audio_buffer_t *inBuffer,
+            audio_buffer_t *outBuffer);
+};
+
+enum effect_command_e {
+    EFFECT_CMD_INIT,
+    EFFECT_CMD_SET_CONFIG,
+    EFFECT_CMD_RESET,
+    EFFECT_CMD_ENABLE,
+    EFFECT_CMD_DISABLE,
+    EFFECT_CMD_SET_PARAM,
+    EFFECT_CMD_SET_PARAM_DEFERRED,
+    EFFECT_CMD_SET_PARAM_COMMIT,
+    EFFECT_CMD_GET_PARAM,
+    EFFECT_CMD_SET_DEVICE,
+    EFFECT_CMD_SET_VOLUME,
+    EFFECT_CMD_SET_AUDIO_MODE,
+    EFFECT_CMD_SET_CONFIG_REVERSE,
+    EFFECT_CMD_SET_INPUT_DEVICE,
+    EFFECT_CMD_GET_CONFIG,
+    EFFECT_CMD_GET_CONFIG_REVERSE,
+    EFFECT_CMD_GET_FEATURE_SUPPORTED_CONFIGS,
+    EFFECT_CMD_GET_FEATURE_CONFIG,
+    EFFECT_CMD_SET_FEATURE_CONFIG,
+    EFFECT_CMD_SET_AUDIO_SOURCE,
+    EFFECT_CMD_OFFLOAD,
+    EFFECT_CMD_FIRST_PROPRIETARY = 0x10000,
+};
+
+typedef struct buffer_provider_s {
+    void *getBuffer;
+    void *releaseBuffer;
+    void *cookie;
+} buffer_provider_t;
+
+typedef struct buffer_config_s {
+    audio_buffer_t buffer;
+    uint32_t samplingRate;
+    uint32_t channels;
+    buffer_provider_t bufferProvider;
+    uint8_t format;
+    uint8_t accessMode;
+    uint16_t mask;
+} buffer_config_t;
+
+enum effect_buffer_access_e {
+    EFFECT_BUFFER_ACCESS_WRITE,
+    EFFECT_BUFFER_ACCESS_READ,
+    EFFECT_BUFFER_ACCESS_ACCUMULATE,
+};
+
+#define EFFECT_CONFIG_BUFFER 0x0001
+#define EFFECT_CONFIG_SMP_RATE 0x0002
+#define EFFECT_CONFIG_CHANNELS 0x0004
+#define EFFECT_CONFIG_FORMAT 0x0008
+#define EFFECT_CONFIG_ACC_MODE 0x0010
+#define EFFECT_CONFIG_PROVIDER 0x0020
+#define EFFECT_CONFIG_ALL (EFFECT_CONFIG_BUFFER | EFFECT_CONFIG_SMP_RATE | \
+        EFFECT_CONFIG_CHANNELS | EFFECT_CONFIG_FORMAT | \
+        EFFECT_CONFIG_ACC_MODE | EFFECT_CONFIG_PROVIDER)
+
+typedef struct effect_config_s {
+    buffer_config_t inputCfg;
+    buffer_config_t outputCfg;
+} effect_config_t;
+
+typedef struct effect_param_s {
+    int32_t status;
+    uint32_t psize;
+    uint32_t vsize;
+    char data[];
+} effect_param_t;
+
+typedef struct effect_offload_param_s {
+    bool isOffload;
+    int ioHandle;
+} effect_offload_param_t;
+
+#define AUDIO_EFFECT_LIBRARY_TAG MAKE_TAG_CONSTANT('A', 'E', 'L', 'T')
+
+typedef struct audio_effect_library_s {
+    uint32_t tag;
+    uint32_t version;
+    const char *name;
+    const char *implementor;
+    int32_t (*create_effect)(const effect_uuid_t *uuid, int32_t sessionId, int32_t ioId,
+            effect_handle_t *pHandle);
+    int32_t (*release_effect)(effect_handle_t handle);
+    int32_t (*get_descriptor)(const effect_uuid_t *uuid, effect_descriptor_t *pDescriptor);
+} audio_effect_library_t;
+
+#define AUDIO_EFFECT_LIBRARY_INFO_SYM AELI
+#define AUDIO_EFFECT_LIBRARY_INFO_SYM_AS_STR "AELI"
+
+__END_DECLS
+
+#endif  // ANDROID_AUDIO_EFFECT_H
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Bionic extensions the HAL relies on that glibc does not provide. Passed to
+ * every host compile with -include. */
+
+#ifndef HOST_COMPAT_H
+#define HOST_COMPAT_H
+
+/* bionic's <pthread.h> pulls in <limits.h>, glibc's does not */
+#include <limits.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/cdefs.h>
+#include <unistd.h>
+
+#ifndef __unused
+#define __unused __attribute__((__unused__))
+#endif
+
+#if !defined(__GLIBC__) || !__GLIBC_PREREQ(2, 38)
+static inline size_t strlcpy(char *dst, const char *src, size_t size)
+{
+    size_t len = strlen(src);
+
+    if (size != 0) {
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+
+static inline size_t strlcat(char *dst, const char *src, size_t size)
+{
+    size_t dlen = strnlen(dst, size);
+
+    if (dlen == size)
+        return size + strlen(src);
+    return dlen + strlcpy(dst + dlen, src, size - dlen);
+}
+#endif
+
+#endif
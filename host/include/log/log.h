@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host build subset of liblog. Messages go to stderr through
+ * __android_log_print() in host/fake_android.c. */
+
+#ifndef _LIBS_LOG_LOG_H
+#define _LIBS_LOG_LOG_H
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <sys/cdefs.h>
+
+__BEGIN_DECLS
+
+typedef enum android_LogPriority {
+    ANDROID_LOG_UNKNOWN = 0,
+    ANDROID_LOG_DEFAULT,
+    ANDROID_LOG_VERBOSE,
+    ANDROID_LOG_DEBUG,
+    ANDROID_LOG_INFO,
+    ANDROID_LOG_WARN,
+    ANDROID_LOG_ERROR,
+    ANDROID_LOG_FATAL,
+    ANDROID_LOG_SILENT,
+} android_LogPriority;
+
+int __android_log_print(int prio, const char *tag, const char *fmt, ...)
+        __attribute__((format(printf, 3, 4)));
+void __android_log_assert(const char *cond, const char *tag, const char *fmt, ...)
+        __attribute__((noreturn));
+
+#ifndef LOG_TAG
+#define LOG_TAG NULL
+#endif
+
+#ifndef LOG_NDEBUG
+#define LOG_NDEBUG 1
+#endif
+
+#define ALOG(prio, tag, ...) __android_log_print(ANDROID_##prio, tag, __VA_ARGS__)
+
+#if LOG_NDEBUG
+#define ALOGV(...) do { if (0) { __android_log_print(ANDROID_LOG_VERBOSE, LOG_TAG, __VA_ARGS__); } } while (0)
+#else
+#define ALOGV(...) ((void)ALOG(LOG_VERBOSE, LOG_TAG, __VA_ARGS__))
+#endif
+#define ALOGD(...) ((void)ALOG(LOG_DEBUG, LOG_TAG, __VA_ARGS__))
+#define ALOGI(...) ((void)ALOG(LOG_INFO, LOG_TAG, __VA_ARGS__))
+#define ALOGW(...) ((void)ALOG(LOG_WARN, LOG_TAG, __VA_ARGS__))
+#define ALOGE(...) ((void)ALOG(LOG_ERROR, LOG_TAG, __VA_ARGS__))
+
+#define ALOGV_IF(cond, ...) do { if (cond) ALOGV(__VA_ARGS__); } while (0)
+#define ALOGD_IF(cond, ...) do { if (cond) ALOGD(__VA_ARGS__); } while (0)
+#define ALOGI_IF(cond, ...) do { if (cond) ALOGI(__VA_ARGS__); } while (0)
+#define ALOGW_IF(cond, ...) do { if (cond) ALOGW(__VA_ARGS__); } while (0)
+#define ALOGE_IF(cond, ...) do { if (cond) ALOGE(__VA_ARGS__); } while (0)
+
+#define LOG_ALWAYS_FATAL_IF(cond, ...) \
+        ((cond) ? __android_log_assert(#cond, LOG_TAG, __VA_ARGS__) : (void)0)
+#define LOG_ALWAYS_FATAL(...) __android_log_assert(NULL, LOG_TAG, __VA_ARGS__)
+#define LOG_FATAL_IF(cond, ...) LOG_ALWAYS_FATAL_IF(cond, __VA_ARGS__)
+#define ALOG_ASSERT(cond, ...) LOG_FATAL_IF(!(cond), __VA_ARGS__)
+
+#define android_errorWriteLog(tag, subtag) ((void)(tag), (void)(subtag))
+
+__END_DECLS
+
+#endif /* _LIBS_LOG_LOG_H */
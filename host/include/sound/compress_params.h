@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host build subset of the ALSA compress offload UAPI header. */
+
+#ifndef __SND_COMPRESS_PARAMS_H
+#define __SND_COMPRESS_PARAMS_H
+
+#include <stdint.h>
+
+#define SND_AUDIOCODEC_PCM 0x00000001
+#define SND_AUDIOCODEC_MP3 0x00000002
+#define SND_AUDIOCODEC_AMR 0x00000003
+#define SND_AUDIOCODEC_AMRWB 0x00000004
+#define SND_AUDIOCODEC_AMRWBPLUS 0x00000005
+#define SND_AUDIOCODEC_AAC 0x00000006
+
+#define MAX_NUM_CODECS 32
+#define MAX_NUM_CODEC_DESCRIPTORS 32
+
+struct snd_enc_generic {
+    uint32_t bw;
+    int32_t reserved[15];
+};
+
+union snd_codec_options {
+    struct snd_enc_generic generic;
+};
+
+struct snd_codec {
+    uint32_t id;
+    uint32_t ch_in;
+    uint32_t ch_out;
+    uint32_t sample_rate;
+    uint32_t bit_rate;
+    uint32_t rate_control;
+    uint32_t profile;
+    uint32_t level;
+    uint32_t ch_mode;
+    uint32_t format;
+    uint32_t align;
+    union snd_codec_options options;
+    uint32_t reserved[3];
+};
+
+#endif
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host build subset of bionic's system property API, backed by the same
+ * table as property_get() in host/fake_android.c. */
+
+#ifndef _INCLUDE_SYS_SYSTEM_PROPERTIES_H
+#define _INCLUDE_SYS_SYSTEM_PROPERTIES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/cdefs.h>
+#include <time.h>
+
+__BEGIN_DECLS
+
+typedef struct prop_info prop_info;
+
+#define PROP_VALUE_MAX 92
+
+const prop_info *__system_property_find(const char *name);
+void __system_property_read_callback(const prop_info *pi,
+        void (*callback)(void *cookie, const char *name, const char *value, uint32_t serial),
+        void *cookie);
+int __system_property_get(const char *name, char *value);
+uint32_t __system_property_serial(const prop_info *pi);
+uint32_t __system_property_area_serial(void);
+bool __system_property_wait(const prop_info *pi, uint32_t old_serial,
+        uint32_t *new_serial_ptr, const struct timespec *relative_timeout);
+
+__END_DECLS
+
+#endif
@@ -0,0 +1,494 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host build subset of system/media/audio/include/system/audio.h. Values
+ * match the platform header for everything the HAL uses. */
+
+#ifndef ANDROID_AUDIO_CORE_H
+#define ANDROID_AUDIO_CORE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int audio_io_handle_t;
+typedef int audio_module_handle_t;
+typedef int audio_port_handle_t;
+typedef int audio_patch_handle_t;
+typedef int audio_session_t;
+typedef uint32_t audio_channel_mask_t;
+typedef uint32_t audio_devices_t;
+typedef uint32_t audio_format_t;
+typedef uint32_t audio_output_flags_t;
+typedef uint32_t audio_input_flags_t;
+typedef int audio_source_t;
+typedef int audio_stream_type_t;
+typedef int audio_usage_t;
+typedef int audio_content_type_t;
+typedef int audio_mode_t;
+
+enum {
+    AUDIO_MODE_INVALID = -2,
+    AUDIO_MODE_CURRENT = -1,
+    AUDIO_MODE_NORMAL = 0,
+    AUDIO_MODE_RINGTONE = 1,
+    AUDIO_MODE_IN_CALL = 2,
+    AUDIO_MODE_IN_COMMUNICATION = 3,
+    AUDIO_MODE_CNT,
+};
+
+enum {
+    AUDIO_SOURCE_DEFAULT = 0,
+    AUDIO_SOURCE_MIC = 1,
+    AUDIO_SOURCE_VOICE_UPLINK = 2,
+    AUDIO_SOURCE_VOICE_DOWNLINK = 3,
+    AUDIO_SOURCE_VOICE_CALL = 4,
+    AUDIO_SOURCE_CAMCORDER = 5,
+    AUDIO_SOURCE_VOICE_RECOGNITION = 6,
+    AUDIO_SOURCE_VOICE_COMMUNICATION = 7,
+    AUDIO_SOURCE_REMOTE_SUBMIX = 8,
+    AUDIO_SOURCE_UNPROCESSED = 9,
+    AUDIO_SOURCE_VOICE_PERFORMANCE = 10,
+    AUDIO_SOURCE_ECHO_REFERENCE = 1997,
+    AUDIO_SOURCE_FM_TUNER = 1998,
+    AUDIO_SOURCE_HOTWORD = 1999,
+    AUDIO_SOURCE_CNT = 11,
+    AUDIO_SOURCE_MAX = AUDIO_SOURCE_CNT - 1,
+};
+
+enum {
+    AUDIO_FORMAT_INVALID = 0xFFFFFFFFu,
+    AUDIO_FORMAT_DEFAULT = 0,
+    AUDIO_FORMAT_PCM = 0x00000000u,
+    AUDIO_FORMAT_MP3 = 0x01000000u,
+    AUDIO_FORMAT_AAC = 0x04000000u,
+    AUDIO_FORMAT_SBC = 0x1F000000u,
+    AUDIO_FORMAT_APTX = 0x20000000u,
+    AUDIO_FORMAT_APTX_HD = 0x21000000u,
+    AUDIO_FORMAT_LDAC = 0x23000000u,
+    AUDIO_FORMAT_MAIN_MASK = 0xFF000000u,
+    AUDIO_FORMAT_SUB_MASK = 0x00FFFFFFu,
+
+    AUDIO_FORMAT_PCM_SUB_16_BIT = 0x1u,
+    AUDIO_FORMAT_PCM_SUB_8_BIT = 0x2u,
+    AUDIO_FORMAT_PCM_SUB_32_BIT = 0x3u,
+    AUDIO_FORMAT_PCM_SUB_8_24_BIT = 0x4u,
+    AUDIO_FORMAT_PCM_SUB_FLOAT = 0x5u,
+    AUDIO_FORMAT_PCM_SUB_24_BIT_PACKED = 0x6u,
+
+    AUDIO_FORMAT_PCM_16_BIT = AUDIO_FORMAT_PCM | AUDIO_FORMAT_PCM_SUB_16_BIT,
+    AUDIO_FORMAT_PCM_8_BIT = AUDIO_FORMAT_PCM | AUDIO_FORMAT_PCM_SUB_8_BIT,
+    AUDIO_FORMAT_PCM_32_BIT = AUDIO_FORMAT_PCM | AUDIO_FORMAT_PCM_SUB_32_BIT,
+    AUDIO_FORMAT_PCM_8_24_BIT = AUDIO_FORMAT_PCM | AUDIO_FORMAT_PCM_SUB_8_24_BIT,
+    AUDIO_FORMAT_PCM_FLOAT = AUDIO_FORMAT_PCM | AUDIO_FORMAT_PCM_SUB_FLOAT,
+    AUDIO_FORMAT_PCM_24_BIT_PACKED = AUDIO_FORMAT_PCM | AUDIO_FORMAT_PCM_SUB_24_BIT_PACKED,
+
+    AUDIO_FORMAT_AAC_SUB_LC = 0x2u,
+    AUDIO_FORMAT_AAC_SUB_HE_V1 = 0x10u,
+    AUDIO_FORMAT_AAC_SUB_HE_V2 = 0x100u,
+    AUDIO_FORMAT_AAC_LC = AUDIO_FORMAT_AAC | AUDIO_FORMAT_AAC_SUB_LC,
+    AUDIO_FORMAT_AAC_HE_V1 = AUDIO_FORMAT_AAC | AUDIO_FORMAT_AAC_SUB_HE_V1,
+    AUDIO_FORMAT_AAC_HE_V2 = AUDIO_FORMAT_AAC | AUDIO_FORMAT_AAC_SUB_HE_V2,
+};
+
+enum {
+    AUDIO_CHANNEL_REPRESENTATION_POSITION = 0x0u,
+    AUDIO_CHANNEL_REPRESENTATION_INDEX = 0x2u,
+    AUDIO_CHANNEL_NONE = 0x0u,
+    AUDIO_CHANNEL_INVALID = 0xC0000000u,
+
+    AUDIO_CHANNEL_OUT_FRONT_LEFT = 0x1u,
+    AUDIO_CHANNEL_OUT_FRONT_RIGHT = 0x2u,
+    AUDIO_CHANNEL_OUT_FRONT_CENTER = 0x4u,
+    AUDIO_CHANNEL_OUT_LOW_FREQUENCY = 0x8u,
+    AUDIO_CHANNEL_OUT_BACK_LEFT = 0x10u,
+    AUDIO_CHANNEL_OUT_BACK_RIGHT = 0x20u,
+    AUDIO_CHANNEL_OUT_BACK_CENTER = 0x100u,
+    AUDIO_CHANNEL_OUT_SIDE_LEFT = 0x200u,
+    AUDIO_CHANNEL_OUT_SIDE_RIGHT = 0x400u,
+    AUDIO_CHANNEL_OUT_HAPTIC_A = 0x20000000u,
+    AUDIO_CHANNEL_OUT_HAPTIC_B = 0x10000000u,
+    AUDIO_CHANNEL_HAPTIC_ALL = AUDIO_CHANNEL_OUT_HAPTIC_A | AUDIO_CHANNEL_OUT_HAPTIC_B,
+
+    AUDIO_CHANNEL_OUT_MONO = AUDIO_CHANNEL_OUT_FRONT_LEFT,
+    AUDIO_CHANNEL_OUT_STEREO = AUDIO_CHANNEL_OUT_FRONT_LEFT | AUDIO_CHANNEL_OUT_FRONT_RIGHT,
+    AUDIO_CHANNEL_OUT_QUAD = AUDIO_CHANNEL_OUT_STEREO | AUDIO_CHANNEL_OUT_BACK_LEFT |
+            AUDIO_CHANNEL_OUT_BACK_RIGHT,
+    AUDIO_CHANNEL_OUT_5POINT1 = AUDIO_CHANNEL_OUT_QUAD | AUDIO_CHANNEL_OUT_FRONT_CENTER |
+            AUDIO_CHANNEL_OUT_LOW_FREQUENCY,
+    AUDIO_CHANNEL_OUT_7POINT1 = AUDIO_CHANNEL_OUT_5POINT1 | AUDIO_CHANNEL_OUT_SIDE_LEFT |
+            AUDIO_CHANNEL_OUT_SIDE_RIGHT,
+
+    AUDIO_CHANNEL_IN_LEFT = 0x4u,
+    AUDIO_CHANNEL_IN_RIGHT = 0x8u,
+    AUDIO_CHANNEL_IN_FRONT = 0x10u,
+    AUDIO_CHANNEL_IN_BACK = 0x20u,
+    AUDIO_CHANNEL_IN_MONO = AUDIO_CHANNEL_IN_FRONT,
+    AUDIO_CHANNEL_IN_STEREO = AUDIO_CHANNEL_IN_LEFT | AUDIO_CHANNEL_IN_RIGHT,
+    AUDIO_CHANNEL_IN_FRONT_BACK = AUDIO_CHANNEL_IN_FRONT | AUDIO_CHANNEL_IN_BACK,
+
+    AUDIO_CHANNEL_INDEX_HDR = 0x80000000u,
+    AUDIO_CHANNEL_INDEX_MASK_1 = AUDIO_CHANNEL_INDEX_HDR | 0x1u,
+    AUDIO_CHANNEL_INDEX_MASK_2 = AUDIO_CHANNEL_INDEX_HDR | 0x3u,
+    AUDIO_CHANNEL_INDEX_MASK_3 = AUDIO_CHANNEL_INDEX_HDR | 0x7u,
+    AUDIO_CHANNEL_INDEX_MASK_4 = AUDIO_CHANNEL_INDEX_HDR | 0xFu,
+    AUDIO_CHANNEL_INDEX_MASK_5 = AUDIO_CHANNEL_INDEX_HDR | 0x1Fu,
+    AUDIO_CHANNEL_INDEX_MASK_6 = AUDIO_CHANNEL_INDEX_HDR | 0x3Fu,
+    AUDIO_CHANNEL_INDEX_MASK_7 = AUDIO_CHANNEL_INDEX_HDR | 0x7Fu,
+    AUDIO_CHANNEL_INDEX_MASK_8 = AUDIO_CHANNEL_INDEX_HDR | 0xFFu,
+};
+
+#define AUDIO_CHANNEL_COUNT_MAX 30u
+
+#define FCC_2 2
+#define FCC_8 8
+
+enum {
+    AUDIO_DEVICE_NONE = 0x0u,
+    AUDIO_DEVICE_BIT_IN = 0x80000000u,
+    AUDIO_DEVICE_BIT_DEFAULT = 0x40000000u,
+
+    AUDIO_DEVICE_OUT_EARPIECE = 0x1u,
+    AUDIO_DEVICE_OUT_SPEAKER = 0x2u,
+    AUDIO_DEVICE_OUT_WIRED_HEADSET = 0x4u,
+    AUDIO_DEVICE_OUT_WIRED_HEADPHONE = 0x8u,
+    AUDIO_DEVICE_OUT_BLUETOOTH_SCO = 0x10u,
+    AUDIO_DEVICE_OUT_BLUETOOTH_SCO_HEADSET = 0x20u,
+    AUDIO_DEVICE_OUT_BLUETOOTH_SCO_CARKIT = 0x40u,
+    AUDIO_DEVICE_OUT_BLUETOOTH_A2DP = 0x80u,
+    AUDIO_DEVICE_OUT_BLUETOOTH_A2DP_HEADPHONES = 0x100u,
+    AUDIO_DEVICE_OUT_BLUETOOTH_A2DP_SPEAKER = 0x200u,
+    AUDIO_DEVICE_OUT_AUX_DIGITAL = 0x400u,
+    AUDIO_DEVICE_OUT_HDMI = AUDIO_DEVICE_OUT_AUX_DIGITAL,
+    AUDIO_DEVICE_OUT_ANLG_DOCK_HEADSET = 0x800u,
+    AUDIO_DEVICE_OUT_DGTL_DOCK_HEADSET = 0x1000u,
+    AUDIO_DEVICE_OUT_USB_ACCESSORY = 0x2000u,
+    AUDIO_DEVICE_OUT_USB_DEVICE = 0x4000u,
+    AUDIO_DEVICE_OUT_REMOTE_SUBMIX = 0x8000u,
+    AUDIO_DEVICE_OUT_TELEPHONY_TX = 0x10000u,
+    AUDIO_DEVICE_OUT_LINE = 0x20000u,
+    AUDIO_DEVICE_OUT_HDMI_ARC = 0x40000u,
+    AUDIO_DEVICE_OUT_SPDIF = 0x80000u,
+    AUDIO_DEVICE_OUT_FM = 0x100000u,
+    AUDIO_DEVICE_OUT_AUX_LINE = 0x200000u,
+    AUDIO_DEVICE_OUT_SPEAKER_SAFE = 0x400000u,
+    AUDIO_DEVICE_OUT_IP = 0x800000u,
+    AUDIO_DEVICE_OUT_BUS = 0x1000000u,
+    AUDIO_DEVICE_OUT_PROXY = 0x2000000u,
+    AUDIO_DEVICE_OUT_USB_HEADSET = 0x4000000u,
+    AUDIO_DEVICE_OUT_HEARING_AID = 0x8000000u,
+    AUDIO_DEVICE_OUT_ECHO_CANCELLER = 0x10000000u,
+    AUDIO_DEVICE_OUT_DEFAULT = AUDIO_DEVICE_BIT_DEFAULT,
+
+    AUDIO_DEVICE_OUT_ALL_A2DP = AUDIO_DEVICE_OUT_BLUETOOTH_A2DP |
+            AUDIO_DEVICE_OUT_BLUETOOTH_A2DP_HEADPHONES | AUDIO_DEVICE_OUT_BLUETOOTH_A2DP_SPEAKER,
+    AUDIO_DEVICE_OUT_ALL_SCO = AUDIO_DEVICE_OUT_BLUETOOTH_SCO |
+            AUDIO_DEVICE_OUT_BLUETOOTH_SCO_HEADSET | AUDIO_DEVICE_OUT_BLUETOOTH_SCO_CARKIT,
+    AUDIO_DEVICE_OUT_ALL_USB = AUDIO_DEVICE_OUT_USB_ACCESSORY | AUDIO_DEVICE_OUT_USB_DEVICE |
+            AUDIO_DEVICE_OUT_USB_HEADSET,
+
+    AUDIO_DEVICE_IN_COMMUNICATION = AUDIO_DEVICE_BIT_IN | 0x1u,
+    AUDIO_DEVICE_IN_AMBIENT = AUDIO_DEVICE_BIT_IN | 0x2u,
+    AUDIO_DEVICE_IN_BUILTIN_MIC = AUDIO_DEVICE_BIT_IN | 0x4u,
+    AUDIO_DEVICE_IN_BLUETOOTH_SCO_HEADSET = AUDIO_DEVICE_BIT_IN | 0x8u,
+    AUDIO_DEVICE_IN_WIRED_HEADSET = AUDIO_DEVICE_BIT_IN | 0x10u,
+    AUDIO_DEVICE_IN_AUX_DIGITAL = AUDIO_DEVICE_BIT_IN | 0x20u,
+    AUDIO_DEVICE_IN_HDMI = AUDIO_DEVICE_IN_AUX_DIGITAL,
+    AUDIO_DEVICE_IN_VOICE_CALL = AUDIO_DEVICE_BIT_IN | 0x40u,
+    AUDIO_DEVICE_IN_TELEPHONY_RX = AUDIO_DEVICE_IN_VOICE_CALL,
+    AUDIO_DEVICE_IN_BACK_MIC = AUDIO_DEVICE_BIT_IN | 0x80u,
+    AUDIO_DEVICE_IN_REMOTE_SUBMIX = AUDIO_DEVICE_BIT_IN | 0x100u,
+    AUDIO_DEVICE_IN_ANLG_DOCK_HEADSET = AUDIO_DEVICE_BIT_IN | 0x200u,
+    AUDIO_DEVICE_IN_DGTL_DOCK_HEADSET = AUDIO_DEVICE_BIT_IN | 0x400u,
+    AUDIO_DEVICE_IN_USB_ACCESSORY = AUDIO_DEVICE_BIT_IN | 0x800u,
+    AUDIO_DEVICE_IN_USB_DEVICE = AUDIO_DEVICE_BIT_IN | 0x1000u,
+    AUDIO_DEVICE_IN_FM_TUNER = AUDIO_DEVICE_BIT_IN | 0x2000u,
+    AUDIO_DEVICE_IN_TV_TUNER = AUDIO_DEVICE_BIT_IN | 0x4000u,
+    AUDIO_DEVICE_IN_LINE = AUDIO_DEVICE_BIT_IN | 0x8000u,
+    AUDIO_DEVICE_IN_SPDIF = AUDIO_DEVICE_BIT_IN | 0x10000u,
+    AUDIO_DEVICE_IN_BLUETOOTH_A2DP = AUDIO_DEVICE_BIT_IN | 0x20000u,
+    AUDIO_DEVICE_IN_LOOPBACK = AUDIO_DEVICE_BIT_IN | 0x40000u,
+    AUDIO_DEVICE_IN_IP = AUDIO_DEVICE_BIT_IN | 0x80000u,
+    AUDIO_DEVICE_IN_BUS = AUDIO_DEVICE_BIT_IN | 0x100000u,
+    AUDIO_DEVICE_IN_PROXY = AUDIO_DEVICE_BIT_IN | 0x1000000u,
+    AUDIO_DEVICE_IN_USB_HEADSET = AUDIO_DEVICE_BIT_IN | 0x2000000u,
+    AUDIO_DEVICE_IN_BLUETOOTH_BLE = AUDIO_DEVICE_BIT_IN | 0x4000000u,
+    AUDIO_DEVICE_IN_ECHO_REFERENCE = AUDIO_DEVICE_BIT_IN | 0x10000000u,
+    AUDIO_DEVICE_IN_DEFAULT = AUDIO_DEVICE_BIT_IN | AUDIO_DEVICE_BIT_DEFAULT,
+};
+
+enum {
+    AUDIO_OUTPUT_FLAG_NONE = 0x0,
+    AUDIO_OUTPUT_FLAG_DIRECT = 0x1,
+    AUDIO_OUTPUT_FLAG_PRIMARY = 0x2,
+    AUDIO_OUTPUT_FLAG_FAST = 0x4,
+    AUDIO_OUTPUT_FLAG_DEEP_BUFFER = 0x8,
+    AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD = 0x10,
+    AUDIO_OUTPUT_FLAG_NON_BLOCKING = 0x20,
+    AUDIO_OUTPUT_FLAG_HW_AV_SYNC = 0x40,
+    AUDIO_OUTPUT_FLAG_TTS = 0x80,
+    AUDIO_OUTPUT_FLAG_RAW = 0x100,
+    AUDIO_OUTPUT_FLAG_SYNC = 0x200,
+    AUDIO_OUTPUT_FLAG_IEC958_NONAUDIO = 0x400,
+    AUDIO_OUTPUT_FLAG_DIRECT_PCM = 0x2000,
+    AUDIO_OUTPUT_FLAG_MMAP_NOIRQ = 0x4000,
+    AUDIO_OUTPUT_FLAG_VOIP_RX = 0x8000,
+    AUDIO_OUTPUT_FLAG_INCALL_MUSIC = 0x10000,
+};
+
+enum {
+    AUDIO_INPUT_FLAG_NONE = 0x0,
+    AUDIO_INPUT_FLAG_FAST = 0x1,
+    AUDIO_INPUT_FLAG_HW_HOTWORD = 0x2,
+    AUDIO_INPUT_FLAG_RAW = 0x4,
+    AUDIO_INPUT_FLAG_SYNC = 0x8,
+    AUDIO_INPUT_FLAG_MMAP_NOIRQ = 0x10,
+    AUDIO_INPUT_FLAG_VOIP_TX = 0x20,
+};
+
+typedef enum {
+    AUDIO_DRAIN_ALL,
+    AUDIO_DRAIN_EARLY_NOTIFY,
+} audio_drain_type_t;
+
+typedef struct {
+    uint16_t version;
+    uint16_t size;
+    audio_channel_mask_t channel_mask;
+    uint32_t sample_rate;
+    audio_format_t format;
+    audio_stream_type_t stream_type;
+    uint32_t bit_rate;
+    int64_t duration_us;
+    bool has_video;
+    bool is_streaming;
+    uint32_t bit_width;
+    uint32_t offload_buffer_size;
+    audio_usage_t usage;
+} audio_offload_info_t;
+
+#define AUDIO_MAKE_OFFLOAD_INFO_VERSION(maj, min) ((((maj) & 0xff) << 8) | ((min) & 0xff))
+#define AUDIO_OFFLOAD_INFO_VERSION_CURRENT AUDIO_MAKE_OFFLOAD_INFO_VERSION(0, 1)
+
+static const audio_offload_info_t AUDIO_INFO_INITIALIZER = {
+    .version = AUDIO_OFFLOAD_INFO_VERSION_CURRENT,
+    .size = sizeof(audio_offload_info_t),
+};
+
+struct audio_config {
+    uint32_t sample_rate;
+    audio_channel_mask_t channel_mask;
+    audio_format_t format;
+    audio_offload_info_t offload_info;
+    size_t frame_count;
+};
+typedef struct audio_config audio_config_t;
+
+/* Microphone characteristics */
+#define AUDIO_DEVICE_MAX_ADDRESS_LEN 32
+#define AUDIO_BOTTOM_MICROPHONE_ADDRESS "bottom"
+#define AUDIO_BACK_MICROPHONE_ADDRESS "back"
+#define AUDIO_MICROPHONE_ID_MAX_LEN 32
+#define AUDIO_MICROPHONE_MAX_CHANNEL_MAPPING AUDIO_CHANNEL_COUNT_MAX
+#define AUDIO_MICROPHONE_MAX_FREQUENCY_RESPONSES 256
+#define AUDIO_MICROPHONE_MAX_COUNT 32
+#define AUDIO_MICROPHONE_SENSITIVITY_UNKNOWN (-3.4028235e+38f)
+#define AUDIO_MICROPHONE_SPL_UNKNOWN (-3.4028235e+38f)
+#define AUDIO_MICROPHONE_COORDINATE_UNKNOWN (-3.4028235e+38f)
+
+typedef enum {
+    AUDIO_MICROPHONE_CHANNEL_MAPPING_UNUSED = 0,
+    AUDIO_MICROPHONE_CHANNEL_MAPPING_DIRECT = 1,
+    AUDIO_MICROPHONE_CHANNEL_MAPPING_PROCESSED = 2,
+    AUDIO_MICROPHONE_CHANNEL_MAPPING_CNT,
+} audio_microphone_channel_mapping_t;
+
+typedef enum {
+    AUDIO_MICROPHONE_LOCATION_UNKNOWN = 0,
+    AUDIO_MICROPHONE_LOCATION_MAINBODY = 1,
+    AUDIO_MICROPHONE_LOCATION_MAINBODY_MOVABLE = 2,
+    AUDIO_MICROPHONE_LOCATION_PERIPHERAL = 3,
+    AUDIO_MICROPHONE_LOCATION_CNT,
+} audio_microphone_location_t;
+
+typedef enum {
+    AUDIO_MICROPHONE_DIRECTIONALITY_UNKNOWN = 0,
+    AUDIO_MICROPHONE_DIRECTIONALITY_OMNI = 1,
+    AUDIO_MICROPHONE_DIRECTIONALITY_BI_DIRECTIONAL = 2,
+    AUDIO_MICROPHONE_DIRECTIONALITY_CARDIOID = 3,
+    AUDIO_MICROPHONE_DIRECTIONALITY_HYPER_CARDIOID = 4,
+    AUDIO_MICROPHONE_DIRECTIONALITY_SUPER_CARDIOID = 5,
+    AUDIO_MICROPHONE_DIRECTIONALITY_CNT,
+} audio_microphone_directionality_t;
+
+typedef enum {
+    MIC_DIRECTION_UNSPECIFIED = 0,
+    MIC_DIRECTION_FRONT = 1,
+    MIC_DIRECTION_BACK = 2,
+    MIC_DIRECTION_EXTERNAL = 3,
+} audio_microphone_direction_t;
+
+typedef struct {
+    float x;
+    float y;
+    float z;
+} audio_microphone_coordinate;
+
+struct audio_microphone_characteristic_t {
+    char device_id[AUDIO_MICROPHONE_ID_MAX_LEN];
+    audio_port_handle_t id;
+    audio_devices_t device;
+    char address[AUDIO_DEVICE_MAX_ADDRESS_LEN];
+    audio_microphone_channel_mapping_t channel_mapping[AUDIO_CHANNEL_COUNT_MAX];
+    audio_microphone_location_t location;
+    unsigned int group;
+    unsigned int index_in_the_group;
+    float sensitivity;
+    float max_spl;
+    float min_spl;
+    audio_microphone_directionality_t directionality;
+    unsigned int num_frequency_responses;
+    float frequency_responses[2][AUDIO_MICROPHONE_MAX_FREQUENCY_RESPONSES];
+    audio_microphone_coordinate geometric_location;
+    audio_microphone_coordinate orientation;
+};
+
+static inline uint32_t popcount(uint32_t u)
+{
+    return __builtin_popcount(u);
+}
+
+static inline bool audio_is_input_device(audio_devices_t device)
+{
+    if ((device & AUDIO_DEVICE_BIT_IN) != 0) {
+        device &= ~AUDIO_DEVICE_BIT_IN;
+        if ((device != 0) && ((device & (device - 1)) == 0))
+            return true;
+    }
+    return false;
+}
+
+static inline bool audio_is_output_device(audio_devices_t device)
+{
+    return (device & AUDIO_DEVICE_BIT_IN) == 0 && device != 0 && (device & (device - 1)) == 0;
+}
+
+static inline bool audio_is_a2dp_out_device(audio_devices_t device)
+{
+    return audio_is_output_device(device) && (device & AUDIO_DEVICE_OUT_ALL_A2DP);
+}
+
+static inline bool audio_is_usb_out_device(audio_devices_t device)
+{
+    return audio_is_output_device(device) && (device & AUDIO_DEVICE_OUT_ALL_USB);
+}
+
+static inline bool audio_is_usb_in_device(audio_devices_t device)
+{
+    return device == AUDIO_DEVICE_IN_USB_ACCESSORY || device == AUDIO_DEVICE_IN_USB_DEVICE ||
+            device == AUDIO_DEVICE_IN_USB_HEADSET;
+}
+
+static inline uint32_t audio_channel_mask_get_bits(audio_channel_mask_t channel)
+{
+    return channel & 0x3FFFFFFFu;
+}
+
+static inline uint32_t audio_channel_mask_get_representation(audio_channel_mask_t channel)
+{
+    return (channel >> 30) & 0x3;
+}
+
+static inline uint32_t audio_channel_count_from_in_mask(audio_channel_mask_t channel)
+{
+    return __builtin_popcount(audio_channel_mask_get_bits(channel));
+}
+
+static inline uint32_t audio_channel_count_from_out_mask(audio_channel_mask_t channel)
+{
+    return __builtin_popcount(audio_channel_mask_get_bits(channel));
+}
+
+static inline audio_channel_mask_t audio_channel_out_mask_from_count(uint32_t channel_count)
+{
+    switch (channel_count) {
+    case 0: return AUDIO_CHANNEL_NONE;
+    case 1: return AUDIO_CHANNEL_OUT_MONO;
+    case 2: return AUDIO_CHANNEL_OUT_STEREO;
+    case 4: return AUDIO_CHANNEL_OUT_QUAD;
+    case 6: return AUDIO_CHANNEL_OUT_5POINT1;
+    case 8: return AUDIO_CHANNEL_OUT_7POINT1;
+    default: return AUDIO_CHANNEL_INVALID;
+    }
+}
+
+static inline audio_channel_mask_t audio_channel_in_mask_from_count(uint32_t channel_count)
+{
+    switch (channel_count) {
+    case 0: return AUDIO_CHANNEL_NONE;
+    case 1: return AUDIO_CHANNEL_IN_MONO;
+    case 2: return AUDIO_CHANNEL_IN_STEREO;
+    default: return AUDIO_CHANNEL_INVALID;
+    }
+}
+
+static inline audio_channel_mask_t audio_channel_mask_for_index_assignment_from_count(
+        uint32_t channel_count)
+{
+    if (channel_count == 0 || channel_count > AUDIO_CHANNEL_COUNT_MAX)
+        return AUDIO_CHANNEL_INVALID;
+    return AUDIO_CHANNEL_INDEX_HDR | ((1u << channel_count) - 1);
+}
+
+static inline bool audio_is_linear_pcm(audio_format_t format)
+{
+    return (format & AUDIO_FORMAT_MAIN_MASK) == AUDIO_FORMAT_PCM;
+}
+
+static inline size_t audio_bytes_per_sample(audio_format_t format)
+{
+    switch (format) {
+    case AUDIO_FORMAT_PCM_32_BIT:
+    case AUDIO_FORMAT_PCM_8_24_BIT:
+    case AUDIO_FORMAT_PCM_FLOAT:
+        return 4;
+    case AUDIO_FORMAT_PCM_24_BIT_PACKED:
+        return 3;
+    case AUDIO_FORMAT_PCM_16_BIT:
+        return 2;
+    case AUDIO_FORMAT_PCM_8_BIT:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static inline bool audio_has_proportional_frames(audio_format_t format)
+{
+    return audio_is_linear_pcm(format);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // ANDROID_AUDIO_CORE_H
@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host build subset of system/core/libsystem/include/system/thread_defs.h. */
+
+#ifndef ANDROID_THREAD_DEFS_H
+#define ANDROID_THREAD_DEFS_H
+
+enum {
+    ANDROID_PRIORITY_LOWEST = 19,
+    ANDROID_PRIORITY_BACKGROUND = 10,
+    ANDROID_PRIORITY_NORMAL = 0,
+    ANDROID_PRIORITY_FOREGROUND = -2,
+    ANDROID_PRIORITY_DISPLAY = -4,
+    ANDROID_PRIORITY_URGENT_DISPLAY = -8,
+    ANDROID_PRIORITY_AUDIO = -16,
+    ANDROID_PRIORITY_URGENT_AUDIO = -19,
+    ANDROID_PRIORITY_HIGHEST = -20,
+};
+
+#endif
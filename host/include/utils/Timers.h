@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host build subset of libutils Timers.h. */
+
+#ifndef _LIBS_UTILS_TIMERS_H
+#define _LIBS_UTILS_TIMERS_H
+
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int64_t nsecs_t;
+
+enum {
+    SYSTEM_TIME_REALTIME = 0,
+    SYSTEM_TIME_MONOTONIC = 1,
+    SYSTEM_TIME_PROCESS = 2,
+    SYSTEM_TIME_THREAD = 3,
+    SYSTEM_TIME_BOOTTIME = 4,
+};
+
+static inline nsecs_t seconds_to_nanoseconds(nsecs_t secs) { return secs * 1000000000; }
+static inline nsecs_t milliseconds_to_nanoseconds(nsecs_t ms) { return ms * 1000000; }
+static inline nsecs_t nanoseconds_to_milliseconds(nsecs_t ns) { return ns / 1000000; }
+
+static inline nsecs_t systemTime(int clock)
+{
+    static const clockid_t clocks[] = {
+        CLOCK_REALTIME, CLOCK_MONOTONIC, CLOCK_PROCESS_CPUTIME_ID,
+        CLOCK_THREAD_CPUTIME_ID, CLOCK_BOOTTIME,
+    };
+    struct timespec t = { 0, 0 };
+    clock_gettime(clocks[clock], &t);
+    return (nsecs_t)t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
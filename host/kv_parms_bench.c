@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Times kv_parms against str_parms on the key/value strings set_parameters()
+ * commonly receives. Each iteration parses the string and looks up every key
+ * of the adev_set_parameters() keyword table, as the entry points do. Fails
+ * when the two disagree on any lookup.
+ */
+
+#define LOG_TAG "kv_parms_bench"
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <cutils/str_parms.h>
+#include <hardware/audio.h>
+
+#include "kv_parms.h"
+
+/* the keys of set_param_keywords in audio_hw.c, consumers do not matter here */
+static const struct kv_keyword keywords[] = {
+    KV_KEYWORD(AUDIO_PARAMETER_STREAM_ROUTING, 0),
+    KV_KEYWORD(AUDIO_PARAMETER_STREAM_INPUT_SOURCE, 0),
+    KV_KEYWORD("card", 0),
+    KV_KEYWORD(AUDIO_PARAMETER_KEY_BT_NREC, 0),
+    KV_KEYWORD("screen_state", 0),
+    KV_KEYWORD("rotation", 0),
+    KV_KEYWORD(AUDIO_PARAMETER_KEY_BT_SCO_WB, 0),
+    KV_KEYWORD("BT_SCO", 0),
+    KV_KEYWORD(AUDIO_PARAMETER_DEVICE_CONNECT, 0),
+    KV_KEYWORD(AUDIO_PARAMETER_DEVICE_DISCONNECT, 0),
+    KV_KEYWORD(AUDIO_PARAMETER_KEY_CAMERA_FACING, 0),
+    KV_KEYWORD("A2dpSuspended", 0),
+    KV_KEYWORD(AUDIO_PARAMETER_RECONFIG_A2DP, 0),
+};
+
+#define NUM_KEYWORDS (sizeof(keywords) / sizeof(keywords[0]))
+
+static const char *const workloads[] = {
+    "routing=2",
+    "screen_state=on",
+    "rotation=90",
+    "routing=2;screen_state=on;rotation=90",
+    "BT_SCO=on;bt_wbs=on",
+    "connect=1024;card=1;device=0",
+    "A2dpSuspended=false",
+    "bt_headset_nrec=on;routing=;rotation=abc;routing=8",
+    /* gapless metadata, not in the table */
+    "music_offload_avg_bit_rate=128000;music_offload_sample_rate=44100",
+};
+
+#define NUM_WORKLOADS (sizeof(workloads) / sizeof(workloads[0]))
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int lookup_kv(const char *kvpairs, char *value, size_t len)
+{
+    struct kv_parms parms;
+    int sum = 0;
+
+    kv_parms_parse(&parms, kvpairs, keywords, NUM_KEYWORDS, 0);
+    for (unsigned int key = 0; key < NUM_KEYWORDS; key++)
+        sum += kv_parms_get_str(&parms, key, value, len);
+    return sum;
+}
+
+static int lookup_str_parms(const char *kvpairs, char *value, size_t len)
+{
+    struct str_parms *parms = str_parms_create_str(kvpairs);
+    int sum = 0;
+
+    for (unsigned int key = 0; key < NUM_KEYWORDS; key++)
+        sum += str_parms_get_str(parms, keywords[key].name, value, len);
+    str_parms_destroy(parms);
+    return sum;
+}
+
+/* every lookup must return the same length and value */
+static int compare(const char *kvpairs)
+{
+    struct str_parms *str_parms = str_parms_create_str(kvpairs);
+    struct kv_parms kv_parms;
+    int failures = 0;
+
+    kv_parms_parse(&kv_parms, kvpairs, keywords, NUM_KEYWORDS, 0);
+    for (unsigned int key = 0; key < NUM_KEYWORDS; key++) {
+        char kv_value[32] = "", str_value[32] = "";
+        const int kv_ret = kv_parms_get_str(&kv_parms, key, kv_value, sizeof(kv_value));
+        const int str_ret = str_parms_get_str(str_parms, keywords[key].name, str_value,
+                                              sizeof(str_value));
+
+        if (kv_ret != str_ret || strcmp(kv_value, str_value) != 0) {
+            fprintf(stderr, "'%s' %s: kv_parms %d '%s', str_parms %d '%s'\n", kvpairs,
+                    keywords[key].name, kv_ret, kv_value, str_ret, str_value);
+            failures++;
+        }
+    }
+    str_parms_destroy(str_parms);
+    return failures;
+}
+
+static double time_ns(int (*lookup)(const char *, char *, size_t), const char *kvpairs,
+                      unsigned int iterations)
+{
+    char value[32];
+    volatile int sink = 0;
+    const int64_t start_ns = now_ns();
+
+    for (unsigned int i = 0; i < iterations; i++)
+        sink += lookup(kvpairs, value, sizeof(value));
+    (void)sink;
+    return iterations ? (double)(now_ns() - start_ns) / iterations : 0;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n <n>  parses per workload and parser (default 200000)\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int iterations = 200000;
+    double kv_total = 0, str_total = 0;
+    int opt, failures = 0;
+
+    while ((opt = getopt(argc, argv, "n:h")) != -1) {
+        switch (opt) {
+        case 'n': iterations = strtoul(optarg, NULL, 0); break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    printf("%-70s %10s %10s\n", "kvpairs", "kv_parms", "str_parms");
+    for (unsigned int i = 0; i < NUM_WORKLOADS; i++) {
+        const double kv_ns = time_ns(lookup_kv, workloads[i], iterations);
+        const double str_ns = time_ns(lookup_str_parms, workloads[i], iterations);
+
+        failures += compare(workloads[i]);
+        kv_total += kv_ns;
+        str_total += str_ns;
+        printf("%-70s %7.1f ns %7.1f ns\n", workloads[i], kv_ns, str_ns);
+    }
+    printf("mean kv_parms %.1f ns, str_parms %.1f ns, %.1fx\n", kv_total / NUM_WORKLOADS,
+           str_total / NUM_WORKLOADS, kv_total > 0 ? str_total / kv_total : 0);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Write bandwidth of out_write() with the DMA buffer filled through mmap
+ * (vendor.audio.mmap_fill_write.enabled) against the default pcm_write()
+ * path, on a deep buffer output and on the VOIP output, whose stereo to
+ * mono downmix is folded into the fill. The fake pcm_write() copies into
+ * the ring as the kernel would, so both paths copy every frame once; the
+ * default path adds the downmix pass over the AF buffer. The fake DSP is
+ * not paced, the numbers are the CPU cost of the writes.
+ */
+
+#define LOG_TAG "mmap_fill_bench"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <cutils/properties.h>
+#include <hardware/audio.h>
+#include <hardware/hardware.h>
+
+#define MMAP_FILL_PROPERTY "vendor.audio.mmap_fill_write.enabled"
+
+extern struct audio_module HAL_MODULE_INFO_SYM;
+
+struct bench_case {
+    const char *name;
+    audio_output_flags_t flags;
+    audio_devices_t device;
+};
+
+static const struct bench_case cases[] = {
+    { "deep buffer", AUDIO_OUTPUT_FLAG_DEEP_BUFFER, AUDIO_DEVICE_OUT_SPEAKER },
+    { "voip downmix", AUDIO_OUTPUT_FLAG_VOIP_RX, AUDIO_DEVICE_OUT_EARPIECE },
+};
+
+#define NUM_CASES (sizeof(cases) / sizeof(cases[0]))
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Average ns per write of iterations writes, after one to leave standby. */
+static int time_writes(struct audio_hw_device *adev, const struct bench_case *bench_case,
+                       bool mmap_fill, unsigned int iterations, audio_io_handle_t handle,
+                       size_t *bytes, double *write_ns)
+{
+    struct audio_config config = {
+        .sample_rate = 48000,
+        .channel_mask = AUDIO_CHANNEL_OUT_STEREO,
+        .format = AUDIO_FORMAT_PCM_16_BIT,
+    };
+    struct audio_stream_out *out = NULL;
+    int16_t *buffer;
+    int64_t start_ns = 0;
+    int ret;
+
+    property_set(MMAP_FILL_PROPERTY, mmap_fill ? "true" : "false");
+    ret = adev->open_output_stream(adev, handle, bench_case->device, bench_case->flags,
+                                   &config, &out, "mmap_fill_bench");
+    if (ret != 0) {
+        fprintf(stderr, "%s: open_output_stream failed: %d\n", bench_case->name, ret);
+        return ret;
+    }
+    *bytes = out->common.get_buffer_size(&out->common);
+    buffer = malloc(*bytes);
+    if (buffer == NULL) {
+        ret = -ENOMEM;
+        goto exit;
+    }
+    for (size_t i = 0; i < *bytes / sizeof(int16_t); i++)
+        buffer[i] = rand();
+
+    for (unsigned int i = 0; i <= iterations; i++) {
+        ssize_t written;
+
+        if (i == 1)
+            start_ns = now_ns();
+        written = out->write(out, buffer, *bytes);
+        if (written != (ssize_t)*bytes) {
+            fprintf(stderr, "%s: write %u returned %zd\n", bench_case->name, i, written);
+            ret = written < 0 ? (int)written : -EIO;
+            goto exit;
+        }
+    }
+    *write_ns = iterations ? (double)(now_ns() - start_ns) / iterations : 0;
+
+exit:
+    free(buffer);
+    adev->close_output_stream(adev, out);
+    return ret;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n <n>  writes timed per case and path (default 20000)\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    const struct hw_module_t *module = &HAL_MODULE_INFO_SYM.common;
+    struct hw_device_t *device = NULL;
+    struct audio_hw_device *adev;
+    unsigned int iterations = 20000;
+    audio_io_handle_t handle = 1;
+    int opt, failures = 0;
+
+    while ((opt = getopt(argc, argv, "n:h")) != -1) {
+        switch (opt) {
+        case 'n': iterations = strtoul(optarg, NULL, 0); break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    setenv("HAL_HOST_LOG", "S", 0);
+    if (module->methods->open(module, AUDIO_HARDWARE_INTERFACE, &device) != 0) {
+        fprintf(stderr, "adev_open failed\n");
+        return 1;
+    }
+    adev = (struct audio_hw_device *)device;
+
+    for (size_t c = 0; c < NUM_CASES; c++) {
+        double pcm_write_ns = 0, mmap_fill_ns = 0;
+        size_t bytes = 0;
+
+        if (time_writes(adev, &cases[c], false, iterations, handle++, &bytes,
+                        &pcm_write_ns) != 0 ||
+                time_writes(adev, &cases[c], true, iterations, handle++, &bytes,
+                            &mmap_fill_ns) != 0) {
+            failures++;
+            continue;
+        }
+        /* MB/s of AF buffer written */
+        printf("%-13s %6zu byte writes: pcm_write %8.1f ns %7.0f MB/s, "
+               "mmap fill %8.1f ns %7.0f MB/s, %.2fx\n", cases[c].name, bytes,
+               pcm_write_ns, bytes * 1e3 / pcm_write_ns, mmap_fill_ns,
+               bytes * 1e3 / mmap_fill_ns, mmap_fill_ns > 0 ? pcm_write_ns / mmap_fill_ns : 0);
+    }
+
+    device->close(device);
+    return failures == 0 ? 0 : 1;
+}
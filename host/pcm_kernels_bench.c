@@ -0,0 +1,265 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Throughput of the pcm_kernels against the scalar code they replaced, on
+ * 960 frame buffers: the haptics split in the layouts out_write() handles,
+ * the stereo to mono downmix of the VOIP output and the 24_8 to 8_24
+ * conversion of a stereo capture. The input is restored before every call,
+ * outside of the timing. Fails when a kernel and its reference disagree;
+ * tests/pcm_kernels_test covers the sizes and alignments.
+ */
+
+#define LOG_TAG "pcm_kernels_bench"
+
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pcm_kernels.h"
+
+#define FRAMES 960
+#define MAX_FRAME_SIZE (4 * 4)
+
+struct haptic_layout {
+    const char *name;
+    size_t bytes_per_sample;
+    size_t audio_channels;
+    size_t haptic_channels;
+    size_t skip_channels;
+};
+
+static const struct haptic_layout haptic_layouts[] = {
+    { "16 bit stereo + 1 haptic", 2, 2, 1, 0 },
+    { "16 bit stereo + 2 haptic", 2, 2, 2, 0 },
+    { "16 bit forced haptic path", 2, 1, 1, 1 },
+    { "24 bit stereo + 1 haptic", 3, 2, 1, 0 },
+    { "32 bit stereo + 1 haptic", 4, 2, 1, 0 },
+    { "32 bit stereo + 2 haptic", 4, 2, 2, 0 },
+};
+
+#define NUM_HAPTIC_LAYOUTS (sizeof(haptic_layouts) / sizeof(haptic_layouts[0]))
+
+static uint8_t input[FRAMES * MAX_FRAME_SIZE];
+static uint8_t buffer[FRAMES * MAX_FRAME_SIZE] __attribute__((aligned(16)));
+static uint8_t haptic_buffer[FRAMES * MAX_FRAME_SIZE] __attribute__((aligned(16)));
+static uint8_t reference_buffer[FRAMES * MAX_FRAME_SIZE] __attribute__((aligned(16)));
+static uint8_t reference_haptic_buffer[FRAMES * MAX_FRAME_SIZE];
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* the byte loops of out_write() before pcm_kernels */
+static void split_haptics_scalar(void *buffer, void *haptic_buffer, size_t frames,
+                                 size_t bytes_per_sample, size_t audio_channels,
+                                 size_t haptic_channels, size_t skip_channels)
+{
+    size_t audio_frame_size = audio_channels * bytes_per_sample;
+    size_t haptic_frame_size = haptic_channels * bytes_per_sample;
+    size_t skip_frame_size = skip_channels * bytes_per_sample;
+    size_t src_index = 0, aud_index = 0, hap_index = 0;
+    uint8_t *audio_buffer = buffer;
+    uint8_t *haptics = haptic_buffer;
+
+    for (size_t i = 0; i < frames; i++) {
+        for (size_t j = 0; j < audio_frame_size; j++)
+            audio_buffer[aud_index++] = audio_buffer[src_index++];
+
+        for (size_t j = 0; j < haptic_frame_size; j++)
+            haptics[hap_index++] = audio_buffer[src_index++];
+
+        src_index += skip_frame_size;
+    }
+}
+
+/* the loops of out_write() and in_read() before pcm_kernels */
+static void downmix_scalar(int16_t *dst, const int16_t *src, size_t frames)
+{
+    for (size_t i = 0; i < frames ; i++, dst++, src += 2) {
+        *dst = (int16_t)(((int32_t)src[0] + (int32_t)src[1]) >> 1);
+    }
+}
+
+static void shift_scalar(int32_t *int_buf_stream, size_t samples)
+{
+    for (size_t itt = 0; itt < samples; itt++) {
+        int_buf_stream[itt] >>= 8;
+    }
+}
+
+static void print_result(const char *kernel, const char *name, size_t bytes, double scalar_ns,
+                         double kernel_ns, bool same)
+{
+    /* MB/s of input processed */
+    printf("%-13s %-26s scalar %8.1f ns %7.0f MB/s, kernel %8.1f ns %7.0f MB/s, %.1fx%s\n",
+           kernel, name, scalar_ns, bytes * 1e3 / scalar_ns, kernel_ns, bytes * 1e3 / kernel_ns,
+           kernel_ns > 0 ? scalar_ns / kernel_ns : 0, same ? "" : " DIFFERS");
+    if (!same)
+        fprintf(stderr, "%s %s: kernel and scalar outputs differ\n", kernel, name);
+}
+
+typedef void (*split_haptics_t)(void *, void *, size_t, size_t, size_t, size_t, size_t);
+
+static size_t input_size(const struct haptic_layout *layout)
+{
+    return FRAMES * (layout->audio_channels + layout->haptic_channels + layout->skip_channels) *
+            layout->bytes_per_sample;
+}
+
+static double time_split_ns(split_haptics_t split, const struct haptic_layout *layout,
+                            unsigned int iterations)
+{
+    int64_t total_ns = 0;
+
+    for (unsigned int i = 0; i < iterations; i++) {
+        int64_t start_ns;
+
+        memcpy(buffer, input, input_size(layout));
+        start_ns = now_ns();
+        split(buffer, haptic_buffer, FRAMES, layout->bytes_per_sample, layout->audio_channels,
+              layout->haptic_channels, layout->skip_channels);
+        total_ns += now_ns() - start_ns;
+    }
+    return iterations ? (double)total_ns / iterations : 0;
+}
+
+static int bench_split_haptics(const struct haptic_layout *layout, unsigned int iterations)
+{
+    const size_t audio_size = FRAMES * layout->audio_channels * layout->bytes_per_sample;
+    const size_t haptic_size = FRAMES * layout->haptic_channels * layout->bytes_per_sample;
+    double scalar_ns, kernel_ns;
+    bool same;
+
+    memcpy(reference_buffer, input, input_size(layout));
+    split_haptics_scalar(reference_buffer, reference_haptic_buffer, FRAMES,
+                         layout->bytes_per_sample, layout->audio_channels,
+                         layout->haptic_channels, layout->skip_channels);
+    scalar_ns = time_split_ns(split_haptics_scalar, layout, iterations);
+    kernel_ns = time_split_ns(pcm_kernels_split_haptics, layout, iterations);
+    same = memcmp(buffer, reference_buffer, audio_size) == 0 &&
+            memcmp(haptic_buffer, reference_haptic_buffer, haptic_size) == 0;
+
+    print_result("split_haptics", layout->name, input_size(layout), scalar_ns, kernel_ns, same);
+    return same ? 0 : 1;
+}
+
+static double time_downmix_ns(void (*downmix)(int16_t *, const int16_t *, size_t),
+                              unsigned int iterations)
+{
+    int64_t total_ns = 0;
+
+    for (unsigned int i = 0; i < iterations; i++) {
+        int64_t start_ns;
+
+        memcpy(buffer, input, FRAMES * 2 * sizeof(int16_t));
+        start_ns = now_ns();
+        /* in place, as out_write() does it */
+        downmix((int16_t *)buffer, (const int16_t *)buffer, FRAMES);
+        total_ns += now_ns() - start_ns;
+    }
+    return iterations ? (double)total_ns / iterations : 0;
+}
+
+static int bench_downmix(unsigned int iterations)
+{
+    double scalar_ns, kernel_ns;
+    bool same;
+
+    memcpy(reference_buffer, input, FRAMES * 2 * sizeof(int16_t));
+    downmix_scalar((int16_t *)reference_buffer, (const int16_t *)reference_buffer, FRAMES);
+    scalar_ns = time_downmix_ns(downmix_scalar, iterations);
+    kernel_ns = time_downmix_ns(pcm_kernels_downmix_to_mono_16, iterations);
+    same = memcmp(buffer, reference_buffer, FRAMES * sizeof(int16_t)) == 0;
+    print_result("downmix", "16 bit stereo to mono", FRAMES * 2 * sizeof(int16_t), scalar_ns,
+                 kernel_ns, same);
+    return same ? 0 : 1;
+}
+
+static double time_shift_ns(void (*shift)(int32_t *, size_t), unsigned int iterations)
+{
+    int64_t total_ns = 0;
+
+    for (unsigned int i = 0; i < iterations; i++) {
+        int64_t start_ns;
+
+        memcpy(buffer, input, FRAMES * 2 * sizeof(int32_t));
+        start_ns = now_ns();
+        shift((int32_t *)buffer, FRAMES * 2);
+        total_ns += now_ns() - start_ns;
+    }
+    return iterations ? (double)total_ns / iterations : 0;
+}
+
+static int bench_shift(unsigned int iterations)
+{
+    double scalar_ns, kernel_ns;
+    bool same;
+
+    memcpy(reference_buffer, input, FRAMES * 2 * sizeof(int32_t));
+    shift_scalar((int32_t *)reference_buffer, FRAMES * 2);
+    scalar_ns = time_shift_ns(shift_scalar, iterations);
+    kernel_ns = time_shift_ns(pcm_kernels_shift_24_8_to_8_24, iterations);
+    same = memcmp(buffer, reference_buffer, FRAMES * 2 * sizeof(int32_t)) == 0;
+    print_result("shift_24_8", "stereo capture", FRAMES * 2 * sizeof(int32_t), scalar_ns,
+                 kernel_ns, same);
+    return same ? 0 : 1;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n <n>  calls timed per kernel and layout (default 20000)\n"
+            "  -s <n>  random seed (default 1)\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int iterations = 20000;
+    unsigned int seed = 1;
+    int opt, failures = 0;
+
+    while ((opt = getopt(argc, argv, "n:s:h")) != -1) {
+        switch (opt) {
+        case 'n': iterations = strtoul(optarg, NULL, 0); break;
+        case 's': seed = strtoul(optarg, NULL, 0); break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    srand(seed);
+    for (size_t i = 0; i < sizeof(input); i++)
+        input[i] = rand();
+
+    for (size_t l = 0; l < NUM_HAPTIC_LAYOUTS; l++)
+        failures += bench_split_haptics(&haptic_layouts[l], iterations);
+    failures += bench_downmix(iterations);
+    failures += bench_shift(iterations);
+
+    if (failures != 0)
+        fprintf(stderr, "%d kernels differ from the scalar code\n", failures);
+    return failures == 0 ? 0 : 1;
+}
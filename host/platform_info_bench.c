@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Times platform_info_init() on each platform info XML given, once parsing
+ * the XML and once loading the snapshot written by the first parse, on the
+ * platform of an opened device. Fails when the HAL does not accept its own
+ * snapshot, or with -k one compiled by the host tool beforehand.
+ */
+
+#define LOG_TAG "platform_info_bench"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cutils/properties.h>
+#include <hardware/audio.h>
+#include <hardware/hardware.h>
+
+#include "audio_extn/latency_histogram.h"
+#include "audio_hw.h"
+#include "platform_api.h"
+
+#define SNAPSHOT_PROPERTY "vendor.audio.platform_info.snapshot"
+#define SNAPSHOT_DIR "/data/vendor/audio"
+
+extern struct audio_module HAL_MODULE_INFO_SYM;
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* open() is redirected to the host root, stat() is not */
+static ino_t snapshot_inode(const char *path)
+{
+    struct stat st;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    ino_t ino = 0;
+
+    if (fd < 0)
+        return 0;
+    if (fstat(fd, &st) == 0)
+        ino = st.st_ino;
+    close(fd);
+    return ino;
+}
+
+static int time_init(void *platform, const char *xml_path, unsigned int iterations,
+                     struct latency_histogram *hist)
+{
+    for (unsigned int i = 0; i < iterations; i++) {
+        const int64_t start_ns = now_ns();
+        int ret = platform_info_init(xml_path, platform, true, platform_set_parameters);
+
+        latency_histogram_log_ns(hist, now_ns() - start_ns);
+        if (ret != 0) {
+            fprintf(stderr, "%s: platform_info_init failed: %d\n", xml_path, ret);
+            return ret;
+        }
+    }
+    return 0;
+}
+
+static double mean_us(const struct latency_histogram *hist)
+{
+    return hist->count ? (double)hist->sum_us / hist->count : 0;
+}
+
+static int run_file(void *platform, const char *xml_path, unsigned int iterations,
+                    bool keep_snapshot)
+{
+    struct latency_histogram parse = { 0 }, load = { 0 };
+    const char *name = strrchr(xml_path, '/');
+    char snapshot_path[PATH_MAX];
+    ino_t ino;
+    int ret;
+
+    snprintf(snapshot_path, sizeof(snapshot_path), "%s/%s.bin", SNAPSHOT_DIR,
+             name != NULL ? name + 1 : xml_path);
+
+    property_set(SNAPSHOT_PROPERTY, "false");
+    ret = time_init(platform, xml_path, iterations, &parse);
+    if (ret != 0)
+        return ret;
+
+    property_set(SNAPSHOT_PROPERTY, "true");
+    if (!keep_snapshot) {
+        unlink(snapshot_path);
+        ret = platform_info_init(xml_path, platform, true, platform_set_parameters);
+        if (ret != 0)
+            return ret;
+    }
+    ino = snapshot_inode(snapshot_path);
+    if (ino == 0) {
+        fprintf(stderr, "%s: no snapshot at %s\n", xml_path, snapshot_path);
+        return -ENOENT;
+    }
+    ret = time_init(platform, xml_path, iterations, &load);
+    if (ret != 0)
+        return ret;
+    /* a rejected snapshot is parsed again and rewritten under a new inode */
+    if (snapshot_inode(snapshot_path) != ino) {
+        fprintf(stderr, "%s: %s was rejected and rewritten\n", xml_path, snapshot_path);
+        return -ESTALE;
+    }
+
+    printf("%s\n", xml_path);
+    fflush(stdout); /* the histograms are written to the fd */
+    latency_histogram_dump(&parse, STDOUT_FILENO, "  ", "xml_parse");
+    latency_histogram_dump(&load, STDOUT_FILENO, "  ", "snapshot_load");
+    printf("  mean parse %.1f us, load %.1f us, %.1fx\n", mean_us(&parse), mean_us(&load),
+           mean_us(&load) > 0 ? mean_us(&parse) / mean_us(&load) : 0);
+    return 0;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options] <platform info xml>...\n"
+            "  -n <n>            platform_info_init() calls per measurement (default 200)\n"
+            "  -f <fingerprint>  ro.build.fingerprint to run with (default: unset)\n"
+            "  -k                load the snapshot already in " SNAPSHOT_DIR " instead of\n"
+            "                    writing one first, fail if it is rejected\n"
+            "Set HAL_HOST_LOG=V|D|I|W|E|S for HAL log output (default W).\n",
+            name);
+}
+
+int main(int argc, char **argv)
+{
+    const struct hw_module_t *module = &HAL_MODULE_INFO_SYM.common;
+    struct hw_device_t *device = NULL;
+    struct audio_device *adev;
+    unsigned int iterations = 200;
+    bool keep_snapshot = false;
+    int opt, ret = 0;
+
+    while ((opt = getopt(argc, argv, "n:f:kh")) != -1) {
+        switch (opt) {
+        case 'n': iterations = strtoul(optarg, NULL, 0); break;
+        case 'f': property_set("ro.build.fingerprint", optarg); break;
+        case 'k': keep_snapshot = true; break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind == argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    ret = module->methods->open(module, AUDIO_HARDWARE_INTERFACE, &device);
+    if (ret != 0) {
+        fprintf(stderr, "adev_open failed: %d\n", ret);
+        return 1;
+    }
+    adev = (struct audio_device *)device;
+
+    for (int i = optind; i < argc && ret == 0; i++)
+        ret = run_file(adev->platform, argv[i], iterations, keep_snapshot);
+
+    device->close(device);
+    return ret == 0 ? 0 : 1;
+}
@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Compiles an audio_platform_info XML into the snapshot the HAL loads in
+ * place of the XML (see platform_info_snapshot.h), or prints the header of
+ * an existing snapshot. The recorded source path, mtime and build
+ * fingerprint must be those the HAL sees on the device, or the HAL rejects
+ * the snapshot as stale and parses the XML. So does a snapshot installed
+ * with another owner than the HAL's uid or writable by group or others.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <expat.h>
+
+#include "platform_info_snapshot.h"
+
+struct recorder {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+    bool failed;
+};
+
+static void append(struct recorder *rec, const void *data, size_t len)
+{
+    if (rec->failed)
+        return;
+    if (rec->size + len > rec->capacity) {
+        size_t capacity = rec->capacity ? rec->capacity : 16384;
+        uint8_t *buf;
+
+        while (capacity < rec->size + len)
+            capacity *= 2;
+        buf = realloc(rec->data, capacity);
+        if (buf == NULL) {
+            rec->failed = true;
+            return;
+        }
+        rec->data = buf;
+        rec->capacity = capacity;
+    }
+    memcpy(rec->data + rec->size, data, len);
+    rec->size += len;
+}
+
+static void record(struct recorder *rec, uint8_t type, const XML_Char *tag_name,
+                   const XML_Char **attr)
+{
+    size_t count = 0;
+
+    while (attr != NULL && attr[count] != NULL)
+        count++;
+    if (count + 1 > PLATFORM_INFO_SNAPSHOT_MAX_STRINGS) {
+        fprintf(stderr, "too many attributes in <%s>\n", tag_name);
+        rec->failed = true;
+        return;
+    }
+
+    uint8_t header[2] = { type, (uint8_t)count };
+    append(rec, header, sizeof(header));
+    append(rec, tag_name, strlen(tag_name) + 1);
+    for (size_t i = 0; i < count; i++)
+        append(rec, attr[i], strlen(attr[i]) + 1);
+}
+
+static void start_tag(void *userdata, const XML_Char *tag_name, const XML_Char **attr)
+{
+    record(userdata, SNAPSHOT_EVENT_START, tag_name, attr);
+}
+
+static void end_tag(void *userdata, const XML_Char *tag_name)
+{
+    record(userdata, SNAPSHOT_EVENT_END, tag_name, NULL);
+}
+
+static int parse(const char *xml_path, struct recorder *rec)
+{
+    XML_Parser parser;
+    FILE *file;
+    int ret = 0;
+
+    file = fopen(xml_path, "r");
+    if (file == NULL) {
+        ret = -errno;
+        fprintf(stderr, "cannot open %s: %s\n", xml_path, strerror(-ret));
+        return ret;
+    }
+    parser = XML_ParserCreate(NULL);
+    if (parser == NULL) {
+        ret = -ENOMEM;
+        goto exit;
+    }
+    XML_SetUserData(parser, rec);
+    XML_SetElementHandler(parser, start_tag, end_tag);
+
+    while (1) {
+        void *buf = XML_GetBuffer(parser, 1024);
+        size_t bytes_read;
+
+        if (buf == NULL) {
+            ret = -ENOMEM;
+            break;
+        }
+        bytes_read = fread(buf, 1, 1024, file);
+        if (XML_ParseBuffer(parser, bytes_read, bytes_read == 0) == XML_STATUS_ERROR) {
+            fprintf(stderr, "%s:%lu: %s\n", xml_path,
+                    (unsigned long)XML_GetCurrentLineNumber(parser),
+                    XML_ErrorString(XML_GetErrorCode(parser)));
+            ret = -EINVAL;
+            break;
+        }
+        if (bytes_read == 0)
+            break;
+    }
+    if (ret == 0 && rec->failed)
+        ret = -ENOMEM;
+    XML_ParserFree(parser);
+exit:
+    fclose(file);
+    return ret;
+}
+
+static int compile(const char *xml_path, const char *device_path, const char *fingerprint,
+                   const char *mtime, const char *snapshot_path)
+{
+    struct platform_info_snapshot_header header;
+    struct recorder rec = { 0 };
+    struct stat st;
+    FILE *out;
+    int ret;
+
+    if (stat(xml_path, &st) != 0) {
+        ret = -errno;
+        fprintf(stderr, "cannot stat %s: %s\n", xml_path, strerror(-ret));
+        return ret;
+    }
+    if (strlen(device_path) >= sizeof(header.source_path)) {
+        fprintf(stderr, "device path %s is too long\n", device_path);
+        return -ENAMETOOLONG;
+    }
+    ret = parse(xml_path, &rec);
+    if (ret != 0)
+        goto exit;
+
+    memset(&header, 0, sizeof(header));
+    header.magic = PLATFORM_INFO_SNAPSHOT_MAGIC;
+    header.version = PLATFORM_INFO_SNAPSHOT_VERSION;
+    if (mtime != NULL)
+        header.source_mtime_ns = strtoll(mtime, NULL, 0) * 1000000000LL;
+    else
+        header.source_mtime_ns = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+    header.source_size = st.st_size;
+    header.build_hash = fingerprint != NULL ?
+            platform_info_snapshot_build_hash(fingerprint) : 0;
+    header.payload_hash = platform_info_snapshot_hash(rec.data, rec.size);
+    header.payload_size = rec.size;
+    /* the length was checked above, header is zeroed */
+    memcpy(header.source_path, device_path, strlen(device_path));
+
+    out = fopen(snapshot_path, "wb");
+    if (out == NULL) {
+        ret = -errno;
+        fprintf(stderr, "cannot create %s: %s\n", snapshot_path, strerror(-ret));
+        goto exit;
+    }
+    /* the HAL ignores a snapshot group or others can write */
+    if (fchmod(fileno(out), 0644) != 0 || fwrite(&header, sizeof(header), 1, out) != 1 ||
+            fwrite(rec.data, 1, rec.size, out) != rec.size)
+        ret = -EIO;
+    if (fclose(out) != 0 && ret == 0)
+        ret = -EIO;
+    if (ret != 0) {
+        fprintf(stderr, "cannot write %s\n", snapshot_path);
+        remove(snapshot_path);
+    }
+exit:
+    free(rec.data);
+    return ret;
+}
+
+static int dump(const char *snapshot_path)
+{
+    struct platform_info_snapshot_header header;
+    uint8_t *payload = NULL;
+    FILE *file;
+    int ret = 0;
+
+    file = fopen(snapshot_path, "rb");
+    if (file == NULL) {
+        ret = -errno;
+        fprintf(stderr, "cannot open %s: %s\n", snapshot_path, strerror(-ret));
+        return ret;
+    }
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+            header.magic != PLATFORM_INFO_SNAPSHOT_MAGIC) {
+        fprintf(stderr, "%s is not a platform info snapshot\n", snapshot_path);
+        ret = -EINVAL;
+        goto exit;
+    }
+    printf("version       %" PRIu32 "%s\n", header.version,
+           header.version == PLATFORM_INFO_SNAPSHOT_VERSION ? "" : " (unsupported)");
+    printf("source        %.*s\n", (int)sizeof(header.source_path), header.source_path);
+    printf("source size   %" PRId64 "\n", header.source_size);
+    printf("source mtime  %" PRId64 ".%09" PRId64 "\n",
+           (int64_t)(header.source_mtime_ns / 1000000000LL),
+           (int64_t)(header.source_mtime_ns % 1000000000LL));
+    printf("build hash    %016" PRIx64 "\n", header.build_hash);
+    printf("payload       %" PRIu64 " bytes, hash %016" PRIx64, header.payload_size,
+           header.payload_hash);
+
+    payload = malloc(header.payload_size ? header.payload_size : 1);
+    if (payload == NULL || fread(payload, 1, header.payload_size, file) != header.payload_size) {
+        printf(" (truncated)\n");
+        ret = -EINVAL;
+    } else if (platform_info_snapshot_hash(payload, header.payload_size) !=
+               header.payload_hash) {
+        printf(" (corrupted)\n");
+        ret = -EINVAL;
+    } else {
+        printf("\n");
+    }
+exit:
+    free(payload);
+    fclose(file);
+    return ret;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options] <xml> <snapshot>\n"
+            "       %s -d <snapshot>\n"
+            "  -p <path>         path of the XML on the device\n"
+            "                    (default /vendor/etc/<xml file name>)\n"
+            "  -f <fingerprint>  ro.build.fingerprint of the device (default: unset)\n"
+            "  -m <seconds>      mtime of the XML on the device (default: its mtime here)\n"
+            "  -d                print the header of a snapshot and check its payload\n",
+            name, name);
+}
+
+int main(int argc, char **argv)
+{
+    const char *device_path = NULL;
+    const char *fingerprint = NULL;
+    const char *mtime = NULL;
+    char default_path[PLATFORM_INFO_SNAPSHOT_PATH_MAX];
+    bool dump_only = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "p:f:m:dh")) != -1) {
+        switch (opt) {
+        case 'p': device_path = optarg; break;
+        case 'f': fingerprint = optarg; break;
+        case 'm': mtime = optarg; break;
+        case 'd': dump_only = true; break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (dump_only) {
+        if (argc - optind != 1) {
+            usage(argv[0]);
+            return 1;
+        }
+        return dump(argv[optind]) == 0 ? 0 : 1;
+    }
+    if (argc - optind != 2) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (device_path == NULL) {
+        const char *name = strrchr(argv[optind], '/');
+
+        snprintf(default_path, sizeof(default_path), "/vendor/etc/%s",
+                 name != NULL ? name + 1 : argv[optind]);
+        device_path = default_path;
+    }
+    return compile(argv[optind], device_path, fingerprint, mtime, argv[optind + 1]) == 0 ? 0 : 1;
+}
@@ -0,0 +1,352 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Reads the VOIP and low latency record streams against the real time fake
+ * capture clock, with synchronous reads and through the async capture
+ * reader (vendor.audio.async_capture.enabled), and checks that both give
+ * the same answers:
+ *
+ * - data: the fake captures a ramp of the capture position, every read must
+ *   continue it unless the stream was left waiting long enough to overrun
+ *   or failed;
+ * - mute: the first read after set_mic_mute(true) must be silent even with
+ *   periods captured before the mute still queued, and data must be back
+ *   within a few reads of unmuting, once the periods the reader zeroed
+ *   while muted have been read;
+ * - read errors: with every Nth kernel read failing, each error must cost
+ *   exactly one silent buffer and the next read must capture again;
+ * - position: in_get_capture_position() must never report fewer frames
+ *   than were read, and frames minus time times the rate must stay constant
+ *   between overruns and errors, as both count the kernel clock.
+ */
+
+#define LOG_TAG "async_capture_test"
+
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cutils/properties.h>
+#include <hardware/audio.h>
+#include <hardware/hardware.h>
+
+#include "fake_alsa.h"
+
+#define ASYNC_CAPTURE_PROPERTY "vendor.audio.async_capture.enabled"
+#define SAMPLE_RATE 48000
+/* buffers left unread before muting and unmuting, more than the ring holds */
+#define MUTE_WAIT_BUFFERS 3
+/* reads after unmuting, the last ones must carry data */
+#define UNMUTE_READS 8
+/* frames minus time times rate may move by this much between reads */
+#define POSITION_TOLERANCE_MS 2
+#define TIMEOUT_S 120
+
+extern struct audio_module HAL_MODULE_INFO_SYM;
+
+struct capture_case {
+    const char *name;
+    audio_input_flags_t flags;
+    audio_source_t source;
+};
+
+static const struct capture_case cases[] = {
+    { "voip", AUDIO_INPUT_FLAG_VOIP_TX, AUDIO_SOURCE_VOICE_COMMUNICATION },
+    { "low latency", AUDIO_INPUT_FLAG_FAST, AUDIO_SOURCE_MIC },
+};
+
+#define NUM_CASES (sizeof(cases) / sizeof(cases[0]))
+
+struct capture_run {
+    struct audio_stream_in *in;
+    int16_t *buffer;
+    size_t frames;              /* per read */
+    int64_t frames_read;        /* as in->frames_read counts them */
+    bool resync;                /* the ramp and the position may jump */
+    int16_t next_sample;
+    double position_base;       /* frames minus time times rate at the last resync */
+    double max_drift_ms;
+    unsigned int positions;
+    unsigned int silent_reads;
+    int failures;
+};
+
+/* mono 16 bit ramp of the capture position, never zero */
+static int16_t ramp_sample(uint64_t position)
+{
+    return (int16_t)(position % 32767 + 1);
+}
+
+static void ramp_source(void *data, unsigned int bytes, uint64_t position, void *cookie __unused)
+{
+    int16_t *samples = data;
+
+    for (unsigned int i = 0; i < bytes / sizeof(int16_t); i++)
+        samples[i] = ramp_sample(position + i);
+}
+
+static void timeout(int sig __unused)
+{
+    static const char message[] = "capture hung\n";
+
+    write(STDERR_FILENO, message, sizeof(message) - 1);
+    _exit(1);
+}
+
+static bool is_silent(const struct capture_run *run)
+{
+    for (size_t i = 0; i < run->frames; i++) {
+        if (run->buffer[i] != 0)
+            return false;
+    }
+    return true;
+}
+
+static void check_ramp(struct capture_run *run, const char *name, unsigned int read)
+{
+    for (size_t i = 0; i < run->frames; i++) {
+        const int16_t sample = run->buffer[i];
+
+        if (sample == 0) {
+            /* muted by the reader before an unmute, still counts as captured */
+            if (!run->resync)
+                run->next_sample = run->next_sample % 32767 + 1;
+            continue;
+        }
+        if (!run->resync && sample != run->next_sample) {
+            fprintf(stderr, "%s: read %u frame %zu is %d instead of %d\n", name, read, i,
+                    sample, run->next_sample);
+            run->failures++;
+            run->resync = true;
+            return;
+        }
+        run->resync = false;
+        run->next_sample = sample % 32767 + 1;
+    }
+}
+
+static void check_position(struct capture_run *run, const char *name, unsigned int read,
+                           bool resync)
+{
+    int64_t frames, time;
+    double base;
+
+    if (run->in->get_capture_position(run->in, &frames, &time) != 0)
+        return;
+    if (frames < run->frames_read) {
+        fprintf(stderr, "%s: read %u position %lld behind the %lld frames read\n", name, read,
+                (long long)frames, (long long)run->frames_read);
+        run->failures++;
+    }
+    base = frames - time * 1e-9 * SAMPLE_RATE;
+    if (resync || run->positions == 0) {
+        run->position_base = base;
+    } else {
+        const double drift_ms = (base - run->position_base) * 1e3 / SAMPLE_RATE;
+
+        if (drift_ms > run->max_drift_ms || -drift_ms > run->max_drift_ms)
+            run->max_drift_ms = drift_ms > 0 ? drift_ms : -drift_ms;
+        if (drift_ms > POSITION_TOLERANCE_MS || drift_ms < -POSITION_TOLERANCE_MS) {
+            fprintf(stderr, "%s: read %u position moved %.2f ms off the capture clock\n",
+                    name, read, drift_ms);
+            run->failures++;
+            run->position_base = base;
+        }
+    }
+    run->positions++;
+}
+
+/* Returns true if the read was silent. */
+static bool read_once(struct capture_run *run, const char *name, unsigned int read)
+{
+    const bool resync = run->resync;
+    ssize_t bytes = run->in->read(run->in, run->buffer, run->frames * sizeof(int16_t));
+    bool silent;
+
+    if (bytes != (ssize_t)(run->frames * sizeof(int16_t))) {
+        fprintf(stderr, "%s: read %u returned %zd\n", name, read, bytes);
+        run->failures++;
+        return false;
+    }
+    run->frames_read += run->frames;
+    silent = is_silent(run);
+    run->silent_reads += silent;
+    if (!silent)
+        check_ramp(run, name, read);
+    check_position(run, name, read, resync);
+    return silent;
+}
+
+static void wait_buffers(struct capture_run *run, unsigned int buffers)
+{
+    usleep(buffers * run->frames * 1000000LL / SAMPLE_RATE);
+    run->resync = true;
+}
+
+static int run_capture(struct audio_hw_device *adev, const struct capture_case *capture_case,
+                       bool async, unsigned int reads, unsigned int error_every,
+                       audio_io_handle_t handle)
+{
+    struct audio_config config = {
+        .sample_rate = SAMPLE_RATE,
+        .channel_mask = AUDIO_CHANNEL_IN_MONO,
+        .format = AUDIO_FORMAT_PCM_16_BIT,
+    };
+    struct fake_alsa_config fake_config = { .real_time = true };
+    struct fake_alsa_stats stats;
+    struct capture_run run = { .resync = true };
+    char name[64];
+    unsigned int read = 0, errors = 0, last_data_read = 0, muted_after_unmute;
+    int ret;
+
+    snprintf(name, sizeof(name), "%s %s", capture_case->name, async ? "async" : "sync");
+    property_set(ASYNC_CAPTURE_PROPERTY, async ? "true" : "false");
+    fake_alsa_configure(&fake_config);
+    ret = adev->open_input_stream(adev, handle, AUDIO_DEVICE_IN_BUILTIN_MIC, &config, &run.in,
+                                  capture_case->flags, "", capture_case->source);
+    if (ret != 0) {
+        fprintf(stderr, "%s: open_input_stream failed: %d\n", name, ret);
+        return 1;
+    }
+    run.frames = run.in->common.get_buffer_size(&run.in->common) / sizeof(int16_t);
+    run.buffer = malloc(run.frames * sizeof(int16_t));
+    if (run.buffer == NULL) {
+        run.failures++;
+        goto exit;
+    }
+
+    /* clean reads, then a mute with captured periods queued */
+    for (; read < reads / 2 && run.failures == 0; read++)
+        read_once(&run, name, read);
+
+    wait_buffers(&run, MUTE_WAIT_BUFFERS);
+    adev->set_mic_mute(adev, true);
+    for (unsigned int i = 0; i < 2; i++, read++) {
+        if (!read_once(&run, name, read)) {
+            fprintf(stderr, "%s: read %u after the mute is not silent\n", name, read);
+            run.failures++;
+        }
+    }
+    wait_buffers(&run, MUTE_WAIT_BUFFERS);
+    adev->set_mic_mute(adev, false);
+    run.silent_reads = 0;
+    for (unsigned int i = 0; i < UNMUTE_READS; i++, read++) {
+        /* the overrun of the wait shows once the ring has drained */
+        run.resync = true;
+        if (!read_once(&run, name, read))
+            last_data_read = i;
+    }
+    if (last_data_read != UNMUTE_READS - 1) {
+        fprintf(stderr, "%s: still silent %u reads after the unmute\n", name, UNMUTE_READS);
+        run.failures++;
+    }
+    muted_after_unmute = run.silent_reads;
+
+    /* every error_every kernel reads fail */
+    fake_alsa_get_stats(&stats);
+    const uint64_t read_errors = stats.pcm_read_errors;
+    fake_config.read_error_every = error_every;
+    fake_alsa_configure(&fake_config);
+    for (unsigned int i = 0; i < reads / 2 && run.failures == 0; i++, read++) {
+        if (read_once(&run, name, read)) {
+            errors++;
+            run.resync = true;
+        }
+    }
+    fake_config.read_error_every = 0;
+    fake_alsa_configure(&fake_config);
+    fake_alsa_get_stats(&stats);
+    /* the error a read may have hit last is only returned by the next read */
+    if (async && errors + 1 == stats.pcm_read_errors - read_errors) {
+        if (read_once(&run, name, read++))
+            errors++;
+    }
+    if (errors != stats.pcm_read_errors - read_errors || errors == 0) {
+        fprintf(stderr, "%s: %u silent reads for %llu read errors\n", name, errors,
+                (unsigned long long)(stats.pcm_read_errors - read_errors));
+        run.failures++;
+    }
+
+    printf("%-17s %4u reads of %4zu frames: %u silent reads after unmute, "
+           "%u read errors recovered, position drift %.3f ms over %u positions%s\n", name,
+           read, run.frames, muted_after_unmute, errors, run.max_drift_ms, run.positions,
+           run.failures ? " FAILED" : "");
+
+exit:
+    free(run.buffer);
+    adev->close_input_stream(adev, run.in);
+    return run.failures;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n <n>  reads per stream and mode (default 200)\n"
+            "  -e <n>  fail every nth kernel read in the error phase (default 7)\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    const struct hw_module_t *module = &HAL_MODULE_INFO_SYM.common;
+    struct hw_device_t *device = NULL;
+    struct audio_hw_device *adev;
+    unsigned int reads = 200, error_every = 7;
+    audio_io_handle_t handle = 1;
+    int opt, failures = 0;
+
+    while ((opt = getopt(argc, argv, "n:e:h")) != -1) {
+        switch (opt) {
+        case 'n': reads = strtoul(optarg, NULL, 0); break;
+        case 'e': error_every = strtoul(optarg, NULL, 0); break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (error_every < 2) {
+        fprintf(stderr, "-e must be at least 2 for reads to recover\n");
+        return 1;
+    }
+
+    /* keep the progress lines if a read hangs */
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    setenv("HAL_HOST_LOG", "S", 0);
+    signal(SIGALRM, timeout);
+    alarm(TIMEOUT_S);
+    fake_alsa_set_capture_source(ramp_source, NULL);
+    if (module->methods->open(module, AUDIO_HARDWARE_INTERFACE, &device) != 0) {
+        fprintf(stderr, "adev_open failed\n");
+        return 1;
+    }
+    adev = (struct audio_hw_device *)device;
+
+    for (size_t c = 0; c < NUM_CASES; c++) {
+        failures += run_capture(adev, &cases[c], false, reads, error_every, handle++);
+        failures += run_capture(adev, &cases[c], true, reads, error_every, handle++);
+    }
+
+    device->close(device);
+    fake_alsa_set_capture_source(NULL, NULL);
+    if (failures != 0)
+        fprintf(stderr, "%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Cost of the name lookups platform_info.c makes while parsing
+ * audio_platform_info.xml: platform_get_*_index() through the hash index
+ * against the linear strcmp scan find_index() did before, for every name
+ * of the msm8974 snd device, usecase and audio source tables and for a
+ * missing name. Fails when the two disagree; tests/name_index_test covers
+ * the round trip in detail.
+ */
+
+#include "msm8974/platform.c"
+
+#include <getopt.h>
+#include <time.h>
+
+struct name_table {
+    const char *kind;
+    const struct name_to_index *table;
+    size_t count;
+    int (*lookup)(const char *name);
+};
+
+static int snd_device_lookup(const char *name)
+{
+    return platform_get_snd_device_index((char *)name);
+}
+
+static const struct name_table name_tables[] = {
+    { "snd device", snd_device_name_index, SND_DEVICE_MAX, snd_device_lookup },
+    { "usecase", usecase_name_index, AUDIO_USECASE_MAX, platform_get_usecase_index },
+    { "audio source", audio_source_index, AUDIO_SOURCE_CNT, platform_get_audio_source_index },
+};
+
+#define NUM_NAME_TABLES (sizeof(name_tables) / sizeof(name_tables[0]))
+
+/* the linear find_index() before name_index */
+static const struct name_table *scan_table;
+
+static int linear_lookup(const char *name)
+{
+    for (size_t i = 0; i < scan_table->count; i++) {
+        if (strcmp(scan_table->table[i].name, name) == 0)
+            return scan_table->table[i].index;
+    }
+    return -ENODEV;
+}
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* ns per lookup of name, or of every name of the table when name is NULL,
+   the sum of the results goes to *checksum */
+static double time_lookups(const struct name_table *t, int (*lookup)(const char *),
+                           const char *name, unsigned int iterations, long *checksum)
+{
+    unsigned long lookups = 0;
+    int64_t start_ns = now_ns();
+
+    *checksum = 0;
+    for (unsigned int n = 0; n < iterations; n++) {
+        if (name != NULL) {
+            *checksum += lookup(name);
+            lookups++;
+            continue;
+        }
+        for (size_t i = 0; i < t->count; i++) {
+            if (t->table[i].name[0] == '\0')
+                continue;
+            *checksum += lookup(t->table[i].name);
+            lookups++;
+        }
+    }
+    return lookups ? (double)(now_ns() - start_ns) / lookups : 0;
+}
+
+static int bench_table(const struct name_table *t, const char *name, unsigned int iterations)
+{
+    long scan_sum, index_sum;
+    double scan_ns, index_ns;
+
+    scan_table = t;
+    scan_ns = time_lookups(t, linear_lookup, name, iterations, &scan_sum);
+    index_ns = time_lookups(t, t->lookup, name, iterations, &index_sum);
+    printf("%-12s %-7s linear %8.1f ns, index %6.1f ns, %5.1fx%s\n", t->kind,
+           name == NULL ? "names" : "missing", scan_ns, index_ns,
+           index_ns > 0 ? scan_ns / index_ns : 0, scan_sum == index_sum ? "" : " DIFFERS");
+    if (scan_sum != index_sum) {
+        fprintf(stderr, "%s: index and linear scan lookups differ\n", t->kind);
+        return 1;
+    }
+    return 0;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n <n>  passes over each table (default 20000)\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int iterations = 20000;
+    int opt, failures = 0;
+
+    while ((opt = getopt(argc, argv, "n:h")) != -1) {
+        switch (opt) {
+        case 'n': iterations = strtoul(optarg, NULL, 0); break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    /* the missing name is logged as an error on every lookup */
+    setenv("HAL_HOST_LOG", "S", 0);
+
+    for (size_t t = 0; t < NUM_NAME_TABLES; t++) {
+        failures += bench_table(&name_tables[t], NULL, iterations);
+        failures += bench_table(&name_tables[t], "NOT_A_NAME", iterations);
+    }
+
+    if (failures != 0)
+        fprintf(stderr, "%d tables differ from the linear scan\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Round trip of the msm8974 name tables through the hash index: every snd
+ * device, usecase and audio source name must come back from
+ * platform_get_*_index() as the index of its first entry in the table, and
+ * near misses of each name (truncated, extended, lower cased) must not be
+ * found. platform.c is compiled into the test to reach the static tables,
+ * the test is linked without the HAL's own copy.
+ *
+ * name_index itself is also checked on small tables: repeated and empty
+ * entries, and an index with a single free slot so that probe sequences
+ * wrap around the end of the slot array.
+ */
+
+#include "msm8974/platform.c"
+
+#include <ctype.h>
+
+#define NUM_NAMES_MAX 400
+
+struct name_table {
+    const char *kind;
+    const struct name_to_index *table;
+    size_t count;
+    int (*lookup)(const char *name);
+};
+
+static int snd_device_lookup(const char *name)
+{
+    return platform_get_snd_device_index((char *)name);
+}
+
+static const struct name_table name_tables[] = {
+    { "snd device", snd_device_name_index, SND_DEVICE_MAX, snd_device_lookup },
+    { "usecase", usecase_name_index, AUDIO_USECASE_MAX, platform_get_usecase_index },
+    { "audio source", audio_source_index, AUDIO_SOURCE_CNT, platform_get_audio_source_index },
+};
+
+#define NUM_NAME_TABLES (sizeof(name_tables) / sizeof(name_tables[0]))
+
+/* what the linear scan find_index() used to do returned */
+static int first_index(const struct name_table *t, const char *name)
+{
+    for (size_t i = 0; i < t->count; i++) {
+        if (strcmp(t->table[i].name, name) == 0)
+            return t->table[i].index;
+    }
+    return -ENODEV;
+}
+
+static int expect_lookup(const struct name_table *t, const char *name, int expected)
+{
+    const int found = t->lookup(name);
+
+    if (found == expected)
+        return 0;
+    fprintf(stderr, "%s \"%s\": %d instead of %d\n", t->kind, name, found, expected);
+    return 1;
+}
+
+/* Names close to name, checked against the table since a variant may be
+   another entry, SND_DEVICE_OUT_SPEAKER is a prefix of many. */
+static int check_near_misses(const struct name_table *t, const char *name)
+{
+    char variant[sizeof(t->table[0].name) + 1];
+    const size_t len = strlen(name);
+    int failures = 0;
+
+    memcpy(variant, name, len - 1);
+    variant[len - 1] = '\0';
+    failures += expect_lookup(t, variant, first_index(t, variant));
+
+    memcpy(variant, name, len);
+    variant[len] = '_';
+    variant[len + 1] = '\0';
+    failures += expect_lookup(t, variant, first_index(t, variant));
+
+    for (size_t i = 0; i <= len; i++)
+        variant[i] = tolower((unsigned char)name[i]);
+    failures += expect_lookup(t, variant, first_index(t, variant));
+    return failures;
+}
+
+static int check_table(const struct name_table *t)
+{
+    size_t names = 0, repeated = 0;
+    int failures = 0;
+
+    for (size_t i = 0; i < t->count; i++) {
+        const char *name = t->table[i].name;
+        const int expected = first_index(t, name);
+
+        if (name[0] == '\0')
+            continue;
+        names++;
+        repeated += expected != (int)t->table[i].index;
+        failures += expect_lookup(t, name, expected);
+        failures += check_near_misses(t, name);
+    }
+    failures += expect_lookup(t, "", -ENODEV);
+
+    printf("%-12s %3zu names, %zu repeated, %zu unnamed entries: %d failures\n", t->kind,
+           names, repeated, t->count - names, failures);
+    if (names == 0) {
+        fprintf(stderr, "%s: empty table\n", t->kind);
+        failures++;
+    }
+    return failures;
+}
+
+static int expect_find(const struct name_index *index, const char *name, bool found,
+                       unsigned int value)
+{
+    unsigned int got = 0;
+    const bool got_found = name_index_find(index, name, &got);
+
+    if (got_found == found && (!found || got == value))
+        return 0;
+    fprintf(stderr, "name_index \"%s\": %s %u, expected %s %u\n", name,
+            got_found ? "found" : "not found", got, found ? "found" : "not found", value);
+    return 1;
+}
+
+static int check_small_tables(void)
+{
+    static struct name_to_index table[NUM_NAMES_MAX];
+    static struct name_index_slot slots[NUM_NAMES_MAX + 1];
+    const struct name_to_index sparse[] = {
+        { "first", 10 },
+        { "", 11 },
+        { "second", 12 },
+        { "first", 13 },
+        { "", 14 },
+    };
+    struct name_index index;
+    int failures = 0;
+
+    name_index_build(&index, slots, NAME_INDEX_SLOTS(ARRAY_SIZE(sparse)), sparse,
+                     ARRAY_SIZE(sparse));
+    failures += expect_find(&index, "first", true, 10);
+    failures += expect_find(&index, "second", true, 12);
+    failures += expect_find(&index, "", false, 0);
+    failures += expect_find(&index, "third", false, 0);
+
+    /* one free slot: most names collide and probes run past the end */
+    for (size_t i = 0; i < NUM_NAMES_MAX; i++) {
+        snprintf(table[i].name, sizeof(table[i].name), "name_%zu", i);
+        table[i].index = i;
+    }
+    name_index_build(&index, slots, NUM_NAMES_MAX + 1, table, NUM_NAMES_MAX);
+    for (size_t i = 0; i < NUM_NAMES_MAX; i++)
+        failures += expect_find(&index, table[i].name, true, i);
+    failures += expect_find(&index, "name_", false, 0);
+    failures += expect_find(&index, "name_400", false, 0);
+
+    printf("%-12s %3d names in %d slots: %d failures\n", "name_index", NUM_NAMES_MAX,
+           NUM_NAMES_MAX + 1, failures);
+    return failures;
+}
+
+int main(int argc __unused, char **argv __unused)
+{
+    int failures = 0;
+
+    /* every near miss is logged as an error */
+    setenv("HAL_HOST_LOG", "S", 0);
+
+    for (size_t t = 0; t < NUM_NAME_TABLES; t++)
+        failures += check_table(&name_tables[t]);
+    failures += check_small_tables();
+
+    if (failures != 0)
+        fprintf(stderr, "%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
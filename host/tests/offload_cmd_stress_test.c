@@ -0,0 +1,331 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Pushes commands through the command ring of the compress offload callback
+ * thread. The fake DSP plays in real time at 8 kbps with its buffer full, so
+ * a drain keeps the thread busy until the stream is paused. Every burst is
+ * a drain followed by 1 to 16 short writes while the thread is held in it:
+ * the first short write queues WAIT_FOR_BUFFER and the others must coalesce
+ * into it, so releasing the thread has to bring exactly one DRAIN_READY and
+ * one WRITE_READY, never more and never none.
+ *
+ * The last phase fills the ring with drains until it refuses one with
+ * -ENOSPC and closes the stream with the commands still queued. The close
+ * must return, EXIT does not take a ring slot.
+ */
+
+#define LOG_TAG "offload_cmd_stress_test"
+
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <hardware/audio.h>
+#include <hardware/hardware.h>
+
+#include "fake_alsa.h"
+
+#define BIT_RATE 8000
+#define WRITE_SIZE 4096
+#define MAX_BURST_WRITES 16
+#define EVENT_TIMEOUT_S 5
+/* a ring larger than this is not bounded in any useful sense */
+#define MAX_RING_DRAINS 64
+/* the close fails through SIGALRM if it hangs on the callback thread */
+#define CLOSE_TIMEOUT_S 30
+
+extern struct audio_module HAL_MODULE_INFO_SYM;
+
+struct offload_events {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    unsigned int write_ready;
+    unsigned int drain_ready;
+};
+
+static uint8_t buffer[WRITE_SIZE];
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void close_timeout(int sig __unused)
+{
+    static const char message[] = "close_output_stream did not return, offload thread hung\n";
+
+    write(STDERR_FILENO, message, sizeof(message) - 1);
+    _exit(1);
+}
+
+static int offload_callback(stream_callback_event_t event, void *param __unused, void *cookie)
+{
+    struct offload_events *events = cookie;
+
+    pthread_mutex_lock(&events->lock);
+    if (event == STREAM_CBK_EVENT_WRITE_READY)
+        events->write_ready++;
+    else if (event == STREAM_CBK_EVENT_DRAIN_READY)
+        events->drain_ready++;
+    pthread_cond_signal(&events->cond);
+    pthread_mutex_unlock(&events->lock);
+    return 0;
+}
+
+/* Waits until the event counts reach write_ready and drain_ready. */
+static bool wait_events(struct offload_events *events, unsigned int write_ready,
+                        unsigned int drain_ready)
+{
+    struct timespec deadline;
+    int ret = 0;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += EVENT_TIMEOUT_S;
+    pthread_mutex_lock(&events->lock);
+    while ((events->write_ready < write_ready || events->drain_ready < drain_ready) && ret == 0)
+        ret = pthread_cond_timedwait(&events->cond, &events->lock, &deadline);
+    pthread_mutex_unlock(&events->lock);
+    return ret == 0;
+}
+
+static void get_events(struct offload_events *events, unsigned int *write_ready,
+                       unsigned int *drain_ready)
+{
+    pthread_mutex_lock(&events->lock);
+    *write_ready = events->write_ready;
+    *drain_ready = events->drain_ready;
+    pthread_mutex_unlock(&events->lock);
+}
+
+static int open_offload_output(struct audio_hw_device *adev, struct audio_stream_out **out,
+                               struct offload_events *events)
+{
+    struct audio_config config = {
+        .sample_rate = 44100,
+        .channel_mask = AUDIO_CHANNEL_OUT_STEREO,
+        .format = AUDIO_FORMAT_MP3,
+        .offload_info = AUDIO_INFO_INITIALIZER,
+    };
+    int ret;
+
+    config.offload_info.format = AUDIO_FORMAT_MP3;
+    config.offload_info.sample_rate = config.sample_rate;
+    config.offload_info.channel_mask = config.channel_mask;
+    config.offload_info.bit_rate = BIT_RATE;
+    ret = adev->open_output_stream(adev, 1, AUDIO_DEVICE_OUT_SPEAKER,
+            AUDIO_OUTPUT_FLAG_DIRECT | AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD |
+            AUDIO_OUTPUT_FLAG_NON_BLOCKING, &config, out, "offload_cmd_stress_test");
+    if (ret != 0) {
+        fprintf(stderr, "open_output_stream failed: %d\n", ret);
+        return ret;
+    }
+    (*out)->set_callback(*out, offload_callback, events);
+    return 0;
+}
+
+/* Writes until the DSP buffer is full and a write comes back short. */
+static int fill_dsp_buffer(struct audio_stream_out *out, struct offload_events *events)
+{
+    for (;;) {
+        unsigned int write_ready, drain_ready;
+        ssize_t written = out->write(out, buffer, sizeof(buffer));
+
+        if (written < 0) {
+            fprintf(stderr, "write failed: %zd\n", written);
+            return (int)written;
+        }
+        if (written == (ssize_t)sizeof(buffer))
+            continue;
+        get_events(events, &write_ready, &drain_ready);
+        if (!wait_events(events, write_ready + 1, drain_ready)) {
+            fprintf(stderr, "no write ready event after filling the buffer\n");
+            return -ETIMEDOUT;
+        }
+        return 0;
+    }
+}
+
+/* One drain and writes short writes behind it, the thread is released by
+   the pause. Returns the number of failures, adds the commands sent and
+   the waits coalesced. */
+static int run_burst(struct audio_stream_out *out, struct offload_events *events,
+                     unsigned int *commands, unsigned int *coalesced)
+{
+    const unsigned int writes = 1 + rand() % MAX_BURST_WRITES;
+    const audio_drain_type_t type = rand() % 2 ? AUDIO_DRAIN_ALL : AUDIO_DRAIN_EARLY_NOTIFY;
+    unsigned int write_ready, drain_ready, short_writes = 0;
+    int ret;
+
+    get_events(events, &write_ready, &drain_ready);
+    ret = out->resume(out);
+    if (ret != 0) {
+        fprintf(stderr, "resume failed: %d\n", ret);
+        return 1;
+    }
+    ret = out->drain(out, type);
+    if (ret != 0) {
+        fprintf(stderr, "drain failed: %d\n", ret);
+        return 1;
+    }
+    (*commands)++;
+    for (unsigned int i = 0; i < writes; i++) {
+        ssize_t written = out->write(out, buffer, sizeof(buffer));
+
+        if (written < 0) {
+            fprintf(stderr, "write failed: %zd\n", written);
+            return 1;
+        }
+        if (written < (ssize_t)sizeof(buffer))
+            short_writes++;
+    }
+    *commands += short_writes;
+    ret = out->pause(out);
+    if (ret != 0) {
+        fprintf(stderr, "pause failed: %d\n", ret);
+        return 1;
+    }
+
+    if (!wait_events(events, write_ready + (short_writes > 0), drain_ready + 1)) {
+        unsigned int now_write_ready, now_drain_ready;
+
+        get_events(events, &now_write_ready, &now_drain_ready);
+        fprintf(stderr, "burst of %u short writes: no %s ready event\n", short_writes,
+                now_drain_ready == drain_ready ? "drain" : "write");
+        return 1;
+    }
+    /* a duplicate would arrive right behind the expected ones */
+    usleep(100);
+    pthread_mutex_lock(&events->lock);
+    ret = events->write_ready - write_ready != (short_writes > 0) ||
+            events->drain_ready - drain_ready != 1;
+    if (ret != 0) {
+        fprintf(stderr, "burst of %u short writes: %u write ready and %u drain ready "
+                "events\n", short_writes, events->write_ready - write_ready,
+                events->drain_ready - drain_ready);
+    }
+    pthread_mutex_unlock(&events->lock);
+    if (short_writes > 0)
+        *coalesced += short_writes - 1;
+    return ret;
+}
+
+/* Queues drains behind the one holding the thread until the ring is full,
+   then closes the stream with them pending. */
+static int close_with_full_ring(struct audio_hw_device *adev, struct audio_stream_out *out)
+{
+    unsigned int queued = 0;
+    int64_t start_ns;
+    int ret = 0;
+
+    out->resume(out);
+    while (queued < MAX_RING_DRAINS && (ret = out->drain(out, AUDIO_DRAIN_ALL)) == 0)
+        queued++;
+    if (ret != -ENOSPC) {
+        fprintf(stderr, "%u drains queued, the ring never refused one (%d)\n", queued, ret);
+        ret = 1;
+    } else {
+        ret = 0;
+    }
+
+    signal(SIGALRM, close_timeout);
+    alarm(CLOSE_TIMEOUT_S);
+    start_ns = now_ns();
+    adev->close_output_stream(adev, out);
+    alarm(0);
+    printf("ring full after %u drains, closed in %.2f ms\n", queued,
+           (now_ns() - start_ns) / 1e6);
+    return ret;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n <n>  commands sent to the offload thread (default 100000)\n"
+            "  -s <n>  random seed (default 1)\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    const struct hw_module_t *module = &HAL_MODULE_INFO_SYM.common;
+    const struct fake_alsa_config fake_config = { .real_time = true };
+    struct offload_events events = {
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+        .cond = PTHREAD_COND_INITIALIZER,
+    };
+    struct hw_device_t *device = NULL;
+    struct audio_hw_device *adev;
+    struct audio_stream_out *out = NULL;
+    unsigned int target = 100000, seed = 1;
+    unsigned int commands = 0, coalesced = 0, bursts = 0;
+    int opt, ret, failures = 0;
+    int64_t start_ns;
+
+    while ((opt = getopt(argc, argv, "n:s:h")) != -1) {
+        switch (opt) {
+        case 'n': target = strtoul(optarg, NULL, 0); break;
+        case 's': seed = strtoul(optarg, NULL, 0); break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    /* keep the progress lines if the close times out */
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    setenv("HAL_HOST_LOG", "S", 0);
+    srand(seed);
+    fake_alsa_configure(&fake_config);
+    ret = module->methods->open(module, AUDIO_HARDWARE_INTERFACE, &device);
+    if (ret != 0) {
+        fprintf(stderr, "adev_open failed: %d\n", ret);
+        return 1;
+    }
+    adev = (struct audio_hw_device *)device;
+    if (open_offload_output(adev, &out, &events) != 0 || fill_dsp_buffer(out, &events) != 0) {
+        device->close(device);
+        return 1;
+    }
+    out->pause(out);
+
+    start_ns = now_ns();
+    while (commands < target && failures == 0) {
+        failures += run_burst(out, &events, &commands, &coalesced);
+        bursts++;
+    }
+    printf("%u commands in %u bursts, %u waits coalesced, %.1f us per burst\n", commands,
+           bursts, coalesced, bursts ? (now_ns() - start_ns) / 1e3 / bursts : 0);
+    if (failures == 0 && coalesced == 0) {
+        fprintf(stderr, "no wait was coalesced\n");
+        failures++;
+    }
+
+    failures += close_with_full_ring(adev, out);
+    device->close(device);
+    if (failures != 0)
+        fprintf(stderr, "%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
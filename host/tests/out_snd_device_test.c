@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Differential test of the msm8974 output snd device cache: random walks
+ * over the device masks and every state get_output_snd_device() reads,
+ * comparing platform_get_output_snd_device() against the uncached decision
+ * tree after each step. platform.c is compiled into the test to reach the
+ * static decision tree, the test is linked without the HAL's own copy.
+ *
+ * HFP, USB capture and MaxxAudio USB support are compile time constants in
+ * the host build and stay fixed.
+ *
+ *   out_snd_device_test [seed] [steps]
+ */
+
+#include "msm8974/platform.c"
+
+#include <hardware/hardware.h>
+
+extern struct audio_module HAL_MODULE_INFO_SYM;
+
+static const audio_devices_t single_devices[] = {
+    AUDIO_DEVICE_OUT_EARPIECE,
+    AUDIO_DEVICE_OUT_SPEAKER,
+    AUDIO_DEVICE_OUT_WIRED_HEADSET,
+    AUDIO_DEVICE_OUT_WIRED_HEADPHONE,
+    AUDIO_DEVICE_OUT_BLUETOOTH_SCO,
+    AUDIO_DEVICE_OUT_BLUETOOTH_SCO_HEADSET,
+    AUDIO_DEVICE_OUT_BLUETOOTH_SCO_CARKIT,
+    AUDIO_DEVICE_OUT_BLUETOOTH_A2DP,
+    AUDIO_DEVICE_OUT_BLUETOOTH_A2DP_HEADPHONES,
+    AUDIO_DEVICE_OUT_AUX_DIGITAL,
+    AUDIO_DEVICE_OUT_USB_DEVICE,
+    AUDIO_DEVICE_OUT_USB_HEADSET,
+    AUDIO_DEVICE_OUT_TELEPHONY_TX,
+    AUDIO_DEVICE_OUT_LINE,
+    AUDIO_DEVICE_OUT_SPEAKER_SAFE,
+    AUDIO_DEVICE_OUT_HEARING_AID,
+    AUDIO_DEVICE_OUT_PROXY,
+};
+
+#define NUM_SINGLE_DEVICES (sizeof(single_devices) / sizeof(single_devices[0]))
+
+static const int tty_modes[] = { TTY_MODE_OFF, TTY_MODE_FULL, TTY_MODE_VCO, TTY_MODE_HCO };
+
+/* Mostly the devices AudioPolicy routes to, some invalid masks */
+static audio_devices_t random_devices(void)
+{
+    int r = rand() % 100;
+
+    if (r < 60)
+        return single_devices[rand() % NUM_SINGLE_DEVICES];
+    if (r < 95)
+        return single_devices[rand() % NUM_SINGLE_DEVICES] |
+               single_devices[rand() % NUM_SINGLE_DEVICES];
+    if (r < 98)
+        return AUDIO_DEVICE_NONE;
+    return AUDIO_DEVICE_IN_BUILTIN_MIC;
+}
+
+/* Changes one input of the decision tree */
+static void random_state_change(struct platform_data *my_data)
+{
+    struct audio_device *adev = my_data->adev;
+
+    switch (rand() % 8) {
+    case 0: adev->voice.in_call = !adev->voice.in_call; break;
+    case 1: adev->enable_voicerx = !adev->enable_voicerx; break;
+    case 2: adev->enable_hfp = !adev->enable_hfp; break;
+    case 3: adev->bt_wb_speech_enabled = !adev->bt_wb_speech_enabled; break;
+    case 4: adev->voice.hac = !adev->voice.hac; break;
+    case 5: adev->voice.tty_mode = tty_modes[rand() % 4]; break;
+    case 6: my_data->speaker_lr_swap = !my_data->speaker_lr_swap; break;
+    case 7:
+        /* the speaker reverse choice depends on the two acdb ids differing */
+        platform_set_snd_device_acdb_id(SND_DEVICE_OUT_SPEAKER_REVERSE,
+                rand() % 2 ? acdb_device_table[SND_DEVICE_OUT_SPEAKER] :
+                             acdb_device_table[SND_DEVICE_OUT_SPEAKER] + 1);
+        break;
+    }
+}
+
+static bool cache_hit(struct platform_data *my_data, audio_devices_t devices)
+{
+    struct out_snd_device_key key;
+
+    get_output_snd_device_key(my_data, devices, &key);
+    for (int i = 0; i < OUT_SND_DEVICE_CACHE_SIZE; i++) {
+        const struct out_snd_device_cache_entry *entry = &my_data->out_snd_device_cache[i];
+
+        if (entry->valid && memcmp(&entry->key, &key, sizeof(key)) == 0)
+            return true;
+    }
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    const struct hw_module_t *module = &HAL_MODULE_INFO_SYM.common;
+    struct hw_device_t *device = NULL;
+    struct audio_device *adev;
+    struct platform_data *my_data;
+    unsigned int seed = argc > 1 ? strtoul(argv[1], NULL, 0) : 1;
+    unsigned long steps = argc > 2 ? strtoul(argv[2], NULL, 0) : 200000;
+    unsigned long lookups, hits = 0, failures = 0;
+    int ret;
+
+    /* invalid masks are logged as errors on every uncached lookup */
+    setenv("HAL_HOST_LOG", "S", 0);
+
+    ret = module->methods->open(module, AUDIO_HARDWARE_INTERFACE, &device);
+    if (ret != 0) {
+        fprintf(stderr, "adev_open failed: %d\n", ret);
+        return 1;
+    }
+    adev = (struct audio_device *)device;
+    my_data = adev->platform;
+
+    srand(seed);
+    pthread_mutex_lock(&adev->lock);
+    for (lookups = 0; lookups < steps && failures < 10; lookups++) {
+        /* a few lookups per state so that entries get reused */
+        if (rand() % 4 == 0)
+            random_state_change(my_data);
+
+        const audio_devices_t devices = random_devices();
+        const bool hit = cache_hit(my_data, devices);
+        const snd_device_t cached = platform_get_output_snd_device(my_data, devices);
+        const snd_device_t expected = get_output_snd_device(my_data, devices);
+
+        hits += hit;
+        if (cached != expected) {
+            fprintf(stderr, "step %lu: devices %#x in_call %d voicerx %d enable_hfp %d "
+                    "bt_wb %d hac %d tty %d lr_swap %d: %s (%s) instead of %s\n",
+                    lookups, devices, adev->voice.in_call, adev->enable_voicerx,
+                    adev->enable_hfp, adev->bt_wb_speech_enabled, adev->voice.hac,
+                    adev->voice.tty_mode, my_data->speaker_lr_swap,
+                    platform_get_snd_device_name(cached), hit ? "cached" : "computed",
+                    platform_get_snd_device_name(expected));
+            failures++;
+        }
+    }
+    pthread_mutex_unlock(&adev->lock);
+    device->close(device);
+
+    printf("seed %u: %lu lookups, %lu cache hits, %lu mismatches\n", seed, lookups, hits,
+           failures);
+    /* a walk that never hits the cache tests nothing */
+    return failures == 0 && hits > 0 ? 0 : 1;
+}
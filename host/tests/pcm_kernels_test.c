@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Checks that the pcm_kernels are bit exact with a per sample reference for
+ * every frame count up to a few vector blocks past the tails, some AF buffer
+ * sizes, and every byte offset of the buffers, so that the SIMD paths, the
+ * scalar tails and the unaligned fallbacks all run. Random samples cover
+ * the full range. Bytes around the outputs must be left untouched.
+ *
+ *   pcm_kernels_test [seed]
+ */
+
+#define LOG_TAG "pcm_kernels_test"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pcm_kernels.h"
+
+#define MAX_FRAMES 2048
+#define MAX_CHANNELS 4
+#define MAX_BYTES_PER_SAMPLE 4
+#define MAX_OFFSET 16
+#define GUARD 32
+#define GUARD_BYTE 0xa5
+
+/* frame counts past the small ones, AF buffer sizes and their neighbours */
+static const size_t large_frames[] = { 191, 192, 193, 240, 480, 960, 1021, 1024, 2047, 2048 };
+
+#define NUM_SMALL_FRAMES 70
+#define NUM_LARGE_FRAMES (sizeof(large_frames) / sizeof(large_frames[0]))
+
+#define ALIGNED __attribute__((aligned(16)))
+
+static uint8_t input[MAX_FRAMES * MAX_CHANNELS * MAX_BYTES_PER_SAMPLE] ALIGNED;
+static uint8_t buffer_space[GUARD + MAX_OFFSET + sizeof(input) + GUARD] ALIGNED;
+static uint8_t haptic_space[GUARD + MAX_OFFSET + sizeof(input) + GUARD] ALIGNED;
+static uint8_t expected_audio[sizeof(input)] ALIGNED;
+static uint8_t expected_haptic[sizeof(input)] ALIGNED;
+
+static size_t frame_count(size_t index)
+{
+    return index < NUM_SMALL_FRAMES ? index : large_frames[index - NUM_SMALL_FRAMES];
+}
+
+static void fill_random(uint8_t *data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+        data[i] = rand();
+}
+
+static bool guard_intact(const uint8_t *data, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+        if (data[i] != GUARD_BYTE)
+            return false;
+    }
+    return true;
+}
+
+/* ------------------------------------------------------------ split_haptics */
+
+struct haptic_layout {
+    size_t bytes_per_sample;
+    size_t audio_channels;
+    size_t haptic_channels;
+    size_t skip_channels;
+};
+
+/* the vectorized layouts at every sample size, and some the scalar code takes */
+static const struct haptic_layout haptic_layouts[] = {
+    { 2, 2, 1, 0 }, { 2, 1, 1, 1 }, { 2, 2, 2, 0 },
+    { 3, 2, 1, 0 }, { 3, 1, 1, 1 }, { 3, 2, 2, 0 },
+    { 4, 2, 1, 0 }, { 4, 1, 1, 1 }, { 4, 2, 2, 0 },
+    { 2, 1, 1, 0 }, { 2, 1, 1, 2 }, { 4, 2, 1, 1 }, { 4, 1, 2, 0 },
+};
+
+#define NUM_HAPTIC_LAYOUTS (sizeof(haptic_layouts) / sizeof(haptic_layouts[0]))
+
+static void split_haptics_reference(const struct haptic_layout *layout, const uint8_t *src,
+                                    size_t frames, uint8_t *audio, uint8_t *haptic)
+{
+    const size_t bps = layout->bytes_per_sample;
+
+    for (size_t f = 0; f < frames; f++) {
+        for (size_t c = 0; c < layout->audio_channels; c++, src += bps, audio += bps)
+            memcpy(audio, src, bps);
+        for (size_t c = 0; c < layout->haptic_channels; c++, src += bps, haptic += bps)
+            memcpy(haptic, src, bps);
+        src += layout->skip_channels * bps;
+    }
+}
+
+static int check_split_haptics(const struct haptic_layout *layout, size_t frames,
+                               size_t offset, size_t haptic_offset)
+{
+    const size_t bps = layout->bytes_per_sample;
+    const size_t in_size = frames *
+            (layout->audio_channels + layout->haptic_channels + layout->skip_channels) * bps;
+    const size_t audio_size = frames * layout->audio_channels * bps;
+    const size_t haptic_size = frames * layout->haptic_channels * bps;
+    uint8_t *buffer = buffer_space + GUARD + offset;
+    uint8_t *haptic = haptic_space + GUARD + haptic_offset;
+
+    memset(buffer_space, GUARD_BYTE, sizeof(buffer_space));
+    memset(haptic_space, GUARD_BYTE, sizeof(haptic_space));
+    memcpy(buffer, input, in_size);
+    split_haptics_reference(layout, input, frames, expected_audio, expected_haptic);
+
+    pcm_kernels_split_haptics(buffer, haptic, frames, bps, layout->audio_channels,
+                              layout->haptic_channels, layout->skip_channels);
+
+    if (memcmp(buffer, expected_audio, audio_size) != 0 ||
+            memcmp(haptic, expected_haptic, haptic_size) != 0 ||
+            !guard_intact(buffer_space, GUARD + offset) ||
+            !guard_intact(buffer + in_size, GUARD) ||
+            !guard_intact(haptic_space, GUARD + haptic_offset) ||
+            !guard_intact(haptic + haptic_size, sizeof(haptic_space) - GUARD - haptic_offset -
+                          haptic_size)) {
+        fprintf(stderr, "split_haptics %zu bytes %zu+%zu+%zu channels, %zu frames, "
+                "offsets %zu/%zu: %s\n", bps, layout->audio_channels,
+                layout->haptic_channels, layout->skip_channels, frames, offset, haptic_offset,
+                memcmp(buffer, expected_audio, audio_size) != 0 ? "audio differs" :
+                memcmp(haptic, expected_haptic, haptic_size) != 0 ? "haptics differ" :
+                "wrote outside of its buffers");
+        return 1;
+    }
+    return 0;
+}
+
+static int test_split_haptics(int *checks)
+{
+    int failures = 0;
+
+    for (size_t l = 0; l < NUM_HAPTIC_LAYOUTS; l++) {
+        for (size_t i = 0; i < NUM_SMALL_FRAMES + NUM_LARGE_FRAMES; i++) {
+            const size_t frames = frame_count(i);
+
+            /* every pair of offsets for the short runs, matching ones for the long */
+            for (size_t offset = 0; offset < MAX_OFFSET; offset++) {
+                for (size_t haptic_offset = 0; haptic_offset < MAX_OFFSET; haptic_offset++) {
+                    if (i >= NUM_SMALL_FRAMES && haptic_offset != offset)
+                        continue;
+                    failures += check_split_haptics(&haptic_layouts[l], frames, offset,
+                                                    haptic_offset);
+                    (*checks)++;
+                }
+            }
+        }
+    }
+    return failures;
+}
+
+/* ------------------------------------------------------------ downmix_to_mono_16 */
+
+static int check_downmix(size_t frames, size_t src_offset, size_t dst_offset, bool in_place)
+{
+    const int16_t *in = (const int16_t *)input;
+    int16_t *src = (int16_t *)(buffer_space + GUARD + src_offset * sizeof(int16_t));
+    int16_t *dst = in_place ? src :
+            (int16_t *)(haptic_space + GUARD + dst_offset * sizeof(int16_t));
+    int16_t *expected = (int16_t *)expected_audio;
+    const size_t src_size = frames * 2 * sizeof(int16_t);
+    const size_t dst_size = frames * sizeof(int16_t);
+    bool guards;
+
+    memset(buffer_space, GUARD_BYTE, sizeof(buffer_space));
+    memset(haptic_space, GUARD_BYTE, sizeof(haptic_space));
+    memcpy(src, in, src_size);
+    for (size_t i = 0; i < frames; i++)
+        expected[i] = (int16_t)(((int32_t)in[2 * i] + (int32_t)in[2 * i + 1]) >> 1);
+
+    pcm_kernels_downmix_to_mono_16(dst, src, frames);
+
+    guards = guard_intact(buffer_space, (uint8_t *)src - buffer_space) &&
+            guard_intact((uint8_t *)src + src_size, GUARD);
+    if (in_place) {
+        /* the second half of the source is not written */
+        guards = guards && memcmp((uint8_t *)src + dst_size, (const uint8_t *)in + dst_size,
+                                  src_size - dst_size) == 0;
+    } else {
+        guards = guards && memcmp(src, in, src_size) == 0 &&
+                guard_intact(haptic_space, (uint8_t *)dst - haptic_space) &&
+                guard_intact((uint8_t *)dst + dst_size, GUARD);
+    }
+    if (memcmp(dst, expected, dst_size) != 0 || !guards) {
+        fprintf(stderr, "downmix_to_mono_16 %zu frames, offsets %zu/%zu%s: %s\n", frames,
+                src_offset, dst_offset, in_place ? " in place" : "",
+                memcmp(dst, expected, dst_size) != 0 ? "output differs" :
+                "wrote outside of its output");
+        return 1;
+    }
+    return 0;
+}
+
+static int test_downmix(int *checks)
+{
+    const size_t max_offset = MAX_OFFSET / sizeof(int16_t);
+    int failures = 0;
+
+    for (size_t i = 0; i < NUM_SMALL_FRAMES + NUM_LARGE_FRAMES; i++) {
+        const size_t frames = frame_count(i);
+
+        for (size_t src_offset = 0; src_offset < max_offset; src_offset++) {
+            failures += check_downmix(frames, src_offset, 0, true);
+            (*checks)++;
+            for (size_t dst_offset = 0; dst_offset < max_offset; dst_offset++) {
+                failures += check_downmix(frames, src_offset, dst_offset, false);
+                (*checks)++;
+            }
+        }
+    }
+    return failures;
+}
+
+/* ------------------------------------------------------------ shift_24_8_to_8_24 */
+
+static int check_shift(size_t samples, size_t offset)
+{
+    const int32_t *in = (const int32_t *)input;
+    int32_t *buffer = (int32_t *)(buffer_space + GUARD + offset * sizeof(int32_t));
+    int32_t *expected = (int32_t *)expected_audio;
+    const size_t size = samples * sizeof(int32_t);
+
+    memset(buffer_space, GUARD_BYTE, sizeof(buffer_space));
+    memcpy(buffer, in, size);
+    for (size_t i = 0; i < samples; i++)
+        expected[i] = in[i] >> 8;
+
+    pcm_kernels_shift_24_8_to_8_24(buffer, samples);
+
+    if (memcmp(buffer, expected, size) != 0 ||
+            !guard_intact(buffer_space, (uint8_t *)buffer - buffer_space) ||
+            !guard_intact((uint8_t *)buffer + size, GUARD)) {
+        fprintf(stderr, "shift_24_8_to_8_24 %zu samples, offset %zu: %s\n", samples, offset,
+                memcmp(buffer, expected, size) != 0 ? "output differs" :
+                "wrote outside of its buffer");
+        return 1;
+    }
+    return 0;
+}
+
+static int test_shift(int *checks)
+{
+    int failures = 0;
+
+    /* stereo and mono captures */
+    for (size_t i = 0; i < NUM_SMALL_FRAMES + NUM_LARGE_FRAMES; i++) {
+        for (size_t channels = 1; channels <= 2; channels++) {
+            for (size_t offset = 0; offset < MAX_OFFSET / sizeof(int32_t); offset++) {
+                failures += check_shift(frame_count(i) * channels, offset);
+                (*checks)++;
+            }
+        }
+    }
+    return failures;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int seed = argc > 1 ? strtoul(argv[1], NULL, 0) : 1;
+    int checks = 0, failures = 0;
+
+    srand(seed);
+    fill_random(input, sizeof(input));
+    /* the extremes of the downmix sum and of the shift */
+    for (size_t i = 0; i < 8; i++) {
+        ((int16_t *)input)[i] = i < 4 ? INT16_MIN : INT16_MAX;
+        ((int32_t *)input)[8 + i] = i < 4 ? INT32_MIN : INT32_MAX;
+    }
+
+    failures += test_split_haptics(&checks);
+    failures += test_downmix(&checks);
+    failures += test_shift(&checks);
+
+    printf("%d checks, %d failures\n", checks, failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Replays the play session traces of period_tuner_traces.txt through the
+ * low latency period tuner, configured as audio_hw.c configures it for the
+ * msm8974 low latency output. Every decision is checked against the tuner
+ * bounds, and a trace fails when the period count it ends on or the number
+ * of underruns it took differs from its expectation.
+ *
+ *   period_tuner_replay [traces]
+ */
+
+#define LOG_TAG "period_tuner_replay"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "period_tuner.h"
+
+#define MAX_ARGS 6
+
+/* audio_hw.c defaults, see PERIOD_TUNER_* there */
+#define SAMPLE_RATE 48000
+#define PERIOD_SIZE 240
+#define MIN_COUNT 2
+#define MAX_COUNT 8
+#define SHRINK_AFTER 8
+#define MIN_SESSION_MS 2000
+#define HIGH_CPU_PRESSURE 20
+
+/* length of the sessions played on a simulated device */
+#define DEVICE_SESSION_FRAMES (SAMPLE_RATE * 10)
+
+struct trace {
+    char name[64];
+    struct period_tuner tuner;
+    unsigned int sessions;
+    unsigned int underruns;
+    uint64_t buffer_frames;          /* sum of the decided buffer sizes */
+    bool failed;
+};
+
+static int split_args(char *line, char **argv)
+{
+    int argc = 0;
+    char *saveptr = NULL;
+
+    for (char *tok = strtok_r(line, " \t\n", &saveptr); tok != NULL && argc < MAX_ARGS;
+            tok = strtok_r(NULL, " \t\n", &saveptr))
+        argv[argc++] = tok;
+    return argc;
+}
+
+static void start_trace(struct trace *trace, const char *name, unsigned int period_count,
+                        unsigned int min_count, unsigned int max_count)
+{
+    const struct period_tuner_config config = {
+        .period_size = PERIOD_SIZE,
+        .min_count = min_count,
+        .max_count = max_count,
+        .shrink_after = SHRINK_AFTER,
+        .min_session_frames = (int64_t)SAMPLE_RATE * MIN_SESSION_MS / 1000,
+        .high_cpu_pressure = HIGH_CPU_PRESSURE,
+    };
+
+    memset(trace, 0, sizeof(*trace));
+    strlcpy(trace->name, name, sizeof(trace->name));
+    period_tuner_init(&trace->tuner, &config, period_count);
+}
+
+/* The configuration of the next session, checked against the tuner bounds */
+static unsigned int decide(struct trace *trace, int cpu_pressure)
+{
+    const struct period_tuner_config *config = &trace->tuner.config;
+    struct period_tuner_decision decision;
+
+    period_tuner_decide(&trace->tuner, cpu_pressure, &decision);
+    if (decision.period_count < config->min_count || decision.period_count > config->max_count) {
+        fprintf(stderr, "%s: session %u: %u periods outside [%u, %u]\n", trace->name,
+                trace->sessions, decision.period_count, config->min_count, config->max_count);
+        trace->failed = true;
+    }
+    /* a start threshold at or above the buffer size never starts the pcm */
+    if (decision.start_threshold >= decision.period_count * config->period_size) {
+        fprintf(stderr, "%s: session %u: start threshold %u with %u periods\n", trace->name,
+                trace->sessions, decision.start_threshold, decision.period_count);
+        trace->failed = true;
+    }
+    if (decision.avail_min == 0 || decision.avail_min > config->period_size) {
+        fprintf(stderr, "%s: session %u: avail_min %u\n", trace->name, trace->sessions,
+                decision.avail_min);
+        trace->failed = true;
+    }
+    trace->buffer_frames += decision.period_count * config->period_size;
+    return decision.period_count;
+}
+
+static void end_session(struct trace *trace, int64_t frames, int64_t underruns,
+                        int cpu_pressure)
+{
+    const struct period_tuner_session session = {
+        .frames = frames,
+        .underruns = underruns,
+        .cpu_pressure = cpu_pressure,
+    };
+
+    period_tuner_end_session(&trace->tuner, &session);
+    trace->sessions++;
+    trace->underruns += underruns > 0;
+}
+
+/* One recorded session, [expected] is the period count it must run with */
+static void replay_session(struct trace *trace, int64_t frames, int64_t underruns,
+                           int cpu_pressure, int expected)
+{
+    const unsigned int period_count = decide(trace, cpu_pressure);
+
+    if (expected >= 0 && period_count != (unsigned int)expected) {
+        fprintf(stderr, "%s: session %u ran with %u periods, expected %d\n", trace->name,
+                trace->sessions, period_count, expected);
+        trace->failed = true;
+    }
+    end_session(trace, frames, underruns, cpu_pressure);
+}
+
+/* Sessions on a device that underruns with fewer than needed periods, and
+   every glitch_every-th session whatever the buffer */
+static void simulate_device(struct trace *trace, unsigned int sessions, unsigned int needed,
+                            int cpu_pressure, unsigned int glitch_every)
+{
+    for (unsigned int i = 0; i < sessions; i++) {
+        const unsigned int period_count = decide(trace, cpu_pressure);
+        const bool glitch = period_count < needed ||
+                (glitch_every > 0 && i % glitch_every == glitch_every - 1);
+
+        end_session(trace, DEVICE_SESSION_FRAMES, glitch, cpu_pressure);
+    }
+}
+
+static void check_trace(struct trace *trace, unsigned int expected_count, int max_underruns)
+{
+    const struct period_tuner *tuner = &trace->tuner;
+
+    if (tuner->period_count != expected_count) {
+        fprintf(stderr, "%s: learned %u periods, expected %u\n", trace->name,
+                tuner->period_count, expected_count);
+        trace->failed = true;
+    }
+    if (max_underruns >= 0 && trace->underruns > (unsigned int)max_underruns) {
+        fprintf(stderr, "%s: %u sessions with underruns, expected at most %d\n", trace->name,
+                trace->underruns, max_underruns);
+        trace->failed = true;
+    }
+}
+
+static void print_trace(const struct trace *trace)
+{
+    const struct period_tuner *tuner = &trace->tuner;
+    const double mean_ms = trace->sessions ?
+            (double)trace->buffer_frames * 1000 / SAMPLE_RATE / trace->sessions : 0;
+
+    printf("  %u sessions, %u with underruns, %u grows, %u shrinks, %u periods, "
+           "mean buffer %.1f ms\n", trace->sessions, trace->underruns, tuner->grows,
+           tuner->shrinks, tuner->period_count, mean_ms);
+}
+
+static int run_step(struct trace *trace, int argc, char **argv)
+{
+    if (strcmp(argv[0], "session") == 0 && (argc == 4 || argc == 5)) {
+        replay_session(trace, strtoll(argv[1], NULL, 0), strtoll(argv[2], NULL, 0),
+                       atoi(argv[3]), argc == 5 ? atoi(argv[4]) : -1);
+        return 0;
+    }
+    if (strcmp(argv[0], "repeat") == 0 && argc == 5) {
+        for (int i = atoi(argv[1]); i > 0; i--)
+            replay_session(trace, strtoll(argv[2], NULL, 0), strtoll(argv[3], NULL, 0),
+                           atoi(argv[4]), -1);
+        return 0;
+    }
+    if (strcmp(argv[0], "device") == 0 && (argc == 4 || argc == 5)) {
+        simulate_device(trace, atoi(argv[1]), atoi(argv[2]), atoi(argv[3]),
+                        argc == 5 ? atoi(argv[4]) : 0);
+        return 0;
+    }
+    if (strcmp(argv[0], "expect") == 0 && (argc == 2 || argc == 3)) {
+        check_trace(trace, atoi(argv[1]), argc == 3 ? atoi(argv[2]) : -1);
+        return 0;
+    }
+    return -EINVAL;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = argc > 1 ? argv[1] : "tests/period_tuner_traces.txt";
+    struct trace trace = { 0 };
+    bool in_trace = false;
+    char line[256];
+    int line_no = 0, traces = 0, failures = 0;
+    FILE *file;
+
+    /* keep the trace lines in order with the failures on stderr */
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return 1;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char *args[MAX_ARGS];
+        char step[256];
+        int nargs;
+
+        line_no++;
+        if (line[0] == '#')
+            continue;
+        strlcpy(step, line, sizeof(step));
+        step[strcspn(step, "\n")] = '\0';
+        nargs = split_args(line, args);
+        if (nargs == 0)
+            continue;
+
+        if (strcmp(args[0], "trace") == 0 && (nargs == 3 || nargs == 5)) {
+            start_trace(&trace, args[1], atoi(args[2]),
+                        nargs == 5 ? atoi(args[3]) : MIN_COUNT,
+                        nargs == 5 ? atoi(args[4]) : MAX_COUNT);
+            in_trace = true;
+            traces++;
+            printf("%s\n", trace.name);
+            continue;
+        }
+        if (!in_trace) {
+            fprintf(stderr, "%s:%d: step outside of a trace\n", path, line_no);
+            return 1;
+        }
+        if (strcmp(args[0], "end") == 0) {
+            print_trace(&trace);
+            failures += trace.failed;
+            in_trace = false;
+            continue;
+        }
+        if (run_step(&trace, nargs, args) != 0) {
+            fprintf(stderr, "%s:%d: bad step '%s'\n", path, line_no, step);
+            return 1;
+        }
+    }
+    fclose(file);
+    if (in_trace) {
+        fprintf(stderr, "%s: missing end\n", trace.name);
+        return 1;
+    }
+
+    printf("%d traces, %d failures\n", traces, failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,504 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Replays the routing sequences of route_sequences.txt through the HAL entry
+ * points and counts the mixer control writes of every step. A step fails
+ * when it writes more controls than its budget or, for an expect step, when
+ * a control does not hold the value it names. A sequence fails when the
+ * mixer state it ends in differs from the one a fresh device reaches by
+ * opening the same streams directly on their final devices.
+ */
+
+#define LOG_TAG "route_replay_test"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <hardware/audio.h>
+#include <hardware/hardware.h>
+
+#include "fake_alsa.h"
+
+#define MAX_STREAMS 8
+#define MAX_ARGS 8
+
+extern struct audio_module HAL_MODULE_INFO_SYM;
+
+enum stream_type {
+    STREAM_PRIMARY,
+    STREAM_DEEP,
+    STREAM_LOW_LATENCY,
+    STREAM_MIC,
+};
+
+struct replay_stream {
+    char name[32];
+    enum stream_type type;
+    audio_devices_t device;
+    bool written;                    /* at least one buffer went through */
+    bool parked;                     /* put in standby, skipped by write */
+    struct audio_stream_out *out;
+    struct audio_stream_in *in;
+    void *buffer;
+    size_t buffer_size;
+};
+
+struct replay {
+    struct audio_hw_device *adev;
+    struct replay_stream streams[MAX_STREAMS];
+    audio_mode_t mode;
+    int next_handle;
+};
+
+static const struct {
+    const char *name;
+    audio_devices_t device;
+} device_names[] = {
+    { "earpiece", AUDIO_DEVICE_OUT_EARPIECE },
+    { "speaker", AUDIO_DEVICE_OUT_SPEAKER },
+    { "headset", AUDIO_DEVICE_OUT_WIRED_HEADSET },
+    { "headphones", AUDIO_DEVICE_OUT_WIRED_HEADPHONE },
+    { "speaker-and-headphones", AUDIO_DEVICE_OUT_SPEAKER | AUDIO_DEVICE_OUT_WIRED_HEADPHONE },
+    { "line", AUDIO_DEVICE_OUT_LINE },
+    { "speaker-and-line", AUDIO_DEVICE_OUT_SPEAKER | AUDIO_DEVICE_OUT_LINE },
+    { "bt-sco", AUDIO_DEVICE_OUT_BLUETOOTH_SCO },
+    { "builtin-mic", AUDIO_DEVICE_IN_BUILTIN_MIC },
+    { "back-mic", AUDIO_DEVICE_IN_BACK_MIC },
+    { "headset-mic", AUDIO_DEVICE_IN_WIRED_HEADSET },
+};
+
+static const struct {
+    const char *name;
+    audio_mode_t mode;
+} mode_names[] = {
+    { "normal", AUDIO_MODE_NORMAL },
+    { "ringtone", AUDIO_MODE_RINGTONE },
+    { "in-call", AUDIO_MODE_IN_CALL },
+    { "in-communication", AUDIO_MODE_IN_COMMUNICATION },
+};
+
+static const char *const type_names[] = {
+    [STREAM_PRIMARY] = "primary",
+    [STREAM_DEEP] = "deep",
+    [STREAM_LOW_LATENCY] = "low-latency",
+    [STREAM_MIC] = "mic",
+};
+
+static int parse_device(const char *name, audio_devices_t *device)
+{
+    for (size_t i = 0; i < sizeof(device_names) / sizeof(device_names[0]); i++) {
+        if (strcmp(device_names[i].name, name) == 0) {
+            *device = device_names[i].device;
+            return 0;
+        }
+    }
+    return -EINVAL;
+}
+
+static int parse_mode(const char *name, audio_mode_t *mode)
+{
+    for (size_t i = 0; i < sizeof(mode_names) / sizeof(mode_names[0]); i++) {
+        if (strcmp(mode_names[i].name, name) == 0) {
+            *mode = mode_names[i].mode;
+            return 0;
+        }
+    }
+    return -EINVAL;
+}
+
+static int parse_type(const char *name, enum stream_type *type)
+{
+    for (size_t i = 0; i < sizeof(type_names) / sizeof(type_names[0]); i++) {
+        if (strcmp(type_names[i], name) == 0) {
+            *type = (enum stream_type)i;
+            return 0;
+        }
+    }
+    return -EINVAL;
+}
+
+static struct replay_stream *find_stream(struct replay *replay, const char *name)
+{
+    for (int i = 0; i < MAX_STREAMS; i++) {
+        if (replay->streams[i].name[0] != '\0' && strcmp(replay->streams[i].name, name) == 0)
+            return &replay->streams[i];
+    }
+    return NULL;
+}
+
+static int open_device(struct replay *replay)
+{
+    const struct hw_module_t *module = &HAL_MODULE_INFO_SYM.common;
+    struct hw_device_t *device = NULL;
+    int ret;
+
+    memset(replay, 0, sizeof(*replay));
+    fake_alsa_reset_ctls();
+    ret = module->methods->open(module, AUDIO_HARDWARE_INTERFACE, &device);
+    if (ret != 0)
+        return ret;
+    replay->adev = (struct audio_hw_device *)device;
+    replay->mode = AUDIO_MODE_NORMAL;
+    replay->next_handle = 1;
+    return 0;
+}
+
+static void close_stream(struct replay *replay, struct replay_stream *stream)
+{
+    if (stream->out != NULL)
+        replay->adev->close_output_stream(replay->adev, stream->out);
+    if (stream->in != NULL)
+        replay->adev->close_input_stream(replay->adev, stream->in);
+    free(stream->buffer);
+    memset(stream, 0, sizeof(*stream));
+}
+
+static void close_device(struct replay *replay)
+{
+    for (int i = 0; i < MAX_STREAMS; i++) {
+        if (replay->streams[i].name[0] != '\0')
+            close_stream(replay, &replay->streams[i]);
+    }
+    replay->adev->common.close(&replay->adev->common);
+    replay->adev = NULL;
+}
+
+static int open_stream(struct replay *replay, const char *name, enum stream_type type,
+                       audio_devices_t device)
+{
+    struct replay_stream *stream = NULL;
+    struct audio_config config = {
+        .sample_rate = 48000,
+        .format = AUDIO_FORMAT_PCM_16_BIT,
+    };
+    int ret;
+
+    for (int i = 0; i < MAX_STREAMS && stream == NULL; i++) {
+        if (replay->streams[i].name[0] == '\0')
+            stream = &replay->streams[i];
+    }
+    if (stream == NULL || find_stream(replay, name) != NULL)
+        return -EINVAL;
+
+    if (type == STREAM_MIC) {
+        config.channel_mask = AUDIO_CHANNEL_IN_MONO;
+        ret = replay->adev->open_input_stream(replay->adev, replay->next_handle++, device,
+                &config, &stream->in, AUDIO_INPUT_FLAG_NONE, "", AUDIO_SOURCE_MIC);
+        if (ret == 0)
+            stream->buffer_size = stream->in->common.get_buffer_size(&stream->in->common);
+    } else {
+        audio_output_flags_t flags = type == STREAM_PRIMARY ? AUDIO_OUTPUT_FLAG_PRIMARY :
+                type == STREAM_DEEP ? AUDIO_OUTPUT_FLAG_DEEP_BUFFER : AUDIO_OUTPUT_FLAG_NONE;
+
+        config.channel_mask = AUDIO_CHANNEL_OUT_STEREO;
+        ret = replay->adev->open_output_stream(replay->adev, replay->next_handle++, device,
+                flags, &config, &stream->out, "");
+        if (ret == 0)
+            stream->buffer_size = stream->out->common.get_buffer_size(&stream->out->common);
+    }
+    if (ret != 0)
+        return ret;
+    stream->buffer = calloc(1, stream->buffer_size);
+    if (stream->buffer == NULL)
+        return -ENOMEM;
+    strlcpy(stream->name, name, sizeof(stream->name));
+    stream->type = type;
+    stream->device = device;
+    return 0;
+}
+
+static int write_stream(struct replay_stream *stream)
+{
+    ssize_t ret;
+
+    if (stream->out != NULL)
+        ret = stream->out->write(stream->out, stream->buffer, stream->buffer_size);
+    else
+        ret = stream->in->read(stream->in, stream->buffer, stream->buffer_size);
+    if (ret < 0)
+        return (int)ret;
+    stream->written = true;
+    return 0;
+}
+
+static int write_all(struct replay *replay)
+{
+    for (int i = 0; i < MAX_STREAMS; i++) {
+        struct replay_stream *stream = &replay->streams[i];
+        int ret;
+
+        if (stream->name[0] == '\0' || stream->parked)
+            continue;
+        ret = write_stream(stream);
+        if (ret != 0)
+            return ret;
+    }
+    return 0;
+}
+
+static int route_stream(struct replay_stream *stream, audio_devices_t device)
+{
+    struct audio_stream *common = stream->out != NULL ? &stream->out->common :
+            &stream->in->common;
+    char kvpairs[32];
+
+    snprintf(kvpairs, sizeof(kvpairs), "%s=%d", AUDIO_PARAMETER_STREAM_ROUTING, (int)device);
+    stream->device = device;
+    return common->set_parameters(common, kvpairs);
+}
+
+static int standby_stream(struct replay_stream *stream)
+{
+    struct audio_stream *common = stream->out != NULL ? &stream->out->common :
+            &stream->in->common;
+
+    stream->parked = true;
+    return common->standby(common);
+}
+
+/* Opens the surviving streams of replay directly on their final devices. */
+static int replay_final_state(const struct replay *replay, struct replay *reference)
+{
+    int ret;
+
+    ret = open_device(reference);
+    if (ret != 0)
+        return ret;
+    reference->adev->set_mode(reference->adev, replay->mode);
+    reference->mode = replay->mode;
+    for (int i = 0; i < MAX_STREAMS; i++) {
+        const struct replay_stream *stream = &replay->streams[i];
+
+        if (stream->name[0] == '\0')
+            continue;
+        ret = open_stream(reference, stream->name, stream->type, stream->device);
+        if (ret != 0)
+            return ret;
+    }
+    for (int i = 0; i < MAX_STREAMS && ret == 0; i++) {
+        const struct replay_stream *stream = &replay->streams[i];
+        struct replay_stream *ref_stream;
+
+        if (stream->name[0] == '\0')
+            continue;
+        ref_stream = find_stream(reference, stream->name);
+        if (stream->written)
+            ret = write_stream(ref_stream);
+        // a routing command on the primary output starts the call in call mode
+        if (ret == 0 && stream->type == STREAM_PRIMARY)
+            ret = route_stream(ref_stream, stream->device);
+        if (ret == 0 && stream->parked)
+            ret = standby_stream(ref_stream);
+    }
+    return ret;
+}
+
+static int check_final_state(struct replay *replay, const char *sequence)
+{
+    const struct replay final = *replay;
+    struct replay reference;
+    uint32_t state, expected;
+    int ret;
+
+    state = fake_alsa_ctl_state_hash();
+    if (getenv("ROUTE_REPLAY_DUMP") != NULL) {
+        fprintf(stderr, "%s: replayed mixer state:\n", sequence);
+        fake_alsa_dump_ctls(stderr);
+    }
+    close_device(replay);
+    ret = replay_final_state(&final, &reference);
+    if (ret != 0) {
+        fprintf(stderr, "%s: reference replay failed: %d\n", sequence, ret);
+        return ret;
+    }
+    expected = fake_alsa_ctl_state_hash();
+    if (state != expected) {
+        fprintf(stderr, "%s: mixer state differs from a direct open on the final devices\n",
+                sequence);
+        fprintf(stderr, "reference mixer state:\n");
+        fake_alsa_dump_ctls(stderr);
+        ret = -EINVAL;
+    }
+    close_device(&reference);
+    return ret;
+}
+
+static int split_args(char *line, char **argv)
+{
+    int argc = 0;
+    char *saveptr = NULL;
+
+    for (char *tok = strtok_r(line, " \t\n", &saveptr); tok != NULL && argc < MAX_ARGS;
+            tok = strtok_r(NULL, " \t\n", &saveptr))
+        argv[argc++] = tok;
+    return argc;
+}
+
+/* Checks the value of the mixer control named by the words of argv. */
+static int expect_ctl(const char *value, int argc, char **argv)
+{
+    char name[128] = "";
+    int actual;
+
+    for (int i = 0; i < argc; i++) {
+        if (i > 0)
+            strlcat(name, " ", sizeof(name));
+        strlcat(name, argv[i], sizeof(name));
+    }
+    actual = fake_alsa_get_ctl_value(name, 0);
+    if (actual != atoi(value)) {
+        fprintf(stderr, "'%s' is %d, expected %s\n", name, actual, value);
+        return -EINVAL;
+    }
+    return 0;
+}
+
+static int run_step(struct replay *replay, int argc, char **argv, int *budget)
+{
+    struct replay_stream *stream;
+    audio_devices_t device;
+    enum stream_type type;
+    audio_mode_t mode;
+
+    *budget = -1;
+    if (strcmp(argv[0], "open") == 0 && argc == 4) {
+        if (parse_type(argv[2], &type) != 0 || parse_device(argv[3], &device) != 0)
+            return -EINVAL;
+        return open_stream(replay, argv[1], type, device);
+    }
+    if (strcmp(argv[0], "write") == 0 && argc == 1)
+        return write_all(replay);
+    if (strcmp(argv[0], "route") == 0 && (argc == 3 || argc == 4)) {
+        stream = find_stream(replay, argv[1]);
+        if (stream == NULL || parse_device(argv[2], &device) != 0)
+            return -EINVAL;
+        if (argc == 4)
+            *budget = atoi(argv[3]);
+        return route_stream(stream, device);
+    }
+    if (strcmp(argv[0], "mode") == 0 && (argc == 2 || argc == 3)) {
+        if (parse_mode(argv[1], &mode) != 0)
+            return -EINVAL;
+        if (argc == 3)
+            *budget = atoi(argv[2]);
+        replay->mode = mode;
+        return replay->adev->set_mode(replay->adev, mode);
+    }
+    if (strcmp(argv[0], "standby") == 0 && argc == 2) {
+        stream = find_stream(replay, argv[1]);
+        return stream != NULL ? standby_stream(stream) : -EINVAL;
+    }
+    if (strcmp(argv[0], "resume") == 0 && argc == 2) {
+        stream = find_stream(replay, argv[1]);
+        if (stream == NULL)
+            return -EINVAL;
+        stream->parked = false;
+        return write_stream(stream);
+    }
+    if (strcmp(argv[0], "close") == 0 && argc == 2) {
+        stream = find_stream(replay, argv[1]);
+        if (stream == NULL)
+            return -EINVAL;
+        close_stream(replay, stream);
+        return 0;
+    }
+    if (strcmp(argv[0], "expect") == 0 && argc >= 3)
+        return expect_ctl(argv[1], argc - 2, argv + 2);
+    return -EINVAL;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = argc > 1 ? argv[1] : "tests/route_sequences.txt";
+    struct replay replay = { 0 };
+    char sequence[64] = "";
+    char line[256];
+    int line_no = 0, sequences = 0, failures = 0;
+    uint64_t total_writes = 0;
+    FILE *file;
+
+    /* keep the step lines in order with the failures on stderr */
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return 1;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char *args[MAX_ARGS];
+        struct fake_alsa_stats before, after;
+        char step[256];
+        int nargs, budget, ret;
+        uint64_t writes;
+
+        line_no++;
+        if (line[0] == '#')
+            continue;
+        strlcpy(step, line, sizeof(step));
+        step[strcspn(step, "\n")] = '\0';
+        nargs = split_args(line, args);
+        if (nargs == 0)
+            continue;
+
+        if (strcmp(args[0], "sequence") == 0 && nargs == 2) {
+            strlcpy(sequence, args[1], sizeof(sequence));
+            if (open_device(&replay) != 0) {
+                fprintf(stderr, "%s: adev_open failed\n", sequence);
+                return 1;
+            }
+            sequences++;
+            printf("%s\n", sequence);
+            continue;
+        }
+        if (replay.adev == NULL) {
+            fprintf(stderr, "%s:%d: step outside of a sequence\n", path, line_no);
+            return 1;
+        }
+        if (strcmp(args[0], "end") == 0) {
+            if (check_final_state(&replay, sequence) != 0)
+                failures++;
+            continue;
+        }
+
+        fake_alsa_get_stats(&before);
+        ret = run_step(&replay, nargs, args, &budget);
+        fake_alsa_get_stats(&after);
+        writes = after.ctl_writes - before.ctl_writes;
+        total_writes += writes;
+        printf("  %-40s %4llu ctl writes\n", step, (unsigned long long)writes);
+        if (ret != 0) {
+            fprintf(stderr, "%s:%d: '%s' failed: %d\n", path, line_no, step, ret);
+            failures++;
+        } else if (budget >= 0 && writes > (uint64_t)budget) {
+            fprintf(stderr, "%s:%d: '%s' wrote %llu controls, budget %d\n", path, line_no,
+                    step, (unsigned long long)writes, budget);
+            failures++;
+        }
+    }
+    fclose(file);
+    if (replay.adev != NULL) {
+        fprintf(stderr, "%s: missing end\n", sequence);
+        return 1;
+    }
+
+    printf("%d sequences, %llu ctl writes, %d failures\n", sequences,
+           (unsigned long long)total_writes, failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Accuracy of the fixed point visualizer spectrum against a double precision
+ * DFT of the same Hann windowed block, for every FFT size: sines centered on
+ * a bin and halfway between two bins, at full scale and 40 dB down, noise
+ * and DC. Every bin must be within one unit per butterfly stage, plus
+ * MAX_ERROR_MARGIN, of the reference. A centered sine must peak on its own
+ * bin at its amplitude with the neighbours at half of it (the Hann main
+ * lobe), and rotating the ring start must not change the result. Sizes
+ * outside of 64 to 1024 or not a power of two must be refused.
+ */
+
+#define LOG_TAG "visualizer_fft_test"
+
+#include <errno.h>
+#include <getopt.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "visualizer_fft.h"
+
+/* Magnitudes are in 16 bit sample units, a full scale sine reads 32767. The
+   butterflies truncate, so the error may grow by one unit per stage. */
+#define MAX_ERROR_MARGIN 2
+/* a centered sine reads its amplitude within this fraction */
+#define PEAK_TOLERANCE 0.01
+
+struct tone {
+    const char *name;
+    double bin;         /* frequency in bins of the FFT size */
+    double amplitude;
+};
+
+static struct visualizer_fft fft;
+static int16_t history[VISUALIZER_FFT_MAX_SIZE];
+static int16_t signal_block[VISUALIZER_FFT_MAX_SIZE];
+static uint16_t bins[VISUALIZER_FFT_MAX_SIZE / 2];
+static uint16_t rotated_bins[VISUALIZER_FFT_MAX_SIZE / 2];
+static double reference[VISUALIZER_FFT_MAX_SIZE / 2];
+
+static int16_t clamp16(double v)
+{
+    long r = lround(v);
+    return r > 32767 ? 32767 : r < -32768 ? -32768 : (int16_t)r;
+}
+
+/* |X[k]| * 4 / size of the periodic Hann windowed block, the scale at which
+   a sine centered on a bin reads its amplitude */
+static void reference_dft(const int16_t *block, uint32_t size, double *out)
+{
+    for (uint32_t k = 0; k < size / 2; k++) {
+        double re = 0, im = 0;
+
+        for (uint32_t n = 0; n < size; n++) {
+            const double w = 0.5 - 0.5 * cos(2.0 * M_PI * n / size);
+            const double a = 2.0 * M_PI * k * n / size;
+
+            re += block[n] * w * cos(a);
+            im -= block[n] * w * sin(a);
+        }
+        out[k] = sqrt(re * re + im * im) * 4.0 / size;
+    }
+}
+
+/* Transforms block with the ring start at start, the history holds block
+   rotated so that its first sample is at index start. */
+static void transform(const int16_t *block, uint32_t size, uint32_t start, uint16_t *out)
+{
+    for (uint32_t n = 0; n < size; n++)
+        history[(start + n) & (size - 1)] = block[n];
+    visualizer_fft_magnitudes(&fft, history, start, out);
+}
+
+static int check_block(const char *name, uint32_t size, double *max_error)
+{
+    const uint32_t start = 1 + rand() % (size - 1);
+    /* log2(size / 2) stages */
+    const double allowed_error = __builtin_ctz(size) - 1 + MAX_ERROR_MARGIN;
+    int failures = 0;
+
+    reference_dft(signal_block, size, reference);
+    transform(signal_block, size, 0, bins);
+    for (uint32_t k = 0; k < size / 2; k++) {
+        const double error = fabs(bins[k] - reference[k]);
+
+        if (error > *max_error)
+            *max_error = error;
+        if (error > allowed_error) {
+            fprintf(stderr, "size %u %s: bin %u is %u instead of %.1f\n", size, name, k,
+                    bins[k], reference[k]);
+            failures++;
+            break;
+        }
+    }
+
+    transform(signal_block, size, start, rotated_bins);
+    if (memcmp(bins, rotated_bins, size / 2 * sizeof(bins[0])) != 0) {
+        fprintf(stderr, "size %u %s: ring start %u changes the spectrum\n", size, name, start);
+        failures++;
+    }
+    return failures;
+}
+
+/* A sine centered on bin k: peak on k at the amplitude, k - 1 and k + 1 at
+   half of it, as the Hann window spreads a centered sine over three bins. */
+static int check_placement(const struct tone *tone, uint32_t size)
+{
+    const uint32_t k = (uint32_t)tone->bin;
+    uint32_t peak = 0;
+
+    for (uint32_t i = 0; i < size / 2; i++) {
+        if (bins[i] > bins[peak])
+            peak = i;
+    }
+    if (peak != k || fabs(bins[k] - tone->amplitude) > tone->amplitude * PEAK_TOLERANCE ||
+            fabs(bins[k - 1] - tone->amplitude / 2) > tone->amplitude * PEAK_TOLERANCE ||
+            fabs(bins[k + 1] - tone->amplitude / 2) > tone->amplitude * PEAK_TOLERANCE) {
+        fprintf(stderr, "size %u %s at bin %u: peak %u, bins %u %u %u for amplitude %.0f\n",
+                size, tone->name, k, peak, bins[k - 1], bins[k], bins[k + 1],
+                tone->amplitude);
+        return 1;
+    }
+    return 0;
+}
+
+static int check_size(uint32_t size, double *max_error)
+{
+    const struct tone tones[] = {
+        { "full scale sine", 2, 32767 },
+        { "full scale sine", 3, 32767 },
+        { "full scale sine", size / 8, 32767 },
+        { "full scale sine", size / 4 + 1, 32767 },
+        { "full scale sine", size / 2 - 2, 32767 },
+        { "-40 dB sine", size / 8, 328 },
+        { "off bin sine", size / 8 + 0.5, 32767 },
+        { "off bin sine", size / 3 + 0.5, 32767 },
+    };
+    int failures = 0;
+
+    if (visualizer_fft_setup(&fft, size) != 0) {
+        fprintf(stderr, "size %u refused\n", size);
+        return 1;
+    }
+
+    for (size_t t = 0; t < sizeof(tones) / sizeof(tones[0]); t++) {
+        const double phase = 2.0 * M_PI * rand() / RAND_MAX;
+
+        for (uint32_t n = 0; n < size; n++)
+            signal_block[n] = clamp16(tones[t].amplitude *
+                                      sin(2.0 * M_PI * tones[t].bin * n / size + phase));
+        failures += check_block(tones[t].name, size, max_error);
+        if (tones[t].bin == floor(tones[t].bin))
+            failures += check_placement(&tones[t], size);
+    }
+
+    for (uint32_t n = 0; n < size; n++)
+        signal_block[n] = (int16_t)(rand() & 0xffff);
+    failures += check_block("full scale noise", size, max_error);
+
+    for (uint32_t n = 0; n < size; n++)
+        signal_block[n] = -32768;
+    failures += check_block("negative full scale DC", size, max_error);
+    return failures;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -s <n>  random seed (default 1)\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    static const uint32_t bad_sizes[] = { 0, 32, 96, 1000, 2048 };
+    unsigned int seed = 1;
+    int opt, failures = 0;
+
+    while ((opt = getopt(argc, argv, "s:h")) != -1) {
+        switch (opt) {
+        case 's': seed = strtoul(optarg, NULL, 0); break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    srand(seed);
+    visualizer_fft_init();
+    for (size_t i = 0; i < sizeof(bad_sizes) / sizeof(bad_sizes[0]); i++) {
+        if (visualizer_fft_setup(&fft, bad_sizes[i]) != -EINVAL) {
+            fprintf(stderr, "size %u not refused\n", bad_sizes[i]);
+            failures++;
+        }
+    }
+
+    for (uint32_t size = VISUALIZER_FFT_MIN_SIZE; size <= VISUALIZER_FFT_MAX_SIZE; size *= 2) {
+        double max_error = 0;
+        const int size_failures = check_size(size, &max_error);
+
+        printf("size %4u: max error %5.2f against the double precision DFT%s\n", size,
+               max_error, size_failures ? " FAILED" : "");
+        failures += size_failures;
+    }
+
+    if (failures != 0)
+        fprintf(stderr, "%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
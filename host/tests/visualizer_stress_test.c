@@ -0,0 +1,396 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Stress test of the lock free capture and measurement commands of the
+ * offload visualizer. The fake proxy port captures a ramp that advances by
+ * one step per frame modulo 251, so a capture mixing frames of two passes
+ * over the ring breaks the ramp. While the capture thread runs without
+ * pacing:
+ *   - reader threads issue VISUALIZER_CMD_CAPTURE and _MEASURE on a
+ *     visualizer that stays enabled, and check every reply;
+ *   - a churn thread creates, enables, starts, stops and releases another
+ *     visualizer, then checks that commands on the released handle fail;
+ *   - a racer thread sends commands to the handle the churn thread is
+ *     about to release. Freed memory is poisoned so that a command that
+ *     reaches a released context crashes;
+ *   - a capture is issued while the library's global lock is held and must
+ *     complete.
+ *
+ *   visualizer_stress_test [captures per reader]
+ */
+
+#define LOG_TAG "visualizer_stress_test"
+
+#include <errno.h>
+#include <malloc.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <audio_effects/effect_visualizer.h>
+#include <hardware/audio_effect.h>
+
+#include "fake_alsa.h"
+
+#define CARD 0
+#define PCM_ID 9
+#define CAPTURE_PCM_ID 8
+#define READER_OUTPUT 13
+#define CHURN_OUTPUT 14
+#define NUM_READERS 2
+#define RAMP_PERIOD 251
+#define RAMP_STEP 256     /* one step of the 8 bit capture when both channels are equal */
+#define CAPTURE_SIZE VISUALIZER_CAPTURE_SIZE_MAX
+#define SILENCE 0x80
+#define LOCKED_CAPTURE_TIMEOUT_MS 500
+
+extern audio_effect_library_t AUDIO_EFFECT_LIBRARY_INFO_SYM;
+/* the visualizer's global lock, held by the capture thread while it processes */
+extern pthread_mutex_t lock;
+
+int visualizer_hal_start_output(audio_io_handle_t output, int pcm_id, int card_number,
+                                int pcm_capture_id);
+int visualizer_hal_stop_output(audio_io_handle_t output, int pcm_id);
+int effect_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize, void *pCmdData,
+                   uint32_t *replySize, void *pReplyData);
+
+static const effect_uuid_t visualizer_uuid =
+        {0x7a8044a0, 0x1a71, 0x11e3, 0xa184, {0x00, 0x02, 0xa5, 0xd5, 0xc5, 0x1b}};
+
+struct reader_result {
+    unsigned long captures;
+    unsigned long ramps;
+    unsigned long silences;        /* overrun or idle capture, returned as silence */
+    unsigned long measures;
+    unsigned long failures;
+};
+
+static effect_handle_t reader_handle;
+static unsigned long captures_per_reader = 200000;
+static atomic_bool readers_done;
+static _Atomic(effect_handle_t) churn_handle;
+static atomic_ulong churn_cycles, stale_rejected, racer_commands;
+static atomic_ulong failures;
+static int32_t expected_peak_mb;
+
+/* ramp frame at capture stream position, equal on both channels */
+static void ramp_source(void *data, unsigned int bytes, uint64_t position,
+                        void *cookie __unused)
+{
+    int16_t *samples = data;
+
+    for (unsigned int i = 0; i < bytes / (2 * sizeof(int16_t)); i++) {
+        const int16_t smp = (int16_t)(((position + i) % RAMP_PERIOD) - RAMP_PERIOD / 2) *
+                            RAMP_STEP;
+
+        samples[2 * i] = smp;
+        samples[2 * i + 1] = smp;
+    }
+}
+
+static int command(effect_handle_t handle, uint32_t code, uint32_t size, void *data,
+                   uint32_t *reply_size, void *reply)
+{
+    /* not through (*handle)->command: the test itself must not read a released context */
+    return effect_command(handle, code, size, data, reply_size, reply);
+}
+
+static int command_int(effect_handle_t handle, uint32_t code, uint32_t size, void *data)
+{
+    int reply = 0;
+    uint32_t reply_size = sizeof(reply);
+    int ret = command(handle, code, size, data, &reply_size, &reply);
+
+    return ret != 0 ? ret : reply;
+}
+
+static int set_param(effect_handle_t handle, uint32_t param, uint32_t value)
+{
+    uint32_t buf[(sizeof(effect_param_t) + 2 * sizeof(uint32_t)) / sizeof(uint32_t)];
+    effect_param_t *p = (effect_param_t *)buf;
+
+    p->status = 0;
+    p->psize = sizeof(uint32_t);
+    p->vsize = sizeof(uint32_t);
+    memcpy(p->data, &param, sizeof(param));
+    memcpy(p->data + sizeof(param), &value, sizeof(value));
+    return command_int(handle, EFFECT_CMD_SET_PARAM, sizeof(buf), buf);
+}
+
+static int create_visualizer(audio_io_handle_t output, effect_handle_t *handle)
+{
+    effect_offload_param_t offload = { .isOffload = true, .ioHandle = output };
+    int ret;
+
+    ret = AUDIO_EFFECT_LIBRARY_INFO_SYM.create_effect(&visualizer_uuid, 0, output, handle);
+    if (ret != 0)
+        return ret;
+    ret = command_int(*handle, EFFECT_CMD_OFFLOAD, sizeof(offload), &offload);
+    if (ret == 0)
+        ret = set_param(*handle, VISUALIZER_PARAM_SCALING_MODE,
+                        VISUALIZER_SCALING_MODE_AS_PLAYED);
+    if (ret == 0)
+        ret = set_param(*handle, VISUALIZER_PARAM_MEASUREMENT_MODE, MEASUREMENT_MODE_PEAK_RMS);
+    if (ret == 0)
+        ret = command_int(*handle, EFFECT_CMD_ENABLE, 0, NULL);
+    if (ret != 0)
+        AUDIO_EFFECT_LIBRARY_INFO_SYM.release_effect(*handle);
+    return ret;
+}
+
+static int capture(effect_handle_t handle, uint8_t *buf)
+{
+    uint32_t size = CAPTURE_SIZE;
+
+    return command(handle, VISUALIZER_CMD_CAPTURE, 0, NULL, &size, buf);
+}
+
+static int measure(effect_handle_t handle, int32_t *reply)
+{
+    uint32_t size = sizeof(int32_t) * MEASUREMENT_COUNT;
+
+    return command(handle, VISUALIZER_CMD_MEASURE, 0, NULL, &size, reply);
+}
+
+static bool is_silence(const uint8_t *buf)
+{
+    for (int i = 0; i < CAPTURE_SIZE; i++) {
+        if (buf[i] != SILENCE)
+            return false;
+    }
+    return true;
+}
+
+static int ramp_value(uint8_t byte)
+{
+    return (int8_t)(byte ^ SILENCE) + RAMP_PERIOD / 2;
+}
+
+/* index of the first frame that does not continue the ramp, -1 if none */
+static int ramp_break(const uint8_t *buf)
+{
+    for (int i = 1; i < CAPTURE_SIZE; i++) {
+        if (ramp_value(buf[i]) != (ramp_value(buf[i - 1]) + 1) % RAMP_PERIOD)
+            return i;
+    }
+    return -1;
+}
+
+static void *reader_loop(void *arg)
+{
+    struct reader_result *result = arg;
+    uint8_t buf[CAPTURE_SIZE];
+    int32_t meas[MEASUREMENT_COUNT];
+
+    for (unsigned long i = 0; i < captures_per_reader; i++) {
+        int ret = capture(reader_handle, buf);
+        int pos;
+
+        result->captures++;
+        if (ret != 0) {
+            fprintf(stderr, "capture %lu failed: %d\n", i, ret);
+            result->failures++;
+        } else if (is_silence(buf)) {
+            result->silences++;
+        } else if ((pos = ramp_break(buf)) >= 0) {
+            fprintf(stderr, "capture %lu: torn at byte %d: %#x %#x\n", i, pos, buf[pos - 1],
+                    buf[pos]);
+            result->failures++;
+        } else {
+            result->ramps++;
+        }
+
+        if (i % 8 == 0) {
+            ret = measure(reader_handle, meas);
+            result->measures++;
+            if (ret != 0 || meas[MEASUREMENT_IDX_PEAK] != expected_peak_mb) {
+                fprintf(stderr, "measure %lu: %d, peak %d mB instead of %d\n", i, ret,
+                        meas[MEASUREMENT_IDX_PEAK], expected_peak_mb);
+                result->failures++;
+            }
+        }
+    }
+    return NULL;
+}
+
+static void *churn_loop(void *arg __unused)
+{
+    uint8_t buf[CAPTURE_SIZE];
+    int32_t meas[MEASUREMENT_COUNT];
+
+    while (!atomic_load(&readers_done)) {
+        const bool start = atomic_load(&churn_cycles) % 2 == 0;
+        effect_handle_t handle;
+        int ret;
+
+        ret = create_visualizer(CHURN_OUTPUT, &handle);
+        if (ret != 0) {
+            fprintf(stderr, "churn: create failed: %d\n", ret);
+            atomic_fetch_add(&failures, 1);
+            break;
+        }
+        atomic_store(&churn_handle, handle);
+        if (start)
+            visualizer_hal_start_output(CHURN_OUTPUT, PCM_ID + 1, CARD, CAPTURE_PCM_ID);
+        if (capture(handle, buf) != 0 || measure(handle, meas) != 0) {
+            fprintf(stderr, "churn: command on a live handle failed\n");
+            atomic_fetch_add(&failures, 1);
+        }
+        if (start)
+            visualizer_hal_stop_output(CHURN_OUTPUT, PCM_ID + 1);
+        command_int(handle, EFFECT_CMD_DISABLE, 0, NULL);
+        AUDIO_EFFECT_LIBRARY_INFO_SYM.release_effect(handle);
+
+        /* the context is freed, only its address is compared */
+        if (capture(handle, buf) != -EINVAL || measure(handle, meas) != -EINVAL) {
+            fprintf(stderr, "churn: command on a released handle did not fail\n");
+            atomic_fetch_add(&failures, 1);
+        } else {
+            atomic_fetch_add(&stale_rejected, 2);
+        }
+        atomic_fetch_add(&churn_cycles, 1);
+    }
+    atomic_store(&churn_handle, NULL);
+    return NULL;
+}
+
+/* commands racing with the release of the churn handle */
+static void *racer_loop(void *arg __unused)
+{
+    uint8_t buf[CAPTURE_SIZE];
+    int32_t meas[MEASUREMENT_COUNT];
+
+    while (!atomic_load(&readers_done)) {
+        effect_handle_t handle = atomic_load(&churn_handle);
+        int ret;
+
+        if (handle == NULL)
+            continue;
+        ret = atomic_load(&racer_commands) % 2 ? capture(handle, buf) : measure(handle, meas);
+        if (ret != 0 && ret != -EINVAL) {
+            fprintf(stderr, "racer: command returned %d\n", ret);
+            atomic_fetch_add(&failures, 1);
+        }
+        atomic_fetch_add(&racer_commands, 1);
+    }
+    return NULL;
+}
+
+static void *locked_capture(void *arg)
+{
+    uint8_t buf[CAPTURE_SIZE];
+
+    capture(reader_handle, buf);
+    atomic_store((atomic_bool *)arg, true);
+    return NULL;
+}
+
+/* the capture must complete while the capture thread would hold the lock */
+static int check_capture_under_lock(void)
+{
+    atomic_bool done = false;
+    pthread_t thread;
+    int ms;
+
+    pthread_mutex_lock(&lock);
+    pthread_create(&thread, NULL, locked_capture, &done);
+    for (ms = 0; ms < LOCKED_CAPTURE_TIMEOUT_MS && !atomic_load(&done); ms++)
+        usleep(1000);
+    pthread_mutex_unlock(&lock);
+    pthread_join(thread, NULL);
+    if (!atomic_load(&done)) {
+        fprintf(stderr, "capture waited for the visualizer lock\n");
+        return -ETIMEDOUT;
+    }
+    return 0;
+}
+
+/* the first captures hold the initial content of the ring */
+static int wait_for_ramp(void)
+{
+    uint8_t buf[CAPTURE_SIZE];
+
+    for (int i = 0; i < 2000; i++) {
+        if (capture(reader_handle, buf) == 0 && !is_silence(buf) && ramp_break(buf) < 0)
+            return 0;
+        usleep(1000);
+    }
+    fprintf(stderr, "no ramp captured\n");
+    return -ETIMEDOUT;
+}
+
+int main(int argc, char **argv)
+{
+    struct reader_result results[NUM_READERS] = { 0 };
+    struct reader_result total = { 0 };
+    pthread_t readers[NUM_READERS], churn, racer;
+    int ret;
+
+    if (argc > 1)
+        captures_per_reader = strtoul(argv[1], NULL, 0);
+    /* every create logs the missing acdb loader */
+    setenv("HAL_HOST_LOG", "S", 0);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    /* a command that reaches a freed context calls through a poisoned pointer */
+    mallopt(M_PERTURB, 0xa5);
+    /* the ramp peaks at 125 steps */
+    expected_peak_mb = (int32_t)(2000 * log10((RAMP_PERIOD / 2) * RAMP_STEP / 32767.0f));
+
+    fake_alsa_set_capture_source(ramp_source, NULL);
+    ret = create_visualizer(READER_OUTPUT, &reader_handle);
+    if (ret != 0) {
+        fprintf(stderr, "create failed: %d\n", ret);
+        return 1;
+    }
+    visualizer_hal_start_output(READER_OUTPUT, PCM_ID, CARD, CAPTURE_PCM_ID);
+    if (wait_for_ramp() != 0 || check_capture_under_lock() != 0)
+        atomic_fetch_add(&failures, 1);
+
+    pthread_create(&churn, NULL, churn_loop, NULL);
+    pthread_create(&racer, NULL, racer_loop, NULL);
+    for (int i = 0; i < NUM_READERS; i++)
+        pthread_create(&readers[i], NULL, reader_loop, &results[i]);
+    for (int i = 0; i < NUM_READERS; i++) {
+        pthread_join(readers[i], NULL);
+        total.captures += results[i].captures;
+        total.ramps += results[i].ramps;
+        total.silences += results[i].silences;
+        total.measures += results[i].measures;
+        total.failures += results[i].failures;
+    }
+    atomic_store(&readers_done, true);
+    pthread_join(churn, NULL);
+    pthread_join(racer, NULL);
+
+    visualizer_hal_stop_output(READER_OUTPUT, PCM_ID);
+    command_int(reader_handle, EFFECT_CMD_DISABLE, 0, NULL);
+    AUDIO_EFFECT_LIBRARY_INFO_SYM.release_effect(reader_handle);
+
+    total.failures += atomic_load(&failures);
+    printf("%lu captures: %lu ramps, %lu silent; %lu measures; %lu churn cycles, "
+           "%lu stale commands rejected, %lu racing commands; %lu failures\n",
+           total.captures, total.ramps, total.silences, total.measures,
+           atomic_load(&churn_cycles), atomic_load(&stale_rejected),
+           atomic_load(&racer_commands), total.failures);
+    /* a run where every capture overran checks nothing */
+    return total.failures == 0 && total.ramps > 0 ? 0 : 1;
+}
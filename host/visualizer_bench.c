@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Times the visualizer period processing, measurement, normalization shift
+ * and 8 bit pack of one capture period, as the per sample loops of
+ * visualizer_process() did it and with visualizer_kernels. Fails when the
+ * two disagree on a peak, a shift or a packed byte, or when their RMS
+ * differ by more than the float accumulation error of the loops.
+ *
+ * The periods are random noise at amplitudes from silence to full scale.
+ * -32768 is left out: the loops read it as a peak of -32768.
+ */
+
+#define LOG_TAG "visualizer_bench"
+
+#include <getopt.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "visualizer_kernels.h"
+
+#define PERIOD_FRAMES 768           /* AUDIO_CAPTURE_PERIOD_SIZE */
+#define MAX_FRAMES (PERIOD_FRAMES + 15)
+#define NUM_PERIODS 64
+#define RMS_TOLERANCE 1e-3
+
+struct period_result {
+    int32_t peak;
+    float rms_squared;
+    int shift;
+    uint8_t packed[MAX_FRAMES];
+};
+
+static int16_t periods[NUM_PERIODS][MAX_FRAMES * 2];
+static size_t period_frames[NUM_PERIODS];
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* from 25 - clz(peak) to the shift visualizer_process() packs with */
+static int normalize_shift(int clz)
+{
+    int shift = 25 - clz;
+
+    if (shift < 3)
+        shift = 3;
+    return shift + 1;
+}
+
+/* the loops of visualizer_process() before visualizer_kernels */
+static void process_loops(const int16_t *src, size_t frames, struct period_result *result)
+{
+    const size_t samples = frames * 2;
+    int16_t max_sample = 0;
+    float rms_squared_acc = 0;
+    int shift = 32;
+
+    for (size_t i = 0; i < samples; i++) {
+        if (src[i] > max_sample) {
+            max_sample = src[i];
+        } else if (-src[i] > max_sample) {
+            max_sample = -src[i];
+        }
+        rms_squared_acc += (src[i] * src[i]);
+    }
+    result->peak = (uint16_t)max_sample;
+    result->rms_squared = rms_squared_acc / samples;
+
+    for (size_t i = 0; i < samples; i++) {
+        int32_t smp = src[i];
+        if (smp < 0) smp = -smp - 1;
+        /* clz(0) is undefined, the loops relied on it being 32 */
+        int32_t clz = smp == 0 ? 32 : __builtin_clz(smp);
+        if (shift > clz) shift = clz;
+    }
+    result->shift = normalize_shift(shift);
+
+    for (size_t i = 0; i < frames; i++) {
+        int32_t smp = src[2 * i] + src[2 * i + 1];
+        smp = smp >> result->shift;
+        result->packed[i] = ((uint8_t)smp)^0x80;
+    }
+}
+
+static void process_kernels(const int16_t *src, size_t frames, struct period_result *result)
+{
+    struct visualizer_stats stats;
+    int32_t peak;
+
+    visualizer_kernels_stats_16(src, frames * 2, &stats);
+    result->peak = stats.max > -stats.min ? stats.max : -stats.min;
+    result->rms_squared = (float)stats.sum_squares / (frames * 2);
+    peak = stats.max > -stats.min - 1 ? stats.max : -stats.min - 1;
+    result->shift = normalize_shift(peak == 0 ? 32 : __builtin_clz(peak));
+    visualizer_kernels_pack_8(result->packed, src, frames, result->shift);
+}
+
+/* Noise up to a random amplitude. Every eighth period is a full period of
+   silence, and one in four is a few frames longer to reach the scalar tails. */
+static void fill_periods(void)
+{
+    for (int p = 0; p < NUM_PERIODS; p++) {
+        const int amplitude = p % 8 == 0 ? 0 : 1 + rand() % 32767;
+
+        period_frames[p] = PERIOD_FRAMES + (p % 4 == 3 ? 1 + rand() % 15 : 0);
+        for (size_t i = 0; i < period_frames[p] * 2; i++)
+            periods[p][i] = amplitude == 0 ? 0 : rand() % (2 * amplitude + 1) - amplitude;
+    }
+}
+
+static int compare(int p)
+{
+    struct period_result loops, kernels;
+    const size_t frames = period_frames[p];
+
+    process_loops(periods[p], frames, &loops);
+    process_kernels(periods[p], frames, &kernels);
+    if (loops.peak != kernels.peak || loops.shift != kernels.shift ||
+            memcmp(loops.packed, kernels.packed, frames) != 0 ||
+            fabsf(loops.rms_squared - kernels.rms_squared) >
+                    RMS_TOLERANCE * loops.rms_squared) {
+        fprintf(stderr, "period %d (%zu frames): loops peak %d shift %d rms^2 %f, "
+                "kernels peak %d shift %d rms^2 %f%s\n", p, frames, loops.peak, loops.shift,
+                loops.rms_squared, kernels.peak, kernels.shift, kernels.rms_squared,
+                memcmp(loops.packed, kernels.packed, frames) != 0 ? ", packed bytes differ" : "");
+        return 1;
+    }
+    return 0;
+}
+
+static double time_ns(void (*process)(const int16_t *, size_t, struct period_result *),
+                      unsigned int iterations)
+{
+    struct period_result result;
+    volatile uint8_t sink = 0;
+    const int64_t start_ns = now_ns();
+
+    for (unsigned int i = 0; i < iterations; i++) {
+        const int p = i % NUM_PERIODS;
+
+        process(periods[p], period_frames[p], &result);
+        sink += result.packed[0];
+    }
+    (void)sink;
+    return iterations ? (double)(now_ns() - start_ns) / iterations : 0;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n <n>  periods processed per implementation (default 200000)\n"
+            "  -s <n>  random seed (default 1)\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int iterations = 200000;
+    unsigned int seed = 1;
+    double loops_ns, kernels_ns;
+    int opt, failures = 0;
+
+    while ((opt = getopt(argc, argv, "n:s:h")) != -1) {
+        switch (opt) {
+        case 'n': iterations = strtoul(optarg, NULL, 0); break;
+        case 's': seed = strtoul(optarg, NULL, 0); break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    srand(seed);
+    fill_periods();
+    for (int p = 0; p < NUM_PERIODS; p++)
+        failures += compare(p);
+
+    loops_ns = time_ns(process_loops, iterations);
+    kernels_ns = time_ns(process_kernels, iterations);
+    printf("%d periods of %d frames, %u iterations: loops %.1f ns, kernels %.1f ns, %.1fx\n",
+           NUM_PERIODS, PERIOD_FRAMES, iterations, loops_ns, kernels_ns,
+           kernels_ns > 0 ? loops_ns / kernels_ns : 0);
+    if (failures != 0)
+        fprintf(stderr, "%d periods differ\n", failures);
+    return failures == 0 ? 0 : 1;
+}
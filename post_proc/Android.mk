@@ -1,5 +1,3 @@
-ifneq ($(filter msm8974 msm8226 msm8084 msm8992 msm8994 msm8996 msm8909 msm8998 sdm845 sdm710 msmnile,$(TARGET_BOARD_PLATFORM)),)
-
 LOCAL_PATH:= $(call my-dir)
 
 qcom_post_proc_common_cflags := \
@@ -8,6 +6,34 @@ qcom_post_proc_common_cflags := \
     -Wno-unused-function \
     -Wno-unused-variable \
 
+# Mixer handles shared by libqcompostprocbundle and libqcomvisualizer
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	effects_mixer.c
+
+LOCAL_CFLAGS += $(qcom_post_proc_common_cflags)
+
+LOCAL_SHARED_LIBRARIES := \
+	libcutils \
+	liblog \
+	libtinyalsa
+
+LOCAL_MODULE_TAGS := optional
+LOCAL_MODULE_OWNER := qcom
+LOCAL_PROPRIETARY_MODULE := true
+
+LOCAL_MODULE:= libqcomeffectsmixer
+
+LOCAL_C_INCLUDES := \
+	external/tinyalsa/include
+
+include $(BUILD_SHARED_LIBRARY)
+
+################################################################################
+
+ifneq ($(filter msm8974 msm8226 msm8084 msm8992 msm8994 msm8996 msm8909 msm8998 sdm845 sdm710 msmnile,$(TARGET_BOARD_PLATFORM)),)
+
 include $(CLEAR_VARS)
 
 LOCAL_SRC_FILES:= \
@@ -23,7 +49,8 @@ LOCAL_CFLAGS += $(qcom_post_proc_common_cflags)
 LOCAL_SHARED_LIBRARIES := \
 	libcutils \
 	liblog \
-	libtinyalsa
+	libtinyalsa \
+	libqcomeffectsmixer
 
 LOCAL_MODULE_TAGS := optional
 LOCAL_MODULE_OWNER := qcom
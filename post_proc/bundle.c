@@ -27,6 +27,7 @@
 #include <hardware/audio_effect.h>
 
 #include "bundle.h"
+#include "effects_mixer.h"
 #include "equalizer.h"
 #include "bass_boost.h"
 #include "virtualizer.h"
@@ -183,7 +184,6 @@ int offload_effects_bundle_hal_start_output(audio_io_handle_t output, int pcm_id
 {
     int ret = 0;
     struct listnode *node;
-    char mixer_string[128];
     output_context_t * out_ctxt = NULL;
 
     ALOGV("%s output %d pcm_id %d", __func__, output, pcm_id);
@@ -204,9 +204,7 @@ int offload_effects_bundle_hal_start_output(audio_io_handle_t output, int pcm_id
     out_ctxt->pcm_device_id = pcm_id;
 
     /* populate the mixer control to send offload parameters */
-    snprintf(mixer_string, sizeof(mixer_string),
-             "%s %d", "Audio Effects Config", out_ctxt->pcm_device_id);
-    out_ctxt->mixer = mixer_open(MIXER_CARD);
+    out_ctxt->mixer = effects_mixer_acquire(MIXER_CARD);
     if (!out_ctxt->mixer) {
         ALOGE("Failed to open mixer");
         out_ctxt->ctl = NULL;
@@ -214,10 +212,11 @@ int offload_effects_bundle_hal_start_output(audio_io_handle_t output, int pcm_id
         free(out_ctxt);
         goto exit;
     } else {
-        out_ctxt->ctl = mixer_get_ctl_by_name(out_ctxt->mixer, mixer_string);
+        out_ctxt->ctl = effects_mixer_get_pcm_ctl(MIXER_CARD, "Audio Effects Config",
+                                                  out_ctxt->pcm_device_id);
         if (!out_ctxt->ctl) {
             ALOGE("mixer_get_ctl_by_name failed");
-            mixer_close(out_ctxt->mixer);
+            effects_mixer_release(MIXER_CARD);
             out_ctxt->mixer = NULL;
             ret = -EINVAL;
             free(out_ctxt);
@@ -226,6 +225,7 @@ int offload_effects_bundle_hal_start_output(audio_io_handle_t output, int pcm_id
     }
 
     list_init(&out_ctxt->effects_list);
+    offload_effects_stage_start(out_ctxt->ctl);
 
     list_for_each(node, &created_effects_list) {
         effect_context_t *fx_ctxt = node_to_item(node,
@@ -237,6 +237,7 @@ int offload_effects_bundle_hal_start_output(audio_io_handle_t output, int pcm_id
             list_add_tail(&out_ctxt->effects_list, &fx_ctxt->output_node);
         }
     }
+    offload_effects_stage_flush(out_ctxt->ctl);
     list_add_tail(&active_outputs_list, &out_ctxt->outputs_list_node);
 exit:
     pthread_mutex_unlock(&lock);
@@ -265,9 +266,6 @@ int offload_effects_bundle_hal_stop_output(audio_io_handle_t output, int pcm_id)
         goto exit;
     }
 
-    if (out_ctxt->mixer)
-        mixer_close(out_ctxt->mixer);
-
     list_for_each(fx_node, &out_ctxt->effects_list) {
         effect_context_t *fx_ctxt = node_to_item(fx_node,
                                                  effect_context_t,
@@ -276,6 +274,11 @@ int offload_effects_bundle_hal_stop_output(audio_io_handle_t output, int pcm_id)
             fx_ctxt->ops.stop(fx_ctxt, out_ctxt);
     }
 
+    /* after the effects dropped their reference to the control */
+    offload_effects_stage_stop(out_ctxt->ctl);
+    if (out_ctxt->mixer)
+        effects_mixer_release(MIXER_CARD);
+
     list_remove(&out_ctxt->outputs_list_node);
 
     free(out_ctxt);
@@ -725,6 +728,14 @@ int effect_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
         break;
     }
 
+    /* parameter sweeps arrive as bursts of SET_PARAM and are left to
+     * coalesce, any other command sends what is staged */
+    if (cmdCode != EFFECT_CMD_SET_PARAM) {
+        output_context_t *out_ctxt = get_output(context->out_handle);
+        if (out_ctxt != NULL)
+            offload_effects_stage_flush(out_ctxt->ctl);
+    }
+
 exit:
     pthread_mutex_unlock(&lock);
 
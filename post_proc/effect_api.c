@@ -19,7 +19,12 @@
 
 #include <stdio.h>
 #include <errno.h>
+#include <pthread.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include <cutils/log.h>
 #include <tinyalsa/asoundlib.h>
@@ -86,6 +91,360 @@ void offload_close_mixer(struct mixer *mixer)
     mixer_close(mixer);
 }
 
+/*
+ * Parameter staging
+ *
+ * A payload of the "Audio Effects Config" control addresses one module:
+ * module id, device, command count, then per command its id, CONFIG_SET,
+ * offset and length followed by length values. Staged commands are merged
+ * per module by id, the last value winning. At flush time a command equal
+ * to the one last sent for the same device is dropped.
+ */
+
+#define OFFLOAD_PARAMS_LEN 128
+#define OFFLOAD_PARAMS_HEADER_LEN 3
+#define OFFLOAD_COMMAND_HEADER_LEN 4
+#define OFFLOAD_MAX_MODULES 4
+#define OFFLOAD_MAX_OUTPUTS 8
+/* a parameter sweep from an app issues commands a few ms apart */
+#define OFFLOAD_PARAMS_COALESCE_MS 10
+
+struct offload_module_stage {
+    bool in_use;
+    int id;
+    bool pending_valid;
+    bool sent_valid;
+    int pending[OFFLOAD_PARAMS_LEN];
+    int sent[OFFLOAD_PARAMS_LEN];
+};
+
+struct offload_effects_stage {
+    struct mixer_ctl *ctl;
+    struct offload_module_stage modules[OFFLOAD_MAX_MODULES];
+    int64_t deadline_ns;            /* 0 when nothing is staged */
+    uint32_t updates;               /* send_params calls with commands */
+    uint32_t transactions;          /* mixer_ctl_set_array calls */
+    uint32_t unchanged;             /* commands dropped as already sent */
+};
+
+/* stage_lock must be held when accessing stages */
+static pthread_mutex_t stage_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stage_cond;
+static struct offload_effects_stage stages[OFFLOAD_MAX_OUTPUTS];
+static unsigned int stage_count;
+static pthread_t stage_thread;
+static bool stage_thread_exit;
+
+static int64_t offload_now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static struct offload_effects_stage *get_stage_l(struct mixer_ctl *ctl)
+{
+    int i;
+
+    for (i = 0; i < OFFLOAD_MAX_OUTPUTS; i++) {
+        if (stages[i].ctl == ctl)
+            return &stages[i];
+    }
+    return NULL;
+}
+
+/* Returns the offset of command id in payload, -1 if absent. Sets *end to
+ * the end of the last command, or to -1 if the payload is malformed. */
+static int find_command(const int *payload, int id, int *end)
+{
+    int count = payload[2];
+    int offset = OFFLOAD_PARAMS_HEADER_LEN;
+    int found = -1;
+    int i, next;
+
+    for (i = 0; i < count; i++) {
+        if (offset + OFFLOAD_COMMAND_HEADER_LEN > OFFLOAD_PARAMS_LEN)
+            goto malformed;
+        next = offset + OFFLOAD_COMMAND_HEADER_LEN + payload[offset + 3];
+        if (payload[offset + 3] < 0 || next > OFFLOAD_PARAMS_LEN)
+            goto malformed;
+        if (payload[offset] == id)
+            found = offset;
+        offset = next;
+    }
+    *end = offset;
+    return found;
+malformed:
+    *end = -1;
+    return -1;
+}
+
+static int command_len(const int *payload, int offset)
+{
+    return OFFLOAD_COMMAND_HEADER_LEN + payload[offset + 3];
+}
+
+/* Replaces command id of payload with cmd, or appends it. */
+static int merge_command(int *payload, const int *cmd)
+{
+    int len = OFFLOAD_COMMAND_HEADER_LEN + cmd[3];
+    int end;
+    int offset = find_command(payload, cmd[0], &end);
+
+    if (end < 0)
+        return -EINVAL;
+    if (offset >= 0 && command_len(payload, offset) == len) {
+        memcpy(&payload[offset], cmd, len * sizeof(int));
+        return 0;
+    }
+    if (offset >= 0) {
+        int old_len = command_len(payload, offset);
+        memmove(&payload[offset], &payload[offset + old_len],
+                (end - offset - old_len) * sizeof(int));
+        end -= old_len;
+        payload[2]--;
+    }
+    if (end + len > OFFLOAD_PARAMS_LEN)
+        return -ENOSPC;
+    memcpy(&payload[end], cmd, len * sizeof(int));
+    payload[2]++;
+    return 0;
+}
+
+static void flush_module_l(struct offload_effects_stage *stage,
+                           struct offload_module_stage *module)
+{
+    int param_values[OFFLOAD_PARAMS_LEN] = {0};
+    const int *pending = module->pending;
+    int offset = OFFLOAD_PARAMS_HEADER_LEN;
+    int end, sent_offset, sent_end, len, i;
+
+    if (!module->pending_valid)
+        return;
+    module->pending_valid = false;
+
+    /* a device change reconfigures the module, send everything */
+    if (module->sent_valid && module->sent[1] != pending[1])
+        module->sent_valid = false;
+    if (!module->sent_valid) {
+        memcpy(module->sent, pending, OFFLOAD_PARAMS_HEADER_LEN * sizeof(int));
+        module->sent[2] = 0;
+        module->sent_valid = true;
+    }
+
+    memcpy(param_values, pending, OFFLOAD_PARAMS_HEADER_LEN * sizeof(int));
+    param_values[2] = 0;
+    end = OFFLOAD_PARAMS_HEADER_LEN;
+    for (i = 0; i < pending[2]; i++) {
+        len = command_len(pending, offset);
+        sent_offset = find_command(module->sent, pending[offset], &sent_end);
+        if (sent_offset >= 0 && command_len(module->sent, sent_offset) == len &&
+                memcmp(&module->sent[sent_offset], &pending[offset], len * sizeof(int)) == 0) {
+            stage->unchanged++;
+        } else {
+            memcpy(&param_values[end], &pending[offset], len * sizeof(int));
+            end += len;
+            param_values[2]++;
+            if (merge_command(module->sent, &pending[offset]) != 0)
+                module->sent_valid = false;
+        }
+        offset += len;
+    }
+
+    if (param_values[2]) {
+        mixer_ctl_set_array(stage->ctl, param_values, ARRAY_SIZE(param_values));
+        stage->transactions++;
+    }
+}
+
+static void flush_stage_l(struct offload_effects_stage *stage)
+{
+    int i;
+
+    for (i = 0; i < OFFLOAD_MAX_MODULES; i++)
+        flush_module_l(stage, &stage->modules[i]);
+    stage->deadline_ns = 0;
+}
+
+static void *stage_thread_loop(void *arg __unused)
+{
+    int64_t now, next;
+    struct timespec ts;
+    int i;
+
+    pthread_mutex_lock(&stage_lock);
+    while (!stage_thread_exit) {
+        now = offload_now_ns();
+        next = 0;
+        for (i = 0; i < OFFLOAD_MAX_OUTPUTS; i++) {
+            struct offload_effects_stage *stage = &stages[i];
+            if (stage->ctl == NULL || stage->deadline_ns == 0)
+                continue;
+            if (stage->deadline_ns <= now)
+                flush_stage_l(stage);
+            else if (next == 0 || stage->deadline_ns < next)
+                next = stage->deadline_ns;
+        }
+        if (next == 0) {
+            pthread_cond_wait(&stage_cond, &stage_lock);
+        } else {
+            ts.tv_sec = next / 1000000000LL;
+            ts.tv_nsec = next % 1000000000LL;
+            pthread_cond_timedwait(&stage_cond, &stage_lock, &ts);
+        }
+    }
+    pthread_mutex_unlock(&stage_lock);
+    return NULL;
+}
+
+/* Stages the payload built by a send_params function. Returns false if
+ * the payload has to be sent right away. */
+static bool stage_params(struct mixer_ctl *ctl, const int *param_values)
+{
+    struct offload_effects_stage *stage;
+    struct offload_module_stage *module = NULL;
+    int offset = OFFLOAD_PARAMS_HEADER_LEN;
+    int end, i;
+    bool staged = false;
+
+    pthread_mutex_lock(&stage_lock);
+    stage = get_stage_l(ctl);
+    if (stage == NULL)
+        goto exit;
+    find_command(param_values, -1, &end);
+    if (end < 0)
+        goto exit;
+
+    for (i = 0; i < OFFLOAD_MAX_MODULES; i++) {
+        struct offload_module_stage *m = &stage->modules[i];
+        if (m->in_use && m->id == param_values[0]) {
+            module = m;
+            break;
+        }
+        if (!m->in_use && module == NULL)
+            module = m;
+    }
+    if (module == NULL)
+        goto exit;
+    if (!module->in_use) {
+        module->in_use = true;
+        module->id = param_values[0];
+    }
+
+    /* keep the order of a device change against staged commands */
+    if (module->pending_valid && module->pending[1] != param_values[1])
+        flush_module_l(stage, module);
+    if (!module->pending_valid) {
+        memcpy(module->pending, param_values, OFFLOAD_PARAMS_HEADER_LEN * sizeof(int));
+        module->pending[2] = 0;
+        module->pending_valid = true;
+    }
+    for (i = 0; i < param_values[2]; i++) {
+        if (merge_command(module->pending, &param_values[offset]) != 0) {
+            /* cannot happen with the payloads built here, play safe */
+            flush_module_l(stage, module);
+            goto exit;
+        }
+        offset += command_len(param_values, offset);
+    }
+
+    stage->updates++;
+    if (stage->deadline_ns == 0) {
+        stage->deadline_ns = offload_now_ns() + OFFLOAD_PARAMS_COALESCE_MS * 1000000LL;
+        pthread_cond_signal(&stage_cond);
+    }
+    staged = true;
+exit:
+    pthread_mutex_unlock(&stage_lock);
+    return staged;
+}
+
+static void send_params(struct mixer_ctl *ctl, int *param_values)
+{
+    if (!stage_params(ctl, param_values))
+        mixer_ctl_set_array(ctl, param_values, OFFLOAD_PARAMS_LEN);
+}
+
+void offload_effects_stage_start(struct mixer_ctl *ctl)
+{
+    struct offload_effects_stage *stage;
+    pthread_condattr_t attr;
+
+    if (ctl == NULL)
+        return;
+
+    pthread_mutex_lock(&stage_lock);
+    /* a new DSP session knows none of the values sent before */
+    stage = get_stage_l(ctl);
+    if (stage == NULL)
+        stage = get_stage_l(NULL);
+    if (stage == NULL) {
+        ALOGW("%s: no stage left, parameters are sent unstaged", __func__);
+        goto exit;
+    }
+    if (stage->ctl == NULL)
+        stage_count++;
+    memset(stage, 0, sizeof(*stage));
+    stage->ctl = ctl;
+
+    if (stage_count == 1) {
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&stage_cond, &attr);
+        pthread_condattr_destroy(&attr);
+        stage_thread_exit = false;
+        if (pthread_create(&stage_thread, (const pthread_attr_t *) NULL,
+                           stage_thread_loop, NULL) != 0) {
+            ALOGE("%s: failed to create stage thread", __func__);
+            memset(stage, 0, sizeof(*stage));
+            stage_count--;
+            pthread_cond_destroy(&stage_cond);
+        }
+    }
+exit:
+    pthread_mutex_unlock(&stage_lock);
+}
+
+void offload_effects_stage_stop(struct mixer_ctl *ctl)
+{
+    struct offload_effects_stage *stage;
+    bool join = false;
+
+    pthread_mutex_lock(&stage_lock);
+    stage = get_stage_l(ctl);
+    if (stage == NULL || ctl == NULL) {
+        pthread_mutex_unlock(&stage_lock);
+        return;
+    }
+    flush_stage_l(stage);
+    ALOGD("%s: %u parameter updates sent in %u transactions, %u unchanged commands dropped",
+          __func__, stage->updates, stage->transactions, stage->unchanged);
+    memset(stage, 0, sizeof(*stage));
+    if (--stage_count == 0) {
+        stage_thread_exit = true;
+        pthread_cond_signal(&stage_cond);
+        join = true;
+    }
+    pthread_mutex_unlock(&stage_lock);
+
+    if (join) {
+        pthread_join(stage_thread, (void **) NULL);
+        pthread_cond_destroy(&stage_cond);
+    }
+}
+
+void offload_effects_stage_flush(struct mixer_ctl *ctl)
+{
+    struct offload_effects_stage *stage;
+
+    pthread_mutex_lock(&stage_lock);
+    stage = get_stage_l(ctl);
+    if (stage != NULL && ctl != NULL && stage->deadline_ns != 0)
+        flush_stage_l(stage);
+    pthread_mutex_unlock(&stage_lock);
+}
+
 void offload_bassboost_set_device(struct bass_boost_params *bassboost,
                                   uint32_t device)
 {
@@ -157,7 +516,7 @@ int offload_bassboost_send_params(struct mixer_ctl *ctl,
     }
 
     if (param_values[2] && ctl)
-        mixer_ctl_set_array(ctl, param_values, ARRAY_SIZE(param_values));
+        send_params(ctl, param_values);
 
     return 0;
 }
@@ -248,7 +607,7 @@ int offload_virtualizer_send_params(struct mixer_ctl *ctl,
     }
 
     if (param_values[2] && ctl)
-        mixer_ctl_set_array(ctl, param_values, ARRAY_SIZE(param_values));
+        send_params(ctl, param_values);
 
     return 0;
 }
@@ -348,7 +707,7 @@ int offload_eq_send_params(struct mixer_ctl *ctl, struct eq_params *eq,
     }
 
     if (param_values[2] && ctl)
-        mixer_ctl_set_array(ctl, param_values, ARRAY_SIZE(param_values));
+        send_params(ctl, param_values);
 
     return 0;
 }
@@ -596,7 +955,7 @@ int offload_reverb_send_params(struct mixer_ctl *ctl,
     }
 
     if (param_values[2] && ctl)
-        mixer_ctl_set_array(ctl, param_values, ARRAY_SIZE(param_values));
+        send_params(ctl, param_values);
 
     return 0;
 }
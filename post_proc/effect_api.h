@@ -22,6 +22,18 @@ int offload_update_mixer_and_effects_ctl(int card, int device_id,
                                          struct mixer_ctl *ctl);
 void offload_close_mixer(struct mixer *mixer);
 
+/* Parameter staging per "Audio Effects Config" control, i.e. per output.
+ * The send_params functions below stage their commands, and changes that
+ * arrive within a short window are sent together: one transaction per
+ * module, holding only the commands whose value differs from what the DSP
+ * already has. Staging starts and stops with the output's DSP session;
+ * without it the commands are sent immediately.
+ */
+void offload_effects_stage_start(struct mixer_ctl *ctl);
+void offload_effects_stage_stop(struct mixer_ctl *ctl);
+/* sends what is staged now instead of at the end of the window */
+void offload_effects_stage_flush(struct mixer_ctl *ctl);
+
 #define OFFLOAD_SEND_BASSBOOST_ENABLE_FLAG      (1 << 0)
 #define OFFLOAD_SEND_BASSBOOST_STRENGTH         \
                                           (OFFLOAD_SEND_BASSBOOST_ENABLE_FLAG << 1)
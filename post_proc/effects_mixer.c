@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "offload_effects_mixer"
+//#define LOG_NDEBUG 0
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cutils/log.h>
+
+#include "effects_mixer.h"
+
+#define EFFECTS_MIXER_MAX_CARDS 4
+#define EFFECTS_MIXER_MAX_CTLS 16
+#define EFFECTS_MIXER_CTL_NAME_LEN 64
+
+struct effects_mixer_ctl {
+    char name[EFFECTS_MIXER_CTL_NAME_LEN];
+    struct mixer_ctl *ctl;
+};
+
+struct effects_mixer {
+    int card;
+    struct mixer *mixer;
+    unsigned int refs;
+    bool stale;
+    unsigned int ctl_count;
+    struct effects_mixer_ctl ctls[EFFECTS_MIXER_MAX_CTLS];
+};
+
+/* lock must be held when accessing mixers */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static struct effects_mixer mixers[EFFECTS_MIXER_MAX_CARDS];
+
+static struct effects_mixer *get_mixer_l(int card)
+{
+    int i;
+
+    for (i = 0; i < EFFECTS_MIXER_MAX_CARDS; i++) {
+        if (mixers[i].mixer != NULL && mixers[i].card == card)
+            return &mixers[i];
+    }
+    return NULL;
+}
+
+static void close_mixer_l(struct effects_mixer *m)
+{
+    ALOGV("%s: card %d", __func__, m->card);
+    mixer_close(m->mixer);
+    memset(m, 0, sizeof(*m));
+}
+
+__attribute__ ((visibility ("default")))
+struct mixer *effects_mixer_acquire(int card)
+{
+    struct effects_mixer *m;
+    struct mixer *mixer = NULL;
+    int i;
+
+    pthread_mutex_lock(&lock);
+    m = get_mixer_l(card);
+    if (m != NULL && m->stale && m->refs == 0) {
+        close_mixer_l(m);
+        m = NULL;
+    }
+    if (m == NULL) {
+        for (i = 0; i < EFFECTS_MIXER_MAX_CARDS && mixers[i].mixer != NULL; i++)
+            ;
+        if (i == EFFECTS_MIXER_MAX_CARDS) {
+            ALOGE("%s: no slot for card %d", __func__, card);
+            goto exit;
+        }
+        m = &mixers[i];
+        m->mixer = mixer_open(card);
+        if (m->mixer == NULL) {
+            ALOGE("%s: failed to open mixer for card %d", __func__, card);
+            goto exit;
+        }
+        m->card = card;
+        ALOGV("%s: opened card %d", __func__, card);
+    }
+    m->refs++;
+    mixer = m->mixer;
+exit:
+    pthread_mutex_unlock(&lock);
+    return mixer;
+}
+
+__attribute__ ((visibility ("default")))
+void effects_mixer_release(int card)
+{
+    struct effects_mixer *m;
+
+    pthread_mutex_lock(&lock);
+    m = get_mixer_l(card);
+    if (m == NULL || m->refs == 0) {
+        ALOGW("%s: card %d not acquired", __func__, card);
+    } else if (--m->refs == 0 && m->stale) {
+        close_mixer_l(m);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+__attribute__ ((visibility ("default")))
+struct mixer_ctl *effects_mixer_get_ctl(int card, const char *name)
+{
+    struct effects_mixer *m;
+    struct mixer_ctl *ctl = NULL;
+    unsigned int i;
+
+    pthread_mutex_lock(&lock);
+    m = get_mixer_l(card);
+    if (m == NULL || m->refs == 0) {
+        ALOGE("%s: card %d not acquired", __func__, card);
+        goto exit;
+    }
+    for (i = 0; i < m->ctl_count; i++) {
+        if (strcmp(m->ctls[i].name, name) == 0) {
+            ctl = m->ctls[i].ctl;
+            goto exit;
+        }
+    }
+    ctl = mixer_get_ctl_by_name(m->mixer, name);
+    if (ctl == NULL) {
+        m->stale = true;
+        goto exit;
+    }
+    if (m->ctl_count < EFFECTS_MIXER_MAX_CTLS && strlen(name) < EFFECTS_MIXER_CTL_NAME_LEN) {
+        strcpy(m->ctls[m->ctl_count].name, name);
+        m->ctls[m->ctl_count].ctl = ctl;
+        m->ctl_count++;
+    }
+exit:
+    pthread_mutex_unlock(&lock);
+    return ctl;
+}
+
+__attribute__ ((visibility ("default")))
+struct mixer_ctl *effects_mixer_get_pcm_ctl(int card, const char *prefix, int pcm_id)
+{
+    char name[EFFECTS_MIXER_CTL_NAME_LEN];
+
+    snprintf(name, sizeof(name), "%s %d", prefix, pcm_id);
+    return effects_mixer_get_ctl(card, name);
+}
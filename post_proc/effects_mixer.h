@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OFFLOAD_EFFECTS_MIXER_H
+#define OFFLOAD_EFFECTS_MIXER_H
+
+#include <tinyalsa/asoundlib.h>
+
+/* Process wide mixer handles shared by libqcompostprocbundle and
+ * libqcomvisualizer.
+ *
+ * mixer_open() enumerates every control of the card, which the effect
+ * libraries used to pay on each offload start. A card's mixer is opened by
+ * the first acquire and stays open when the last user releases it, so the
+ * next start reuses it. Controls found by name are cached per card, and
+ * the returned pointers stay valid until the matching release.
+ *
+ * A failed lookup marks the handle stale: it is reopened once no user
+ * holds it, in case the control was registered after the mixer was opened.
+ */
+struct mixer *effects_mixer_acquire(int card);
+void effects_mixer_release(int card);
+
+struct mixer_ctl *effects_mixer_get_ctl(int card, const char *name);
+/* control named "<prefix> <pcm_id>", e.g. "Audio Effects Config 9" */
+struct mixer_ctl *effects_mixer_get_pcm_ctl(int card, const char *prefix, int pcm_id);
+
+#endif /* OFFLOAD_EFFECTS_MIXER_H */
@@ -20,7 +20,9 @@
 #include <dlfcn.h>
 #include <math.h>
 #include <pthread.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/prctl.h>
 
 #include <cutils/list.h>
 #include <cutils/log.h>
@@ -55,6 +57,13 @@
 #define AHAL_GAIN_GET_MAPPING_TABLE "audio_hw_get_gain_level_mapping"
 #define DEFAULT_CAL_STEP 0
 
+/* volume margin past the edges of the current calibration step before leaving it */
+#define DEFAULT_CAL_HYSTERESIS_MB 100
+/* minimum time between two calibration sends to the HAL */
+#define DEFAULT_CAL_INTERVAL_MS 100
+/* period of the calibration send counters */
+#define CAL_STATS_WINDOW_MS 60000
+
 enum {
     VOL_LISTENER_STATE_UNINITIALIZED,
     VOL_LISTENER_STATE_INITIALIZED,
@@ -91,6 +100,8 @@ struct vol_listener_context_s {
     uint32_t dev_id;
     float left_vol;
     float right_vol;
+    bool energy_counted; /* the context contributes energy to sum_energy */
+    float energy;        /* the contribution, loudest channel volume squared */
 };
 
 /* volume listener, music UUID: 08b8b058-0590-11e5-ac71-0025b32654a0 */
@@ -192,6 +203,32 @@ static int init_status;
 /* current volume level for which gain dep cal level was selected */
 static float current_vol = 0.0;
 
+/* table step of current_gain_dep_cal_level, -1 if the level is not from the table */
+static int current_gain_dep_cal_step = -1;
+
+/* energy sum of the active effects on a calibrated device and their count.
+ * Updated on each context change with vol_listner_init_lock held. */
+static double sum_energy = 0.0;
+static int energy_count = 0;
+
+/* ratio by which the volume must cross a step edge to change step */
+static float cal_hysteresis_ratio = 1.0;
+
+/* Calibration dispatcher: the level is sent to the HAL from gain_dep_cal_thread so that effect
+ * commands do not wait for it, at most once per cal_interval_ms. Only the latest requested
+ * level is sent. cal_lock protects the variables below. */
+static pthread_mutex_t cal_lock;
+static pthread_cond_t cal_cond;
+static pthread_t gain_dep_cal_thread;
+static bool cal_thread_started = false;
+static int cal_requested_level = -1;
+static int cal_sent_level = -1;
+static int64_t cal_interval_ns;
+/* counters over the current stats window */
+static uint32_t cal_requests;
+static uint32_t cal_sends;
+static int64_t cal_window_start_ns;
+
 /* HAL interface to send calibration */
 static bool (*send_gain_dep_cal)(int);
 
@@ -236,6 +273,12 @@ static void dump_list_l()
                 context->dev_id, context->state, context->session_id, context->left_vol,context->right_vol);
     }
 
+    pthread_mutex_lock(&cal_lock);
+    ALOGW("%s: energy sum %f count %d, gain dep cal level (requested/sent) %d / %d, "
+          "%u requests %u sends in the current window", __func__, sum_energy, energy_count,
+          cal_requested_level, cal_sent_level, cal_requests, cal_sends);
+    pthread_mutex_unlock(&cal_lock);
+
     ALOGW("DUMP_END :: ===========");
 }
 
@@ -254,38 +297,208 @@ static inline bool valid_dev_in_context(struct vol_listener_context_s *context)
     return false;
 }
 
+static int64_t vol_now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Updates the contribution of context to the energy sum. Called with vol_listner_init_lock
+ * held after any change of the context state, device or volume, counted is false before
+ * the context is released. */
+static void update_energy_l(vol_listener_context_t *context, bool counted)
+{
+    float energy = 0;
+
+    if (counted) {
+        float vol = fmax(context->left_vol, context->right_vol);
+        energy = vol * vol;
+    }
+    if (context->energy_counted) {
+        sum_energy -= context->energy;
+        energy_count--;
+    }
+    if (counted) {
+        sum_energy += energy;
+        energy_count++;
+    }
+    context->energy_counted = counted;
+    context->energy = energy;
+
+    /* do not carry rounding errors once no context is counted, nor let them
+     * take the sum below zero */
+    if (energy_count == 0 || sum_energy < 0)
+        sum_energy = 0.0;
+}
+
+static inline void refresh_energy_l(vol_listener_context_t *context)
+{
+    update_energy_l(context, context->state == VOL_LISTENER_STATE_ACTIVE &&
+                             valid_dev_in_context(context));
+}
+
+/* Returns the table step with amp <= vol < next step amp, -1 below the first step or
+ * at or above the last one, as the former linear scan. */
+static int find_gain_dep_cal_step(float vol)
+{
+    int lo = 0, hi = total_volume_cal_step - 1;
+
+    if (total_volume_cal_step < 2 || vol < volume_curve_gain_mapping_table[0].amp)
+        return -1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (volume_curve_gain_mapping_table[mid].amp <= vol)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo + 1 < total_volume_cal_step ? lo : -1;
+}
+
+/* Returns the gain dep cal level for vol, -1 if none, and its table step in *step */
+static int get_gain_dep_cal_level(float vol, int *step)
+{
+    *step = -1;
+    if (vol >= 1 && total_volume_cal_step > 0) { // max amplitude, use highest DRC level
+        *step = total_volume_cal_step - 1;
+    } else if (vol == -1) {
+        return DEFAULT_CAL_STEP;
+    } else if (vol == 0) {
+        *step = 0;
+    } else {
+        int cur = current_gain_dep_cal_step;
+
+        *step = find_gain_dep_cal_step(vol);
+        // stay on the current step until the volume is past its edges by the hysteresis
+        if (*step != -1 && cur != -1 && *step != cur) {
+            if (*step > cur && cur + 1 < total_volume_cal_step &&
+                    vol < volume_curve_gain_mapping_table[cur + 1].amp * cal_hysteresis_ratio)
+                *step = cur;
+            else if (*step < cur &&
+                    vol * cal_hysteresis_ratio >= volume_curve_gain_mapping_table[cur].amp)
+                *step = cur;
+        }
+        if (*step == -1)
+            return -1;
+    }
+    return volume_curve_gain_mapping_table[*step].level;
+}
+
+static void *gain_dep_cal_thread_loop(void *arg __unused)
+{
+    int64_t last_send_ns = 0;
+    struct timespec ts;
+
+    prctl(PR_SET_NAME, (unsigned long)"vol listener cal", 0, 0, 0);
+
+    pthread_mutex_lock(&cal_lock);
+    for (;;) {
+        if (cal_requested_level == cal_sent_level) {
+            pthread_cond_wait(&cal_cond, &cal_lock);
+            continue;
+        }
+        int64_t now = vol_now_ns();
+        int64_t next = last_send_ns + cal_interval_ns;
+        if (last_send_ns != 0 && now < next) {
+            // a volume ramp is in progress, send its latest level once the interval is over
+            ts.tv_sec = next / 1000000000LL;
+            ts.tv_nsec = next % 1000000000LL;
+            pthread_cond_timedwait(&cal_cond, &cal_lock, &ts);
+            continue;
+        }
+
+        int level = cal_requested_level;
+        cal_sent_level = level;
+        pthread_mutex_unlock(&cal_lock);
+
+        if (!send_gain_dep_cal(level)) {
+            ALOGE("%s: Failed to set gain dep cal level", __func__);
+        }
+
+        pthread_mutex_lock(&cal_lock);
+        last_send_ns = now;
+        cal_sends++;
+        if (now - cal_window_start_ns >= CAL_STATS_WINDOW_MS * 1000000LL) {
+            ALOGD("%s: %u gain dep cal sends for %u requests in the last %lld s", __func__,
+                  cal_sends, cal_requests, (long long)((now - cal_window_start_ns) / 1000000000LL));
+            cal_sends = 0;
+            cal_requests = 0;
+            cal_window_start_ns = now;
+        }
+    }
+    pthread_mutex_unlock(&cal_lock);
+    return NULL;
+}
+
+/* Hands the level over to the dispatcher, or sends it if the dispatcher is not running */
+static void request_gain_dep_cal(int level)
+{
+    if (!cal_thread_started) {
+        if (!send_gain_dep_cal(level)) {
+            ALOGE("%s: Failed to set gain dep cal level", __func__);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&cal_lock);
+    cal_requests++;
+    if (cal_requested_level != level) {
+        cal_requested_level = level;
+        pthread_cond_signal(&cal_cond);
+    }
+    pthread_mutex_unlock(&cal_lock);
+}
+
+/* Forgets the levels requested so far, the next request is sent whatever its level */
+static void reset_gain_dep_cal()
+{
+    pthread_mutex_lock(&cal_lock);
+    cal_requested_level = -1;
+    cal_sent_level = -1;
+    pthread_mutex_unlock(&cal_lock);
+}
+
+static void start_gain_dep_cal_thread()
+{
+    pthread_condattr_t attr;
+
+    pthread_mutex_init(&cal_lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&cal_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    if (send_gain_dep_cal == NULL)
+        return;
+
+    cal_window_start_ns = vol_now_ns();
+    if (pthread_create(&gain_dep_cal_thread, (const pthread_attr_t *) NULL,
+                       gain_dep_cal_thread_loop, NULL) != 0) {
+        ALOGE("%s: failed to create gain dep cal thread, sending synchronously", __func__);
+        return;
+    }
+    cal_thread_started = true;
+}
+
 static void check_and_set_gain_dep_cal()
 {
-    // iterate through list and make decision to set new gain dep cal level for speaker device
-    // 1. find all usecase active on speaker
-    // 2. find energy sum for each usecase
-    // 3. find the highest of all the active usecase
-    // 4. if new value is different than the current value then load new calibration
+    // make decision to set new gain dep cal level for speaker device
+    // 1. take the energy sum of all usecases active on speaker, kept by update_energy_l()
+    // 2. find the calibration step of the resulting volume
+    // 3. if new level is different than the current level then request the new calibration
 
-    struct listnode *node = NULL;
     float new_vol = -1.0;
-    int max_level = 0;
-    vol_listener_context_t *context = NULL;
+    int gain_dep_cal_step = -1;
     if (dumping_enabled) {
         dump_list_l();
     }
 
     ALOGV("%s ==> Start ...", __func__);
 
-    float sum_energy = 0.0;
-    bool sum_energy_used = false;
-    float temp_vol = 0;
-    // compute energy sum for the active speaker device (pick loudest of both channels)
-    list_for_each(node, &vol_effect_list) {
-        context = node_to_item(node, struct vol_listener_context_s, effect_list_node);
-        if ((context->state == VOL_LISTENER_STATE_ACTIVE) &&
-            valid_dev_in_context(context)) {
-            sum_energy_used = true;
-            temp_vol = fmax(context->left_vol, context->right_vol);
-            sum_energy += temp_vol * temp_vol;
-        }
-    }
-    if (sum_energy_used) {
+    // energy sum for the active speaker device (pick loudest of both channels)
+    if (energy_count > 0) {
         new_vol = fmin(sqrt(sum_energy), 1.0);
     }
 
@@ -295,33 +508,15 @@ static void check_and_set_gain_dep_cal()
 
         if (send_gain_dep_cal != NULL) {
             // send Gain dep cal level
-            int gain_dep_cal_level = -1;
-
-            if (new_vol >= 1 && total_volume_cal_step > 0) { // max amplitude, use highest DRC level
-                gain_dep_cal_level = volume_curve_gain_mapping_table[total_volume_cal_step - 1].level;
-            } else if (new_vol == -1) {
-                gain_dep_cal_level = DEFAULT_CAL_STEP;
-            } else if (new_vol == 0) {
-                gain_dep_cal_level = volume_curve_gain_mapping_table[0].level;
-            } else {
-                for (max_level = 0; max_level + 1 < total_volume_cal_step; max_level++) {
-                    if (new_vol < volume_curve_gain_mapping_table[max_level + 1].amp &&
-                        new_vol >= volume_curve_gain_mapping_table[max_level].amp) {
-                        gain_dep_cal_level = volume_curve_gain_mapping_table[max_level].level;
-                        ALOGV("%s: volume(%f), gain dep cal selcetd %d ",
-                              __func__, current_vol, gain_dep_cal_level);
-                        break;
-                    }
-                }
-            }
+            int gain_dep_cal_level = get_gain_dep_cal_level(new_vol, &gain_dep_cal_step);
+            ALOGV("%s: volume(%f), gain dep cal selected %d ",
+                  __func__, new_vol, gain_dep_cal_level);
 
             // check here if previous gain dep cal level was not same
             if (gain_dep_cal_level != -1) {
                 if (gain_dep_cal_level != current_gain_dep_cal_level) {
                     // decision made .. send new level now
-                    if (!send_gain_dep_cal(gain_dep_cal_level)) {
-                        ALOGE("%s: Failed to set gain dep cal level", __func__);
-                    }
+                    request_gain_dep_cal(gain_dep_cal_level);
 
                     if (dumping_enabled) {
                         ALOGW("%s: (old/new) Volume (%f/%f) (old/new) level (%d/%d)",
@@ -336,6 +531,7 @@ static void check_and_set_gain_dep_cal()
                     // Gain level change info send to lower layer that has logic to re-apply on
                     // failure, so change current gain level to reflect new level
                     current_gain_dep_cal_level = gain_dep_cal_level;
+                    current_gain_dep_cal_step = gain_dep_cal_step;
                     current_vol = new_vol;
                 } else {
                     if (dumping_enabled) {
@@ -458,6 +654,7 @@ static int vol_effect_command(effect_handle_t self,
 
         context->state = VOL_LISTENER_STATE_ACTIVE;
         *(int *)p_reply_data = 0;
+        refresh_energy_l(context);
 
         // After changing the state and if device is speaker
         // recalculate gain dep cal level
@@ -485,6 +682,7 @@ static int vol_effect_command(effect_handle_t self,
 
         context->state = VOL_LISTENER_STATE_INITIALIZED;
         *(int *)p_reply_data = 0;
+        refresh_energy_l(context);
 
         // After changing the state and if device is speaker
         // recalculate gain dep cal level
@@ -526,6 +724,7 @@ static int vol_effect_command(effect_handle_t self,
         }
 
         context->dev_id = new_device;
+        refresh_energy_l(context);
 
         if (recompute_gain_dep_cal_Level) {
             check_and_set_gain_dep_cal();
@@ -557,6 +756,7 @@ static int vol_effect_command(effect_handle_t self,
 
         context->left_vol = left_vol;
         context->right_vol = right_vol;
+        refresh_energy_l(context);
 
         // recompute gan dep cal level only if volume changed on speaker device
         if (recompute_gain_dep_cal_Level) {
@@ -610,6 +810,7 @@ static bool resolve_audio_hal_path(char *file_name, int mode) {
 static void init_once()
 {
     int max_table_ent = 0;
+    int32_t hysteresis_mb, interval_ms;
     void *hal_lib_pointer = NULL;
     char primary_hal_path[PATH_MAX] = {0};
 
@@ -680,6 +881,13 @@ static void init_once()
     headset_cal_enabled = property_get_bool(
         "vendor.audio.volume.headset.gain.depcal",
         property_get_bool("audio.volume.headset.gain.depcal", false));
+    hysteresis_mb = property_get_int32("vendor.audio.volume.listener.hysteresis_mb",
+                                       DEFAULT_CAL_HYSTERESIS_MB);
+    cal_hysteresis_ratio = powf(10.0f, (hysteresis_mb > 0 ? hysteresis_mb : 0) / 2000.0f);
+    interval_ms = property_get_int32("vendor.audio.volume.listener.cal_interval_ms",
+                                     DEFAULT_CAL_INTERVAL_MS);
+    cal_interval_ns = (interval_ms > 0 ? interval_ms : 0) * 1000000LL;
+    start_gain_dep_cal_thread();
     init_status = 0;
     list_init(&vol_effect_list);
     initialized = true;
@@ -781,6 +989,7 @@ static int vol_prc_lib_release(effect_handle_t handle)
             if (valid_dev_in_context(context)) {
                 recompute_flag = true;
             }
+            update_energy_l(context, false);
             list_remove(&context->effect_list_node);
             free(context);
             status = 0;
@@ -799,7 +1008,9 @@ static int vol_prc_lib_release(effect_handle_t handle)
     // if there are no active streams, reset cal and volume level
     if (active_stream_count == 0) {
         current_gain_dep_cal_level = -1;
+        current_gain_dep_cal_step = -1;
         current_vol = 0.0;
+        reset_gain_dep_cal();
     }
 
     if (recompute_flag) {
@@ -17,7 +17,9 @@ LOCAL_PATH:= $(call my-dir)
 include $(CLEAR_VARS)
 
 LOCAL_SRC_FILES:= \
-	offload_visualizer.c
+	offload_visualizer.c \
+	visualizer_fft.c \
+	visualizer_kernels.c
 
 LOCAL_CFLAGS+= -O2 -fvisibility=hidden
 
@@ -25,7 +27,8 @@ LOCAL_SHARED_LIBRARIES := \
 	libcutils \
 	liblog \
 	libdl \
-	libtinyalsa
+	libtinyalsa \
+	libqcomeffectsmixer
 
 LOCAL_CFLAGS += \
     -Wall \
@@ -41,6 +44,7 @@ LOCAL_PROPRIETARY_MODULE := true
 
 LOCAL_C_INCLUDES := \
 	external/tinyalsa/include \
+	$(LOCAL_PATH)/../post_proc \
 	$(call include-path-for, audio-effects)
 
 LOCAL_HEADER_LIBRARIES += libsystem_headers
@@ -20,6 +20,7 @@
 #include <dlfcn.h>
 #include <math.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/prctl.h>
@@ -32,6 +33,11 @@
 #include <tinyalsa/asoundlib.h>
 #include <audio_effects/effect_visualizer.h>
 
+#include "effects_mixer.h"
+#include "offload_visualizer.h"
+#include "visualizer_fft.h"
+#include "visualizer_kernels.h"
+
 #define LIB_ACDB_LOADER "libacdbloader.so"
 #define ACDB_DEV_TYPE_OUT 1
 #define AFE_PROXY_ACDB_ID 45
@@ -87,8 +93,23 @@ struct output_context_s {
     struct listnode outputs_list_node;  /* node in active_outputs_list */
     audio_io_handle_t handle; /* io handle */
     struct listnode effects_list; /* list of effects attached to this output */
+    struct listnode spectrum_taps; /* list of spectrum_tap_t computed for this output */
 };
 
+/* Spectrum of the capture for one FFT size and decimation. It is computed once per capture
+ * period and shared by all the visualizers on the output requesting the same configuration.
+ * Accessed with lock held. */
+typedef struct spectrum_tap_s {
+    struct listnode node;  /* node in output_context_t.spectrum_taps */
+    uint32_t users;
+    uint32_t decimation_log2;
+    uint32_t history_idx;  /* index of the oldest sample in history */
+    uint64_t update_ns;    /* CLOCK_MONOTONIC time of the last computation, 0 if none */
+    int16_t history[VISUALIZER_FFT_MAX_SIZE];  /* decimated mono capture */
+    uint16_t bins[VISUALIZER_FFT_MAX_SIZE / 2];
+    struct visualizer_fft fft;
+} spectrum_tap_t;
+
 
 /* maximum time since last capture buffer update before resetting capture buffer. This means
   that the framework has stopped playing audio and we must start returning silence */
@@ -101,28 +122,45 @@ struct output_context_s {
 /* maximum number of buffers for which we keep track of the measurements */
 #define MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS 25 /* note: buffer index is stored in uint8_t */
 
-typedef struct buffer_stats_s {
-    bool is_valid;
-    uint16_t peak_u16; /* the positive peak of the absolute value of the samples in a buffer */
-    float rms_squared; /* the average square of the samples in a buffer */
-} buffer_stats_t;
+#define SPECTRUM_MAX_DECIMATION 8
+
+/* times a capture is copied again when the capture thread overwrote it during the copy */
+#define CAPTURE_READ_RETRIES 3
+
+/* A buffer measurement is packed in one word so that it is published atomically:
+ * bit 63 is the valid flag, bits 32-47 the positive peak of the absolute value of
+ * the samples and bits 0-31 the float average square of the samples. */
+#define MEAS_VALID (1ULL << 63)
+
+/* Position of the capture ring. It is written by the capture thread with lock held and read
+ * lock free by the capture and measurement commands. seq is odd while the thread writes the
+ * ring. */
+typedef struct capture_position_s {
+    atomic_uint seq;
+    atomic_uint frames;     /* frames written since reset, the ring index is frames % size */
+    atomic_ullong time_ns;  /* CLOCK_MONOTONIC time of the last update, 0 if none */
+} capture_position_t;
 
 typedef struct visualizer_context_s {
     effect_context_t common;
 
-    uint32_t capture_idx;
     uint32_t capture_size;
     uint32_t scaling_mode;
-    uint32_t last_capture_idx;
     uint32_t latency;
-    struct timespec buffer_update_time;
+    capture_position_t position;
+    uint32_t last_capture_frames; /* only accessed by VISUALIZER_CMD_CAPTURE */
     uint8_t capture_buf[CAPTURE_BUF_SIZE];
     /* for measurements */
     uint8_t channel_count; /* to avoid recomputing it every time a buffer is processed */
     uint32_t meas_mode;
     uint8_t meas_wndw_size_in_buffers;
-    uint8_t meas_buffer_idx;
-    buffer_stats_t past_meas[MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS];
+    uint8_t meas_buffer_idx; /* only accessed by the capture thread */
+    atomic_ullong past_meas[MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS];
+    /* for the spectrum */
+    uint32_t spectrum_size;
+    uint32_t spectrum_decimation;
+    output_context_t *output; /* output the effect is started on, NULL if none */
+    spectrum_tap_t *spectrum_tap;
 } visualizer_context_t;
 
 
@@ -167,6 +205,10 @@ struct listnode active_outputs_list;
 pthread_t capture_thread;
 /* lock must be held when modifying or accessing created_effects_list or active_outputs_list */
 pthread_mutex_t lock;
+/* effects_lock is also held for writing when adding to or removing from created_effects_list,
+ * so that the capture and measurement commands can validate a handle without waiting for
+ * lock, which the capture thread holds while processing. Locking order: lock -> effects_lock */
+pthread_rwlock_t effects_lock;
 /* thread_lock must be held when starting or stopping the capture thread.
  * Locking order: thread_lock -> lock */
 pthread_mutex_t thread_lock;
@@ -211,10 +253,12 @@ static void init_once() {
     list_init(&active_outputs_list);
 
     pthread_mutex_init(&lock, NULL);
+    pthread_rwlock_init(&effects_lock, NULL);
     pthread_mutex_init(&thread_lock, NULL);
     pthread_cond_init(&cond, NULL);
     exit_thread = false;
     thread_status = -1;
+    visualizer_fft_init();
 
     init_status = 0;
 }
@@ -224,6 +268,7 @@ int lib_init() {
     return init_status;
 }
 
+/* called with lock or effects_lock held */
 bool effect_exists(effect_context_t *context) {
     struct listnode *node;
 
@@ -303,14 +348,92 @@ bool effects_enabled() {
     return false;
 }
 
-int configure_proxy_capture(struct mixer *mixer, int value) {
+static uint64_t visualizer_get_time_ns() {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0)
+        return 0;
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Returns the tap of output for this configuration, shared with other effects if it exists.
+ * Called with lock held. */
+spectrum_tap_t *spectrum_get_tap(output_context_t *output, uint32_t size,
+                                 uint32_t decimation_log2) {
+    struct listnode *node;
+    spectrum_tap_t *tap;
+
+    list_for_each(node, &output->spectrum_taps) {
+        tap = node_to_item(node, spectrum_tap_t, node);
+        if (tap->fft.size == size && tap->decimation_log2 == decimation_log2) {
+            tap->users++;
+            return tap;
+        }
+    }
+
+    tap = (spectrum_tap_t *)calloc(1, sizeof(spectrum_tap_t));
+    if (tap == NULL)
+        return NULL;
+    if (visualizer_fft_setup(&tap->fft, size) != 0) {
+        free(tap);
+        return NULL;
+    }
+    tap->decimation_log2 = decimation_log2;
+    tap->users = 1;
+    list_add_tail(&output->spectrum_taps, &tap->node);
+    return tap;
+}
+
+/* Called with lock held */
+void spectrum_put_tap(spectrum_tap_t *tap) {
+    if (--tap->users == 0) {
+        list_remove(&tap->node);
+        free(tap);
+    }
+}
+
+/* Feeds one capture period to the spectrum taps of output. Called with lock held. */
+void spectrum_process(output_context_t *output, audio_buffer_t *buf) {
+    struct listnode *node;
+    uint64_t now_ns = 0;
+
+    list_for_each(node, &output->spectrum_taps) {
+        spectrum_tap_t *tap = node_to_item(node, spectrum_tap_t, node);
+        const uint32_t size = tap->fft.size;
+        /* frames left over by the decimation are dropped: the proxy period is a
+         * multiple of SPECTRUM_MAX_DECIMATION */
+        uint32_t frames = buf->frameCount >> tap->decimation_log2;
+        const int16_t *src = buf->s16;
+
+        if (frames > size) {
+            /* only the last size samples are transformed */
+            src += 2 * ((frames - size) << tap->decimation_log2);
+            frames = size;
+        }
+
+        uint32_t count = size - tap->history_idx;
+        if (count > frames)
+            count = frames;
+        visualizer_kernels_decimate_16(tap->history + tap->history_idx, src, count,
+                                       tap->decimation_log2);
+        visualizer_kernels_decimate_16(tap->history, src + 2 * (count << tap->decimation_log2),
+                                       frames - count, tap->decimation_log2);
+        tap->history_idx = (tap->history_idx + frames) & (size - 1);
+
+        visualizer_fft_magnitudes(&tap->fft, tap->history, tap->history_idx, tap->bins);
+        if (now_ns == 0)
+            now_ns = visualizer_get_time_ns();
+        tap->update_ns = now_ns;
+    }
+}
+
+int configure_proxy_capture(int card, int value) {
     const char *proxy_ctl_name = "AFE_PCM_RX Audio Mixer MultiMedia4";
     struct mixer_ctl *ctl;
 
     if (value && acdb_send_audio_cal)
         acdb_send_audio_cal(AFE_PROXY_ACDB_ID, ACDB_DEV_TYPE_OUT);
 
-    ctl = mixer_get_ctl_by_name(mixer, proxy_ctl_name);
+    ctl = effects_mixer_get_ctl(card, proxy_ctl_name);
     if (ctl == NULL) {
         ALOGW("%s: could not get %s ctl", __func__, proxy_ctl_name);
         return -EINVAL;
@@ -324,11 +447,12 @@ int configure_proxy_capture(struct mixer *mixer, int value) {
 
 void *capture_thread_loop(void *arg __unused)
 {
-    int16_t data[AUDIO_CAPTURE_PERIOD_SIZE * AUDIO_CAPTURE_CHANNEL_COUNT * sizeof(int16_t)];
+    int16_t data[AUDIO_CAPTURE_PERIOD_SIZE * AUDIO_CAPTURE_CHANNEL_COUNT];
     audio_buffer_t buf;
     buf.frameCount = AUDIO_CAPTURE_PERIOD_SIZE;
     buf.s16 = data;
     bool capture_enabled = false;
+    int card;
     struct mixer *mixer;
     struct pcm *pcm = NULL;
     int ret;
@@ -340,10 +464,11 @@ void *capture_thread_loop(void *arg __unused)
 
     pthread_mutex_lock(&lock);
 
-    mixer = mixer_open(capture_config.snd_card_num);
+    card = capture_config.snd_card_num;
+    mixer = effects_mixer_acquire(card);
     while (mixer == NULL && retry_num < RETRY_NUMBER) {
         usleep(RETRY_US);
-        mixer = mixer_open(capture_config.snd_card_num);
+        mixer = effects_mixer_acquire(card);
         retry_num++;
     }
     if (mixer == NULL) {
@@ -357,16 +482,16 @@ void *capture_thread_loop(void *arg __unused)
         }
         if (effects_enabled()) {
             if (!capture_enabled) {
-                ret = configure_proxy_capture(mixer, 1);
+                ret = configure_proxy_capture(card, 1);
                 if (ret == 0) {
-                    pcm = pcm_open(capture_config.snd_card_num,
+                    pcm = pcm_open(card,
                                    capture_config.capture_device_id,
                                    PCM_IN|PCM_MMAP|PCM_NOIRQ, &pcm_config_capture);
                     if (pcm && !pcm_is_ready(pcm)) {
                         ALOGW("%s: %s", __func__, pcm_get_error(pcm));
                         pcm_close(pcm);
                         pcm = NULL;
-                        configure_proxy_capture(mixer, 0);
+                        configure_proxy_capture(card, 0);
                     } else {
                         capture_enabled = true;
                         ALOGD("%s: capture ENABLED", __func__);
@@ -377,7 +502,7 @@ void *capture_thread_loop(void *arg __unused)
             if (capture_enabled) {
                 if (pcm != NULL)
                     pcm_close(pcm);
-                configure_proxy_capture(mixer, 0);
+                configure_proxy_capture(card, 0);
                 ALOGD("%s: capture DISABLED", __func__);
                 capture_enabled = false;
             }
@@ -399,6 +524,8 @@ void *capture_thread_loop(void *arg __unused)
                                                           outputs_list_node);
                 struct listnode *fx_node;
 
+                spectrum_process(out_ctxt, &buf);
+
                 list_for_each(fx_node, &out_ctxt->effects_list) {
                     effect_context_t *fx_ctxt = node_to_item(fx_node,
                                                                 effect_context_t,
@@ -415,9 +542,9 @@ void *capture_thread_loop(void *arg __unused)
     if (capture_enabled) {
         if (pcm != NULL)
             pcm_close(pcm);
-        configure_proxy_capture(mixer, 0);
+        configure_proxy_capture(card, 0);
     }
-    mixer_close(mixer);
+    effects_mixer_release(card);
     pthread_mutex_unlock(&lock);
 
     ALOGD("thread exit");
@@ -456,6 +583,7 @@ int visualizer_hal_start_output(audio_io_handle_t output, int pcm_id,
     output_context_t *out_ctxt = (output_context_t *)malloc(sizeof(output_context_t));
     out_ctxt->handle = output;
     list_init(&out_ctxt->effects_list);
+    list_init(&out_ctxt->spectrum_taps);
 
     list_for_each(node, &created_effects_list) {
         effect_context_t *fx_ctxt = node_to_item(node,
@@ -564,39 +692,110 @@ void get_config(effect_context_t *context, effect_config_t *config)
  * Visualizer operations
  */
 
-uint32_t visualizer_get_delta_time_ms_from_updated_time(visualizer_context_t* visu_ctxt) {
+uint32_t visualizer_get_delta_time_ms_from_updated_time(uint64_t update_time_ns) {
     uint32_t delta_ms = 0;
-    if (visu_ctxt->buffer_update_time.tv_sec != 0) {
-        struct timespec ts;
-        if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
-            time_t secs = ts.tv_sec - visu_ctxt->buffer_update_time.tv_sec;
-            long nsec = ts.tv_nsec - visu_ctxt->buffer_update_time.tv_nsec;
-            if (nsec < 0) {
-                --secs;
-                nsec += 1000000000;
-            }
-            delta_ms = secs * 1000 + nsec / 1000000;
-        }
+    if (update_time_ns != 0) {
+        uint64_t now_ns = visualizer_get_time_ns();
+        if (now_ns > update_time_ns)
+            delta_ms = (now_ns - update_time_ns) / 1000000;
     }
     return delta_ms;
 }
 
+/* Called by the capture thread, or with lock held, before writing to the capture ring */
+static void visualizer_begin_capture_write(visualizer_context_t *visu_ctxt) {
+    capture_position_t *pos = &visu_ctxt->position;
+    const unsigned int seq = atomic_load_explicit(&pos->seq, memory_order_relaxed);
+
+    atomic_store_explicit(&pos->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+/* Publishes the ring content written since visualizer_begin_capture_write() */
+static void visualizer_end_capture_write(visualizer_context_t *visu_ctxt,
+                                         uint32_t frames, uint64_t time_ns) {
+    capture_position_t *pos = &visu_ctxt->position;
+    const unsigned int seq = atomic_load_explicit(&pos->seq, memory_order_relaxed);
+
+    atomic_store_explicit(&pos->frames, frames, memory_order_relaxed);
+    atomic_store_explicit(&pos->time_ns, time_ns, memory_order_relaxed);
+    atomic_store_explicit(&pos->seq, seq + 1, memory_order_release);
+}
+
+static void visualizer_read_position(visualizer_context_t *visu_ctxt,
+                                     uint32_t *frames, uint64_t *time_ns) {
+    capture_position_t *pos = &visu_ctxt->position;
+    unsigned int seq;
+
+    do {
+        seq = atomic_load_explicit(&pos->seq, memory_order_acquire);
+        *frames = atomic_load_explicit(&pos->frames, memory_order_relaxed);
+        *time_ns = atomic_load_explicit(&pos->time_ns, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+    } while ((seq & 1) != 0 || seq != atomic_load_explicit(&pos->seq, memory_order_relaxed));
+}
+
+static void visualizer_clear_measurements(visualizer_context_t *visu_ctxt) {
+    uint32_t i;
+
+    for (i = 0; i < MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS; i++)
+        atomic_store_explicit(&visu_ctxt->past_meas[i], 0, memory_order_relaxed);
+    visu_ctxt->meas_buffer_idx = 0;
+}
+
+/* Called with lock held */
+static void visualizer_detach_spectrum(visualizer_context_t *visu_ctxt) {
+    if (visu_ctxt->spectrum_tap != NULL) {
+        spectrum_put_tap(visu_ctxt->spectrum_tap);
+        visu_ctxt->spectrum_tap = NULL;
+    }
+}
+
+/* Called with lock held */
+static void visualizer_attach_spectrum(visualizer_context_t *visu_ctxt) {
+    visualizer_detach_spectrum(visu_ctxt);
+    if (visu_ctxt->output == NULL || visu_ctxt->spectrum_size == 0)
+        return;
+    visu_ctxt->spectrum_tap = spectrum_get_tap(visu_ctxt->output, visu_ctxt->spectrum_size,
+                                               __builtin_ctz(visu_ctxt->spectrum_decimation));
+    if (visu_ctxt->spectrum_tap == NULL)
+        ALOGW("%s could not create spectrum tap size %u decimation %u", __func__,
+              visu_ctxt->spectrum_size, visu_ctxt->spectrum_decimation);
+}
+
+int visualizer_start(effect_context_t *context, output_context_t *output)
+{
+    visualizer_context_t *visu_ctxt = (visualizer_context_t *)context;
+
+    visu_ctxt->output = output;
+    visualizer_attach_spectrum(visu_ctxt);
+    return 0;
+}
+
+int visualizer_stop(effect_context_t *context, output_context_t *output __unused)
+{
+    visualizer_context_t *visu_ctxt = (visualizer_context_t *)context;
+
+    visualizer_detach_spectrum(visu_ctxt);
+    visu_ctxt->output = NULL;
+    return 0;
+}
+
+/* Called with lock held: the capture thread cannot write to the ring meanwhile */
 int visualizer_reset(effect_context_t *context)
 {
     visualizer_context_t * visu_ctxt = (visualizer_context_t *)context;
 
-    visu_ctxt->capture_idx = 0;
-    visu_ctxt->last_capture_idx = 0;
-    visu_ctxt->buffer_update_time.tv_sec = 0;
-    visu_ctxt->latency = DSP_OUTPUT_LATENCY_MS;
+    visualizer_begin_capture_write(visu_ctxt);
     memset(visu_ctxt->capture_buf, 0x80, CAPTURE_BUF_SIZE);
+    visualizer_end_capture_write(visu_ctxt, 0, 0);
+    visu_ctxt->last_capture_frames = 0;
+    visu_ctxt->latency = DSP_OUTPUT_LATENCY_MS;
     return 0;
 }
 
 int visualizer_init(effect_context_t *context)
 {
-    int32_t i;
-
     visualizer_context_t * visu_ctxt = (visualizer_context_t *)context;
 
     context->config.inputCfg.accessMode = EFFECT_BUFFER_ACCESS_READ;
@@ -623,12 +822,12 @@ int visualizer_init(effect_context_t *context)
     visu_ctxt->channel_count = audio_channel_count_from_out_mask(context->config.inputCfg.channels);
     visu_ctxt->meas_mode = MEASUREMENT_MODE_NONE;
     visu_ctxt->meas_wndw_size_in_buffers = MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS;
-    visu_ctxt->meas_buffer_idx = 0;
-    for (i=0 ; i<visu_ctxt->meas_wndw_size_in_buffers ; i++) {
-        visu_ctxt->past_meas[i].is_valid = false;
-        visu_ctxt->past_meas[i].peak_u16 = 0;
-        visu_ctxt->past_meas[i].rms_squared = 0;
-    }
+    visualizer_clear_measurements(visu_ctxt);
+
+    // spectrum initialization
+    visualizer_detach_spectrum(visu_ctxt);
+    visu_ctxt->spectrum_size = 0;
+    visu_ctxt->spectrum_decimation = 1;
 
     set_config(context, &context->config);
 
@@ -651,6 +850,7 @@ int visualizer_init(effect_context_t *context)
 int visualizer_get_parameter(effect_context_t *context, effect_param_t *p, uint32_t *size)
 {
     visualizer_context_t *visu_ctxt = (visualizer_context_t *)context;
+    const uint32_t reply_size = *size;
 
     p->status = 0;
     *size = sizeof(effect_param_t) + sizeof(uint32_t);
@@ -677,6 +877,39 @@ int visualizer_get_parameter(effect_context_t *context, effect_param_t *p, uint3
         p->vsize = sizeof(uint32_t);
         *size += sizeof(uint32_t);
         break;
+    case VISUALIZER_PARAM_SPECTRUM_SIZE:
+        ALOGV("%s get spectrum_size = %d", __func__, visu_ctxt->spectrum_size);
+        *((uint32_t *)p->data + 1) = visu_ctxt->spectrum_size;
+        p->vsize = sizeof(uint32_t);
+        *size += sizeof(uint32_t);
+        break;
+    case VISUALIZER_PARAM_SPECTRUM_DECIMATION:
+        ALOGV("%s get spectrum_decimation = %d", __func__, visu_ctxt->spectrum_decimation);
+        *((uint32_t *)p->data + 1) = visu_ctxt->spectrum_decimation;
+        p->vsize = sizeof(uint32_t);
+        *size += sizeof(uint32_t);
+        break;
+    case VISUALIZER_PARAM_SPECTRUM: {
+        const uint32_t bytes = visu_ctxt->spectrum_size / 2 * sizeof(uint16_t);
+        spectrum_tap_t *tap = visu_ctxt->spectrum_tap;
+        void *bins = (uint32_t *)p->data + 1;
+
+        if (bytes == 0 || reply_size < *size + bytes) {
+            ALOGV("%s VISUALIZER_PARAM_SPECTRUM error spectrum_size %d reply size %d",
+                  __func__, visu_ctxt->spectrum_size, reply_size);
+            p->status = -EINVAL;
+            break;
+        }
+        /* return silence if the capture stopped as for VISUALIZER_CMD_CAPTURE */
+        if (tap != NULL && tap->update_ns != 0 &&
+                visualizer_get_delta_time_ms_from_updated_time(tap->update_ns) <=
+                        MAX_STALL_TIME_MS)
+            memcpy(bins, tap->bins, bytes);
+        else
+            memset(bins, 0, bytes);
+        p->vsize = bytes;
+        *size += bytes;
+        } break;
     default:
         p->status = -EINVAL;
     }
@@ -708,13 +941,33 @@ int visualizer_set_parameter(effect_context_t *context, effect_param_t *p, uint3
         visu_ctxt->meas_mode = *((uint32_t *)p->data + 1);
         ALOGV("%s set meas_mode = %d", __func__, visu_ctxt->meas_mode);
         break;
+    case VISUALIZER_PARAM_SPECTRUM_SIZE: {
+        const uint32_t spectrum_size = *((uint32_t *)p->data + 1);
+        if (spectrum_size != 0 && (spectrum_size < VISUALIZER_FFT_MIN_SIZE ||
+                spectrum_size > VISUALIZER_FFT_MAX_SIZE ||
+                (spectrum_size & (spectrum_size - 1)) != 0))
+            return -EINVAL;
+        visu_ctxt->spectrum_size = spectrum_size;
+        visualizer_attach_spectrum(visu_ctxt);
+        ALOGV("%s set spectrum_size = %d", __func__, visu_ctxt->spectrum_size);
+        } break;
+    case VISUALIZER_PARAM_SPECTRUM_DECIMATION: {
+        const uint32_t decimation = *((uint32_t *)p->data + 1);
+        if (decimation == 0 || decimation > SPECTRUM_MAX_DECIMATION ||
+                (decimation & (decimation - 1)) != 0)
+            return -EINVAL;
+        visu_ctxt->spectrum_decimation = decimation;
+        visualizer_attach_spectrum(visu_ctxt);
+        ALOGV("%s set spectrum_decimation = %d", __func__, visu_ctxt->spectrum_decimation);
+        } break;
     default:
         return -EINVAL;
     }
     return 0;
 }
 
-/* Real process function called from capture thread. Called with lock held */
+/* Real process function called from capture thread. Called with lock held.
+ * The capture ring and measurements are published for lock free readers. */
 int visualizer_process(effect_context_t *context,
                        audio_buffer_t *inBuffer,
                        audio_buffer_t *outBuffer)
@@ -731,45 +984,51 @@ int visualizer_process(effect_context_t *context,
         return -EINVAL;
     }
 
+    /* all code below assumes stereo 16 bit PCM output and input */
+    const bool measure = (visu_ctxt->meas_mode & MEASUREMENT_MODE_PEAK_RMS) != 0;
+    const bool normalize = visu_ctxt->scaling_mode == VISUALIZER_SCALING_MODE_NORMALIZED;
+    const uint32_t samples = inBuffer->frameCount * visu_ctxt->channel_count;
+    struct visualizer_stats stats;
+    uint64_t now_ns = visualizer_get_time_ns();
+
+    /* one pass gives both the measurements and the normalization peak */
+    if (measure || normalize)
+        visualizer_kernels_stats_16(inBuffer->s16, samples, &stats);
+
     // perform measurements if needed
-    if (visu_ctxt->meas_mode & MEASUREMENT_MODE_PEAK_RMS) {
-        // find the peak and RMS squared for the new buffer
-        uint32_t inIdx;
-        int16_t max_sample = 0;
-        float rms_squared_acc = 0;
-        for (inIdx = 0 ; inIdx < inBuffer->frameCount * visu_ctxt->channel_count ; inIdx++) {
-            if (inBuffer->s16[inIdx] > max_sample) {
-                max_sample = inBuffer->s16[inIdx];
-            } else if (-inBuffer->s16[inIdx] > max_sample) {
-                max_sample = -inBuffer->s16[inIdx];
-            }
-            rms_squared_acc += (inBuffer->s16[inIdx] * inBuffer->s16[inIdx]);
+    if (measure) {
+        /* reset measurements if last measurement was too long ago (which implies stored
+         * measurements aren't relevant anymore and shouldn't bias the new one) */
+        uint64_t last_ns = atomic_load_explicit(&visu_ctxt->position.time_ns,
+                                                memory_order_relaxed);
+        if (last_ns != 0 && now_ns > last_ns &&
+                now_ns - last_ns > DISCARD_MEASUREMENTS_TIME_MS * 1000000ULL) {
+            ALOGV("Discarding measurements, last measurement is %ums old",
+                  (uint32_t)((now_ns - last_ns) / 1000000));
+            visualizer_clear_measurements(visu_ctxt);
         }
+
         // store the measurement
-        visu_ctxt->past_meas[visu_ctxt->meas_buffer_idx].peak_u16 = (uint16_t)max_sample;
-        visu_ctxt->past_meas[visu_ctxt->meas_buffer_idx].rms_squared =
-                rms_squared_acc / (inBuffer->frameCount * visu_ctxt->channel_count);
-        visu_ctxt->past_meas[visu_ctxt->meas_buffer_idx].is_valid = true;
+        int32_t peak = stats.max > -stats.min ? stats.max : -stats.min;
+        float rms_squared = (float)stats.sum_squares / samples;
+        uint32_t rms_bits;
+        memcpy(&rms_bits, &rms_squared, sizeof(rms_bits));
+        atomic_store_explicit(&visu_ctxt->past_meas[visu_ctxt->meas_buffer_idx],
+                              MEAS_VALID | ((uint64_t)(uint16_t)peak << 32) | rms_bits,
+                              memory_order_relaxed);
         if (++visu_ctxt->meas_buffer_idx >= visu_ctxt->meas_wndw_size_in_buffers) {
             visu_ctxt->meas_buffer_idx = 0;
         }
     }
 
-    /* all code below assumes stereo 16 bit PCM output and input */
     int32_t shift;
 
-    if (visu_ctxt->scaling_mode == VISUALIZER_SCALING_MODE_NORMALIZED) {
+    if (normalize) {
         /* derive capture scaling factor from peak value in current buffer
-         * this gives more interesting captures for display. */
-        shift = 32;
-        int len = inBuffer->frameCount * 2;
-        int i;
-        for (i = 0; i < len; i++) {
-            int32_t smp = inBuffer->s16[i];
-            if (smp < 0) smp = -smp - 1; /* take care to keep the max negative in range */
-            int32_t clz = __builtin_clz(smp);
-            if (shift > clz) shift = clz;
-        }
+         * this gives more interesting captures for display. Take care to keep
+         * the max negative in range. */
+        int32_t peak = stats.max > -stats.min - 1 ? stats.max : -stats.min - 1;
+        shift = peak == 0 ? 32 : __builtin_clz(peak);
         /* A maximum amplitude signal will have 17 leading zeros, which we want to
          * translate to a shift of 8 (for converting 16 bit to 8 bit) */
         shift = 25 - shift;
@@ -785,28 +1044,22 @@ int visualizer_process(effect_context_t *context,
         shift = 9;
     }
 
-    uint32_t capt_idx;
-    uint32_t in_idx;
-    uint8_t *buf = visu_ctxt->capture_buf;
-    for (in_idx = 0, capt_idx = visu_ctxt->capture_idx;
-         in_idx < inBuffer->frameCount;
-         in_idx++, capt_idx++) {
-        if (capt_idx >= CAPTURE_BUF_SIZE) {
-            /* wrap around */
-            capt_idx = 0;
-        }
-        int32_t smp = inBuffer->s16[2 * in_idx] + inBuffer->s16[2 * in_idx + 1];
-        smp = smp >> shift;
-        buf[capt_idx] = ((uint8_t)smp)^0x80;
-    }
-
-    /* XXX the following two should really be atomic, though it probably doesn't
-     * matter much for visualization purposes */
-    visu_ctxt->capture_idx = capt_idx;
-    /* update last buffer update time stamp */
-    if (clock_gettime(CLOCK_MONOTONIC, &visu_ctxt->buffer_update_time) < 0) {
-        visu_ctxt->buffer_update_time.tv_sec = 0;
+    /* only this thread writes the ring position so it can be read relaxed */
+    uint32_t frames = atomic_load_explicit(&visu_ctxt->position.frames, memory_order_relaxed);
+    uint32_t capt_idx = frames % CAPTURE_BUF_SIZE;
+    uint32_t count = inBuffer->frameCount;
+
+    visualizer_begin_capture_write(visu_ctxt);
+    if (count > CAPTURE_BUF_SIZE - capt_idx) {
+        /* wrap around */
+        uint32_t tail = CAPTURE_BUF_SIZE - capt_idx;
+        visualizer_kernels_pack_8(visu_ctxt->capture_buf + capt_idx, inBuffer->s16, tail, shift);
+        visualizer_kernels_pack_8(visu_ctxt->capture_buf, inBuffer->s16 + 2 * tail,
+                                  count - tail, shift);
+    } else {
+        visualizer_kernels_pack_8(visu_ctxt->capture_buf + capt_idx, inBuffer->s16, count, shift);
     }
+    visualizer_end_capture_write(visu_ctxt, frames + count, now_ns);
 
     if (context->state != EFFECT_STATE_ACTIVE) {
         ALOGV("%s DONE inactive", __func__);
@@ -833,47 +1086,57 @@ int visualizer_command(effect_context_t * context, uint32_t cmdCode, uint32_t cm
             break;
 
         if (context->state == EFFECT_STATE_ACTIVE) {
-            int32_t latency_ms = visu_ctxt->latency;
-            const uint32_t delta_ms = visualizer_get_delta_time_ms_from_updated_time(visu_ctxt);
-            if (latency_ms < delta_ms) {
-                latency_ms = 0;
-            } else {
-                latency_ms -= delta_ms;
-            }
-            const uint32_t delta_smp = context->config.inputCfg.samplingRate * latency_ms / 1000;
-
-            int32_t capture_point = 0;
-            __builtin_sub_overflow(visu_ctxt->capture_idx, visu_ctxt->capture_size + delta_smp,
-                                   &capture_point);
-            int32_t capture_size = visu_ctxt->capture_size;
-            if (capture_point < 0) {
-                int32_t size = -capture_point;
+            const uint32_t capture_size = visu_ctxt->capture_size;
+            uint32_t frames;
+            uint64_t time_ns;
+            uint32_t delta_ms;
+            int retries = CAPTURE_READ_RETRIES;
+
+            for (;;) {
+                visualizer_read_position(visu_ctxt, &frames, &time_ns);
+
+                int32_t latency_ms = visu_ctxt->latency;
+                delta_ms = visualizer_get_delta_time_ms_from_updated_time(time_ns);
+                if (latency_ms < delta_ms) {
+                    latency_ms = 0;
+                } else {
+                    latency_ms -= delta_ms;
+                }
+                const uint32_t delta_smp =
+                        context->config.inputCfg.samplingRate * latency_ms / 1000;
+
+                /* frames count modulo 2^32, a multiple of the ring size */
+                const uint32_t start = frames - capture_size - delta_smp;
+                const uint32_t capture_point = start % CAPTURE_BUF_SIZE;
+                uint32_t size = CAPTURE_BUF_SIZE - capture_point;
                 if (size > capture_size)
                     size = capture_size;
-
-                memcpy(pReplyData,
-                       visu_ctxt->capture_buf + CAPTURE_BUF_SIZE + capture_point,
-                       size);
-                pReplyData = (void *)((size_t)pReplyData + size);
-                capture_size -= size;
-                capture_point = 0;
+                memcpy(pReplyData, visu_ctxt->capture_buf + capture_point, size);
+                memcpy((uint8_t *)pReplyData + size, visu_ctxt->capture_buf, capture_size - size);
+
+                /* the capture thread writes at most one period past the published position:
+                 * the copy is valid if that did not reach the start of the copied frames */
+                atomic_thread_fence(memory_order_acquire);
+                const uint32_t written =
+                        atomic_load_explicit(&visu_ctxt->position.frames, memory_order_relaxed)
+                        + AUDIO_CAPTURE_PERIOD_SIZE - start;
+                if (written <= CAPTURE_BUF_SIZE)
+                    break;
+                if (--retries == 0) {
+                    ALOGV("%s capture overrun", __func__);
+                    memset(pReplyData, 0x80, capture_size);
+                    break;
+                }
             }
-            memcpy(pReplyData,
-                   visu_ctxt->capture_buf + capture_point,
-                   capture_size);
-
 
             /* if audio framework has stopped playing audio although the effect is still
-             * active we must clear the capture buffer to return silence */
-            if ((visu_ctxt->last_capture_idx == visu_ctxt->capture_idx) &&
-                    (visu_ctxt->buffer_update_time.tv_sec != 0)) {
-                if (delta_ms > MAX_STALL_TIME_MS) {
-                    ALOGV("%s capture going to idle", __func__);
-                    visu_ctxt->buffer_update_time.tv_sec = 0;
-                    memset(pReplyData, 0x80, visu_ctxt->capture_size);
-                }
+             * active we must return silence */
+            if (visu_ctxt->last_capture_frames == frames && time_ns != 0 &&
+                    delta_ms > MAX_STALL_TIME_MS) {
+                ALOGV("%s capture idle", __func__);
+                memset(pReplyData, 0x80, capture_size);
             }
-            visu_ctxt->last_capture_idx = visu_ctxt->capture_idx;
+            visu_ctxt->last_capture_frames = frames;
         } else {
             memset(pReplyData, 0x80, visu_ctxt->capture_size);
         }
@@ -895,29 +1158,32 @@ int visualizer_command(effect_context_t * context, uint32_t cmdCode, uint32_t cm
         uint16_t peak_u16 = 0;
         float sum_rms_squared = 0.0f;
         uint8_t nb_valid_meas = 0;
-        /* reset measurements if last measurement was too long ago (which implies stored
-         * measurements aren't relevant anymore and shouldn't bias the new one) */
-        const int32_t delay_ms = visualizer_get_delta_time_ms_from_updated_time(visu_ctxt);
+        uint32_t frames;
+        uint64_t time_ns;
+        /* ignore measurements if last measurement was too long ago (which implies stored
+         * measurements aren't relevant anymore and shouldn't bias the new one). The capture
+         * thread discards them when it measures again. */
+        visualizer_read_position(visu_ctxt, &frames, &time_ns);
+        const int32_t delay_ms = visualizer_get_delta_time_ms_from_updated_time(time_ns);
         if (delay_ms > DISCARD_MEASUREMENTS_TIME_MS) {
-            uint32_t i;
-            ALOGV("Discarding measurements, last measurement is %dms old", delay_ms);
-            for (i=0 ; i<visu_ctxt->meas_wndw_size_in_buffers ; i++) {
-                visu_ctxt->past_meas[i].is_valid = false;
-                visu_ctxt->past_meas[i].peak_u16 = 0;
-                visu_ctxt->past_meas[i].rms_squared = 0;
-            }
-            visu_ctxt->meas_buffer_idx = 0;
+            ALOGV("Ignoring measurements, last measurement is %dms old", delay_ms);
         } else {
             /* only use actual measurements, otherwise the first RMS measure happening before
              * MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS have been played will always be artificially
              * low */
             uint32_t i;
             for (i=0 ; i < visu_ctxt->meas_wndw_size_in_buffers ; i++) {
-                if (visu_ctxt->past_meas[i].is_valid) {
-                    if (visu_ctxt->past_meas[i].peak_u16 > peak_u16) {
-                        peak_u16 = visu_ctxt->past_meas[i].peak_u16;
+                uint64_t meas = atomic_load_explicit(&visu_ctxt->past_meas[i],
+                                                     memory_order_relaxed);
+                if (meas & MEAS_VALID) {
+                    uint16_t peak = (uint16_t)(meas >> 32);
+                    uint32_t rms_bits = (uint32_t)meas;
+                    float rms_squared;
+                    memcpy(&rms_squared, &rms_bits, sizeof(rms_squared));
+                    if (peak > peak_u16) {
+                        peak_u16 = peak;
                     }
-                    sum_rms_squared += visu_ctxt->past_meas[i].rms_squared;
+                    sum_rms_squared += rms_squared;
                     nb_valid_meas++;
                 }
             }
@@ -981,6 +1247,8 @@ int effect_lib_create(const effect_uuid_t *uuid,
         context = (effect_context_t *)visu_ctxt;
         context->ops.init = visualizer_init;
         context->ops.reset = visualizer_reset;
+        context->ops.start = visualizer_start;
+        context->ops.stop = visualizer_stop;
         context->ops.process = visualizer_process;
         context->ops.set_parameter = visualizer_set_parameter;
         context->ops.get_parameter = visualizer_get_parameter;
@@ -1004,7 +1272,9 @@ int effect_lib_create(const effect_uuid_t *uuid,
     context->state = EFFECT_STATE_INITIALIZED;
 
     pthread_mutex_lock(&lock);
+    pthread_rwlock_wrlock(&effects_lock);
     list_add_tail(&created_effects_list, &context->effects_list_node);
+    pthread_rwlock_unlock(&effects_lock);
     output_context_t *out_ctxt = get_output(ioId);
     if (out_ctxt != NULL)
         add_effect_to_output(out_ctxt, context);
@@ -1032,7 +1302,9 @@ int effect_lib_release(effect_handle_t handle) {
         output_context_t *out_ctxt = get_output(context->out_handle);
         if (out_ctxt != NULL)
             remove_effect_from_output(out_ctxt, context);
+        pthread_rwlock_wrlock(&effects_lock);
         list_remove(&context->effects_list_node);
+        pthread_rwlock_unlock(&effects_lock);
         if (context->ops.release)
             context->ops.release(context);
         free(context);
@@ -1103,6 +1375,22 @@ int effect_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
     int retsize;
     int status = 0;
 
+    /* Commands to one effect handle are serialized by the framework, and capture and
+     * measurement only read what the capture thread publishes: they must not wait for
+     * the lock the capture thread holds while processing a period. effects_lock keeps
+     * the handle from being released meanwhile. */
+    if (cmdCode == VISUALIZER_CMD_CAPTURE || cmdCode == VISUALIZER_CMD_MEASURE) {
+        pthread_rwlock_rdlock(&effects_lock);
+        if (!effect_exists(context) || context->state == EFFECT_STATE_UNINITIALIZED ||
+                context->ops.command == NULL)
+            status = -EINVAL;
+        else
+            status = context->ops.command(context, cmdCode, cmdSize,
+                                          pCmdData, replySize, pReplyData);
+        pthread_rwlock_unlock(&effects_lock);
+        return status;
+    }
+
     pthread_mutex_lock(&lock);
 
     if (!effect_exists(context)) {
@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OFFLOAD_VISUALIZER_H_
+#define OFFLOAD_VISUALIZER_H_
+
+/* Proprietary parameters of libqcomvisualizer, numbered above the framework
+ * visualizer parameters of audio_effects/effect_visualizer.h.
+ *
+ * VISUALIZER_PARAM_SPECTRUM_SIZE: FFT size, 0 (default) to disable the spectrum or a power
+ *   of two from VISUALIZER_FFT_MIN_SIZE to VISUALIZER_FFT_MAX_SIZE (64 to 1024).
+ * VISUALIZER_PARAM_SPECTRUM_DECIMATION: 1 (default), 2, 4 or 8 capture frames averaged into
+ *   each FFT input sample. Bin k is at k * 48000 / (decimation * size) Hz.
+ * VISUALIZER_PARAM_SPECTRUM: read only, size / 2 uint16_t magnitudes of the last capture
+ *   period, all 0 while no audio is captured. A full scale sine centered on a bin reads
+ *   about 32767.
+ */
+#define VISUALIZER_PARAM_SPECTRUM_SIZE 0x10000
+#define VISUALIZER_PARAM_SPECTRUM_DECIMATION 0x10001
+#define VISUALIZER_PARAM_SPECTRUM 0x10002
+
+#endif /* OFFLOAD_VISUALIZER_H_ */
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Spectrum of the visualizer capture.
+
+   A real block of size N is transformed as a complex block of N / 2 points
+   made of the even and odd samples, followed by the split step that yields
+   the N / 2 lowest bins of the real transform. Samples are 16 bit and the
+   transform at most 1024 points, so the result grows to at most 2^25 and the
+   butterflies run on 32 bit integers without scaling. Twiddles are Q15 and
+   come from one table for the largest size, smaller sizes use a stride.
+*/
+
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+
+#include "visualizer_fft.h"
+
+#define FFT_TABLE_SIZE (VISUALIZER_FFT_MAX_SIZE / 2)
+
+/* cos and sin of 2 * pi * i / VISUALIZER_FFT_MAX_SIZE in Q15, for i over half a turn */
+static int16_t twiddle_cos[FFT_TABLE_SIZE];
+static int16_t twiddle_sin[FFT_TABLE_SIZE];
+
+static int16_t q15(double v)
+{
+    long r = lround(v * 32768.0);
+    return r > 32767 ? 32767 : (int16_t)r;
+}
+
+void visualizer_fft_init()
+{
+    for (int i = 0; i < FFT_TABLE_SIZE; i++) {
+        double a = 2.0 * M_PI * i / VISUALIZER_FFT_MAX_SIZE;
+        twiddle_cos[i] = q15(cos(a));
+        twiddle_sin[i] = q15(sin(a));
+    }
+}
+
+int visualizer_fft_setup(struct visualizer_fft *fft, uint32_t size)
+{
+    uint32_t half = size / 2;
+    uint32_t bits = 0;
+
+    if (size < VISUALIZER_FFT_MIN_SIZE || size > VISUALIZER_FFT_MAX_SIZE ||
+            (size & (size - 1)) != 0)
+        return -EINVAL;
+
+    while ((1u << bits) < half)
+        bits++;
+    for (uint32_t i = 0; i < half; i++) {
+        uint32_t r = 0;
+        for (uint32_t b = 0; b < bits; b++)
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        fft->bitrev[i] = r;
+    }
+    /* periodic Hann window */
+    for (uint32_t i = 0; i < size; i++)
+        fft->window[i] = q15(0.5 - 0.5 * cos(2.0 * M_PI * i / size));
+    fft->size = size;
+    return 0;
+}
+
+/* (re + i im) * (c - i s) in Q15, the twiddle e^(-i a) for a = c, s */
+#define MUL_RE(re, im, c, s) ((int32_t)(((int64_t)(re) * (c) + (int64_t)(im) * (s)) >> 15))
+#define MUL_IM(re, im, c, s) ((int32_t)(((int64_t)(im) * (c) - (int64_t)(re) * (s)) >> 15))
+
+void visualizer_fft_magnitudes(struct visualizer_fft *fft, const int16_t *history,
+                               uint32_t start, uint16_t *bins)
+{
+    const uint32_t size = fft->size;
+    const uint32_t half = size / 2;
+    const uint32_t mask = size - 1;
+    int32_t *z = fft->work;
+
+    /* window and pack even samples as real and odd samples as imaginary parts,
+     * in bit reversed order for the in place decimation in time */
+    for (uint32_t i = 0; i < half; i++) {
+        uint32_t n = 2 * i;
+        uint32_t j = fft->bitrev[i];
+        z[2 * j] = (history[(start + n) & mask] * fft->window[n]) >> 15;
+        z[2 * j + 1] = (history[(start + n + 1) & mask] * fft->window[n + 1]) >> 15;
+    }
+
+    /* radix 2 butterflies over half complex points */
+    for (uint32_t len = 2; len <= half; len <<= 1) {
+        const uint32_t stride = VISUALIZER_FFT_MAX_SIZE / len;
+        for (uint32_t base = 0; base < half; base += len) {
+            for (uint32_t k = 0; k < len / 2; k++) {
+                const int32_t c = twiddle_cos[k * stride];
+                const int32_t s = twiddle_sin[k * stride];
+                int32_t *a = z + 2 * (base + k);
+                int32_t *b = z + 2 * (base + k + len / 2);
+                int32_t tr = MUL_RE(b[0], b[1], c, s);
+                int32_t ti = MUL_IM(b[0], b[1], c, s);
+                b[0] = a[0] - tr;
+                b[1] = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+        }
+    }
+
+    /* split step: 2 X[k] = E + W^k * -i O with E = Z[k] + conj(Z[half - k])
+     * and O = Z[k] - conj(Z[half - k]) */
+    const uint32_t stride = VISUALIZER_FFT_MAX_SIZE / size;
+    /* |X| * 4 / N is the amplitude of a sine under the Hann window */
+    const float scale = 2.0f / size;
+    for (uint32_t k = 0; k < half; k++) {
+        const uint32_t m = (half - k) & (half - 1);
+        const int32_t zr = z[2 * k], zi = z[2 * k + 1];
+        const int32_t wr = z[2 * m], wi = -z[2 * m + 1];
+        const int64_t er = (int64_t)zr + wr, ei = (int64_t)zi + wi;
+        const int64_t or_ = (int64_t)zr - wr, oi = (int64_t)zi - wi;
+        const int32_t c = twiddle_cos[k * stride];
+        const int32_t s = twiddle_sin[k * stride];
+        const float xr = (float)(er + ((oi * c - or_ * s) >> 15));
+        const float xi = (float)(ei - ((or_ * c + oi * s) >> 15));
+        float mag = sqrtf(xr * xr + xi * xi) * scale;
+        bins[k] = mag > 65535.0f ? 65535 : (uint16_t)mag;
+    }
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VISUALIZER_FFT_H_
+#define VISUALIZER_FFT_H_
+
+#include <stdint.h>
+
+#define VISUALIZER_FFT_MIN_SIZE 64
+#define VISUALIZER_FFT_MAX_SIZE 1024
+
+/* Fixed point real FFT of a Hann windowed block of 16 bit samples. The state
+ * only depends on the size and holds no history: the caller keeps the samples.
+ */
+struct visualizer_fft {
+    uint32_t size;
+    int16_t window[VISUALIZER_FFT_MAX_SIZE];          /* Q15 Hann window */
+    uint16_t bitrev[VISUALIZER_FFT_MAX_SIZE / 2];     /* half size complex permutation */
+    int32_t work[VISUALIZER_FFT_MAX_SIZE];            /* interleaved re/im */
+};
+
+/* Computes the shared twiddle table. Must be called once before any setup. */
+void visualizer_fft_init();
+
+/* Prepares fft for a power of two size between the min and max sizes.
+ * Returns 0 on success or -EINVAL.
+ */
+int visualizer_fft_setup(struct visualizer_fft *fft, uint32_t size);
+
+/* Transforms the size samples of the ring history, oldest at index start, and
+ * writes size / 2 magnitudes to bins, from DC up to the bin below Nyquist.
+ * A full scale sine centered on a bin reads about 32767.
+ */
+void visualizer_fft_magnitudes(struct visualizer_fft *fft, const int16_t *history,
+                               uint32_t start, uint16_t *bins);
+
+#endif /* VISUALIZER_FFT_H_ */
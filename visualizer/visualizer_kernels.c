@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Kernels run by the visualizer capture thread on each proxy period.
+
+   As in the HAL PCM kernels, the ABI's SIMD unit (NEON on arm/arm64, SSE2
+   on x86) handles whole vectors and the scalar code finishes the tail, so
+   results are bit exact whatever path is taken.
+*/
+
+#include <stdint.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define VISUALIZER_KERNELS_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define VISUALIZER_KERNELS_SSE2
+#endif
+
+#include "visualizer_kernels.h"
+
+void visualizer_kernels_stats_16(const int16_t *src, size_t samples,
+                                 struct visualizer_stats *stats)
+{
+    int16_t min = 0;
+    int16_t max = 0;
+    uint64_t sum_squares = 0;
+    size_t i = 0;
+
+#if defined(VISUALIZER_KERNELS_NEON)
+    if (samples >= 8) {
+        int16x8_t vmin = vdupq_n_s16(0);
+        int16x8_t vmax = vdupq_n_s16(0);
+        uint64x2_t vsum = vdupq_n_u64(0);
+        int16_t lanes[8];
+        uint64_t sums[2];
+
+        for (; i + 8 <= samples; i += 8) {
+            int16x8_t v = vld1q_s16(src + i);
+            vmin = vminq_s16(vmin, v);
+            vmax = vmaxq_s16(vmax, v);
+            /* a square is at most 2^30 so it fits the unsigned 32 bit lanes */
+            vsum = vpadalq_u32(vsum,
+                    vreinterpretq_u32_s32(vmull_s16(vget_low_s16(v), vget_low_s16(v))));
+            vsum = vpadalq_u32(vsum,
+                    vreinterpretq_u32_s32(vmull_s16(vget_high_s16(v), vget_high_s16(v))));
+        }
+        vst1q_s16(lanes, vmin);
+        for (int l = 0; l < 8; l++)
+            if (lanes[l] < min) min = lanes[l];
+        vst1q_s16(lanes, vmax);
+        for (int l = 0; l < 8; l++)
+            if (lanes[l] > max) max = lanes[l];
+        vst1q_u64(sums, vsum);
+        sum_squares = sums[0] + sums[1];
+    }
+#elif defined(VISUALIZER_KERNELS_SSE2)
+    if (samples >= 8) {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i vmin = zero;
+        __m128i vmax = zero;
+        __m128i vsum = zero;
+        int16_t lanes[8];
+        uint64_t sums[2];
+
+        for (; i + 8 <= samples; i += 8) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+            vmin = _mm_min_epi16(vmin, v);
+            vmax = _mm_max_epi16(vmax, v);
+            /* a pair of squares is at most 2^31, widen it as unsigned */
+            __m128i sq = _mm_madd_epi16(v, v);
+            vsum = _mm_add_epi64(vsum, _mm_unpacklo_epi32(sq, zero));
+            vsum = _mm_add_epi64(vsum, _mm_unpackhi_epi32(sq, zero));
+        }
+        _mm_storeu_si128((__m128i *)lanes, vmin);
+        for (int l = 0; l < 8; l++)
+            if (lanes[l] < min) min = lanes[l];
+        _mm_storeu_si128((__m128i *)lanes, vmax);
+        for (int l = 0; l < 8; l++)
+            if (lanes[l] > max) max = lanes[l];
+        _mm_storeu_si128((__m128i *)sums, vsum);
+        sum_squares = sums[0] + sums[1];
+    }
+#endif
+    for (; i < samples; i++) {
+        int32_t smp = src[i];
+        if (smp < min) min = smp;
+        if (smp > max) max = smp;
+        sum_squares += (uint32_t)(smp * smp);
+    }
+
+    stats->min = min;
+    stats->max = max;
+    stats->sum_squares = sum_squares;
+}
+
+void visualizer_kernels_pack_8(uint8_t *dst, const int16_t *src, size_t frames, int shift)
+{
+    size_t i = 0;
+
+#if defined(VISUALIZER_KERNELS_NEON)
+    /* (L + R) >> shift == ((L + R) >> 1) >> (shift - 1), and the halving add
+     * cannot overflow, so the whole computation stays in 16 bit lanes */
+    const int16x8_t vshift = vdupq_n_s16(1 - shift);
+    const uint8x8_t sign = vdup_n_u8(0x80);
+    for (; i + 8 <= frames; i += 8) {
+        int16x8x2_t in = vld2q_s16(src + 2 * i);
+        int16x8_t smp = vshlq_s16(vhaddq_s16(in.val[0], in.val[1]), vshift);
+        vst1_u8(dst + i, veor_u8(vmovn_u16(vreinterpretq_u16_s16(smp)), sign));
+    }
+#elif defined(VISUALIZER_KERNELS_SSE2)
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i low_byte = _mm_set1_epi32(0xff);
+    const __m128i sign = _mm_set1_epi8((char)0x80);
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    for (; i + 8 <= frames; i += 8) {
+        __m128i lo = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+        __m128i hi = _mm_loadu_si128((const __m128i *)(src + 2 * i + 8));
+        /* madd by one sums each L/R pair into 32 bits, the mask keeps the
+         * truncation of the scalar cast through the saturating packs */
+        lo = _mm_and_si128(_mm_sra_epi32(_mm_madd_epi16(lo, ones), count), low_byte);
+        hi = _mm_and_si128(_mm_sra_epi32(_mm_madd_epi16(hi, ones), count), low_byte);
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(lo, hi), _mm_setzero_si128());
+        _mm_storel_epi64((__m128i *)(dst + i), _mm_xor_si128(packed, sign));
+    }
+#endif
+    for (; i < frames; i++) {
+        int32_t smp = (int32_t)src[2 * i] + (int32_t)src[2 * i + 1];
+        dst[i] = ((uint8_t)(smp >> shift)) ^ 0x80;
+    }
+}
+
+void visualizer_kernels_decimate_16(int16_t *dst, const int16_t *src, size_t frames_out,
+                                    uint32_t factor_log2)
+{
+    const size_t run = (size_t)2 << factor_log2;
+
+    /* the plain loop is left to the compiler's vectorizer: the tap runs on a
+     * fraction of the period and the run length varies */
+    for (size_t i = 0; i < frames_out; i++) {
+        int32_t sum = 0;
+        for (size_t j = 0; j < run; j++)
+            sum += src[j];
+        dst[i] = (int16_t)(sum >> (factor_log2 + 1));
+        src += run;
+    }
+}
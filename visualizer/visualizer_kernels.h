@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VISUALIZER_KERNELS_H_
+#define VISUALIZER_KERNELS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct visualizer_stats {
+    int16_t min;            /* smallest sample */
+    int16_t max;            /* largest sample */
+    uint64_t sum_squares;   /* exact sum of the squared samples */
+};
+
+/* Scans samples once and returns the extremes and the sum of squares.
+ * The peak magnitude is max(max, -min) and the normalization magnitude,
+ * which keeps the max negative in range, is max(max, -min - 1).
+ */
+void visualizer_kernels_stats_16(const int16_t *src, size_t samples,
+                                 struct visualizer_stats *stats);
+
+/* Sums each stereo frame of src, shifts it right arithmetically by shift
+ * (1 to 16) and stores the low 8 bits as unsigned PCM into dst.
+ */
+void visualizer_kernels_pack_8(uint8_t *dst, const int16_t *src, size_t frames, int shift);
+
+/* Averages each run of 2^factor_log2 stereo frames of src into one mono
+ * sample of dst. frames_out samples are written.
+ */
+void visualizer_kernels_decimate_16(int16_t *dst, const int16_t *src, size_t frames_out,
+                                    uint32_t factor_log2);
+
+#endif /* VISUALIZER_KERNELS_H_ */